@@ -0,0 +1,149 @@
+export module mcpplibs.llmapi:affinity;
+
+import :types;
+import std;
+
+namespace mcpplibs::llmapi {
+
+class Fnv1a {
+private:
+    std::uint64_t hash_ { 14695981039346656037ull };
+
+public:
+    Fnv1a& add(std::string_view bytes) {
+        for (unsigned char c : bytes) {
+            hash_ ^= c;
+            hash_ *= 1099511628211ull;
+        }
+        // Field separator so ("ab", "c") and ("a", "bc") differ
+        hash_ ^= 0xff;
+        hash_ *= 1099511628211ull;
+        return *this;
+    }
+
+    std::uint64_t value() const { return hash_; }
+};
+
+inline void hash_message_(Fnv1a& hash, const Message& message) {
+    hash.add(std::to_string(static_cast<int>(message.role)));
+    std::visit([&](const auto& content) {
+        using T = std::decay_t<decltype(content)>;
+        if constexpr (std::is_same_v<T, std::string>) {
+            hash.add(content);
+        } else {
+            for (const auto& part : content) {
+                std::visit([&](const auto& p) {
+                    using P = std::decay_t<decltype(p)>;
+                    if constexpr (std::is_same_v<P, TextContent>) {
+                        hash.add(p.text);
+                    } else if constexpr (std::is_same_v<P, ImageContent>) {
+                        hash.add(p.mediaType).add(p.data);
+                    } else if constexpr (std::is_same_v<P, AudioContent>) {
+                        hash.add(p.format).add(p.data);
+                    } else if constexpr (std::is_same_v<P, ToolUseContent>) {
+                        hash.add(p.name).add(p.inputJson);
+                    } else if constexpr (std::is_same_v<P, ToolResultContent>) {
+                        hash.add(p.content);
+                    }
+                }, part);
+            }
+        }
+    }, message.content);
+}
+
+} // namespace mcpplibs::llmapi
+
+export namespace mcpplibs::llmapi {
+
+// Prompt caches are per organization/key and effectively per backend, so
+// turns sharing a prefix should keep hitting the same target. Balancers with
+// affinity enabled rank targets by rendezvous hashing of the prefix
+// fingerprint and take the first one that is not saturated.
+struct AffinityPolicy {
+    bool enabled { false };
+    std::size_t prefixMessages { 1 };   // leading non-system messages hashed with system + tools
+    double maxCostRatio { 4.0 };        // RoutingProvider: skip targets costlier than this x the cheapest
+    double minHeadroom { 0.1 };         // MultiKeyProvider: skip keys with less headroom than this
+};
+
+// Prompt-cache effectiveness observed on one target
+struct CacheStats {
+    std::uint64_t requests { 0 };
+    std::uint64_t cacheHits { 0 };             // responses with cacheReadTokens > 0
+    std::uint64_t inputTokens { 0 };
+    std::uint64_t cacheReadTokens { 0 };
+    std::uint64_t cacheCreationTokens { 0 };
+
+    void record(const Usage& usage) {
+        requests++;
+        if (usage.cacheReadTokens > 0) cacheHits++;
+        inputTokens += static_cast<std::uint64_t>(std::max(usage.inputTokens, 0));
+        cacheReadTokens += static_cast<std::uint64_t>(std::max(usage.cacheReadTokens, 0));
+        cacheCreationTokens += static_cast<std::uint64_t>(std::max(usage.cacheCreationTokens, 0));
+    }
+
+    // Share of requests that read from the cache
+    double hit_rate() const {
+        return requests == 0 ? 0.0 : static_cast<double>(cacheHits) / static_cast<double>(requests);
+    }
+};
+
+// FNV-1a over the system prompt, the tool definitions and the first
+// prefixMessages non-system messages. Stable across processes.
+std::uint64_t prefix_fingerprint(const std::vector<Message>& messages, const ChatParams& params,
+                                 std::size_t prefixMessages = 1) {
+    Fnv1a hash;
+    for (const auto& message : messages) {
+        if (message.role == Role::System) hash_message_(hash, message);
+    }
+    if (params.tools) {
+        for (const auto& tool : *params.tools) {
+            hash.add(tool.name).add(tool.description).add(tool.inputSchema);
+        }
+    }
+    std::size_t hashed { 0 };
+    for (const auto& message : messages) {
+        if (hashed >= prefixMessages) break;
+        if (message.role == Role::System) continue;
+        hash_message_(hash, message);
+        hashed++;
+    }
+    return hash.value();
+}
+
+} // namespace mcpplibs::llmapi
+
+namespace mcpplibs::llmapi {
+
+inline std::uint64_t affinity_seed(std::string_view target) {
+    return Fnv1a {}.add(target).value();
+}
+
+// Weighted rendezvous (highest random weight) score of one target
+inline double rendezvous_score(std::uint64_t fingerprint, std::uint64_t seed, double weight) {
+    // splitmix64 finalizer
+    auto x = fingerprint ^ seed;
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    auto u = (static_cast<double>(x >> 11) + 0.5) / 9007199254740992.0;   // (0, 1)
+    return std::max(weight, 0.0) / -std::log(u);
+}
+
+// Target indices ordered by preference for this fingerprint
+inline std::vector<std::size_t> rendezvous_order(std::uint64_t fingerprint, std::span<const std::uint64_t> seeds,
+                                                 std::span<const double> weights) {
+    std::vector<std::pair<double, std::size_t>> scored;
+    scored.reserve(seeds.size());
+    for (std::size_t i = 0; i < seeds.size(); ++i) {
+        scored.emplace_back(rendezvous_score(fingerprint, seeds[i], i < weights.size() ? weights[i] : 1.0), i);
+    }
+    std::ranges::sort(scored, std::greater {});
+    std::vector<std::size_t> order;
+    order.reserve(scored.size());
+    for (const auto& [score, index] : scored) order.push_back(index);
+    return order;
+}
+
+} // namespace mcpplibs::llmapi
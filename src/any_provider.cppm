@@ -0,0 +1,86 @@
+export module mcpplibs.llmapi:any_provider;
+
+import :types;
+import :coro;
+import :provider;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+// Type-erased provider, so heterogeneous providers (Anthropic, OpenAI,
+// DeepSeek via OpenAI, ...) can be held in one container. Providers that are
+// not streamable get a chat_stream() that delivers the full text once.
+class AnyProvider {
+private:
+    struct Concept {
+        virtual ~Concept() = default;
+        virtual std::string_view name() const = 0;
+        virtual bool streamable() const = 0;
+        virtual ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) = 0;
+        virtual ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                                         std::function<void(std::string_view)> callback) = 0;
+    };
+
+    template<Provider P>
+    struct Model final : Concept {
+        P provider;
+
+        explicit Model(P p) : provider(std::move(p)) {}
+
+        std::string_view name() const override { return provider.name(); }
+        bool streamable() const override { return StreamableProvider<P>; }
+
+        ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) override {
+            return provider.chat(messages, params);
+        }
+
+        ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                                 std::function<void(std::string_view)> callback) override {
+            if constexpr (StreamableProvider<P>) {
+                return provider.chat_stream(messages, params, std::move(callback));
+            } else {
+                auto response = provider.chat(messages, params);
+                auto text = response.text();
+                if (!text.empty()) callback(text);
+                return response;
+            }
+        }
+    };
+
+    std::unique_ptr<Concept> impl_;
+
+public:
+    template<Provider P>
+        requires (!std::same_as<std::remove_cvref_t<P>, AnyProvider>)
+    AnyProvider(P provider)
+        : impl_(std::make_unique<Model<P>>(std::move(provider))) {}
+
+    AnyProvider(AnyProvider&&) noexcept = default;
+    AnyProvider& operator=(AnyProvider&&) noexcept = default;
+
+    // Provider concept
+    std::string_view name() const { return impl_->name(); }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        return impl_->chat(messages, params);
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback) {
+        return impl_->chat_stream(messages, params, std::move(callback));
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback) {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    bool streamable() const { return impl_->streamable(); }
+};
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,128 @@
+export module mcpplibs.llmapi:batch;
+
+import :errors;
+import :retry;
+import std;
+
+namespace mcpplibs::llmapi {
+
+// Files a batch job wrote (request shards, downloaded results); removed
+// with the job unless kept. A moved-from set owns nothing.
+class BatchFiles {
+private:
+    std::vector<std::filesystem::path> paths_;
+    bool keep_ { false };
+
+public:
+    explicit BatchFiles(bool keep) : keep_(keep) {}
+
+    BatchFiles(const BatchFiles&) = delete;
+    BatchFiles& operator=(const BatchFiles&) = delete;
+    BatchFiles(BatchFiles&& other) noexcept
+        : paths_(std::exchange(other.paths_, {}))
+        , keep_(other.keep_)
+    {}
+    BatchFiles& operator=(BatchFiles&& other) noexcept {
+        if (this != &other) {
+            remove_();
+            paths_ = std::exchange(other.paths_, {});
+            keep_ = other.keep_;
+        }
+        return *this;
+    }
+
+    ~BatchFiles() { remove_(); }
+
+    void add(std::filesystem::path path) { paths_.push_back(std::move(path)); }
+
+    bool contains(const std::filesystem::path& path) const {
+        return std::ranges::find(paths_, path) != paths_.end();
+    }
+
+private:
+    void remove_() {
+        if (keep_) return;
+        for (const auto& path : paths_) {
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+        paths_.clear();
+    }
+};
+
+// The batch calls below work on any provider whose retrieve_batch(id) and
+// cancel_batch(id) return its BatchInfo, which has an id and done()
+
+// Refresh the status of every unfinished batch
+template<typename P, typename Info>
+void poll_batches(P& provider, std::vector<Info>& batches) {
+    for (auto& batch : batches) {
+        if (!batch.done()) {
+            batch = provider.retrieve_batch(batch.id);
+        }
+    }
+}
+
+struct BatchWait {
+    std::chrono::milliseconds pollInterval;
+    std::chrono::milliseconds maxPollInterval;
+    std::chrono::milliseconds timeout;   // 0 = never
+    std::string_view what;               // names the wait in its TimeoutError
+};
+
+// Poll with exponential backoff until every batch is done; transient
+// failures while polling are retried rather than abandoning the job.
+// Throws TimeoutError once wait.timeout has passed, after one last poll at
+// the deadline; the batches keep running.
+template<typename P, typename Info>
+void wait_batches(P& provider, std::vector<Info>& batches, const BatchWait& wait) {
+    auto start = std::chrono::steady_clock::now();
+    Backoff backoff { RetryPolicy {
+        .initialBackoff = wait.pollInterval,
+        .maxBackoff = wait.maxPollInterval,
+        .multiplier = 1.5,
+    } };
+    for (int attempt = 0;; ++attempt) {
+        try {
+            poll_batches(provider, batches);
+            if (std::ranges::all_of(batches, &Info::done)) return;
+        } catch (...) {
+            if (!classify_failure(std::current_exception()).retryable) throw;
+        }
+        auto delay = std::max(wait.pollInterval, backoff.delay(attempt));
+        if (wait.timeout.count() > 0) {
+            auto left = wait.timeout - std::chrono::duration_cast<std::chrono::milliseconds>(
+                                           std::chrono::steady_clock::now() - start);
+            if (left.count() <= 0) {
+                throw TimeoutError(TimeoutPhase::Total, wait.timeout, std::string(wait.what));
+            }
+            delay = std::min(delay, left);
+        }
+        std::this_thread::sleep_for(delay);
+    }
+}
+
+template<typename P, typename Info>
+void cancel_batches(P& provider, std::vector<Info>& batches) {
+    for (auto& batch : batches) {
+        if (!batch.done()) {
+            batch = provider.cancel_batch(batch.id);
+        }
+    }
+}
+
+// Collects what forEach(handler) reports, from any number of threads, by
+// custom id; a later result for the same id replaces the earlier one
+template<typename Result, typename ForEach>
+std::map<std::string, Result> results_by_id(ForEach&& forEach) {
+    std::mutex mutex;
+    std::map<std::string, Result> results;
+    forEach([&](Result result) {
+        std::lock_guard lock { mutex };
+        auto id = result.customId;
+        results.insert_or_assign(std::move(id), std::move(result));
+    });
+    return results;
+}
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,142 @@
+export module mcpplibs.llmapi:buffers;
+
+import std;
+
+export namespace mcpplibs::llmapi {
+
+struct ReadBufferStats {
+    std::uint64_t allocated { 0 };   // buffers created
+    std::uint64_t reused { 0 };      // leases served from the pool
+    std::uint64_t dropped { 0 };     // returned oversized, freed instead of pooled
+    std::size_t leased { 0 };        // in use right now
+    std::size_t pooled { 0 };        // idle, ready for reuse
+};
+
+// Process-wide pool of fixed-size receive buffers. A connection leases one
+// only for the duration of an exchange, so idle kept-alive connections
+// hold no receive memory and 10k streams reuse a working set of buffers
+// instead of each growing its own. Thread-safe.
+class ReadBufferPool {
+public:
+    static constexpr std::size_t BLOCK_BYTES { 16 * 1024 };
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::string> free_;
+    std::size_t maxPooled_;
+    ReadBufferStats stats_;
+
+public:
+    explicit ReadBufferPool(std::size_t maxPooled = 1024) : maxPooled_(maxPooled) {}
+
+    ReadBufferPool(const ReadBufferPool&) = delete;
+    ReadBufferPool& operator=(const ReadBufferPool&) = delete;
+
+    static ReadBufferPool& shared() {
+        static ReadBufferPool pool;
+        return pool;
+    }
+
+    // An empty string with BLOCK_BYTES of capacity
+    std::string acquire() {
+        std::lock_guard lock { mutex_ };
+        stats_.leased++;
+        if (!free_.empty()) {
+            auto buffer = std::move(free_.back());
+            free_.pop_back();
+            stats_.reused++;
+            return buffer;
+        }
+        stats_.allocated++;
+        std::string buffer;
+        buffer.reserve(BLOCK_BYTES);
+        return buffer;
+    }
+
+    // Takes the buffer back. One that had to grow past the block size (a
+    // line longer than a block) is freed, so pooled memory stays bounded.
+    void release(std::string&& buffer) {
+        std::string dropped;   // freed outside the lock
+        std::lock_guard lock { mutex_ };
+        stats_.leased--;
+        if (buffer.capacity() > 2 * BLOCK_BYTES || free_.size() >= maxPooled_) {
+            stats_.dropped++;
+            dropped = std::move(buffer);
+            return;
+        }
+        buffer.clear();
+        free_.push_back(std::move(buffer));
+    }
+
+    ReadBufferStats stats() const {
+        std::lock_guard lock { mutex_ };
+        auto stats = stats_;
+        stats.pooled = free_.size();
+        return stats;
+    }
+};
+
+struct StreamMemoryStats {
+    std::size_t activeStreams { 0 };
+    std::size_t liveBytes { 0 };        // held by active streams right now
+    std::size_t peakStreamBytes { 0 };  // largest single stream seen
+    std::uint64_t streams { 0 };        // streams started
+};
+
+// Process-wide accounting of what streaming responses hold: the receive
+// buffer, accumulated text and tool-call arguments. Multiply
+// peakStreamBytes by the target concurrency to size a host.
+class StreamMemory {
+private:
+    std::atomic<std::size_t> active_ { 0 };
+    std::atomic<std::size_t> live_ { 0 };
+    std::atomic<std::size_t> peak_ { 0 };
+    std::atomic<std::uint64_t> streams_ { 0 };
+
+public:
+    static StreamMemory& shared() {
+        static StreamMemory memory;
+        return memory;
+    }
+
+    StreamMemoryStats stats() const {
+        return StreamMemoryStats {
+            .activeStreams = active_.load(std::memory_order_relaxed),
+            .liveBytes = live_.load(std::memory_order_relaxed),
+            .peakStreamBytes = peak_.load(std::memory_order_relaxed),
+            .streams = streams_.load(std::memory_order_relaxed),
+        };
+    }
+
+    // Charged by one stream for its lifetime
+    class Account {
+    private:
+        StreamMemory* memory_;
+        std::size_t bytes_ { 0 };
+
+    public:
+        explicit Account(StreamMemory& memory = StreamMemory::shared()) : memory_(&memory) {
+            memory_->active_.fetch_add(1, std::memory_order_relaxed);
+            memory_->streams_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ~Account() {
+            memory_->live_.fetch_sub(bytes_, std::memory_order_relaxed);
+            memory_->active_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        Account(const Account&) = delete;
+        Account& operator=(const Account&) = delete;
+
+        void charge(std::size_t bytes) {
+            bytes_ += bytes;
+            memory_->live_.fetch_add(bytes, std::memory_order_relaxed);
+            auto peak = memory_->peak_.load(std::memory_order_relaxed);
+            while (bytes_ > peak && !memory_->peak_.compare_exchange_weak(peak, bytes_, std::memory_order_relaxed)) {}
+        }
+
+        std::size_t bytes() const { return bytes_; }
+    };
+};
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,85 @@
+export module mcpplibs.llmapi:cancel;
+
+import :errors;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+// Cancellation and deadline of one call, set on ChatParams::cancel. Stop
+// is requested through the std::stop_source the token came from; either
+// way the call throws CancelledError and its connection is closed, so the
+// upstream stops generating.
+struct Cancellation {
+    std::stop_token token;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
+    static Cancellation after(std::chrono::milliseconds timeout, std::stop_token token = {}) {
+        return Cancellation { std::move(token), std::chrono::steady_clock::now() + timeout };
+    }
+
+    bool active() const { return token.stop_possible() || deadline.has_value(); }
+    bool stop_requested() const { return token.stop_requested(); }
+    bool expired() const { return deadline && std::chrono::steady_clock::now() >= *deadline; }
+
+    // Until the deadline, floored at zero; max() without one
+    std::chrono::milliseconds remaining() const {
+        if (!deadline) return std::chrono::milliseconds::max();
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now());
+        return std::max(left, std::chrono::milliseconds { 0 });
+    }
+
+    void check(std::string_view where) const {
+        if (stop_requested()) throw CancelledError(false, std::string(where));
+        if (expired()) throw CancelledError(true, std::string(where));
+    }
+
+    // Sleeps for `duration` unless cancelled first; false if cancelled
+    bool sleep_for(std::chrono::milliseconds duration) const {
+        auto until = std::chrono::steady_clock::now() + duration;
+        if (deadline && *deadline < until) until = *deadline;
+        std::mutex mutex;
+        std::condition_variable_any cv;
+        std::unique_lock lock { mutex };
+        cv.wait_until(lock, token, until, [] { return false; });
+        return !stop_requested() && !expired();
+    }
+};
+
+// The transport sees the cancellation of the call running on its thread
+// through this slot: providers install a CancelScope around each blocking
+// request, so the Transport signatures need not carry it.
+inline const Cancellation*& cancellation_slot() {
+    static thread_local const Cancellation* current { nullptr };
+    return current;
+}
+
+inline const Cancellation& current_cancellation() {
+    static const Cancellation none;
+    auto* current = cancellation_slot();
+    return current ? *current : none;
+}
+
+// Makes `cancel` current for this thread until destroyed. An inactive one
+// leaves an enclosing scope in place.
+class CancelScope {
+private:
+    const Cancellation* previous_;
+
+public:
+    explicit CancelScope(const Cancellation& cancel) : previous_(cancellation_slot()) {
+        if (cancel.active()) cancellation_slot() = &cancel;
+    }
+    ~CancelScope() { cancellation_slot() = previous_; }
+
+    CancelScope(const CancelScope&) = delete;
+    CancelScope& operator=(const CancelScope&) = delete;
+};
+
+} // namespace mcpplibs::llmapi
+
+namespace mcpplibs::llmapi {
+
+// How often a blocked read of a cancellable call checks its stop token
+inline constexpr std::chrono::milliseconds CANCEL_POLL { 20 };
+
+} // namespace mcpplibs::llmapi
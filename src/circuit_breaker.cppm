@@ -0,0 +1,134 @@
+export module mcpplibs.llmapi:circuit_breaker;
+
+import std;
+
+export namespace mcpplibs::llmapi {
+
+enum class CircuitState { Closed, Open, HalfOpen };
+
+struct CircuitBreakerPolicy {
+    std::size_t window { 20 };                              // most recent outcomes considered
+    std::size_t minRequests { 5 };                          // no tripping below this many outcomes
+    double failureRateThreshold { 0.5 };
+    std::chrono::milliseconds slowCallThreshold { 30000 };  // successes slower than this count as slow
+    double slowCallRateThreshold { 0.8 };
+    std::chrono::milliseconds openDuration { 30000 };       // Open -> HalfOpen after this
+    std::size_t halfOpenProbes { 1 };                       // concurrent trial requests in HalfOpen
+};
+
+// Closed/open/half-open breaker over a rolling window of outcomes. Trips on
+// error rate or slow-call rate; while open, allow() fails in O(1) so callers
+// can move on without waiting for a timeout.
+class CircuitBreaker {
+private:
+    struct Outcome {
+        bool failed;
+        bool slow;
+    };
+
+    mutable std::mutex mutex_;
+    CircuitBreakerPolicy policy_;
+    CircuitState state_ { CircuitState::Closed };
+    std::deque<Outcome> outcomes_;
+    std::chrono::steady_clock::time_point openedAt_;
+    std::size_t probesInFlight_ { 0 };
+    std::uint64_t rejected_ { 0 };
+
+public:
+    explicit CircuitBreaker(CircuitBreakerPolicy policy = {}) : policy_(policy) {}
+
+    // Acquire permission for one request. In HalfOpen only a limited number
+    // of probes are admitted; their outcome closes or re-opens the circuit.
+    bool allow() {
+        std::lock_guard lock { mutex_ };
+        if (state_ == CircuitState::Open) {
+            if (std::chrono::steady_clock::now() - openedAt_ < policy_.openDuration) {
+                rejected_++;
+                return false;
+            }
+            state_ = CircuitState::HalfOpen;
+            probesInFlight_ = 0;
+        }
+        if (state_ == CircuitState::HalfOpen) {
+            if (probesInFlight_ >= policy_.halfOpenProbes) {
+                rejected_++;
+                return false;
+            }
+            probesInFlight_++;
+        }
+        return true;
+    }
+
+    void record_success(std::chrono::milliseconds latency) {
+        std::lock_guard lock { mutex_ };
+        bool slow = latency >= policy_.slowCallThreshold;
+        if (state_ == CircuitState::HalfOpen) {
+            probesInFlight_ = probesInFlight_ > 0 ? probesInFlight_ - 1 : 0;
+            if (slow) {
+                open_();
+            } else {
+                state_ = CircuitState::Closed;
+                outcomes_.clear();
+            }
+            return;
+        }
+        push_(Outcome { .failed = false, .slow = slow });
+    }
+
+    void record_failure() {
+        std::lock_guard lock { mutex_ };
+        if (state_ == CircuitState::HalfOpen) {
+            open_();
+            return;
+        }
+        push_(Outcome { .failed = true, .slow = false });
+    }
+
+    // The request ended without telling anything about the upstream's health
+    // (a rejected request, a cancelled call, a throwing callback): frees a
+    // half-open probe without recording an outcome
+    void record_ignored() {
+        std::lock_guard lock { mutex_ };
+        if (state_ == CircuitState::HalfOpen && probesInFlight_ > 0) probesInFlight_--;
+    }
+
+    CircuitState state() const {
+        std::lock_guard lock { mutex_ };
+        if (state_ == CircuitState::Open &&
+            std::chrono::steady_clock::now() - openedAt_ >= policy_.openDuration) {
+            return CircuitState::HalfOpen;
+        }
+        return state_;
+    }
+
+    std::uint64_t rejected() const {
+        std::lock_guard lock { mutex_ };
+        return rejected_;
+    }
+
+    const CircuitBreakerPolicy& policy() const { return policy_; }
+
+private:
+    void push_(Outcome outcome) {
+        outcomes_.push_back(outcome);
+        while (outcomes_.size() > policy_.window) outcomes_.pop_front();
+        if (state_ != CircuitState::Closed || outcomes_.size() < policy_.minRequests) return;
+
+        auto total = static_cast<double>(outcomes_.size());
+        auto failures = static_cast<double>(std::ranges::count_if(outcomes_, &Outcome::failed));
+        auto slow = static_cast<double>(std::ranges::count_if(outcomes_, &Outcome::slow));
+        if (failures / total >= policy_.failureRateThreshold ||
+            slow / total >= policy_.slowCallRateThreshold) {
+            open_();
+        }
+    }
+
+    void open_() {
+        state_ = CircuitState::Open;
+        openedAt_ = std::chrono::steady_clock::now();
+        probesInFlight_ = 0;
+        outcomes_.clear();
+    }
+};
+
+} // namespace mcpplibs::llmapi
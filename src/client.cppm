@@ -72,6 +72,12 @@ public:
         conversation_.push(Message::assistant(response.text()));
         co_return response;
     }
+    Task<ChatResponse> chat_async(std::string_view userMessage, ChatParams params) {
+        conversation_.push(Message::user(userMessage));
+        auto response = provider_.chat(conversation_.messages, params);
+        conversation_.push(Message::assistant(response.text()));
+        co_return response;
+    }
 
     // Streaming (requires StreamableProvider)
     ChatResponse chat_stream(std::string_view userMessage,
@@ -80,7 +86,16 @@ public:
     {
         conversation_.push(Message::user(userMessage));
         auto response = provider_.chat_stream(conversation_.messages, defaultParams_, std::move(callback));
-        conversation_.push(Message::assistant(response.text()));
+        push_streamed_(response, defaultParams_);
+        return response;
+    }
+    ChatResponse chat_stream(std::string_view userMessage, ChatParams params,
+                             std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        conversation_.push(Message::user(userMessage));
+        auto response = provider_.chat_stream(conversation_.messages, params, std::move(callback));
+        push_streamed_(response, params);
         return response;
     }
 
@@ -90,7 +105,16 @@ public:
     {
         conversation_.push(Message::user(userMessage));
         auto response = provider_.chat_stream(conversation_.messages, defaultParams_, std::move(callback));
-        conversation_.push(Message::assistant(response.text()));
+        push_streamed_(response, defaultParams_);
+        co_return response;
+    }
+    Task<ChatResponse> chat_stream_async(std::string_view userMessage, ChatParams params,
+                                          std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        conversation_.push(Message::user(userMessage));
+        auto response = provider_.chat_stream(conversation_.messages, params, std::move(callback));
+        push_streamed_(response, params);
         co_return response;
     }
 
@@ -115,6 +139,15 @@ public:
     // Provider access
     const P& provider() const { return provider_; }
     P& provider() { return provider_; }
+
+private:
+    // With accumulateStream off the response carries no text, so there is
+    // no assistant turn to record; the caller appends its own copy if needed.
+    void push_streamed_(const ChatResponse& response, const ChatParams& params) {
+        if (params.accumulateStream) {
+            conversation_.push(Message::assistant(response.text()));
+        }
+    }
 };
 
 Client(openai::Config) -> Client<openai::OpenAI>;
@@ -0,0 +1,242 @@
+export module mcpplibs.llmapi:combinators;
+
+import :coro;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+// What a Task<T> yields inside a combinator result: void becomes monostate
+template<typename T>
+using TaskResult = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+namespace detail {
+
+// Joins a set of branches: the awaiting coroutine counts as one extra
+// arrival, so branches that finish while the others are still being
+// started cannot resume it early
+class Countdown {
+private:
+    std::atomic<std::size_t> remaining_;
+    std::coroutine_handle<> continuation_;
+
+public:
+    explicit Countdown(std::size_t branches) : remaining_(branches + 1) {}
+
+    void set_continuation(std::coroutine_handle<> continuation) { continuation_ = continuation; }
+
+    // Whoever arrives last resumes the awaiter
+    std::coroutine_handle<> arrive() noexcept {
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) return continuation_;
+        return std::noop_coroutine();
+    }
+};
+
+// One awaited task inside a combinator. Started explicitly, reports to the
+// countdown when done, never throws (the body stores the exception).
+class Branch {
+public:
+    struct promise_type {
+        Countdown* countdown { nullptr };
+
+        Branch get_return_object() {
+            return Branch { std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept {
+            struct Arrive {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    return h.promise().countdown->arrive();
+                }
+                void await_resume() const noexcept {}
+            };
+            return Arrive {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+
+public:
+    explicit Branch(std::coroutine_handle<promise_type> h) : handle_(h) {}
+    ~Branch() { if (handle_) handle_.destroy(); }
+    Branch(Branch&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Branch& operator=(Branch&&) = delete;
+    Branch(const Branch&) = delete;
+
+    void start(Countdown& countdown) {
+        handle_.promise().countdown = &countdown;
+        handle_.resume();
+    }
+};
+
+// co_await join(branches) starts every branch and resumes once all are done
+inline auto join(std::span<Branch> branches) {
+    struct Awaiter {
+        std::span<Branch> branches;
+        Countdown countdown;
+
+        bool await_ready() const noexcept { return branches.empty(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) {
+            countdown.set_continuation(awaiter);
+            for (auto& branch : branches) branch.start(countdown);
+            return countdown.arrive();
+        }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter { branches, Countdown { branches.size() } };
+}
+
+template<typename T>
+Branch collect(Task<T>& task, std::optional<TaskResult<T>>& slot, std::exception_ptr& error) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+            slot.emplace();
+        } else {
+            slot.emplace(co_await task);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+}
+
+inline constexpr std::size_t NO_WINNER { std::numeric_limits<std::size_t>::max() };
+
+// The first branch to succeed claims the win, stores its value and stops
+// the rest
+template<typename T>
+Branch race(Task<T>& task, std::size_t index, std::atomic<std::size_t>& winner,
+            std::optional<TaskResult<T>>& value, std::exception_ptr& error, std::stop_source& stop) {
+    auto claim = [&] {
+        auto expected = NO_WINNER;
+        return winner.compare_exchange_strong(expected, index, std::memory_order_acq_rel);
+    };
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await task;
+            if (!claim()) co_return;
+            value.emplace();
+        } else {
+            auto result = co_await task;
+            if (!claim()) co_return;
+            value.emplace(std::move(result));
+        }
+        stop.request_stop();
+    } catch (...) {
+        error = std::current_exception();
+    }
+}
+
+inline void rethrow_first(const std::vector<std::exception_ptr>& errors) {
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+} // namespace detail
+
+// Awaits every task; they run concurrently as far as they suspend (on I/O or
+// by moving to an executor). Once all have finished, the first failure in
+// argument order is rethrown, otherwise the results come back in order.
+template<typename... Ts>
+Task<std::tuple<TaskResult<Ts>...>> when_all(Task<Ts>... tasks) {
+    std::tuple<std::optional<TaskResult<Ts>>...> slots;
+    std::vector<std::exception_ptr> errors(sizeof...(Ts));
+    auto branches = [&]<std::size_t... I>(std::index_sequence<I...>) {
+        auto all = std::forward_as_tuple(tasks...);
+        std::vector<detail::Branch> out;
+        out.reserve(sizeof...(Ts));
+        (out.push_back(detail::collect(std::get<I>(all), std::get<I>(slots), errors[I])), ...);
+        return out;
+    }(std::index_sequence_for<Ts...> {});
+    co_await detail::join(branches);
+    detail::rethrow_first(errors);
+    co_return std::apply([](auto&... slot) { return std::tuple<TaskResult<Ts>...>(std::move(*slot)...); }, slots);
+}
+
+template<typename T>
+Task<std::vector<TaskResult<T>>> when_all(std::vector<Task<T>> tasks) {
+    std::vector<std::optional<TaskResult<T>>> slots(tasks.size());
+    std::vector<std::exception_ptr> errors(tasks.size());
+    std::vector<detail::Branch> branches;
+    branches.reserve(tasks.size());
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        branches.push_back(detail::collect(tasks[i], slots[i], errors[i]));
+    }
+    co_await detail::join(branches);
+    detail::rethrow_first(errors);
+    std::vector<TaskResult<T>> results;
+    results.reserve(slots.size());
+    for (auto& slot : slots) results.push_back(std::move(*slot));
+    co_return results;
+}
+
+template<typename T>
+struct WhenAnyResult {
+    std::size_t index;      // of the winning task
+    TaskResult<T> value;
+};
+
+// Resolves with the first task to succeed and requests `stop` so the losers
+// can wind down: tasks built with stop.get_token() see it. The losers are
+// still awaited to completion before this returns, so nothing they
+// reference is left dangling, and this returns only as fast as the slowest
+// loser stops. A loser that cannot be stopped (a request on the default
+// tinyhttps https path, or a task that ignores the token) holds it up for
+// its full length. If every task fails, the first failure is rethrown.
+template<typename T>
+Task<WhenAnyResult<T>> when_any(std::vector<Task<T>> tasks, std::stop_source stop = {}) {
+    if (tasks.empty()) throw std::invalid_argument("when_any: no tasks");
+    std::atomic<std::size_t> winner { detail::NO_WINNER };
+    std::optional<TaskResult<T>> value;
+    std::vector<std::exception_ptr> errors(tasks.size());
+    std::vector<detail::Branch> branches;
+    branches.reserve(tasks.size());
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        branches.push_back(detail::race(tasks[i], i, winner, value, errors[i], stop));
+    }
+    co_await detail::join(branches);
+    auto index = winner.load(std::memory_order_acquire);
+    if (index == detail::NO_WINNER) detail::rethrow_first(errors);
+    co_return WhenAnyResult<T> { index, std::move(*value) };
+}
+
+// Runs fn(item) for every item with at most `limit` calls in flight. Each
+// of the `limit` workers first moves to `executor`, so blocking provider
+// calls spread over its threads. After a failure no new items are started;
+// the first failure is rethrown once the running calls have finished.
+template<Executor E, typename T, typename F>
+    requires std::invocable<F&, T&>
+Task<void> for_each_async(E& executor, std::vector<T> items, std::size_t limit, F fn) {
+    std::atomic<std::size_t> next { 0 };
+    std::atomic<bool> failed { false };
+    auto worker = [&]() -> Task<void> {
+        co_await schedule_on(executor);
+        for (auto i = next++; i < items.size() && !failed; i = next++) {
+            try {
+                co_await fn(items[i]);
+            } catch (...) {
+                failed = true;
+                throw;
+            }
+        }
+    };
+    std::vector<Task<void>> workers;
+    for (std::size_t i = 0; i < std::min(std::max<std::size_t>(limit, 1), items.size()); ++i) {
+        workers.push_back(worker());
+    }
+    co_await when_all(std::move(workers));
+}
+
+// Without an executor the calls interleave only where fn itself suspends
+template<typename T, typename F>
+    requires std::invocable<F&, T&>
+Task<void> for_each_async(std::vector<T> items, std::size_t limit, F fn) {
+    InlineExecutor executor;
+    co_await for_each_async(executor, std::move(items), limit, std::move(fn));
+}
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,140 @@
+module;
+
+#include <zlib.h>
+#include <zstd.h>
+
+export module mcpplibs.llmapi:compression;
+
+import std;
+
+export namespace mcpplibs::llmapi {
+
+// Sent as Accept-Encoding on requests the transport can decode
+inline constexpr std::string_view ACCEPT_ENCODING { "zstd, gzip, deflate" };
+
+enum class ContentEncoding { Identity, Gzip, Deflate, Zstd };
+
+// nullopt for codings this library cannot decode
+std::optional<ContentEncoding> parse_content_encoding(std::string_view name) {
+    auto lower = std::string(name);
+    std::ranges::transform(lower, lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    while (lower.ends_with(' ')) lower.pop_back();
+    while (lower.starts_with(' ')) lower.erase(0, 1);
+    if (lower.empty() || lower == "identity") return ContentEncoding::Identity;
+    if (lower == "gzip" || lower == "x-gzip") return ContentEncoding::Gzip;
+    if (lower == "deflate") return ContentEncoding::Deflate;
+    if (lower == "zstd") return ContentEncoding::Zstd;
+    return std::nullopt;
+}
+
+// Streaming decoder for one response body. Compressed bytes go in through
+// feed() in whatever pieces the socket delivers; decoded bytes come out in
+// pieces of at most OUTPUT_BYTES as soon as they are available, so SSE
+// events are not held back until the body ends. Concatenated gzip members
+// and zstd frames are decoded in sequence.
+class Decompressor {
+public:
+    static constexpr std::size_t OUTPUT_BYTES { 64 * 1024 };
+    using Output = std::function<bool(std::string_view)>;
+
+private:
+    ContentEncoding encoding_;
+    z_stream zlib_ {};
+    ZSTD_DStream* zstd_ { nullptr };
+    std::string output_;
+    bool finished_ { false };   // the last member/frame is complete
+
+public:
+    explicit Decompressor(ContentEncoding encoding) : encoding_(encoding) {
+        output_.resize(OUTPUT_BYTES);
+        switch (encoding_) {
+            case ContentEncoding::Identity:
+                break;
+            case ContentEncoding::Gzip:
+            case ContentEncoding::Deflate:
+                // 15 + 32: zlib or gzip wrapper, detected from the header
+                if (inflateInit2(&zlib_, 15 + 32) != Z_OK) {
+                    throw std::runtime_error("inflateInit2 failed");
+                }
+                break;
+            case ContentEncoding::Zstd:
+                zstd_ = ZSTD_createDStream();
+                if (zstd_ == nullptr) throw std::runtime_error("ZSTD_createDStream failed");
+                break;
+        }
+    }
+
+    ~Decompressor() {
+        if (encoding_ == ContentEncoding::Gzip || encoding_ == ContentEncoding::Deflate) {
+            inflateEnd(&zlib_);
+        }
+        if (zstd_) ZSTD_freeDStream(zstd_);
+    }
+
+    Decompressor(const Decompressor&) = delete;
+    Decompressor& operator=(const Decompressor&) = delete;
+
+    ContentEncoding encoding() const { return encoding_; }
+
+    // Decodes `data` and hands the result to `out`; false once `out` asks to
+    // stop. Throws std::runtime_error on corrupt input.
+    bool feed(std::string_view data, const Output& out) {
+        switch (encoding_) {
+            case ContentEncoding::Identity:
+                return data.empty() || out(data);
+            case ContentEncoding::Gzip:
+            case ContentEncoding::Deflate:
+                return inflate_(data, out);
+            case ContentEncoding::Zstd:
+                return decompress_zstd_(data, out);
+        }
+        return true;
+    }
+
+    // Whether everything fed so far forms complete members/frames; a body
+    // that ends while this is false was truncated
+    bool finished() const { return encoding_ == ContentEncoding::Identity || finished_; }
+
+private:
+    bool inflate_(std::string_view data, const Output& out) {
+        zlib_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        zlib_.avail_in = static_cast<uInt>(data.size());
+        for (;;) {
+            if (finished_) {
+                if (zlib_.avail_in == 0) return true;
+                inflateReset(&zlib_);   // next gzip member
+                finished_ = false;
+            }
+            zlib_.next_out = reinterpret_cast<Bytef*>(output_.data());
+            zlib_.avail_out = static_cast<uInt>(output_.size());
+            auto status = ::inflate(&zlib_, Z_SYNC_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("inflate failed: ") + (zlib_.msg ? zlib_.msg : "corrupt data"));
+            }
+            auto produced = output_.size() - zlib_.avail_out;
+            if (produced > 0 && !out(std::string_view(output_.data(), produced))) return false;
+            if (status == Z_STREAM_END) {
+                finished_ = true;
+            } else if (status == Z_BUF_ERROR || (zlib_.avail_in == 0 && zlib_.avail_out > 0)) {
+                return true;   // needs more input
+            }
+        }
+    }
+
+    bool decompress_zstd_(std::string_view data, const Output& out) {
+        ZSTD_inBuffer input { data.data(), data.size(), 0 };
+        for (;;) {
+            ZSTD_outBuffer output { output_.data(), output_.size(), 0 };
+            auto hint = ZSTD_decompressStream(zstd_, &output, &input);
+            if (ZSTD_isError(hint)) {
+                throw std::runtime_error(std::string("zstd decompression failed: ") + ZSTD_getErrorName(hint));
+            }
+            finished_ = hint == 0;
+            if (output.pos > 0 && !out(std::string_view(output_.data(), output.pos))) return false;
+            // A full output buffer may hold back more data even with no input left
+            if (input.pos == input.size && output.pos < output.size) return true;
+        }
+    }
+};
+
+} // namespace mcpplibs::llmapi
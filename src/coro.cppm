@@ -4,20 +4,77 @@ import std;
 
 export namespace mcpplibs::llmapi {
 
+namespace detail {
+
+// Signalled by a task that finishes with nobody awaiting it, so get() can
+// block until a task that moved to another thread is done
+struct CompletionLatch {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done { false };
+
+    void set() {
+        std::lock_guard lock { mutex };
+        done = true;
+        cv.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock lock { mutex };
+        cv.wait(lock, [&] { return done; });
+    }
+};
+
+// What Task<T> and Task<void> promises share: lazy start, the awaiting
+// coroutine to transfer to at the end, and the exception if any
+struct PromiseBase {
+    std::coroutine_handle<> continuation;
+    CompletionLatch* latch { nullptr };
+    std::exception_ptr exception;
+
+    // Symmetric transfer back to the awaiter: no resume() nested on the
+    // stack, so arbitrarily long co_await chains run in constant stack
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template<typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+            auto& promise = h.promise();
+            if (promise.continuation) return promise.continuation;
+            // The frame may be destroyed by the waiter as soon as the latch is set
+            if (auto* latch = promise.latch) latch->set();
+            return std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+};
+
+// Runs a not-yet-started task on the calling thread until it suspends,
+// then blocks until it finishes wherever it was resumed
+template<typename P>
+void run_to_completion(std::coroutine_handle<P> handle) {
+    if (handle.done()) return;
+    CompletionLatch latch;
+    handle.promise().latch = &latch;
+    handle.resume();
+    latch.wait();
+}
+
+} // namespace detail
+
 template<typename T>
 class Task {
 public:
-    struct promise_type {
+    struct promise_type : detail::PromiseBase {
         std::optional<T> value;
-        std::exception_ptr exception;
 
         Task get_return_object() {
             return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
         }
-        std::suspend_always initial_suspend() noexcept { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
         void return_value(T val) { value = std::move(val); }
-        void unhandled_exception() { exception = std::current_exception(); }
     };
 
 private:
@@ -39,11 +96,12 @@ public:
     Task(const Task&) = delete;
     Task& operator=(const Task&) = delete;
 
-    // Awaitable
+    // Awaitable: starts the task and resumes the awaiter when it finishes,
+    // on whichever thread that happens
     bool await_ready() const noexcept { return handle_.done(); }
-    void await_suspend(std::coroutine_handle<> awaiter) noexcept {
-        handle_.resume();
-        awaiter.resume();
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        handle_.promise().continuation = awaiter;
+        return handle_;
     }
     T await_resume() {
         if (handle_.promise().exception)
@@ -51,12 +109,10 @@ public:
         return std::move(*handle_.promise().value);
     }
 
-    // Sync get
+    // Sync get: blocks until done, also when the task hopped to an executor
     T get() {
-        if (!handle_.done()) handle_.resume();
-        if (handle_.promise().exception)
-            std::rethrow_exception(handle_.promise().exception);
-        return std::move(*handle_.promise().value);
+        detail::run_to_completion(handle_);
+        return await_resume();
     }
 };
 
@@ -64,15 +120,11 @@ public:
 template<>
 class Task<void> {
 public:
-    struct promise_type {
-        std::exception_ptr exception;
+    struct promise_type : detail::PromiseBase {
         Task get_return_object() {
             return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
         }
-        std::suspend_always initial_suspend() noexcept { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
         void return_void() noexcept {}
-        void unhandled_exception() { exception = std::current_exception(); }
     };
 
 private:
@@ -93,19 +145,112 @@ public:
     Task& operator=(const Task&) = delete;
 
     bool await_ready() const noexcept { return handle_.done(); }
-    void await_suspend(std::coroutine_handle<> awaiter) noexcept {
-        handle_.resume();
-        awaiter.resume();
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        handle_.promise().continuation = awaiter;
+        return handle_;
     }
     void await_resume() {
         if (handle_.promise().exception)
             std::rethrow_exception(handle_.promise().exception);
     }
     void get() {
-        if (!handle_.done()) handle_.resume();
-        if (handle_.promise().exception)
-            std::rethrow_exception(handle_.promise().exception);
+        detail::run_to_completion(handle_);
+        await_resume();
     }
 };
 
+// Runs the task to completion and returns its result; the calling thread
+// blocks while the task runs on other executors
+template<typename T>
+T sync_wait(Task<T> task) {
+    return task.get();
+}
+
+// Something that resumes coroutines, now or later, on some thread
+template<typename E>
+concept Executor = requires(E& executor, std::coroutine_handle<> handle) {
+    executor.post(handle);
+};
+
+// Resumes on the posting thread: the default, synchronous behavior
+struct InlineExecutor {
+    void post(std::coroutine_handle<> handle) { handle.resume(); }
+};
+
+// Fixed set of worker threads resuming posted coroutines in FIFO order.
+// The destructor runs what is still queued, then joins.
+class ThreadPool {
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> queue_;
+    bool stopping_ { false };
+    std::vector<std::jthread> workers_;
+
+public:
+    explicit ThreadPool(std::size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+        workers_.reserve(threads);
+        for (std::size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { run_(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock { mutex_ };
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        workers_.clear();   // joins
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // One worker per core, created on first use
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    void post(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard lock { mutex_ };
+            queue_.push_back(handle);
+        }
+        cv_.notify_one();
+    }
+
+    std::size_t size() const { return workers_.size(); }
+
+private:
+    void run_() {
+        for (;;) {
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock lock { mutex_ };
+                cv_.wait(lock, [&] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return;
+                handle = queue_.front();
+                queue_.pop_front();
+            }
+            handle.resume();
+        }
+    }
+};
+
+// `co_await schedule_on(pool);` continues the coroutine on the executor
+template<Executor E>
+auto schedule_on(E& executor) {
+    struct Awaiter {
+        E& executor;
+        bool await_ready() const noexcept { return false; }
+        // Nothing in the frame is touched after post(): another thread may
+        // already be running the coroutine
+        void await_suspend(std::coroutine_handle<> handle) { executor.post(handle); }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter { executor };
+}
+
 } // namespace mcpplibs::llmapi
@@ -0,0 +1,239 @@
+export module mcpplibs.llmapi:dispatch;
+
+import :types;
+import :provider;
+import :affinity;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+struct BatchRequest {
+    std::vector<Message> messages;
+    ChatParams params;
+};
+
+struct BatchResult {
+    std::optional<ChatResponse> response;
+    std::exception_ptr error;
+
+    bool ok() const { return response.has_value(); }
+};
+
+enum class PrimeMode {
+    FirstRequest,     // the first request of a group writes the cache
+    PrimingRequest,   // a prime_cache() call writes it (if the provider has one)
+};
+
+struct DispatchPolicy {
+    std::size_t concurrency { 8 };                     // worker threads, one provider each
+    PrimeMode prime { PrimeMode::FirstRequest };
+    std::size_t minPrefixChars { 4096 };               // ~1024 tokens, the smallest cacheable prefix
+    std::chrono::milliseconds holdTimeout { 60000 };   // release held requests even if priming stalls
+};
+
+struct DispatchStats {
+    std::size_t groups { 0 };      // shared prefixes that were primed
+    std::size_t held { 0 };        // requests held until their prefix was cached
+    std::size_t primingRequests { 0 };
+};
+
+// Runs a batch on a pool of providers (one per worker, see Concurrency Model)
+// and avoids a thundering herd of cache misses: requests sharing a large
+// system + tools prefix are grouped; one request per group goes first and
+// the rest are held until it starts streaming (the cache entry exists from
+// then on) or completes. Unrelated requests are not held.
+template<Provider P>
+class BurstDispatcher {
+private:
+    struct Group {
+        bool open { false };
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    struct Job {
+        std::size_t index;               // into the batch; for priming, the group's first request
+        std::optional<std::size_t> group;
+        bool leader { false };
+        bool priming { false };
+    };
+
+    std::function<P()> factory_;
+    DispatchPolicy policy_;
+    DispatchStats stats_;
+
+public:
+    explicit BurstDispatcher(std::function<P()> factory, DispatchPolicy policy = {})
+        : factory_(std::move(factory)), policy_(policy) {}
+
+    // Results are in batch order; a failed request carries its exception
+    std::vector<BatchResult> run(const std::vector<BatchRequest>& batch) {
+        stats_ = {};
+        std::vector<BatchResult> results(batch.size());
+        std::vector<Group> groups;
+        std::deque<Job> pending = plan_(batch, groups);
+
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        auto open = [&](std::size_t group) {
+            {
+                std::lock_guard lock { mutex };
+                groups[group].open = true;
+            }
+            cv.notify_all();
+        };
+
+        // Next job whose group is open (or whose hold expired); false when done
+        auto next = [&](Job& job) {
+            std::unique_lock lock { mutex };
+            while (true) {
+                if (pending.empty()) return false;
+                auto now = std::chrono::steady_clock::now();
+                auto earliest = std::chrono::steady_clock::time_point::max();
+                for (auto it = pending.begin(); it != pending.end(); ++it) {
+                    if (!it->group || it->leader || groups[*it->group].open ||
+                        now >= groups[*it->group].deadline) {
+                        job = *it;
+                        pending.erase(it);
+                        return true;
+                    }
+                    earliest = std::min(earliest, groups[*it->group].deadline);
+                }
+                cv.wait_until(lock, earliest);
+            }
+        };
+
+        // Providers are built here so a throwing factory surfaces to the caller
+        auto workers = std::min(std::max<std::size_t>(policy_.concurrency, 1), std::max<std::size_t>(pending.size(), 1));
+        std::vector<P> providers;
+        providers.reserve(workers);
+        for (std::size_t i = 0; i < workers; ++i) {
+            providers.push_back(factory_());
+        }
+
+        {
+            std::vector<std::jthread> threads;
+            for (auto& provider : providers) {
+                threads.emplace_back([&] {
+                    Job job;
+                    while (next(job)) {
+                        execute_(provider, batch, results, job, open);
+                    }
+                });
+            }
+        }
+        return results;
+    }
+
+    const DispatchStats& stats() const { return stats_; }
+    const DispatchPolicy& policy() const { return policy_; }
+
+private:
+    static std::size_t prefix_chars_(const BatchRequest& request) {
+        std::size_t chars { 0 };
+        for (const auto& message : request.messages) {
+            if (message.role != Role::System) continue;
+            if (auto* text = std::get_if<std::string>(&message.content)) {
+                chars += text->size();
+            } else if (auto* parts = std::get_if<std::vector<ContentPart>>(&message.content)) {
+                for (const auto& part : *parts) {
+                    if (auto* t = std::get_if<TextContent>(&part)) chars += t->text.size();
+                }
+            }
+        }
+        if (request.params.tools) {
+            for (const auto& tool : *request.params.tools) {
+                chars += tool.name.size() + tool.description.size() + tool.inputSchema.size();
+            }
+        }
+        return chars;
+    }
+
+    // Group requests by system + tools fingerprint; leaders (or priming
+    // requests) are queued first so they are never stuck behind held jobs.
+    std::deque<Job> plan_(const std::vector<BatchRequest>& batch, std::vector<Group>& groups) {
+        std::map<std::uint64_t, std::vector<std::size_t>> byPrefix;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (prefix_chars_(batch[i]) < policy_.minPrefixChars) continue;
+            byPrefix[prefix_fingerprint(batch[i].messages, batch[i].params, 0)].push_back(i);
+        }
+
+        std::deque<Job> leaders;
+        std::deque<Job> rest;
+        std::vector<bool> grouped(batch.size(), false);
+        auto deadline = std::chrono::steady_clock::now() + policy_.holdTimeout;
+        for (const auto& [fingerprint, members] : byPrefix) {
+            if (members.size() < 2) continue;
+            auto group = groups.size();
+            groups.push_back(Group { .deadline = deadline });
+            stats_.groups++;
+
+            bool priming = policy_.prime == PrimeMode::PrimingRequest && CachePrimableProvider<P>;
+            if (priming) {
+                leaders.push_back(Job { .index = members.front(), .group = group, .leader = true, .priming = true });
+                stats_.primingRequests++;
+            }
+            for (std::size_t k = 0; k < members.size(); ++k) {
+                grouped[members[k]] = true;
+                bool leader = !priming && k == 0;
+                (leader ? leaders : rest).push_back(Job { .index = members[k], .group = group, .leader = leader });
+                if (!leader) stats_.held++;
+            }
+        }
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (!grouped[i]) rest.push_back(Job { .index = i });
+        }
+        std::ranges::move(rest, std::back_inserter(leaders));
+        return leaders;
+    }
+
+    template<typename Open>
+    static void execute_(P& provider, const std::vector<BatchRequest>& batch, std::vector<BatchResult>& results,
+                         const Job& job, Open&& open) {
+        if (job.priming) {
+            // Cache the group's shared system prompt and tools
+            const auto& request = batch[job.index];
+            try {
+                if constexpr (CachePrimableProvider<P>) {
+                    std::vector<Message> prefix;
+                    for (const auto& message : request.messages) {
+                        if (message.role == Role::System) prefix.push_back(message);
+                    }
+                    provider.prime_cache(prefix, request.params.tools.value_or(std::vector<ToolDef> {}));
+                }
+            } catch (...) {
+                // Priming is an optimization; the real requests still run
+            }
+            open(*job.group);
+            return;
+        }
+
+        const auto& request = batch[job.index];
+        auto& result = results[job.index];
+        try {
+            if constexpr (StreamableProvider<P>) {
+                if (job.leader) {
+                    bool started = false;
+                    result.response = provider.chat_stream(request.messages, request.params,
+                        [&](std::string_view) {
+                            if (!started) {
+                                started = true;
+                                open(*job.group);
+                            }
+                        });
+                } else {
+                    result.response = provider.chat(request.messages, request.params);
+                }
+            } else {
+                result.response = provider.chat(request.messages, request.params);
+            }
+        } catch (...) {
+            result.error = std::current_exception();
+        }
+        if (job.leader) {
+            open(*job.group);
+        }
+    }
+};
+
+} // namespace mcpplibs::llmapi
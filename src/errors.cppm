@@ -1,5 +1,6 @@
 export module mcpplibs.llmapi:errors;
 
+import mcpplibs.llmapi.nlohmann.json;
 import std;
 
 export namespace mcpplibs::llmapi {
@@ -10,13 +11,23 @@ public:
     int statusCode;
     std::string type;
     std::string body;
+    std::optional<std::chrono::milliseconds> retryAfter;   // from Retry-After / retry-after-ms
 
-    ApiError(int status, std::string errorType, std::string errorBody, const std::string& message)
+    ApiError(int status, std::string errorType, std::string errorBody, const std::string& message,
+             std::optional<std::chrono::milliseconds> retryAfterHint = std::nullopt)
         : std::runtime_error(message)
         , statusCode(status)
         , type(std::move(errorType))
         , body(std::move(errorBody))
+        , retryAfter(retryAfterHint)
     {}
+
+    // 408/409/429 and 5xx (incl. Anthropic 529 overloaded) are transient.
+    // A 429 caused by an exhausted quota is not: retrying only burns capacity.
+    bool retryable() const {
+        if (type == "insufficient_quota") return false;
+        return statusCode == 408 || statusCode == 409 || statusCode == 429 || statusCode >= 500;
+    }
 };
 
 // Network/connection errors (DNS, TLS, timeout)
@@ -25,4 +36,171 @@ public:
     using std::runtime_error::runtime_error;
 };
 
+enum class TimeoutPhase {
+    Connect,      // DNS, TCP connect and TLS handshake
+    FirstByte,    // request sent, no response yet
+    StreamIdle,   // gap between reads of a response body / SSE stream
+    Total,        // whole request, from connect to the last byte
+};
+
+inline std::string_view timeout_phase_name(TimeoutPhase phase) {
+    switch (phase) {
+        case TimeoutPhase::Connect: return "connect";
+        case TimeoutPhase::FirstByte: return "first byte";
+        case TimeoutPhase::StreamIdle: return "stream idle";
+        case TimeoutPhase::Total: return "total";
+    }
+    return "unknown";
+}
+
+// A per-phase deadline (see Timeouts) expired. Retryable like any other
+// ConnectionError: the upstream is stuck, not rejecting the request.
+class TimeoutError : public ConnectionError {
+public:
+    TimeoutPhase phase;
+    std::chrono::milliseconds limit;
+
+    TimeoutError(TimeoutPhase timeoutPhase, std::chrono::milliseconds timeoutLimit, const std::string& where)
+        : ConnectionError(where + ": " + std::string(timeout_phase_name(timeoutPhase)) + " timeout after " +
+                          std::to_string(timeoutLimit.count()) + "ms")
+        , phase(timeoutPhase)
+        , limit(timeoutLimit)
+    {}
+};
+
+// The caller cancelled the call, or its deadline passed (see Cancellation).
+// Not a ConnectionError: never retried.
+class CancelledError : public std::runtime_error {
+public:
+    bool deadlineExceeded;
+
+    CancelledError(bool deadline, const std::string& where)
+        : std::runtime_error(where + (deadline ? ": deadline exceeded" : ": cancelled"))
+        , deadlineExceeded(deadline)
+    {}
+};
+
+// Every candidate upstream was skipped because its circuit breaker is open
+class CircuitOpenError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+} // namespace mcpplibs::llmapi
+
+namespace mcpplibs::llmapi {
+
+using Headers = std::map<std::string, std::string>;
+
+// Header lookup is case-insensitive; servers disagree on capitalization.
+inline std::optional<std::string> find_header(const Headers& headers, std::string_view name) {
+    for (const auto& [key, value] : headers) {
+        if (key.size() != name.size()) continue;
+        bool equal = true;
+        for (std::size_t i = 0; i < key.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(key[i])) !=
+                std::tolower(static_cast<unsigned char>(name[i]))) {
+                equal = false;
+                break;
+            }
+        }
+        if (equal) return value;
+    }
+    return std::nullopt;
+}
+
+// IMF-fixdate, e.g. "Wed, 21 Oct 2015 07:28:00 GMT"
+inline std::optional<std::chrono::system_clock::time_point> parse_http_date(std::string_view text) {
+    static constexpr std::array<std::string_view, 12> MONTHS {
+        "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
+    };
+    auto comma = text.find(", ");
+    if (comma == std::string_view::npos || text.size() < comma + 22) return std::nullopt;
+    auto rest = text.substr(comma + 2);   // "21 Oct 2015 07:28:00 GMT"
+
+    auto number = [&](std::size_t pos, std::size_t len) -> std::optional<int> {
+        int value { 0 };
+        auto field = rest.substr(pos, len);
+        auto [ptr, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+        if (ec != std::errc{} || ptr != field.data() + field.size()) return std::nullopt;
+        return value;
+    };
+    auto day = number(0, 2);
+    auto year = number(7, 4);
+    auto hour = number(12, 2);
+    auto minute = number(15, 2);
+    auto second = number(18, 2);
+    auto monthIt = std::ranges::find(MONTHS, rest.substr(3, 3));
+    if (!day || !year || !hour || !minute || !second || monthIt == MONTHS.end()) return std::nullopt;
+
+    auto month = static_cast<unsigned>(monthIt - MONTHS.begin() + 1);
+    std::chrono::year_month_day date {
+        std::chrono::year { *year }, std::chrono::month { month }, std::chrono::day { static_cast<unsigned>(*day) },
+    };
+    if (!date.ok()) return std::nullopt;
+    return std::chrono::sys_days { date } + std::chrono::hours { *hour } +
+           std::chrono::minutes { *minute } + std::chrono::seconds { *second };
+}
+
+// Retry-After is either delay-seconds or an HTTP-date; OpenAI additionally
+// sends the more precise retry-after-ms.
+inline std::optional<std::chrono::milliseconds> parse_retry_after(const Headers& headers) {
+    if (auto ms = find_header(headers, "retry-after-ms")) {
+        double value { 0 };
+        auto [ptr, ec] = std::from_chars(ms->data(), ms->data() + ms->size(), value);
+        if (ec == std::errc{} && value >= 0) {
+            return std::chrono::milliseconds { static_cast<std::int64_t>(value) };
+        }
+    }
+    if (auto header = find_header(headers, "retry-after")) {
+        std::int64_t seconds { 0 };
+        auto [ptr, ec] = std::from_chars(header->data(), header->data() + header->size(), seconds);
+        if (ec == std::errc{} && seconds >= 0) {
+            return std::chrono::seconds { seconds };
+        }
+        if (auto when = parse_http_date(*header)) {
+            auto delta = *when - std::chrono::system_clock::now();
+            return std::max(std::chrono::milliseconds { 0 },
+                            std::chrono::duration_cast<std::chrono::milliseconds>(delta));
+        }
+    }
+    return std::nullopt;
+}
+
+// Build an ApiError from a non-2xx response. Both OpenAI and Anthropic use
+// {"error": {"type": ..., "message": ...}}; OpenAI may put the type in "code".
+inline ApiError make_api_error(std::string_view provider, int statusCode, std::string_view statusText,
+                               std::string body, const Headers& headers) {
+    std::string type;
+    std::string detail;
+    try {
+        auto json = nlohmann::json::parse(body);
+        if (json.contains("error") && json["error"].is_object()) {
+            const auto& error = json["error"];
+            if (error.contains("type") && error["type"].is_string()) {
+                type = error["type"].get<std::string>();
+            }
+            if (error.contains("code") && error["code"].is_string() &&
+                (type.empty() || type == "invalid_request_error" || type == "requests")) {
+                type = error["code"].get<std::string>();
+            }
+            detail = error.value("message", "");
+        }
+    } catch (const nlohmann::json::exception&) {
+        // Non-JSON body (proxy error page, empty stream body)
+    }
+    if (detail.empty()) {
+        detail = std::string(statusText);
+    }
+
+    std::string message = std::string(provider) + " API error: " + std::to_string(statusCode);
+    if (!type.empty()) {
+        message += " " + type;
+    }
+    if (!detail.empty()) {
+        message += ": " + detail;
+    }
+    return ApiError(statusCode, std::move(type), std::move(body), message, parse_retry_after(headers));
+}
+
 } // namespace mcpplibs::llmapi
@@ -0,0 +1,168 @@
+export module mcpplibs.llmapi:fallback;
+
+import :types;
+import :coro;
+import :provider;
+import :errors;
+import :retry;
+import :any_provider;
+import :circuit_breaker;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+struct FallbackMemberStatus {
+    std::string name;
+    CircuitState state;
+    std::uint64_t requests { 0 };
+    std::uint64_t failures { 0 };
+    std::uint64_t skipped { 0 };
+};
+
+} // namespace mcpplibs::llmapi
+
+namespace mcpplibs::llmapi {
+
+struct FallbackCounters {
+    std::atomic<std::uint64_t> requests { 0 };
+    std::atomic<std::uint64_t> failures { 0 };
+    std::atomic<std::uint64_t> skipped { 0 };
+};
+
+} // namespace mcpplibs::llmapi
+
+export namespace mcpplibs::llmapi {
+
+// Ordered fallback chain, e.g. Anthropic -> OpenAI -> DeepSeek. Each member has
+// its own circuit breaker; members whose circuit is open are skipped without
+// sending anything. Only transient failures (see classify_failure) fail over
+// and count against a breaker, and only a response counts for it; a bad
+// request is rethrown from the first member that rejects it. Streams fail
+// over only before the first chunk is delivered.
+class FallbackProvider {
+private:
+    struct Member {
+        AnyProvider provider;
+        std::string name;
+        std::unique_ptr<CircuitBreaker> breaker;
+        std::unique_ptr<FallbackCounters> counters;
+    };
+
+    CircuitBreakerPolicy policy_;
+    std::vector<Member> members_;
+
+public:
+    template<Provider... Ps>
+    explicit FallbackProvider(Ps... providers)
+        : FallbackProvider(CircuitBreakerPolicy {}, std::move(providers)...) {}
+
+    template<Provider... Ps>
+    explicit FallbackProvider(CircuitBreakerPolicy policy, Ps... providers)
+        : policy_(policy)
+    {
+        (add(std::move(providers)), ...);
+    }
+
+    FallbackProvider(FallbackProvider&&) = default;
+    FallbackProvider& operator=(FallbackProvider&&) = default;
+
+    // Append a member at the lowest priority
+    template<Provider P>
+    FallbackProvider& add(P provider) {
+        AnyProvider any { std::move(provider) };
+        auto memberName = std::string(any.name());
+        members_.push_back(Member {
+            .provider = std::move(any),
+            .name = std::move(memberName),
+            .breaker = std::make_unique<CircuitBreaker>(policy_),
+            .counters = std::make_unique<FallbackCounters>(),
+        });
+        return *this;
+    }
+
+    // Provider concept
+    std::string_view name() const { return "fallback"; }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        return run_([&](AnyProvider& provider) { return provider.chat(messages, params); },
+                    [] { return true; });
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback) {
+        bool delivered = false;
+        std::function<void(std::string_view)> tracked = [&](std::string_view chunk) {
+            delivered = true;
+            callback(chunk);
+        };
+        return run_([&](AnyProvider& provider) { return provider.chat_stream(messages, params, tracked); },
+                    [&] { return !delivered; });
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback) {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    std::size_t size() const { return members_.size(); }
+
+    std::vector<FallbackMemberStatus> members() const {
+        std::vector<FallbackMemberStatus> result;
+        result.reserve(members_.size());
+        for (const auto& member : members_) {
+            result.push_back(FallbackMemberStatus {
+                .name = member.name,
+                .state = member.breaker->state(),
+                .requests = member.counters->requests.load(),
+                .failures = member.counters->failures.load(),
+                .skipped = member.counters->skipped.load(),
+            });
+        }
+        return result;
+    }
+
+private:
+    template<typename Fn, typename CanFailOver>
+    ChatResponse run_(Fn&& attempt, CanFailOver&& canFailOver) {
+        std::exception_ptr lastError;
+        for (auto& member : members_) {
+            if (!member.breaker->allow()) {
+                member.counters->skipped++;
+                continue;
+            }
+            member.counters->requests++;
+            auto start = std::chrono::steady_clock::now();
+            try {
+                auto response = attempt(member.provider);
+                member.breaker->record_success(elapsed_(start));
+                return response;
+            } catch (...) {
+                if (!classify_failure(std::current_exception()).retryable) {
+                    // A rejected request, a parse failure or a throwing
+                    // callback: no verdict on the upstream either way
+                    member.breaker->record_ignored();
+                    throw;
+                }
+                member.breaker->record_failure();
+                member.counters->failures++;
+                if (!canFailOver()) throw;
+                lastError = std::current_exception();
+            }
+        }
+        if (lastError) {
+            std::rethrow_exception(lastError);
+        }
+        throw CircuitOpenError("all fallback providers are unavailable (circuit open)");
+    }
+
+    static std::chrono::milliseconds elapsed_(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    }
+};
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,320 @@
+export module mcpplibs.llmapi:files;
+
+import :types;
+import :coro;
+import :provider;
+import std;
+
+namespace mcpplibs::llmapi {
+
+inline std::string base64_decode(std::string_view input) {
+    static constexpr auto TABLE = [] {
+        std::array<std::int8_t, 256> table {};
+        table.fill(-1);
+        constexpr std::string_view ALPHABET {
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" };
+        for (std::size_t i = 0; i < ALPHABET.size(); ++i) {
+            table[static_cast<unsigned char>(ALPHABET[i])] = static_cast<std::int8_t>(i);
+        }
+        table['-'] = 62;   // base64url
+        table['_'] = 63;
+        return table;
+    }();
+
+    std::string output;
+    output.reserve(input.size() / 4 * 3);
+    std::uint32_t buffer { 0 };
+    int bits { 0 };
+    for (unsigned char c : input) {
+        auto value = TABLE[c];
+        if (value < 0) continue;   // padding, whitespace
+        buffer = (buffer << 6) | static_cast<std::uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            output.push_back(static_cast<char>((buffer >> bits) & 0xff));
+        }
+    }
+    return output;
+}
+
+// SHA-256 (FIPS 180-4), fed in pieces like Fnv1a. Keys uploaded content:
+// a collision would attach another image, so a weak hash will not do.
+class Sha256 {
+private:
+    static constexpr std::array<std::uint32_t, 64> K {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    std::array<std::uint32_t, 8> h_ { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    std::array<unsigned char, 64> block_ {};
+    std::size_t used_ { 0 };
+    std::uint64_t length_ { 0 };
+
+    void compress_() {
+        std::array<std::uint32_t, 64> w;
+        for (int i = 0; i < 16; ++i) {
+            w[i] = static_cast<std::uint32_t>(block_[i * 4]) << 24 | static_cast<std::uint32_t>(block_[i * 4 + 1]) << 16 |
+                   static_cast<std::uint32_t>(block_[i * 4 + 2]) << 8 | static_cast<std::uint32_t>(block_[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            auto s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        auto [a, b, c, d, e, f, g, h] = h_;
+        for (int i = 0; i < 64; ++i) {
+            auto t1 = h + (std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            auto t2 = (std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+        }
+        h_[0] += a; h_[1] += b; h_[2] += c; h_[3] += d; h_[4] += e; h_[5] += f; h_[6] += g; h_[7] += h;
+    }
+
+public:
+    Sha256& add(std::string_view bytes) {
+        length_ += bytes.size();
+        for (unsigned char c : bytes) {
+            block_[used_++] = c;
+            if (used_ == block_.size()) {
+                compress_();
+                used_ = 0;
+            }
+        }
+        return *this;
+    }
+
+    // Lowercase hex; the hasher is spent afterwards
+    std::string hex() {
+        auto bits = length_ * 8;
+        add(std::string_view("\x80", 1));
+        while (used_ != 56) add(std::string_view("\0", 1));
+        for (int i = 7; i >= 0; --i) {
+            block_[used_++] = static_cast<unsigned char>(bits >> (i * 8));
+        }
+        compress_();
+        std::string out;
+        out.reserve(64);
+        for (auto word : h_) out += std::format("{:08x}", word);
+        return out;
+    }
+};
+
+// multipart/form-data up to the file content: text fields, then the
+// headers of one file part
+inline std::string multipart_head(std::string_view boundary,
+                                  const std::vector<std::pair<std::string, std::string>>& fields,
+                                  std::string_view fileField, std::string_view filename,
+                                  std::string_view mediaType) {
+    std::string head;
+    for (const auto& [name, value] : fields) {
+        head += "--";
+        head += boundary;
+        head += "\r\nContent-Disposition: form-data; name=\"" + name + "\"\r\n\r\n";
+        head += value;
+        head += "\r\n";
+    }
+    head += "--";
+    head += boundary;
+    head += "\r\nContent-Disposition: form-data; name=\"";
+    head += fileField;
+    head += "\"; filename=\"";
+    head += filename;
+    head += "\"\r\nContent-Type: ";
+    head += mediaType;
+    head += "\r\n\r\n";
+    return head;
+}
+
+// What follows the file content
+inline std::string multipart_tail(std::string_view boundary) {
+    return "\r\n--" + std::string(boundary) + "--\r\n";
+}
+
+// multipart/form-data body with text fields followed by one file part
+inline std::string multipart_body(std::string_view boundary,
+                                  const std::vector<std::pair<std::string, std::string>>& fields,
+                                  std::string_view fileField, std::string_view filename,
+                                  std::string_view mediaType, std::string_view data) {
+    auto body = multipart_head(boundary, fields, fileField, filename, mediaType);
+    body.reserve(body.size() + data.size() + boundary.size() + 8);
+    body += data;
+    body += multipart_tail(boundary);
+    return body;
+}
+
+inline std::string multipart_boundary() {
+    static std::atomic<std::uint64_t> counter { 0 };
+    auto seed = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return "llmapi-" + std::to_string(seed) + "-" + std::to_string(counter++);
+}
+
+} // namespace mcpplibs::llmapi
+
+export namespace mcpplibs::llmapi {
+
+// A file stored with the provider's Files API
+struct FileObject {
+    std::string id;
+    std::string filename;
+    std::string mediaType;
+    std::int64_t bytes { 0 };
+};
+
+template<typename P>
+concept FileUploadProvider = Provider<P> && requires(P p, std::string_view data) {
+    { p.upload_file(data, data, data) } -> std::same_as<FileObject>;
+};
+
+// Upload providers whose request format can reference an uploaded image by
+// id: Anthropic image sources, Responses input_image. Chat Completions
+// cannot (its file parts take documents such as PDFs), so images sent
+// there stay inline.
+template<typename P>
+concept ImageFileProvider = FileUploadProvider<P> && P::referencesImageFiles;
+
+struct AttachmentPolicy {
+    std::size_t minBytes { 16 * 1024 };   // smaller inline images are cheaper to resend than to upload
+    std::size_t maxCached { 256 };        // file ids remembered; the least recently used is forgotten first
+};
+
+// Uploads inline (base64) images once through the provider's Files API and
+// sends them by reference afterwards. File ids are cached by the SHA-256 of
+// the media type and content, so the same screenshot in every turn of a
+// conversation is uploaded once. Forgetting an id (past maxCached, or on
+// clear()) only means the next use uploads again; the provider's copy is
+// not deleted.
+template<ImageFileProvider P>
+class AttachmentProvider {
+private:
+    using Entry = std::pair<std::string, FileObject>;   // content key, uploaded file
+
+    P provider_;
+    AttachmentPolicy policy_;
+    std::list<Entry> files_;   // most recently used first
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index_;
+    std::uint64_t uploads_ { 0 };
+
+public:
+    explicit AttachmentProvider(P provider, AttachmentPolicy policy = {})
+        : provider_(std::move(provider)), policy_(policy) {}
+
+    // Provider concept
+    std::string_view name() const { return provider_.name(); }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        if (auto rewritten = by_reference_(messages)) {
+            return provider_.chat(*rewritten, params);
+        }
+        return provider_.chat(messages, params);
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        if (auto rewritten = by_reference_(messages)) {
+            return provider_.chat_stream(*rewritten, params, std::move(callback));
+        }
+        return provider_.chat_stream(messages, params, std::move(callback));
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    // Upload inline images in place (e.g. in Client::conversation().messages)
+    // so the history stops carrying base64 at all. Returns the number replaced.
+    std::size_t attach(std::vector<Message>& messages) {
+        std::size_t replaced { 0 };
+        for (auto& message : messages) {
+            auto* parts = std::get_if<std::vector<ContentPart>>(&message.content);
+            if (parts == nullptr) continue;
+            for (auto& part : *parts) {
+                auto* image = std::get_if<ImageContent>(&part);
+                if (image == nullptr || !uploadable_(*image)) continue;
+                image->fileId = upload_(*image).id;
+                image->data.clear();
+                replaced++;
+            }
+        }
+        return replaced;
+    }
+
+    // Upload one image (or return the cached upload of identical content)
+    FileObject upload(const ImageContent& image) { return upload_(image); }
+
+    std::uint64_t uploads() const { return uploads_; }
+    std::size_t cached() const { return files_.size(); }
+
+    // Forgets every cached file id
+    void clear() {
+        files_.clear();
+        index_.clear();
+    }
+
+    P& provider() { return provider_; }
+    const P& provider() const { return provider_; }
+
+private:
+    bool uploadable_(const ImageContent& image) const {
+        return !image.isUrl && image.fileId.empty() && image.data.size() >= policy_.minBytes;
+    }
+
+    static std::string content_key_(const ImageContent& image) {
+        return Sha256 {}.add(image.mediaType).add(std::string_view("\0", 1)).add(image.data).hex();
+    }
+
+    FileObject upload_(const ImageContent& image) {
+        auto key = content_key_(image);
+        if (auto it = index_.find(key); it != index_.end()) {
+            files_.splice(files_.begin(), files_, it->second);
+            return it->second->second;
+        }
+        auto bytes = base64_decode(image.data);
+        auto extension = image.mediaType.substr(image.mediaType.find('/') + 1);
+        auto file = provider_.upload_file(bytes, "image-" + key.substr(0, 16) + "." + extension, image.mediaType);
+        uploads_++;
+        files_.emplace_front(key, file);
+        index_[std::move(key)] = files_.begin();
+        while (files_.size() > std::max<std::size_t>(policy_.maxCached, 1)) {
+            index_.erase(files_.back().first);
+            files_.pop_back();
+        }
+        return file;
+    }
+
+    // nullopt when nothing needs rewriting, so the common case copies nothing
+    std::optional<std::vector<Message>> by_reference_(const std::vector<Message>& messages) {
+        bool any = std::ranges::any_of(messages, [&](const Message& message) {
+            auto* parts = std::get_if<std::vector<ContentPart>>(&message.content);
+            return parts != nullptr && std::ranges::any_of(*parts, [&](const ContentPart& part) {
+                auto* image = std::get_if<ImageContent>(&part);
+                return image != nullptr && uploadable_(*image);
+            });
+        });
+        if (!any) return std::nullopt;
+
+        auto rewritten = messages;
+        attach(rewritten);
+        return rewritten;
+    }
+};
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,367 @@
+export module mcpplibs.llmapi:hedging;
+
+import :types;
+import :errors;
+import :coro;
+import :provider;
+import :metrics;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+struct HedgePolicy {
+    double percentile { 0.95 };                           // hedge chat() past this completion latency
+    double ttftPercentile { 0.95 };                       // hedge chat_stream() past this time-to-first-token
+    std::size_t minSamples { 20 };                        // below this, use fallbackDelay
+    std::chrono::milliseconds fallbackDelay { 2000 };
+    std::chrono::milliseconds minDelay { 20 };
+    // Hedge budget: at most budgetRatio * requests + budgetBurst hedges overall
+    double budgetRatio { 0.05 };
+    double budgetBurst { 2.0 };
+};
+
+struct HedgeStats {
+    std::uint64_t requests { 0 };
+    std::uint64_t hedges { 0 };
+    std::uint64_t hedgeWins { 0 };
+};
+
+} // namespace mcpplibs::llmapi
+
+namespace mcpplibs::llmapi {
+
+struct HedgeRace {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<ChatResponse> response;
+    std::array<std::exception_ptr, 2> errors;
+    std::array<std::stop_source, 2> stops;   // per replica: requested when it loses
+    int launched { 0 };
+    int failed { 0 };
+    int winner { -1 };           // chat: first to complete; stream: first to produce a token
+    std::deque<std::string> chunks;
+    bool winnerDone { false };
+
+    bool settled() const { return winnerDone || failed == launched; }
+
+    // Caller holds mutex
+    void decide(int index) {
+        winner = index;
+        stops[1 - index].request_stop();
+    }
+
+    // The caller left (returned or threw): stop whatever still runs
+    void abandon() {
+        for (auto& stop : stops) stop.request_stop();
+    }
+};
+
+} // namespace mcpplibs::llmapi
+
+export namespace mcpplibs::llmapi {
+
+// Tail-latency hedging over two replicas of a provider (separate connections or
+// endpoints). If a chat() has not completed by the live latency percentile, or
+// a chat_stream() has not produced its first token by the TTFT percentile, the
+// request is duplicated on the idle replica; the first to finish wins and the
+// loser is stopped. Each replica runs with its own stop token in
+// ChatParams::cancel, so the loser's transport drops its connection instead
+// of waiting out the response; the caller's stop token stops both, and the
+// caller's deadline applies to each.
+//
+// Each replica serves one request at a time. A call takes a free replica,
+// waiting only while both are busy, and hedges only onto a free one; a loser
+// winding down keeps its replica without blocking the next call, which takes
+// the other. Safe for concurrent callers, who then rarely get to hedge.
+//
+// Replicas run on detached worker threads; the stream callback is always
+// invoked on the calling thread. Messages and params are copied once per
+// request so a losing replica can outlive the call, and params once more per
+// replica for its token. Destruction waits for running workers.
+template<StreamableProvider P>
+class HedgedProvider {
+private:
+    struct Slot {
+        P provider;
+        bool busy { false };   // guarded by State::slotMutex
+
+        explicit Slot(P p) : provider(std::move(p)) {}
+    };
+
+    struct Request {
+        std::vector<Message> messages;
+        ChatParams params;
+
+        // The caller's params with the replica's stop token, which the caller's
+        // own token and losing the race both request
+        ChatParams params_for(std::stop_token stop) const {
+            auto copy = params;
+            copy.cancel.token = std::move(stop);
+            return copy;
+        }
+    };
+
+    struct State {
+        HedgePolicy policy;
+        LatencyHistogram latency;
+        LatencyHistogram ttft;
+        std::mutex statsMutex;
+        HedgeStats stats;
+        std::mutex slotMutex;
+        std::condition_variable slotFreed;
+        int running { 0 };   // workers still using a slot's provider
+        std::array<std::unique_ptr<Slot>, 2> slots;
+
+        ~State() {
+            std::unique_lock lock { slotMutex };
+            slotFreed.wait(lock, [&] { return running == 0; });
+        }
+
+        // Takes a free replica, the first one if both are
+        int acquire() {
+            std::unique_lock lock { slotMutex };
+            slotFreed.wait(lock, [&] { return !slots[0]->busy || !slots[1]->busy; });
+            int index = slots[0]->busy ? 1 : 0;
+            slots[index]->busy = true;
+            return index;
+        }
+
+        bool try_acquire(int index) {
+            std::lock_guard lock { slotMutex };
+            if (slots[index]->busy) return false;
+            slots[index]->busy = true;
+            return true;
+        }
+
+        // A worker is done with its slot; the last thing it touches
+        void release(int index, bool worker) {
+            std::lock_guard lock { slotMutex };
+            slots[index]->busy = false;
+            if (worker) running--;
+            slotFreed.notify_all();
+        }
+    };
+
+    std::unique_ptr<State> state_;
+
+public:
+    HedgedProvider(P primary, P secondary, HedgePolicy policy = {})
+        : state_(std::make_unique<State>())
+    {
+        state_->policy = policy;
+        state_->slots[0] = std::make_unique<Slot>(std::move(primary));
+        state_->slots[1] = std::make_unique<Slot>(std::move(secondary));
+    }
+
+    // Provider concept
+    std::string_view name() const { return state_->slots[0]->provider.name(); }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        auto request = std::make_shared<const Request>(Request { messages, params });
+        auto race = std::make_shared<HedgeRace>();
+        std::stop_callback stopped { params.cancel.token, [race] { race->abandon(); } };
+        auto primary = state_->acquire();
+        launch_chat_(primary, race, request);
+
+        std::unique_lock lock { race->mutex };
+        auto delay = hedge_delay_(state_->latency, state_->policy.percentile);
+        if (!race->cv.wait_for(lock, delay, [&] { return race->settled(); })) {
+            if (try_begin_hedge_(1 - primary)) {
+                launch_chat_(1 - primary, race, request);
+            }
+        }
+        race->cv.wait(lock, [&] { return race->settled(); });
+        race->abandon();
+
+        if (!race->winnerDone) {
+            std::rethrow_exception(race->errors[primary] ? race->errors[primary] : race->errors[1 - primary]);
+        }
+        if (race->winner != primary) {
+            std::lock_guard statsLock { state_->statsMutex };
+            state_->stats.hedgeWins++;
+        }
+        return std::move(*race->response);
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback) {
+        auto request = std::make_shared<const Request>(Request { messages, params });
+        auto race = std::make_shared<HedgeRace>();
+        std::stop_callback stopped { params.cancel.token, [race] { race->abandon(); } };
+        auto primary = state_->acquire();
+        auto start = std::chrono::steady_clock::now();
+        auto hedgeAt = start + hedge_delay_(state_->ttft, state_->policy.ttftPercentile);
+        launch_stream_(primary, race, request);
+
+        // Stops the workers however the call ends, including a throwing callback
+        struct Abandon {
+            HedgeRace& race;
+            ~Abandon() { race.abandon(); }
+        } abandon { *race };
+
+        std::unique_lock lock { race->mutex };
+        bool hedgeConsidered = false;
+        while (true) {
+            auto ready = [&] { return !race->chunks.empty() || race->settled(); };
+            if (!hedgeConsidered && race->winner < 0) {
+                if (!race->cv.wait_until(lock, hedgeAt, ready)) {
+                    hedgeConsidered = true;
+                    if (race->winner < 0 && try_begin_hedge_(1 - primary)) {
+                        launch_stream_(1 - primary, race, request);
+                    }
+                    continue;
+                }
+            } else {
+                race->cv.wait(lock, ready);
+            }
+
+            while (!race->chunks.empty()) {
+                auto chunk = std::move(race->chunks.front());
+                race->chunks.pop_front();
+                lock.unlock();
+                callback(chunk);
+                lock.lock();
+            }
+            if (race->winnerDone) break;
+            if (race->failed == race->launched) {
+                std::rethrow_exception(race->winner >= 0 ? race->errors[race->winner]
+                                       : race->errors[primary] ? race->errors[primary]
+                                       : race->errors[1 - primary]);
+            }
+            // The stream we forwarded from failed mid-way: do not splice another one in
+            if (race->winner >= 0 && race->errors[race->winner]) {
+                std::rethrow_exception(race->errors[race->winner]);
+            }
+        }
+
+        if (race->winner != primary) {
+            std::lock_guard statsLock { state_->statsMutex };
+            state_->stats.hedgeWins++;
+        }
+        return std::move(*race->response);
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback) {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    // Live histograms (shared by both replicas)
+    const LatencyHistogram& latency() const { return state_->latency; }
+    const LatencyHistogram& ttft() const { return state_->ttft; }
+
+    HedgeStats stats() const {
+        std::lock_guard lock { state_->statsMutex };
+        return state_->stats;
+    }
+
+private:
+    std::chrono::milliseconds hedge_delay_(const LatencyHistogram& histogram, double q) const {
+        const auto& policy = state_->policy;
+        auto delay = histogram.percentile(q, policy.minSamples).value_or(policy.fallbackDelay);
+        return std::max(delay, policy.minDelay);
+    }
+
+    // Takes the replica only if it is free (not still finishing an earlier
+    // loser) and the budget allows another hedge
+    bool try_begin_hedge_(int slot) {
+        if (!state_->try_acquire(slot)) return false;
+        std::lock_guard lock { state_->statsMutex };
+        auto& stats = state_->stats;
+        auto allowance = state_->policy.budgetRatio * static_cast<double>(stats.requests) +
+                         state_->policy.budgetBurst;
+        if (static_cast<double>(stats.hedges) + 1.0 > allowance) {
+            state_->release(slot, false);
+            return false;
+        }
+        stats.hedges++;
+        return true;
+    }
+
+    // The slot has been acquired. Caller holds race->mutex when launching the
+    // hedge; workers only touch the race under that mutex, so launching never
+    // blocks on it.
+    template<typename Work>
+    void launch_(int index, const std::shared_ptr<HedgeRace>& race, Work work) {
+        auto* state = state_.get();
+        race->launched++;
+        if (race->launched == 1) {
+            std::lock_guard lock { state->statsMutex };
+            state->stats.requests++;
+        }
+        {
+            std::lock_guard lock { state->slotMutex };
+            state->running++;
+        }
+        try {
+            std::thread([state, race, index, work = std::move(work)] {
+                try {
+                    work(state->slots[index]->provider, race->stops[index].get_token());
+                } catch (...) {
+                    std::lock_guard lock { race->mutex };
+                    race->errors[index] = std::current_exception();
+                    race->failed++;
+                }
+                race->cv.notify_all();
+                state->release(index, true);
+            }).detach();
+        } catch (...) {
+            state->release(index, true);
+            throw;
+        }
+    }
+
+    void launch_chat_(int index, const std::shared_ptr<HedgeRace>& race,
+                      const std::shared_ptr<const Request>& request) {
+        auto* state = state_.get();
+        launch_(index, race, [state, race, request, index](P& provider, std::stop_token stop) {
+            auto start = std::chrono::steady_clock::now();
+            auto response = provider.chat(request->messages, request->params_for(stop));
+            state->latency.record(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start));
+            std::lock_guard lock { race->mutex };
+            if (race->winner < 0) {
+                race->decide(index);
+                race->response = std::move(response);
+                race->winnerDone = true;
+            }
+        });
+    }
+
+    void launch_stream_(int index, const std::shared_ptr<HedgeRace>& race,
+                        const std::shared_ptr<const Request>& request) {
+        auto* state = state_.get();
+        launch_(index, race, [state, race, request, index](P& provider, std::stop_token stop) {
+            auto start = std::chrono::steady_clock::now();
+            bool first = true;
+            auto forward = [&](std::string_view chunk) {
+                if (first) {
+                    first = false;
+                    state->ttft.record(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start));
+                }
+                {
+                    std::lock_guard lock { race->mutex };
+                    if (stop.stop_requested()) throw CancelledError(false, "hedged stream");
+                    if (race->winner < 0) race->decide(index);
+                    race->chunks.emplace_back(chunk);
+                }
+                race->cv.notify_all();
+            };
+            auto response = provider.chat_stream(request->messages, request->params_for(stop), forward);
+            std::lock_guard lock { race->mutex };
+            if (race->winner < 0) race->decide(index);   // completed without any text
+            if (race->winner == index) {
+                race->response = std::move(response);
+                race->winnerDone = true;
+            }
+        });
+    }
+};
+
+} // namespace mcpplibs::llmapi
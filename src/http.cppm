@@ -0,0 +1,1125 @@
+module;
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+export module mcpplibs.llmapi:http;
+
+import :buffers;
+import :cancel;
+import :compression;
+import :errors;
+import :http_pool;
+import mcpplibs.tinyhttps;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+namespace mcpplibs::llmapi {
+
+inline constexpr std::string_view UNIX_SCHEME { "unix://" };
+
+// Streamed request bodies go out in chunks of at most this size
+inline constexpr std::size_t BODY_CHUNK_BYTES { 64 * 1024 };
+
+// Largest TLS record plaintext (RFC 8446 5.1); a read at least this big
+// drains a whole record
+inline constexpr std::size_t TLS_RECORD_BYTES { 16 * 1024 };
+
+bool is_unix_url(std::string_view url) {
+    return url.starts_with(UNIX_SCHEME);
+}
+
+// unix:///run/llama.sock/v1/chat/completions names no explicit boundary
+// between the socket and the request path, so walk the path: the first
+// component that is not a directory is the socket. A missing path ends the
+// walk too, so the connect then fails with ENOENT.
+std::string unix_socket_path(std::string_view url) {
+    auto path = url.substr(UNIX_SCHEME.size());
+    std::size_t end = path.starts_with('/') ? 1 : 0;
+    while (end < path.size()) {
+        auto next = path.find('/', end);
+        auto prefix = path.substr(0, next);
+        std::error_code ec;
+        auto type = std::filesystem::status(std::filesystem::path(prefix), ec).type();
+        if (type != std::filesystem::file_type::directory || next == std::string_view::npos) {
+            return std::string(prefix);
+        }
+        end = next + 1;
+    }
+    return std::string(path);
+}
+
+// scheme://host[:port] of an http(s) URL
+std::string url_origin(std::string_view url) {
+    auto scheme = url.find("://");
+    if (scheme == std::string_view::npos) return std::string(url);
+    auto end = url.find_first_of("/?#", scheme + 3);
+    return std::string(url.substr(0, end));
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    return std::ranges::equal(a, b, [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+std::string_view method_name(tinyhttps::Method method) {
+    switch (method) {
+        case tinyhttps::Method::GET: return "GET";
+        case tinyhttps::Method::POST: return "POST";
+        case tinyhttps::Method::PUT: return "PUT";
+        case tinyhttps::Method::DELETE_: return "DELETE";
+        case tinyhttps::Method::PATCH: return "PATCH";
+        case tinyhttps::Method::HEAD: return "HEAD";
+    }
+    return "GET";
+}
+
+// AF_UNIX stream with the read/write/wait_readable shape of tinyhttps::Socket
+class UnixStream {
+private:
+    int fd_ { -1 };
+
+public:
+    UnixStream() = default;
+    ~UnixStream() { close(); }
+    UnixStream(UnixStream&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+    UnixStream& operator=(UnixStream&& other) noexcept {
+        if (this != &other) {
+            close();
+            fd_ = std::exchange(other.fd_, -1);
+        }
+        return *this;
+    }
+
+#if defined(_WIN32)
+    void connect(const std::string&) { throw std::runtime_error("unix sockets are not supported on this platform"); }
+    void close() {}
+    int read(void*, int) { return -1; }
+    int write(const void*, int) { return -1; }
+    bool wait_readable(int) { return false; }
+#else
+    void connect(const std::string& path) {
+        sockaddr_un addr {};
+        if (path.size() >= sizeof(addr.sun_path)) {
+            throw std::invalid_argument("unix socket path too long: " + path);
+        }
+        addr.sun_family = AF_UNIX;
+        std::ranges::copy(path, addr.sun_path);
+        fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd_ < 0) fail_("socket");
+#if defined(SO_NOSIGPIPE)
+        int yes = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#endif
+        if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) fail_("connect");
+    }
+
+    void close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    int read(void* buffer, int size) {
+        for (;;) {
+            auto n = ::recv(fd_, buffer, static_cast<std::size_t>(size), 0);
+            if (n < 0 && errno == EINTR) continue;
+            return static_cast<int>(n);
+        }
+    }
+
+    int write(const void* data, int size) {
+#if defined(MSG_NOSIGNAL)
+        constexpr int flags = MSG_NOSIGNAL;
+#else
+        constexpr int flags = 0;
+#endif
+        for (;;) {
+            auto n = ::send(fd_, data, static_cast<std::size_t>(size), flags);
+            if (n < 0 && errno == EINTR) continue;
+            return static_cast<int>(n);
+        }
+    }
+
+    bool wait_readable(int timeoutMs) {
+        pollfd readable { .fd = fd_, .events = POLLIN, .revents = 0 };
+        return ::poll(&readable, 1, timeoutMs) > 0;
+    }
+
+private:
+    [[noreturn]] void fail_(std::string_view what) {
+        auto error = errno;
+        close();
+        throw std::runtime_error(std::string(what) + ": " + std::generic_category().message(error));
+    }
+#endif
+};
+
+} // namespace mcpplibs::llmapi
+
+export namespace mcpplibs::llmapi {
+
+// Destination of a streamed request body. Writes collect in a buffer of at
+// most `limit` bytes, which is drained (to the socket) whenever it fills,
+// so a body of any size needs only that much memory.
+class BodySink {
+private:
+    std::size_t limit_;
+    std::function<void(std::string_view)> drain_;
+    std::string buffer_;
+    std::uint64_t bytes_ { 0 };
+
+public:
+    BodySink(std::size_t limit, std::function<void(std::string_view)> drain)
+        : limit_(std::max<std::size_t>(limit, 1))
+        , drain_(std::move(drain))
+    {
+        buffer_.reserve(limit_);
+    }
+
+    void write(std::string_view data) {
+        bytes_ += data.size();
+        while (!data.empty()) {
+            auto take = std::min(data.size(), limit_ - buffer_.size());
+            buffer_.append(data.substr(0, take));
+            data.remove_prefix(take);
+            if (buffer_.size() == limit_) flush();
+        }
+    }
+
+    void flush() {
+        if (buffer_.empty()) return;
+        drain_(buffer_);
+        buffer_.clear();
+    }
+
+    std::uint64_t bytes() const { return bytes_; }
+};
+
+// Produces a request body into a sink; may be called again for a retry
+using BodyWriter = std::function<void(BodySink&)>;
+
+// Writes `value` exactly as value.dump(-1, ' ', false, replace) would,
+// without building the whole text: long strings (inline base64 media) are
+// escaped in slices cut at UTF-8 boundaries.
+void write_json(BodySink& sink, const nlohmann::json& value) {
+    using Json = nlohmann::json;
+    auto dump = [](const Json& v) { return v.dump(-1, ' ', false, Json::error_handler_t::replace); };
+    if (value.is_object()) {
+        sink.write("{");
+        bool first = true;
+        for (const auto& [key, item] : value.items()) {
+            if (!first) sink.write(",");
+            first = false;
+            sink.write(dump(Json(key)));
+            sink.write(":");
+            write_json(sink, item);
+        }
+        sink.write("}");
+    } else if (value.is_array()) {
+        sink.write("[");
+        bool first = true;
+        for (const auto& item : value) {
+            if (!first) sink.write(",");
+            first = false;
+            write_json(sink, item);
+        }
+        sink.write("]");
+    } else if (value.is_string() && value.get_ref<const std::string&>().size() > BODY_CHUNK_BYTES) {
+        const auto& text = value.get_ref<const std::string&>();
+        sink.write("\"");
+        std::size_t pos = 0;
+        while (pos < text.size()) {
+            auto end = std::min(pos + BODY_CHUNK_BYTES, text.size());
+            while (end < text.size() && end > pos + 1 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+                --end;   // don't split a multi-byte sequence
+            }
+            auto piece = dump(Json(text.substr(pos, end - pos)));
+            sink.write(std::string_view(piece).substr(1, piece.size() - 2));
+            pos = end;
+        }
+        sink.write("\"");
+    } else {
+        sink.write(dump(value));
+    }
+}
+
+// Copies a file into the sink BODY_CHUNK_BYTES at a time
+void write_file(BodySink& sink, const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot open " + path.string());
+    std::string chunk(BODY_CHUNK_BYTES, '\0');
+    while (in) {
+        in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        if (auto n = in.gcount(); n > 0) sink.write(std::string_view(chunk).substr(0, static_cast<std::size_t>(n)));
+    }
+    if (in.bad()) throw std::runtime_error("read from " + path.string() + " failed");
+}
+
+// Total length of the strings in a JSON value: a cheap lower bound on its
+// serialized size, used to decide whether a body is worth streaming.
+std::size_t json_size_hint(const nlohmann::json& value) {
+    std::size_t size = 0;
+    if (value.is_object()) {
+        for (const auto& [key, item] : value.items()) {
+            size += key.size() + json_size_hint(item);
+        }
+    } else if (value.is_array()) {
+        for (const auto& item : value) size += json_size_hint(item);
+    } else if (value.is_string()) {
+        size += value.get_ref<const std::string&>().size();
+    }
+    return size;
+}
+
+// Per-phase deadlines for one request. An expired one raises TimeoutError
+// naming the phase. DNS, TCP connect and the TLS handshake happen in one
+// tinyhttps call and share the connect budget. streamIdle bounds the gap
+// between reads, so SSE keep-alives (Anthropic `ping`s) count as liveness.
+// For a non-streamed response the first byte arrives only when the whole
+// completion is done, hence the generous firstByte default. nullopt falls
+// back to HttpClientConfig::connectTimeoutMs / readTimeoutMs.
+struct Timeouts {
+    std::optional<std::chrono::milliseconds> connect { std::chrono::seconds { 10 } };
+    std::optional<std::chrono::milliseconds> firstByte { std::chrono::minutes { 10 } };
+    std::optional<std::chrono::milliseconds> streamIdle { std::chrono::seconds { 90 } };
+    std::optional<std::chrono::milliseconds> total;
+};
+
+// Response body bytes as they came off the socket and after any
+// Content-Encoding was undone
+struct TransferStats {
+    std::uint64_t responses { 0 };
+    std::uint64_t compressed { 0 };   // responses that carried a Content-Encoding
+    std::uint64_t wireBytes { 0 };
+    std::uint64_t bodyBytes { 0 };
+
+    TransferStats& operator+=(const TransferStats& other) {
+        responses += other.responses;
+        compressed += other.compressed;
+        wireBytes += other.wireBytes;
+        bodyBytes += other.bodyBytes;
+        return *this;
+    }
+};
+
+// HTTP/1.1 client for one origin: a Unix domain socket (unix://), or a
+// direct TCP/TLS connection over tinyhttps sockets (http://, https://).
+// Unlike tinyhttps::HttpClient it can stream a request body with chunked
+// transfer encoding. The connection is kept open between requests. Not
+// thread-safe.
+//
+// Unix sockets reach inference servers on the same host (llama.cpp, vLLM
+// behind a local proxy) with no DNS, TCP or TLS. A unix:// URL's request
+// path is whatever follows the socket path.
+//
+// With `decompress` set, requests advertise Accept-Encoding (zstd, gzip)
+// and compressed responses, SSE streams included, are decoded as they
+// arrive; callers only ever see the decoded body.
+class Http1Client {
+private:
+    enum class Kind { Unix, Tcp, Tls };
+
+    Kind kind_;
+    std::string origin_;      // unix://<socket> or scheme://host[:port]
+    std::string host_;        // socket path for Kind::Unix
+    int port_ { 0 };
+    tinyhttps::HttpClientConfig config_;
+    bool decompress_;
+    Timeouts timeouts_;
+    TransferStats stats_;
+    // Deadlines of the exchange in progress
+    TimeoutPhase readPhase_ { TimeoutPhase::FirstByte };
+    std::optional<std::chrono::steady_clock::time_point> totalDeadline_;
+    const Cancellation* cancel_ { &current_cancellation() };
+    std::variant<std::monostate, UnixStream, tinyhttps::Socket, tinyhttps::TlsSocket> stream_;
+    std::string buffer_;      // received but not yet consumed; leased during an exchange
+    bool leasedBuffer_ { false };
+
+    struct WriteFailed {};
+
+public:
+    explicit Http1Client(std::string_view url, tinyhttps::HttpClientConfig config = {}, bool decompress = true,
+                         Timeouts timeouts = {})
+        : config_(std::move(config))
+        , decompress_(decompress)
+        , timeouts_(timeouts)
+    {
+        if (is_unix_url(url)) {
+            kind_ = Kind::Unix;
+            host_ = unix_socket_path(url);
+            origin_ = std::string(UNIX_SCHEME) + host_;
+            return;
+        }
+        bool tls = url.starts_with("https://");
+        if (!tls && !url.starts_with("http://")) {
+            throw std::invalid_argument("unsupported URL scheme: " + std::string(url));
+        }
+        kind_ = tls ? Kind::Tls : Kind::Tcp;
+        origin_ = url_origin(url);
+        auto authority = std::string_view(origin_).substr(tls ? 8 : 7);
+        host_ = authority;
+        port_ = tls ? 443 : 80;
+        if (auto colon = authority.rfind(':'); colon != std::string_view::npos && authority.find(']', colon) == std::string_view::npos) {
+            host_ = authority.substr(0, colon);
+            port_ = std::stoi(std::string(authority.substr(colon + 1)));
+        }
+    }
+
+    Http1Client(const Http1Client&) = delete;
+    Http1Client& operator=(const Http1Client&) = delete;
+    Http1Client(Http1Client&&) = default;
+    Http1Client& operator=(Http1Client&&) = default;
+
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request) {
+        return collect_(request, nullptr);
+    }
+
+    // request.body is ignored; the body comes from `body`, chunk-encoded
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request, const BodyWriter& body) {
+        return collect_(request, &body);
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, F&& callback) {
+        return stream_events_(request, nullptr, callback);
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, const BodyWriter& body, F&& callback) {
+        return stream_events_(request, &body, callback);
+    }
+
+    // The body of a 2xx response goes to onBody as it arrives, until it
+    // returns false; error responses come back with their body
+    template<typename F>
+    tinyhttps::HttpResponse send_download(const tinyhttps::HttpRequest& request, F&& onBody) {
+        std::string errorBody;
+        const tinyhttps::HttpResponse* head { nullptr };
+        auto response = exchange_(request, nullptr, [&](std::string_view data) -> bool {
+            if (!head->ok()) {
+                errorBody.append(data);
+                return true;
+            }
+            return onBody(data);
+        }, &head);
+        if (!response.ok()) {
+            response.body = std::move(errorBody);
+        }
+        return response;
+    }
+
+    const std::string& origin() const { return origin_; }
+    const TransferStats& stats() const { return stats_; }
+    bool connected() const { return !std::holds_alternative<std::monostate>(stream_); }
+
+    // Whether `url` is served by this client (same socket or origin)
+    bool serves(std::string_view url) const {
+        if (!url.starts_with(origin_)) return false;
+        auto rest = url.substr(origin_.size());
+        return rest.empty() || rest.starts_with('/') || (kind_ != Kind::Unix && rest.starts_with('?'));
+    }
+
+private:
+    tinyhttps::HttpResponse collect_(const tinyhttps::HttpRequest& request, const BodyWriter* body) {
+        std::string content;
+        auto response = exchange_(request, body, [&](std::string_view data) {
+            content.append(data);
+            return true;
+        });
+        response.body = std::move(content);
+        return response;
+    }
+
+    // Error responses are returned with their body instead of being parsed as SSE
+    template<typename F>
+    tinyhttps::HttpResponse stream_events_(const tinyhttps::HttpRequest& request, const BodyWriter* body, F& callback) {
+        tinyhttps::SseParser parser;
+        std::string errorBody;
+        const tinyhttps::HttpResponse* head { nullptr };
+        bool cancelled = false;
+        auto response = exchange_(request, body, [&](std::string_view data) {
+            if (!head->ok()) {
+                errorBody.append(data);
+                return true;
+            }
+            for (const auto& event : parser.feed(data)) {
+                if (!callback(event)) return false;
+                // Events already buffered are not delivered after a stop request
+                if (cancel_->active() && (cancel_->stop_requested() || cancel_->expired())) {
+                    cancelled = true;
+                    return false;
+                }
+            }
+            return true;
+        }, &head);
+        if (cancelled) cancel_->check(origin_);
+        if (!response.ok()) {
+            response.body = std::move(errorBody);
+        }
+        return response;
+    }
+
+    std::string error_(std::string_view what) const {
+        return origin_ + ": " + std::string(what);
+    }
+
+    // Request target: what follows the socket path in a unix:// URL, or the
+    // path and query of an http(s) URL
+    std::string target_(std::string_view url) const {
+        std::string_view rest;
+        if (url.starts_with(origin_)) {
+            rest = url.substr(origin_.size());
+        } else if (auto scheme = url.find("://"); scheme != std::string_view::npos) {
+            auto slash = url.find_first_of("/?", scheme + 3);
+            rest = slash == std::string_view::npos ? std::string_view {} : url.substr(slash);
+        }
+        std::string target(rest);
+        if (target.empty() || target.starts_with('?')) target.insert(0, "/");
+        return target;
+    }
+
+    std::string head_(const tinyhttps::HttpRequest& request, bool chunked) const {
+        std::string head;
+        head.reserve(256);
+        head += method_name(request.method);
+        head += ' ';
+        head += target_(request.url);
+        head += " HTTP/1.1\r\nHost: ";
+        head += kind_ == Kind::Unix ? std::string_view("localhost") : std::string_view(origin_).substr(origin_.find("://") + 3);
+        head += "\r\n";
+        bool acceptEncoding = false;
+        for (const auto& [name, value] : request.headers) {
+            head += name;
+            head += ": ";
+            head += value;
+            head += "\r\n";
+            acceptEncoding = acceptEncoding || iequals(name, "Accept-Encoding");
+        }
+        if (decompress_ && !acceptEncoding) {
+            head += "Accept-Encoding: ";
+            head += ACCEPT_ENCODING;
+            head += "\r\n";
+        }
+        if (chunked) {
+            head += "Transfer-Encoding: chunked\r\n";
+        } else if (!request.body.empty() || request.method == tinyhttps::Method::POST ||
+                   request.method == tinyhttps::Method::PUT || request.method == tinyhttps::Method::PATCH) {
+            head += "Content-Length: " + std::to_string(request.body.size()) + "\r\n";
+        }
+        head += config_.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        return head;
+    }
+
+    // A kept-alive connection may have been closed by the server while idle.
+    // A non-blocking probe catches most of those before anything is sent;
+    // one that closes in the meantime shows up as a failed write or EOF
+    // before any response byte, and the request is retried once on a new
+    // connection (re-running the body writer).
+    template<typename OnBody>
+    tinyhttps::HttpResponse exchange_(const tinyhttps::HttpRequest& request, const BodyWriter* body, OnBody&& onBody,
+                                      const tinyhttps::HttpResponse** headOut = nullptr) {
+        auto head = head_(request, body != nullptr);
+        tinyhttps::HttpResponse response;
+        struct BufferLease {
+            Http1Client& client;
+            ~BufferLease() { client.return_buffer_(); }
+        } lease { *this };
+        if (!leasedBuffer_) {
+            buffer_ = ReadBufferPool::shared().acquire();
+            leasedBuffer_ = true;
+        }
+        totalDeadline_.reset();
+        if (timeouts_.total) totalDeadline_ = std::chrono::steady_clock::now() + *timeouts_.total;
+        cancel_ = &current_cancellation();
+        check_cancel_();
+        for (int attempt = 0;; ++attempt) {
+            bool reused = connected();
+            if (reused && attempt == 0 && idle_closed_()) {
+                close_();
+                reused = false;
+            }
+            if (!reused) connect_();
+            readPhase_ = TimeoutPhase::FirstByte;
+            try {
+                write_(head);
+                if (body) {
+                    write_chunked_(*body);
+                } else {
+                    write_(request.body);
+                }
+                if (read_head_(response)) break;
+            } catch (const WriteFailed&) {
+            }
+            close_();
+            if (!reused || attempt > 0) {
+                throw std::runtime_error(error_("connection closed by server"));
+            }
+        }
+        if (headOut) *headOut = &response;
+
+        // Undo Content-Encoding between the socket and onBody. Codings we did
+        // not ask for (a caller's own Accept-Encoding) are passed through.
+        std::optional<Decompressor> decoder;
+        if (auto coding = header_(response, "Content-Encoding"); coding && decompress_) {
+            auto encoding = parse_content_encoding(*coding);
+            if (encoding && *encoding != ContentEncoding::Identity) {
+                decoder.emplace(*encoding);
+                stats_.compressed++;
+            }
+        }
+        stats_.responses++;
+        Decompressor::Output decoded = [&](std::string_view data) {
+            stats_.bodyBytes += data.size();
+            return onBody(data);
+        };
+        std::uint64_t received = 0;
+        auto deliver = [&](std::string_view data) {
+            received += data.size();
+            stats_.wireBytes += data.size();
+            return decoder ? decoder->feed(data, decoded) : decoded(data);
+        };
+
+        bool complete = true;
+        bool bodyless = request.method == tinyhttps::Method::HEAD || response.statusCode == 204 ||
+                        response.statusCode == 304 || response.statusCode / 100 == 1;
+        if (bodyless) {
+            // nothing to read
+        } else if (auto encoding = header_(response, "Transfer-Encoding"); encoding && iequals(*encoding, "chunked")) {
+            complete = read_chunked_(deliver);
+        } else if (auto length = header_(response, "Content-Length")) {
+            complete = read_exact_(std::stoull(*length), deliver);
+        } else {
+            read_to_close_(deliver);
+            complete = false;   // the connection is gone
+        }
+        if (decoder) {
+            if (complete && received > 0 && !decoder->finished()) {
+                close_();
+                throw std::runtime_error(error_("truncated compressed response body"));
+            }
+            // What the caller gets is the decoded body
+            erase_header_(response, "Content-Encoding");
+            erase_header_(response, "Content-Length");
+        }
+
+        auto connection = header_(response, "Connection");
+        if (!complete || !buffer_.empty() || !config_.keepAlive || (connection && iequals(*connection, "close"))) {
+            close_();
+        }
+        return response;
+    }
+
+    static std::optional<std::string> header_(const tinyhttps::HttpResponse& response, std::string_view name) {
+        for (const auto& [key, value] : response.headers) {
+            if (iequals(key, name)) return value;
+        }
+        return std::nullopt;
+    }
+
+    static void erase_header_(tinyhttps::HttpResponse& response, std::string_view name) {
+        std::erase_if(response.headers, [&](const auto& header) { return iequals(header.first, name); });
+    }
+
+    // The budget for `phase`, cut short by the total deadline
+    std::pair<std::chrono::milliseconds, TimeoutPhase> budget_(TimeoutPhase phase,
+                                                               std::optional<std::chrono::milliseconds> limit,
+                                                               int fallbackMs) const {
+        auto wait = limit.value_or(std::chrono::milliseconds { fallbackMs });
+        if (totalDeadline_) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(*totalDeadline_ - std::chrono::steady_clock::now());
+            if (left < wait) return { std::max(left, std::chrono::milliseconds { 0 }), TimeoutPhase::Total };
+        }
+        return { wait, phase };
+    }
+
+    [[noreturn]] void timed_out_(TimeoutPhase phase) {
+        close_();
+        auto limit = phase == TimeoutPhase::Total ? *timeouts_.total
+                   : phase == TimeoutPhase::Connect ? timeouts_.connect.value_or(std::chrono::milliseconds { config_.connectTimeoutMs })
+                   : phase == TimeoutPhase::FirstByte ? timeouts_.firstByte.value_or(std::chrono::milliseconds { config_.readTimeoutMs })
+                   : timeouts_.streamIdle.value_or(std::chrono::milliseconds { config_.readTimeoutMs });
+        throw TimeoutError(phase, limit, origin_);
+    }
+
+    void connect_() {
+        buffer_.clear();
+        auto [budget, phase] = budget_(TimeoutPhase::Connect, timeouts_.connect, config_.connectTimeoutMs);
+        budget = std::min(budget, cancel_->remaining());
+        if (budget.count() <= 0) {
+            check_cancel_();
+            timed_out_(phase);
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto ms = static_cast<int>(budget.count());
+        try {
+            switch (kind_) {
+                case Kind::Unix:
+                    stream_.emplace<UnixStream>().connect(host_);
+                    return;
+                case Kind::Tcp:
+                    if (stream_.emplace<tinyhttps::Socket>().connect(host_, port_, ms)) return;
+                    break;
+                case Kind::Tls:
+                    if (stream_.emplace<tinyhttps::TlsSocket>().connect(host_, port_, ms, config_.verifySsl)) return;
+                    break;
+            }
+        } catch (const std::runtime_error& e) {
+            close_();
+            throw std::runtime_error(error_(e.what()));
+        }
+        // tinyhttps reports a timeout as a plain failure: tell them apart by the clock
+        check_cancel_();
+        if (std::chrono::steady_clock::now() - start >= budget) timed_out_(phase);
+        close_();
+        throw std::runtime_error(error_("connect failed"));
+    }
+
+    void close_() {
+        stream_.emplace<std::monostate>();
+        buffer_.clear();
+    }
+
+    // Throws WriteFailed when the peer is gone
+    void write_(std::string_view data) {
+        while (!data.empty()) {
+            auto size = static_cast<int>(std::min<std::size_t>(data.size(), 1 << 30));
+            int n = std::visit([&](auto& stream) -> int {
+                if constexpr (std::is_same_v<std::decay_t<decltype(stream)>, std::monostate>) {
+                    return -1;
+                } else {
+                    return stream.write(data.data(), size);
+                }
+            }, stream_);
+            if (n <= 0) throw WriteFailed {};
+            data.remove_prefix(static_cast<std::size_t>(n));
+        }
+    }
+
+    void write_chunked_(const BodyWriter& body) {
+        BodySink sink { BODY_CHUNK_BYTES, [&](std::string_view chunk) {
+            check_total_();
+            check_cancel_();
+            char size[20];
+            auto [end, ec] = std::to_chars(size, size + sizeof(size), chunk.size(), 16);
+            write_(std::string_view(size, static_cast<std::size_t>(end - size)));
+            write_("\r\n");
+            write_(chunk);
+            write_("\r\n");
+        } };
+        body(sink);
+        sink.flush();
+        write_("0\r\n\r\n");
+    }
+
+    // Writes block in the socket layer; the total deadline is checked
+    // between body chunks
+    void check_total_() {
+        if (totalDeadline_ && std::chrono::steady_clock::now() >= *totalDeadline_) timed_out_(TimeoutPhase::Total);
+    }
+
+    // A cancelled call closes its connection, so the upstream sees the
+    // disconnect and stops generating
+    void check_cancel_() {
+        if (cancel_->active() && (cancel_->stop_requested() || cancel_->expired())) {
+            close_();
+            cancel_->check(origin_);
+        }
+    }
+
+    // Waits up to `budget` for the connection to become readable. A
+    // cancellable call waits in slices of CANCEL_POLL, since a stop request
+    // cannot interrupt a blocked wait on a tinyhttps socket.
+    void await_readable_(std::chrono::milliseconds budget, TimeoutPhase phase) {
+        auto until = std::chrono::steady_clock::now() + budget;
+        for (;;) {
+            check_cancel_();
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(until - std::chrono::steady_clock::now());
+            if (left.count() <= 0) timed_out_(phase);
+            if (cancel_->active()) {
+                left = std::min({ left, CANCEL_POLL, std::max(cancel_->remaining(), std::chrono::milliseconds { 1 }) });
+            }
+            auto waitMs = static_cast<int>(std::min<std::int64_t>(left.count(), std::numeric_limits<int>::max()));
+            bool ready = std::visit([&](auto& stream) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(stream)>, std::monostate>) {
+                    return true;   // read_ reports EOF
+                } else {
+                    return stream.wait_readable(waitMs);
+                }
+            }, stream_);
+            if (ready) return;
+        }
+    }
+
+    // Liveness probe for an idle kept-alive connection: between exchanges
+    // the server has nothing to send, so a readable socket means it closed
+    // the connection (EOF, or a TLS close_notify) or broke the protocol
+    bool idle_closed_() {
+        return std::visit([](auto& stream) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(stream)>, std::monostate>) {
+                return true;
+            } else {
+                return stream.wait_readable(0);
+            }
+        }, stream_);
+    }
+
+    // Whether a read can make progress although the socket may not poll
+    // readable: a TLS socket can hold decrypted bytes of a record it has
+    // already taken off the wire. Without a way to ask, every read polls
+    // first; TLS reads offer a whole record of space, so none is left
+    // half-drained behind a socket that stays quiet.
+    template<typename S>
+    bool buffered_(S& stream) const {
+        if constexpr (!std::is_same_v<S, tinyhttps::TlsSocket>) {
+            return false;
+        } else if constexpr (requires { { stream.pending() } -> std::convertible_to<std::size_t>; }) {
+            return stream.pending() > 0;
+        } else {
+            return false;
+        }
+    }
+
+    // Between exchanges the receive buffer goes back to the pool, so an idle
+    // kept-alive connection holds none
+    void return_buffer_() {
+        if (!leasedBuffer_) return;
+        leasedBuffer_ = false;
+        ReadBufferPool::shared().release(std::exchange(buffer_, std::string {}));
+    }
+
+    // Reads the next bytes from the connection straight into buffer_, up to
+    // the block size (further only for a line longer than a block); false
+    // on EOF. Waits no longer than the current phase allows.
+    bool fill_() {
+        auto [budget, phase] = readPhase_ == TimeoutPhase::FirstByte
+            ? budget_(TimeoutPhase::FirstByte, timeouts_.firstByte, config_.readTimeoutMs)
+            : budget_(TimeoutPhase::StreamIdle, timeouts_.streamIdle, config_.readTimeoutMs);
+        bool buffered = std::visit([&](auto& stream) { return buffered_(stream); }, stream_);
+        if (!buffered) await_readable_(budget, phase);
+        auto size = buffer_.size();
+        auto room = std::max(ReadBufferPool::BLOCK_BYTES - std::min(size, ReadBufferPool::BLOCK_BYTES),
+                             ReadBufferPool::BLOCK_BYTES / 4);
+        if (kind_ == Kind::Tls) room = std::max(room, TLS_RECORD_BYTES);
+        int n = 0;
+        buffer_.resize_and_overwrite(size + room, [&](char* data, std::size_t) {
+            n = std::visit([&](auto& stream) -> int {
+                if constexpr (std::is_same_v<std::decay_t<decltype(stream)>, std::monostate>) {
+                    return 0;
+                } else {
+                    return stream.read(data + size, static_cast<int>(room));
+                }
+            }, stream_);
+            return size + static_cast<std::size_t>(std::max(n, 0));
+        });
+        if (n < 0) {
+            close_();
+            throw std::runtime_error(error_("read failed"));
+        }
+        if (n > 0) readPhase_ = TimeoutPhase::StreamIdle;
+        return n > 0;
+    }
+
+    // False if the connection closed before any part of the response arrived
+    bool read_head_(tinyhttps::HttpResponse& response) {
+        std::size_t end;
+        while ((end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+            auto before = buffer_.size();
+            if (!fill_()) {
+                if (before == 0) return false;
+                throw std::runtime_error(error_("truncated response head"));
+            }
+        }
+        std::string_view head { buffer_.data(), end };
+        auto lineEnd = head.find("\r\n");
+        auto statusLine = head.substr(0, lineEnd);
+        auto sp1 = statusLine.find(' ');
+        if (!statusLine.starts_with("HTTP/") || sp1 == std::string_view::npos) {
+            throw std::runtime_error(error_("malformed status line"));
+        }
+        auto sp2 = statusLine.find(' ', sp1 + 1);
+        response.statusCode = std::stoi(std::string(statusLine.substr(sp1 + 1, 3)));
+        response.statusText = sp2 == std::string_view::npos ? std::string {} : std::string(statusLine.substr(sp2 + 1));
+        auto pos = lineEnd == std::string_view::npos ? head.size() : lineEnd + 2;
+        while (pos < head.size()) {
+            auto next = head.find("\r\n", pos);
+            if (next == std::string_view::npos) next = head.size();
+            auto line = head.substr(pos, next - pos);
+            if (auto colon = line.find(':'); colon != std::string_view::npos) {
+                auto value = line.substr(colon + 1);
+                while (value.starts_with(' ') || value.starts_with('\t')) value.remove_prefix(1);
+                response.headers[std::string(line.substr(0, colon))] = std::string(value);
+            }
+            pos = next + 2;
+        }
+        buffer_.erase(0, end + 4);
+        return true;
+    }
+
+    std::string read_line_() {
+        std::size_t end;
+        while ((end = buffer_.find("\r\n")) == std::string::npos) {
+            if (!fill_()) throw std::runtime_error(error_("truncated response"));
+        }
+        auto line = buffer_.substr(0, end);
+        buffer_.erase(0, end + 2);
+        return line;
+    }
+
+    // Hands exactly `size` body bytes to onBody; false if it asked to stop
+    template<typename OnBody>
+    bool read_exact_(std::uint64_t size, OnBody& onBody) {
+        while (size > 0) {
+            if (buffer_.empty() && !fill_()) {
+                throw std::runtime_error(error_("truncated response body"));
+            }
+            auto take = static_cast<std::size_t>(std::min<std::uint64_t>(size, buffer_.size()));
+            bool more = onBody(std::string_view(buffer_).substr(0, take));
+            buffer_.erase(0, take);
+            size -= take;
+            if (!more) return false;
+        }
+        return true;
+    }
+
+    template<typename OnBody>
+    bool read_chunked_(OnBody& onBody) {
+        for (;;) {
+            auto line = read_line_();
+            auto size = std::stoull(line.substr(0, line.find(';')), nullptr, 16);
+            if (size == 0) {
+                while (!read_line_().empty()) {}   // trailers
+                return true;
+            }
+            if (!read_exact_(size, onBody)) return false;
+            read_line_();
+        }
+    }
+
+    template<typename OnBody>
+    void read_to_close_(OnBody& onBody) {
+        do {
+            if (!buffer_.empty() && !onBody(std::string_view(buffer_))) break;
+            buffer_.clear();
+        } while (fill_());
+    }
+};
+
+// The HTTP client behind every provider. Plain http:// requests go through
+// an Http1Client for their origin, which decodes compressed responses;
+// https:// ones go through tinyhttps unless `nativeTls` is set. Streamed
+// request bodies and downloads always take the Http1Client, since tinyhttps
+// holds both in memory. Behind a proxy everything goes through tinyhttps
+// (only it tunnels), so responses are fetched uncompressed and streamed
+// bodies are collected first. unix:// URLs never use the proxy. tinyhttps
+// clients (and the CONNECT tunnels they hold) come from
+// HttpClientPool::shared().
+class HttpTransport {
+private:
+    tinyhttps::HttpClientConfig config_;
+    tinyhttps::HttpClientConfig bufferedConfig_;   // pooled tinyhttps, whole responses
+    tinyhttps::HttpClientConfig streamConfig_;     // pooled tinyhttps, SSE streams
+    bool decompress_;
+    Timeouts timeouts_;
+    bool nativeTls_;
+    std::list<Http1Client> direct_;   // one per origin; stable addresses
+
+public:
+    // tinyhttps has a single per-read timeout and no total deadline: on that
+    // path whole responses read with firstByte and streams with streamIdle
+    // (headers included), each capped at total. total is also checked
+    // between SSE events. A read that ran out surfaces as TimeoutError.
+    explicit HttpTransport(tinyhttps::HttpClientConfig config = {}, bool decompress = true, Timeouts timeouts = {},
+                           bool nativeTls = false)
+        : config_(std::move(config))
+        , decompress_(decompress)
+        , timeouts_(timeouts)
+        , nativeTls_(nativeTls)
+    {
+        if (timeouts_.connect) config_.connectTimeoutMs = static_cast<int>(timeouts_.connect->count());
+        bufferedConfig_ = pooled_config_(timeouts_.firstByte);
+        streamConfig_ = pooled_config_(timeouts_.streamIdle);
+    }
+
+    // Summed over the direct connections; proxied traffic is not counted
+    TransferStats stats() const {
+        TransferStats total;
+        for (const auto& client : direct_) total += client.stats();
+        return total;
+    }
+
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request) {
+        if (direct_for_(request.url)) {
+            return direct_client_(request.url).send(request);
+        }
+        return pooled_(request.url, [&](tinyhttps::HttpClient& http) { return http.send(request); });
+    }
+
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request, const BodyWriter& body) {
+        if (is_unix_url(request.url) || !config_.proxy) {
+            return direct_client_(request.url).send(request, body);
+        }
+        auto collected = collected_(request, body);
+        return pooled_(request.url, [&](tinyhttps::HttpClient& http) { return http.send(collected); });
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, F&& callback) {
+        if (direct_for_(request.url)) {
+            return direct_client_(request.url).send_stream(request, std::forward<F>(callback));
+        }
+        return pooled_stream_(request, callback);
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, const BodyWriter& body, F&& callback) {
+        if (is_unix_url(request.url) || !config_.proxy) {
+            return direct_client_(request.url).send_stream(request, body, std::forward<F>(callback));
+        }
+        return pooled_stream_(collected_(request, body), callback);
+    }
+
+    // Behind a proxy the body is fetched whole and handed over in one piece
+    template<typename F>
+    tinyhttps::HttpResponse send_download(const tinyhttps::HttpRequest& request, F&& onBody) {
+        if (is_unix_url(request.url) || !config_.proxy) {
+            return direct_client_(request.url).send_download(request, std::forward<F>(onBody));
+        }
+        auto response = pooled_(request.url, [&](tinyhttps::HttpClient& http) { return http.send(request); });
+        if (response.ok()) {
+            onBody(std::string_view(response.body));
+            response.body.clear();
+        }
+        return response;
+    }
+
+private:
+    tinyhttps::HttpClientConfig pooled_config_(std::optional<std::chrono::milliseconds> read) const {
+        auto config = config_;
+        if (timeouts_.total) read = read ? std::min(*read, *timeouts_.total) : *timeouts_.total;
+        if (read) config.readTimeoutMs = static_cast<int>(std::max<std::int64_t>(read->count(), 1));
+        return config;
+    }
+
+    // A whole response read with bufferedConfig_. tinyhttps cannot be
+    // interrupted, so cancellation is checked only before and after the
+    // call. It reports a timeout as a plain failure: one that came after a
+    // full read timeout is taken to be it.
+    template<typename F>
+    tinyhttps::HttpResponse pooled_(std::string_view url, F&& use) {
+        auto start = std::chrono::steady_clock::now();
+        auto response = leased_(url, bufferedConfig_, [&](tinyhttps::HttpClient& http) {
+            try {
+                auto response = use(http);
+                if (response.statusCode == 0) timed_out_(start, bufferedConfig_, TimeoutPhase::FirstByte, url);
+                return response;
+            } catch (const std::runtime_error&) {
+                timed_out_(start, bufferedConfig_, TimeoutPhase::FirstByte, url);
+                throw;
+            }
+        });
+        // The call could not be interrupted; a stop that came meanwhile still
+        // wins over its result
+        current_cancellation().check(url_origin(url));
+        return response;
+    }
+
+    // The total deadline and cancellation are checked between SSE events;
+    // either one throws from inside leased_, so the half-read connection is
+    // discarded rather than returned to the pool. A stream that ends a full
+    // read timeout after its last event was cut off by that timeout.
+    template<typename F>
+    tinyhttps::HttpResponse pooled_stream_(const tinyhttps::HttpRequest& request, F& callback) {
+        auto start = std::chrono::steady_clock::now();
+        const auto& cancel = current_cancellation();
+        return leased_(request.url, streamConfig_, [&](tinyhttps::HttpClient& http) {
+            bool expired = false;
+            bool cancelled = false;
+            std::optional<std::chrono::steady_clock::time_point> lastEvent;
+            tinyhttps::HttpResponse response;
+            try {
+                response = http.send_stream(request, [&](const tinyhttps::SseEvent& event) -> bool {
+                    lastEvent = std::chrono::steady_clock::now();
+                    if (timeouts_.total && *lastEvent - start >= *timeouts_.total) {
+                        expired = true;
+                        return false;
+                    }
+                    if (cancel.active() && (cancel.stop_requested() || cancel.expired())) {
+                        cancelled = true;
+                        return false;
+                    }
+                    return callback(event);
+                });
+            } catch (const std::runtime_error&) {
+                if (!lastEvent) timed_out_(start, streamConfig_, TimeoutPhase::FirstByte, request.url);
+                else timed_out_(*lastEvent, streamConfig_, TimeoutPhase::StreamIdle, request.url, start);
+                throw;
+            }
+            if (expired) throw TimeoutError(TimeoutPhase::Total, *timeouts_.total, url_origin(request.url));
+            if (cancelled) cancel.check(url_origin(request.url));
+            if (!lastEvent) timed_out_(start, streamConfig_, TimeoutPhase::FirstByte, request.url);
+            else timed_out_(*lastEvent, streamConfig_, TimeoutPhase::StreamIdle, request.url, start);
+            return response;
+        });
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse leased_(std::string_view url, const tinyhttps::HttpClientConfig& config, F&& use) {
+        current_cancellation().check(url_origin(url));
+        auto lease = HttpClientPool::shared().acquire(config, url);
+        try {
+            return use(lease.client());
+        } catch (...) {
+            lease.discard();
+            throw;
+        }
+    }
+
+    // Throws TimeoutError if a read that began at `since` (the exchange
+    // itself began at `start`) used up the read timeout of `config`; the
+    // total deadline is named when it was the binding limit
+    void timed_out_(std::chrono::steady_clock::time_point since, const tinyhttps::HttpClientConfig& config,
+                    TimeoutPhase phase, std::string_view url,
+                    std::optional<std::chrono::steady_clock::time_point> start = std::nullopt) const {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::milliseconds limit { config.readTimeoutMs };
+        if (now - since < limit) return;
+        if (timeouts_.total && now - start.value_or(since) >= *timeouts_.total) {
+            throw TimeoutError(TimeoutPhase::Total, *timeouts_.total, url_origin(url));
+        }
+        throw TimeoutError(phase, limit, url_origin(url));
+    }
+
+    // Where buffered requests and SSE streams go
+    bool direct_for_(std::string_view url) const {
+        if (is_unix_url(url)) return true;
+        if (config_.proxy) return false;
+        return url.starts_with("https://") ? nativeTls_ : decompress_;
+    }
+
+    Http1Client& direct_client_(std::string_view url) {
+        // Match by prefix first: skips the filesystem walk for unix:// URLs
+        for (auto& client : direct_) {
+            if (client.serves(url)) return client;
+        }
+        return direct_.emplace_back(url, config_, decompress_, timeouts_);
+    }
+
+    static tinyhttps::HttpRequest collected_(const tinyhttps::HttpRequest& request, const BodyWriter& body) {
+        auto copy = request;
+        copy.body.clear();
+        BodySink sink { BODY_CHUNK_BYTES, [&](std::string_view chunk) { copy.body.append(chunk); } };
+        body(sink);
+        sink.flush();
+        return copy;
+    }
+};
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,183 @@
+export module mcpplibs.llmapi:http_pool;
+
+import mcpplibs.tinyhttps;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+struct HttpPoolOptions {
+    std::size_t maxIdlePerKey { 8 };
+    // Idle connections older than this are dropped rather than reused:
+    // proxies and load balancers close idle tunnels after about a minute,
+    // and a request on a dead one costs a failed write plus a reconnect.
+    std::chrono::milliseconds idleTimeout { std::chrono::seconds { 45 } };
+    // Connections are retired after this long even if kept busy, so DNS and
+    // proxy changes are eventually picked up
+    std::chrono::milliseconds maxAge { std::chrono::minutes { 10 } };
+};
+
+struct HttpPoolStats {
+    std::uint64_t created { 0 };
+    std::uint64_t reused { 0 };
+    std::uint64_t expired { 0 };     // idle or too old when next wanted
+    std::uint64_t discarded { 0 };   // failed while in use
+    std::size_t idle { 0 };
+};
+
+// Process-wide pool of keep-alive tinyhttps clients, keyed by (proxy,
+// origin, client settings). Through a proxy each client holds a CONNECT
+// tunnel with TLS on top; leasing it again skips the CONNECT round trip and
+// the handshake, also for a different provider instance. Direct origins
+// that go through tinyhttps are pooled the same way.
+//
+// A client is leased by one request at a time. tinyhttps does not expose
+// its socket, so an idle client cannot be probed for a closed connection;
+// instead it is only reused within the idle time and age limits of
+// HttpPoolOptions, and a client whose request threw is closed instead of
+// returned. Thread-safe.
+class HttpClientPool {
+public:
+    class Lease {
+    private:
+        HttpClientPool* pool_ { nullptr };
+        std::string key_;
+        std::unique_ptr<tinyhttps::HttpClient> client_;
+        std::chrono::steady_clock::time_point createdAt_;
+
+    public:
+        Lease(HttpClientPool* pool, std::string key, std::unique_ptr<tinyhttps::HttpClient> client,
+              std::chrono::steady_clock::time_point createdAt)
+            : pool_(pool), key_(std::move(key)), client_(std::move(client)), createdAt_(createdAt) {}
+
+        ~Lease() {
+            if (client_) pool_->release_(std::move(key_), std::move(client_), createdAt_);
+        }
+
+        Lease(Lease&&) = default;
+        Lease& operator=(Lease&&) = delete;
+
+        tinyhttps::HttpClient& client() { return *client_; }
+
+        // The connection is in an unknown state; close it instead of pooling it
+        void discard() {
+            if (!client_) return;
+            client_.reset();
+            std::lock_guard lock { pool_->mutex_ };
+            pool_->stats_.discarded++;
+        }
+    };
+
+private:
+    struct Idle {
+        std::unique_ptr<tinyhttps::HttpClient> client;
+        std::chrono::steady_clock::time_point createdAt;
+        std::chrono::steady_clock::time_point idleSince;
+    };
+
+    mutable std::mutex mutex_;
+    HttpPoolOptions options_;
+    std::map<std::string, std::vector<Idle>> idle_;   // most recently used last
+    HttpPoolStats stats_;
+
+public:
+    explicit HttpClientPool(HttpPoolOptions options = {}) : options_(options) {}
+
+    HttpClientPool(const HttpClientPool&) = delete;
+    HttpClientPool& operator=(const HttpClientPool&) = delete;
+
+    // Shared by every provider in the process
+    static HttpClientPool& shared() {
+        static HttpClientPool pool;
+        return pool;
+    }
+
+    void set_options(HttpPoolOptions options) {
+        std::lock_guard lock { mutex_ };
+        options_ = options;
+    }
+
+    // A client for requests to `url` with `config`: the most recently used
+    // idle one still within the limits, or a new one
+    Lease acquire(const tinyhttps::HttpClientConfig& config, std::string_view url) {
+        auto key = key_(config, url);
+        auto now = std::chrono::steady_clock::now();
+        std::vector<Idle> expired;   // closed outside the lock
+        {
+            std::lock_guard lock { mutex_ };
+            if (auto it = idle_.find(key); it != idle_.end()) {
+                auto& clients = it->second;
+                while (!clients.empty()) {
+                    auto entry = std::move(clients.back());
+                    clients.pop_back();
+                    if (!within_limits_(entry, now)) {
+                        stats_.expired++;
+                        expired.push_back(std::move(entry));
+                        continue;
+                    }
+                    stats_.reused++;
+                    if (clients.empty()) idle_.erase(it);
+                    return Lease(this, std::move(key), std::move(entry.client), entry.createdAt);
+                }
+                idle_.erase(it);
+            }
+            stats_.created++;
+        }
+        return Lease(this, std::move(key), std::make_unique<tinyhttps::HttpClient>(config), now);
+    }
+
+    // Closes idle clients that are past the idle time or age limit
+    void prune() {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<Idle> expired;
+        std::lock_guard lock { mutex_ };
+        for (auto it = idle_.begin(); it != idle_.end();) {
+            std::erase_if(it->second, [&](Idle& entry) {
+                if (within_limits_(entry, now)) return false;
+                stats_.expired++;
+                expired.push_back(std::move(entry));
+                return true;
+            });
+            it = it->second.empty() ? idle_.erase(it) : std::next(it);
+        }
+    }
+
+    // Closes every idle client
+    void clear() {
+        std::map<std::string, std::vector<Idle>> idle;
+        std::lock_guard lock { mutex_ };
+        idle.swap(idle_);
+    }
+
+    HttpPoolStats stats() const {
+        std::lock_guard lock { mutex_ };
+        auto stats = stats_;
+        for (const auto& [key, clients] : idle_) stats.idle += clients.size();
+        return stats;
+    }
+
+private:
+    static std::string key_(const tinyhttps::HttpClientConfig& config, std::string_view url) {
+        auto scheme = url.find("://");
+        auto end = scheme == std::string_view::npos ? url.size() : url.find_first_of("/?#", scheme + 3);
+        return std::format("{}|{}|{}|{}|{}|{}", config.proxy.value_or(""), url.substr(0, end),
+                           config.verifySsl, config.keepAlive, config.connectTimeoutMs, config.readTimeoutMs);
+    }
+
+    bool within_limits_(const Idle& entry, std::chrono::steady_clock::time_point now) const {
+        return now - entry.idleSince < options_.idleTimeout && now - entry.createdAt < options_.maxAge;
+    }
+
+    void release_(std::string key, std::unique_ptr<tinyhttps::HttpClient> client,
+                  std::chrono::steady_clock::time_point createdAt) {
+        std::unique_ptr<tinyhttps::HttpClient> evicted;   // closed outside the lock
+        std::lock_guard lock { mutex_ };
+        auto& clients = idle_[std::move(key)];
+        clients.push_back(Idle { std::move(client), createdAt, std::chrono::steady_clock::now() });
+        if (clients.size() > options_.maxIdlePerKey) {
+            evicted = std::move(clients.front().client);   // least recently used
+            clients.erase(clients.begin());
+        }
+    }
+};
+
+} // namespace mcpplibs::llmapi
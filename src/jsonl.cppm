@@ -0,0 +1,173 @@
+export module mcpplibs.llmapi:jsonl;
+
+import std;
+
+export namespace mcpplibs::llmapi {
+
+// Append-only JSON Lines file. Lines go straight to disk as they are
+// written, so building a batch of millions of requests needs memory for
+// one request at a time.
+class JsonlWriter {
+private:
+    std::filesystem::path path_;
+    std::ofstream out_;
+    std::size_t lines_ { 0 };
+    std::uint64_t bytes_ { 0 };
+
+public:
+    explicit JsonlWriter(std::filesystem::path path)
+        : path_(std::move(path))
+        , out_(path_, std::ios::binary | std::ios::trunc)
+    {
+        if (!out_) {
+            throw std::runtime_error("cannot open " + path_.string() + " for writing");
+        }
+    }
+
+    // `line` must not contain a newline (compact JSON never does)
+    void write(std::string_view line) {
+        out_.write(line.data(), static_cast<std::streamsize>(line.size()));
+        out_.put('\n');
+        if (!out_) {
+            throw std::runtime_error("write to " + path_.string() + " failed");
+        }
+        lines_++;
+        bytes_ += line.size() + 1;
+    }
+
+    void flush() { out_.flush(); }
+    void close() { out_.close(); }
+
+    std::size_t lines() const { return lines_; }
+    std::uint64_t bytes() const { return bytes_; }
+    const std::filesystem::path& path() const { return path_; }
+};
+
+struct JsonlReadOptions {
+    std::size_t threads { 0 };                // 0 = one per core
+    std::size_t chunkBytes { 1 << 20 };       // read size; a chunk always ends on a line boundary
+    std::size_t maxQueuedChunks { 0 };        // 0 = 2 per thread; bounds memory to ~chunks * chunkBytes
+};
+
+// Calls handler(line) for every non-empty line of a JSONL file. One thread
+// reads the file in chunks while `threads` workers parse them, so large
+// result files are neither loaded whole nor parsed on a single core. The
+// handler runs concurrently and lines arrive in no particular order. The
+// first exception a handler throws stops the read and is rethrown here, as
+// is a read error, so a file cut short by I/O failure is never taken as
+// complete.
+inline void for_each_jsonl_line(const std::filesystem::path& path,
+                                const std::function<void(std::string_view)>& handler,
+                                JsonlReadOptions options = {}) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path.string());
+    }
+    auto threads = options.threads != 0 ? options.threads
+                                         : std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    auto maxQueued = options.maxQueuedChunks != 0 ? options.maxQueuedChunks : threads * 2;
+    auto chunkBytes = std::max<std::size_t>(options.chunkBytes, 1);
+
+    std::mutex mutex;
+    std::condition_variable readable;
+    std::condition_variable writable;
+    std::deque<std::string> queue;
+    bool done = false;
+    std::exception_ptr error;
+
+    auto worker = [&] {
+        while (true) {
+            std::string chunk;
+            {
+                std::unique_lock lock { mutex };
+                readable.wait(lock, [&] { return !queue.empty() || done || error; });
+                if (error || queue.empty()) return;
+                chunk = std::move(queue.front());
+                queue.pop_front();
+            }
+            writable.notify_one();
+            try {
+                std::string_view rest { chunk };
+                while (!rest.empty()) {
+                    auto end = rest.find('\n');
+                    auto line = rest.substr(0, end);
+                    rest = end == std::string_view::npos ? std::string_view {} : rest.substr(end + 1);
+                    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                    if (!line.empty()) handler(line);
+                }
+            } catch (...) {
+                {
+                    std::lock_guard lock { mutex };
+                    if (!error) error = std::current_exception();
+                }
+                readable.notify_all();
+                writable.notify_all();
+                return;
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> pool;
+        // However reading ends, the workers are told before the jthreads join them
+        struct Finish {
+            std::mutex& mutex;
+            bool& done;
+            std::condition_variable& readable;
+            ~Finish() {
+                {
+                    std::lock_guard lock { mutex };
+                    done = true;
+                }
+                readable.notify_all();
+            }
+        } finish { mutex, done, readable };
+
+        try {
+            for (std::size_t i = 0; i < threads; ++i) {
+                pool.emplace_back(worker);
+            }
+
+            std::string carry;
+            while (in) {
+                auto chunk = std::move(carry);
+                carry.clear();
+                auto offset = chunk.size();
+                chunk.resize(offset + chunkBytes);
+                in.read(chunk.data() + offset, static_cast<std::streamsize>(chunkBytes));
+                chunk.resize(offset + static_cast<std::size_t>(in.gcount()));
+                if (in) {
+                    // Hand whole lines to the workers; the partial tail goes with the next read
+                    auto newline = chunk.rfind('\n');
+                    if (newline == std::string::npos) {
+                        carry = std::move(chunk);
+                        continue;
+                    }
+                    carry.assign(chunk, newline + 1);
+                    chunk.resize(newline + 1);
+                }
+                if (chunk.empty()) continue;
+
+                std::unique_lock lock { mutex };
+                writable.wait(lock, [&] { return queue.size() < maxQueued || error; });
+                if (error) break;
+                queue.push_back(std::move(chunk));
+                lock.unlock();
+                readable.notify_one();
+            }
+            // EOF ends the loop too; only an I/O error leaves badbit
+            if (in.bad()) {
+                throw std::runtime_error("read from " + path.string() + " failed");
+            }
+        } catch (...) {
+            std::lock_guard lock { mutex };
+            if (!error) error = std::current_exception();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace mcpplibs::llmapi
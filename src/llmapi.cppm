@@ -2,12 +2,39 @@ export module mcpplibs.llmapi;
 
 export import :types;
 export import :url;
+export import :cancel;
 export import :coro;
+export import :combinators;
 export import :provider;
 export import :client;
 export import :openai;
 export import :anthropic;
 export import :errors;
+export import :retry;
+export import :metrics;
+export import :hedging;
+export import :any_provider;
+export import :circuit_breaker;
+export import :fallback;
+export import :routing;
+export import :rate_limit;
+export import :multi_key;
+export import :affinity;
+export import :dispatch;
+export import :files;
+export import :openai_responses;
+export import :jsonl;
+export import :batch;
+export import :openai_batch;
+export import :anthropic_batch;
+export import :logprobs;
+export import :buffers;
+export import :compression;
+export import :http_pool;
+export import :http;
+export import :transport;
+export import :websocket;
+export import :openai_realtime;
 
 import std;
 
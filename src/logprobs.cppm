@@ -0,0 +1,163 @@
+export module mcpplibs.llmapi:logprobs;
+
+import :types;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+namespace mcpplibs::llmapi {
+
+// Parser callback that pulls choices[i].logprobs.content out of a chat
+// completion (or a stream chunk) while it is being parsed. Tokens go
+// straight into per-choice Logprobs and every logprobs node is dropped as
+// soon as it is complete, so the DOM never holds them.
+class LogprobsReader {
+public:
+    using Json = nlohmann::json;
+
+private:
+    enum class Frame { Other, Root, Choices, Choice, Logprobs, Content, Entry, Top, TopEntry };
+    enum class Key { Other, Choices, Index, Logprobs, Content, Token, Logprob, TopLogprobs };
+
+    struct Level {
+        Frame frame;
+        Key key { Key::Other };       // last key seen in this object
+        std::size_t children { 0 };   // containers started inside this one
+        std::size_t choice { 0 };
+    };
+
+    static constexpr std::size_t NONE { static_cast<std::size_t>(-1) };
+
+    std::vector<Logprobs>& out_;
+    std::size_t choices_;   // tokens of choices at or past this index are dropped
+    std::vector<Level> stack_;
+    std::size_t logprobsLevel_ { NONE };
+    std::string token_;
+    float logprob_ { 0 };
+    bool pending_ { false };
+
+public:
+    explicit LogprobsReader(std::vector<Logprobs>& out, std::size_t choices = NONE)
+        : out_(out)
+        , choices_(choices)
+    {}
+
+    Json parse(std::string_view text) {
+        stack_.clear();
+        logprobsLevel_ = NONE;
+        pending_ = false;
+        return Json::parse(text, [this](int, Json::parse_event_t event, Json& parsed) {
+            return on_event_(event, parsed);
+        });
+    }
+
+private:
+    static Key key_id_(const std::string& key) {
+        if (key == "choices") return Key::Choices;
+        if (key == "index") return Key::Index;
+        if (key == "logprobs") return Key::Logprobs;
+        if (key == "content") return Key::Content;
+        if (key == "token") return Key::Token;
+        if (key == "logprob") return Key::Logprob;
+        if (key == "top_logprobs") return Key::TopLogprobs;
+        return Key::Other;
+    }
+
+    Frame child_frame_(bool object) const {
+        if (stack_.empty()) return object ? Frame::Root : Frame::Other;
+        const auto& parent = stack_.back();
+        switch (parent.frame) {
+            case Frame::Root: return !object && parent.key == Key::Choices ? Frame::Choices : Frame::Other;
+            case Frame::Choices: return object ? Frame::Choice : Frame::Other;
+            case Frame::Choice: return object && parent.key == Key::Logprobs ? Frame::Logprobs : Frame::Other;
+            case Frame::Logprobs: return !object && parent.key == Key::Content ? Frame::Content : Frame::Other;
+            case Frame::Content: return object ? Frame::Entry : Frame::Other;
+            case Frame::Entry: return !object && parent.key == Key::TopLogprobs ? Frame::Top : Frame::Other;
+            case Frame::Top: return object ? Frame::TopEntry : Frame::Other;
+            default: return Frame::Other;
+        }
+    }
+
+    bool inside_logprobs_() const { return logprobsLevel_ != NONE && stack_.size() > logprobsLevel_; }
+
+    // Null for a choice outside the requested ones (or a negative index)
+    Logprobs* target_() {
+        auto choice = stack_.back().choice;
+        if (choice == NONE || choice >= choices_) return nullptr;
+        if (choice >= out_.size()) out_.resize(choice + 1);
+        return &out_[choice];
+    }
+
+    // The token is complete once its alternatives start or its entry ends
+    void commit_() {
+        if (!pending_) return;
+        if (auto* target = target_()) target->add_token(token_, logprob_);
+        pending_ = false;
+    }
+
+    bool on_event_(Json::parse_event_t event, Json& parsed) {
+        using Event = Json::parse_event_t;
+        switch (event) {
+            case Event::object_start:
+            case Event::array_start: {
+                auto frame = child_frame_(event == Event::object_start);
+                std::size_t choice { 0 };
+                if (!stack_.empty()) {
+                    auto& parent = stack_.back();
+                    choice = frame == Frame::Choice ? parent.children : parent.choice;
+                    parent.children++;
+                }
+                if (frame == Frame::Top) {
+                    commit_();
+                } else if (frame == Frame::Entry || frame == Frame::TopEntry) {
+                    token_.clear();
+                    logprob_ = 0;
+                    pending_ = true;
+                } else if (frame == Frame::Logprobs) {
+                    logprobsLevel_ = stack_.size();
+                }
+                stack_.push_back(Level { .frame = frame, .choice = choice });
+                return true;
+            }
+            case Event::key:
+                if (!stack_.empty() && parsed.is_string()) {
+                    stack_.back().key = key_id_(parsed.get_ref<const std::string&>());
+                }
+                return true;
+            case Event::value: {
+                if (stack_.empty()) return true;
+                auto& level = stack_.back();
+                if (level.frame == Frame::Choice && level.key == Key::Index && parsed.is_number_integer()) {
+                    level.choice = parsed.is_number_unsigned() ? parsed.get<std::size_t>() : NONE;
+                } else if (level.frame == Frame::Entry || level.frame == Frame::TopEntry) {
+                    if (level.key == Key::Token && parsed.is_string()) {
+                        token_ = parsed.get_ref<const std::string&>();
+                    } else if (level.key == Key::Logprob && parsed.is_number()) {
+                        logprob_ = parsed.get<float>();
+                    }
+                    return false;
+                }
+                return !inside_logprobs_();
+            }
+            case Event::object_end:
+            case Event::array_end: {
+                if (stack_.empty()) return true;
+                auto frame = stack_.back().frame;
+                bool drop = inside_logprobs_();
+                if (frame == Frame::Entry) {
+                    commit_();
+                } else if (frame == Frame::TopEntry && pending_) {
+                    if (auto* target = target_()) target->add_alternative(token_, logprob_);
+                    pending_ = false;
+                }
+                stack_.pop_back();
+                if (frame == Frame::Logprobs) {
+                    logprobsLevel_ = NONE;
+                }
+                return !drop;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,120 @@
+export module mcpplibs.llmapi:metrics;
+
+import std;
+
+export namespace mcpplibs::llmapi {
+
+// Thread-safe latency histogram with geometric buckets (x1.25, 1ms .. ~25min).
+// Samples age out: percentiles are computed over the current and the previous
+// window, so the distribution follows the live behaviour of the upstream.
+class LatencyHistogram {
+public:
+    static constexpr std::size_t BUCKETS { 64 };
+    static constexpr double GROWTH { 1.25 };
+
+private:
+    mutable std::mutex mutex_;
+    std::array<std::uint32_t, BUCKETS> current_ {};
+    std::array<std::uint32_t, BUCKETS> previous_ {};
+    std::uint64_t currentCount_ { 0 };
+    std::uint64_t previousCount_ { 0 };
+    std::chrono::milliseconds window_;
+    std::chrono::steady_clock::time_point windowStart_ { std::chrono::steady_clock::now() };
+
+public:
+    explicit LatencyHistogram(std::chrono::milliseconds window = std::chrono::seconds { 60 })
+        : window_(window) {}
+
+    void record(std::chrono::milliseconds latency) {
+        std::lock_guard lock { mutex_ };
+        rotate_();
+        current_[bucket_for_(latency)]++;
+        currentCount_++;
+    }
+
+    // q in [0, 1]; nullopt until at least minSamples are available
+    std::optional<std::chrono::milliseconds> percentile(double q, std::size_t minSamples = 1) const {
+        std::lock_guard lock { mutex_ };
+        auto total = currentCount_ + previousCount_;
+        if (total == 0 || total < minSamples) return std::nullopt;
+
+        auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total)));
+        rank = std::max<std::uint64_t>(rank, 1);
+        std::uint64_t seen { 0 };
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            seen += current_[i] + previous_[i];
+            if (seen >= rank) {
+                return upper_bound_(i);
+            }
+        }
+        return upper_bound_(BUCKETS - 1);
+    }
+
+    std::uint64_t count() const {
+        std::lock_guard lock { mutex_ };
+        return currentCount_ + previousCount_;
+    }
+
+private:
+    void rotate_() {
+        auto now = std::chrono::steady_clock::now();
+        if (now - windowStart_ < window_) return;
+        if (now - windowStart_ >= 2 * window_) {
+            previous_ = {};
+            previousCount_ = 0;
+        } else {
+            previous_ = current_;
+            previousCount_ = currentCount_;
+        }
+        current_ = {};
+        currentCount_ = 0;
+        windowStart_ = now;
+    }
+
+    static std::size_t bucket_for_(std::chrono::milliseconds latency) {
+        auto ms = static_cast<double>(std::max<std::int64_t>(latency.count(), 1));
+        auto index = static_cast<std::size_t>(std::ceil(std::log(ms) / std::log(GROWTH)));
+        return std::min(index, BUCKETS - 1);
+    }
+
+    static std::chrono::milliseconds upper_bound_(std::size_t index) {
+        return std::chrono::milliseconds { static_cast<std::int64_t>(std::ceil(std::pow(GROWTH, index))) };
+    }
+};
+
+// Time-decayed exponentially weighted moving average. A sample observed dt
+// after the previous one gets weight 1 - exp(-dt / decay), so the average
+// forgets at the same rate regardless of request volume. With peak = true a
+// sample above the average replaces it (peak EWMA), so degradation shows up
+// on the first slow response while recovery is blended in. Not synchronized.
+class Ewma {
+private:
+    std::chrono::milliseconds decay_;
+    bool peak_;
+    double value_ { 0.0 };
+    bool initialized_ { false };
+    std::chrono::steady_clock::time_point last_;
+
+public:
+    explicit Ewma(std::chrono::milliseconds decay = std::chrono::seconds { 10 }, bool peak = false)
+        : decay_(decay), peak_(peak) {}
+
+    void record(double sample) {
+        auto now = std::chrono::steady_clock::now();
+        if (!initialized_ || (peak_ && sample > value_)) {
+            value_ = sample;
+            initialized_ = true;
+        } else {
+            auto dt = std::chrono::duration<double, std::milli>(now - last_).count();
+            auto tau = std::max(1.0, static_cast<double>(decay_.count()));
+            auto weight = 1.0 - std::exp(-std::max(dt, 1.0) / tau);
+            value_ += weight * (sample - value_);
+        }
+        last_ = now;
+    }
+
+    bool has_value() const { return initialized_; }
+    double value_or(double fallback) const { return initialized_ ? value_ : fallback; }
+};
+
+} // namespace mcpplibs::llmapi
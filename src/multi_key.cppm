@@ -0,0 +1,340 @@
+export module mcpplibs.llmapi:multi_key;
+
+import :types;
+import :coro;
+import :provider;
+import :errors;
+import :rate_limit;
+import :affinity;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+struct ApiKey {
+    std::string key;
+    std::string organization;          // OpenAI only; empty = keep the base config's
+    double weight { 1.0 };             // share of traffic relative to other keys
+    std::int64_t requestsPerMinute { 0 };  // 0 = no local limit
+    std::int64_t tokensPerMinute { 0 };    // 0 = no local limit
+};
+
+struct MultiKeyPolicy {
+    std::chrono::milliseconds quarantine { 30000 };   // used when a 429 carries no Retry-After
+    std::chrono::milliseconds window { 60000 };       // accounting window for per-minute limits
+    AffinityPolicy affinity {};                       // sticky keys by prompt prefix
+};
+
+struct KeyStatus {
+    std::string name;        // masked key, e.g. "...a1b2"
+    double headroom { 1.0 }; // 0 = exhausted, 1 = idle
+    bool quarantined { false };
+    std::uint64_t requests { 0 };
+    std::uint64_t throttled { 0 };
+    std::int64_t tokensInWindow { 0 };
+    CacheStats cache;
+};
+
+// One provider per API key behind a single Provider. Requests are spread by
+// weight * headroom, where headroom combines local per-minute accounting with
+// the rate-limit headers the upstream returned for that key. A key answering
+// 429 is quarantined for Retry-After (or policy.quarantine) and the request is
+// re-sent on another key; when every key is unavailable an ApiError 429 is
+// thrown whose retryAfter is the time until the first key frees up.
+//
+// Prompt caches are per organization/key: with policy.affinity enabled,
+// requests sharing a prompt prefix stick to one key (weighted rendezvous
+// hashing) while it keeps at least affinity.minHeadroom.
+//
+// P must expose its config type as P::ConfigType (openai::OpenAI,
+// anthropic::Anthropic). Thread-safe; each key serves one request at a time.
+template<Provider P>
+    requires requires { typename P::ConfigType; }
+class MultiKeyProvider {
+public:
+    using ConfigType = typename P::ConfigType;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Key {
+        P provider;
+        ApiKey spec;
+        std::string label;
+        std::uint64_t seed;
+        std::mutex callMutex;
+        std::deque<Clock::time_point> requests;
+        std::deque<std::pair<Clock::time_point, std::int64_t>> tokens;
+        std::int64_t tokensInWindow { 0 };
+        std::optional<RateLimitStatus> remote;
+        Clock::time_point quarantinedUntil {};
+        int inFlight { 0 };
+        std::uint64_t total { 0 };
+        std::uint64_t throttled { 0 };
+        CacheStats cache;
+
+        Key(P p, ApiKey k, std::string name)
+            : provider(std::move(p)), spec(std::move(k)), label(std::move(name)), seed(affinity_seed(spec.key)) {}
+    };
+
+    struct State {
+        MultiKeyPolicy policy;
+        std::mutex mutex;   // guards everything but Key::provider
+        std::mt19937_64 rng { std::random_device{}() };
+        std::vector<std::unique_ptr<Key>> keys;
+    };
+
+    std::unique_ptr<State> state_;
+
+public:
+    MultiKeyProvider(ConfigType base, std::vector<ApiKey> keys, MultiKeyPolicy policy = {})
+        : state_(std::make_unique<State>())
+    {
+        state_->policy = policy;
+        for (auto& spec : keys) {
+            auto config = base;
+            config.apiKey = spec.key;
+            if constexpr (requires { config.organization; }) {
+                if (!spec.organization.empty()) {
+                    config.organization = spec.organization;
+                }
+            }
+            auto label = "..." + (spec.key.size() > 4 ? spec.key.substr(spec.key.size() - 4) : spec.key);
+            state_->keys.push_back(std::make_unique<Key>(P(std::move(config)), std::move(spec), std::move(label)));
+        }
+        if (state_->keys.empty()) {
+            throw std::invalid_argument("MultiKeyProvider requires at least one API key");
+        }
+    }
+
+    // Provider concept
+    std::string_view name() const { return state_->keys.front()->provider.name(); }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        return run_(fingerprint_(messages, params),
+                    [&](P& provider) { return provider.chat(messages, params); }, [] { return true; });
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        bool delivered = false;
+        return run_(fingerprint_(messages, params), [&](P& provider) {
+            return provider.chat_stream(messages, params, [&](std::string_view chunk) {
+                delivered = true;
+                callback(chunk);
+            });
+        }, [&] { return !delivered; });
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    // EmbeddableProvider
+    EmbeddingResponse embed(const std::vector<std::string>& inputs, std::string_view model)
+        requires EmbeddableProvider<P>
+    {
+        return run_(std::nullopt, [&](P& provider) { return provider.embed(inputs, model); }, [] { return true; });
+    }
+
+    std::size_t size() const { return state_->keys.size(); }
+
+    std::vector<KeyStatus> keys() const {
+        std::lock_guard lock { state_->mutex };
+        auto now = Clock::now();
+        std::vector<KeyStatus> result;
+        for (const auto& key : state_->keys) {
+            prune_(*key, now);
+            result.push_back(KeyStatus {
+                .name = key->label,
+                .headroom = headroom_(*key),
+                .quarantined = key->quarantinedUntil > now,
+                .requests = key->total,
+                .throttled = key->throttled,
+                .tokensInWindow = key->tokensInWindow,
+                .cache = key->cache,
+            });
+        }
+        return result;
+    }
+
+private:
+    void prune_(Key& key, Clock::time_point now) const {
+        auto cutoff = now - state_->policy.window;
+        while (!key.requests.empty() && key.requests.front() <= cutoff) key.requests.pop_front();
+        while (!key.tokens.empty() && key.tokens.front().first <= cutoff) {
+            key.tokensInWindow -= key.tokens.front().second;
+            key.tokens.pop_front();
+        }
+    }
+
+    // Remaining share of the tightest limit, in [0, 1]
+    double headroom_(const Key& key) const {
+        double result { 1.0 };
+        if (key.spec.requestsPerMinute > 0) {
+            auto used = static_cast<double>(key.requests.size());   // includes in-flight requests
+            result = std::min(result, 1.0 - used / static_cast<double>(key.spec.requestsPerMinute));
+        }
+        if (key.spec.tokensPerMinute > 0) {
+            result = std::min(result, 1.0 - static_cast<double>(key.tokensInWindow) /
+                                                static_cast<double>(key.spec.tokensPerMinute));
+        }
+        if (key.remote && Clock::now() - key.remote->observedAt < state_->policy.window) {
+            if (auto remote = key.remote->headroom()) {
+                result = std::min(result, *remote);
+            }
+        }
+        return std::max(result, 0.0);
+    }
+
+    std::optional<std::uint64_t> fingerprint_(const std::vector<Message>& messages, const ChatParams& params) const {
+        const auto& affinity = state_->policy.affinity;
+        if (!affinity.enabled) return std::nullopt;
+        return prefix_fingerprint(messages, params, affinity.prefixMessages);
+    }
+
+    bool available_(const Key& key, Clock::time_point now, const std::vector<Key*>& exclude) const {
+        return key.quarantinedUntil <= now && std::ranges::find(exclude, &key) == exclude.end();
+    }
+
+    // Sticky choice for a prompt prefix, or weighted random choice by
+    // weight * headroom; caller holds state_->mutex
+    Key* pick_(Clock::time_point now, std::optional<std::uint64_t> fingerprint, const std::vector<Key*>& exclude) {
+        if (fingerprint) {
+            std::vector<std::uint64_t> seeds;
+            std::vector<double> weights;
+            for (auto& key : state_->keys) {
+                prune_(*key, now);
+                seeds.push_back(key->seed);
+                weights.push_back(key->spec.weight);
+            }
+            for (auto index : rendezvous_order(*fingerprint, seeds, weights)) {
+                auto& key = *state_->keys[index];
+                if (available_(key, now, exclude) && headroom_(key) >= state_->policy.affinity.minHeadroom) {
+                    return &key;
+                }
+            }
+        }
+
+        std::vector<std::pair<Key*, double>> candidates;
+        double total { 0 };
+        for (auto& key : state_->keys) {
+            prune_(*key, now);
+            if (!available_(*key, now, exclude)) continue;
+            auto score = std::max(key->spec.weight, 0.0) * headroom_(*key);
+            if (score <= 0) continue;
+            candidates.emplace_back(key.get(), score);
+            total += score;
+        }
+        if (candidates.empty()) return nullptr;
+
+        std::uniform_real_distribution<double> dist { 0.0, total };
+        auto target = dist(state_->rng);
+        for (auto& [key, score] : candidates) {
+            if (target < score) return key;
+            target -= score;
+        }
+        return candidates.back().first;
+    }
+
+    // Time until some key becomes usable again
+    std::chrono::milliseconds wait_hint_(Clock::time_point now) const {
+        auto earliest = now + state_->policy.window;
+        for (const auto& key : state_->keys) {
+            if (key->quarantinedUntil > now) {
+                earliest = std::min(earliest, key->quarantinedUntil);
+            } else if (!key->requests.empty()) {
+                earliest = std::min(earliest, key->requests.front() + state_->policy.window);
+            } else if (!key->tokens.empty()) {
+                earliest = std::min(earliest, key->tokens.front().first + state_->policy.window);
+            }
+        }
+        return std::max(std::chrono::milliseconds { 0 },
+                        std::chrono::duration_cast<std::chrono::milliseconds>(earliest - now));
+    }
+
+    template<typename Response>
+    static std::int64_t tokens_of_(const Response& response) {
+        if constexpr (requires { response.usage.totalTokens; }) {
+            return response.usage.totalTokens;
+        } else {
+            return 0;
+        }
+    }
+
+    template<typename Fn, typename CanFailOver>
+    auto run_(std::optional<std::uint64_t> fingerprint, Fn&& attempt, CanFailOver&& canFailOver)
+        -> decltype(attempt(std::declval<P&>())) {
+        std::vector<Key*> tried;
+        while (true) {
+            Key* key = nullptr;
+            {
+                std::lock_guard lock { state_->mutex };
+                auto now = Clock::now();
+                key = pick_(now, fingerprint, tried);
+                if (key == nullptr) {
+                    auto wait = wait_hint_(now);
+                    throw ApiError(429, "rate_limit_error", "",
+                                   "all API keys are rate limited (retry in " + std::to_string(wait.count()) + "ms)",
+                                   wait);
+                }
+                key->requests.push_back(now);
+                key->inFlight++;
+                key->total++;
+            }
+            tried.push_back(key);
+
+            try {
+                std::unique_lock call { key->callMutex };
+                auto response = attempt(key->provider);
+                auto remote = remote_status_(key->provider);
+                call.unlock();
+
+                std::lock_guard lock { state_->mutex };
+                key->inFlight--;
+                if (remote) key->remote = remote;
+                if constexpr (requires { response.usage; }) {
+                    key->cache.record(response.usage);
+                }
+                if (auto used = tokens_of_(response); used > 0) {
+                    key->tokens.emplace_back(Clock::now(), used);
+                    key->tokensInWindow += used;
+                }
+                return response;
+            } catch (const ApiError& e) {
+                {
+                    std::lock_guard lock { state_->mutex };
+                    key->inFlight--;
+                    if (e.statusCode == 429) {
+                        key->throttled++;
+                        key->quarantinedUntil = Clock::now() + e.retryAfter.value_or(state_->policy.quarantine);
+                    }
+                }
+                if (e.statusCode != 429 || !canFailOver()) throw;
+            } catch (...) {
+                std::lock_guard lock { state_->mutex };
+                key->inFlight--;
+                throw;
+            }
+        }
+    }
+
+    static std::optional<RateLimitStatus> remote_status_(const P& provider) {
+        if constexpr (requires { provider.rate_limit(); }) {
+            return provider.rate_limit();
+        } else {
+            return std::nullopt;
+        }
+    }
+};
+
+} // namespace mcpplibs::llmapi
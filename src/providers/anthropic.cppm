@@ -8,6 +8,13 @@ export import :url;
 
 import :types;
 import :coro;
+import :errors;
+import :buffers;
+import :cancel;
+import :http;
+import :transport;
+import :rate_limit;
+import :files;
 import mcpplibs.tinyhttps;
 import mcpplibs.llmapi.nlohmann.json;
 import std;
@@ -16,6 +23,35 @@ export namespace mcpplibs::llmapi::anthropic {
 
 using Json = nlohmann::json;
 
+// Where automatic prompt-cache breakpoints go
+enum class CacheStrategy {
+    None,             // only explicit Message::cacheControl (plus system/tools if enabled)
+    RollingLastUser,  // the last two user turns: each request reads the prefix the previous one wrote
+    FixedAnchors,     // CachePolicy::anchors
+};
+
+struct CachePolicy {
+    CacheStrategy strategy { CacheStrategy::RollingLastUser };
+    std::string ttl;                     // "" = API default (5m), or "1h"
+    std::vector<std::size_t> anchors;    // FixedAnchors: indices into the messages passed to chat()
+    bool system { true };                // breakpoint after the system prompt
+    bool tools { true };                 // breakpoint after the last tool definition
+};
+
+// A Message Batch as reported by /messages/batches
+struct BatchInfo {
+    std::string id;
+    std::string status;   // in_progress, canceling, ended
+    std::int64_t processing { 0 };
+    std::int64_t succeeded { 0 };
+    std::int64_t errored { 0 };
+    std::int64_t canceled { 0 };
+    std::int64_t expired { 0 };
+    std::string resultsUrl;   // set once the batch has ended
+
+    bool done() const { return status == "ended"; }
+};
+
 struct Config {
     std::string apiKey;
     std::string baseUrl { "https://api.anthropic.com/v1" };
@@ -24,20 +60,49 @@ struct Config {
     int defaultMaxTokens { 4096 };          // REQUIRED by Anthropic
     std::optional<std::string> proxy;
     std::map<std::string, std::string> customHeaders;
+    CachePolicy cache {};
+    // Request bodies whose strings (inline images, PDFs) total at least this
+    // many bytes are streamed in chunks instead of serialized whole
+    std::size_t streamBodyAbove { 4 * 1024 * 1024 };
+    // Ask for zstd/gzip responses and decode them on the fly (not behind a proxy)
+    bool compression { true };
+    // https:// through the built-in HTTP/1.1 client instead of tinyhttps, so
+    // compression, per-phase timeouts and mid-request cancellation apply to
+    // it too (streamed bodies always take it)
+    bool nativeTls { false };
+    // Per-phase deadlines (connect, first byte, stream idle, total); an
+    // expired one raises TimeoutError
+    Timeouts timeouts {};
 };
 
 class Anthropic {
+public:
+    using ConfigType = Config;
+
+    static constexpr std::size_t MAX_CACHE_BREAKPOINTS { 4 };
+    static constexpr std::string_view FILES_BETA { "files-api-2025-04-14" };
+
 private:
     Config config_;
-    tinyhttps::HttpClient http_;
+    AnyTransport http_;
+    std::optional<RateLimitStatus> rateLimit_;
 
 public:
     explicit Anthropic(Config config)
         : config_(std::move(config))
-        , http_(tinyhttps::HttpClientConfig {
+        , http_(HttpTransport(tinyhttps::HttpClientConfig {
             .proxy = config_.proxy,
             .keepAlive = true,
-          })
+          }, config_.compression, config_.timeouts, config_.nativeTls))
+    {
+    }
+
+    // Sends every request through `transport` instead of the default
+    // HttpTransport; config.proxy, config.compression, config.nativeTls and
+    // config.timeouts are then unused
+    Anthropic(Config config, AnyTransport transport)
+        : config_(std::move(config))
+        , http_(std::move(transport))
     {
     }
 
@@ -51,13 +116,13 @@ public:
     std::string_view name() const { return "anthropic"; }
 
     ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        CancelScope cancelScope { params.cancel };
         auto payload = build_payload_(messages, params, false);
         auto request = build_request_("/messages", payload);
-        auto response = http_.send(request);
-        if (!response.ok()) {
-            throw std::runtime_error("Anthropic API error: " +
-                std::to_string(response.statusCode) + " " + response.body);
+        if (references_files_(messages)) {
+            add_beta_(request, FILES_BETA);
         }
+        auto response = send_(request, &payload);
         return parse_response_(Json::parse(response.body));
     }
 
@@ -68,8 +133,12 @@ public:
     // StreamableProvider
     ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
                              std::function<void(std::string_view)> callback) {
+        CancelScope cancelScope { params.cancel };
         auto payload = build_payload_(messages, params, true);
         auto request = build_request_("/messages", payload);
+        if (references_files_(messages)) {
+            add_beta_(request, FILES_BETA);
+        }
 
         ChatResponse result;
         std::string fullContent;
@@ -77,8 +146,10 @@ public:
         std::string currentToolName;
         std::string currentToolArgs;
         bool inToolCall = false;
+        StreamMemory::Account account;
+        account.charge(ReadBufferPool::BLOCK_BYTES);
 
-        auto sseResponse = http_.send_stream(request, [&](const tinyhttps::SseEvent& event) -> bool {
+        send_stream_(request, &payload, [&](const tinyhttps::SseEvent& event) -> bool {
             // Anthropic uses named events
             if (event.event == "message_stop") {
                 return false;
@@ -128,12 +199,18 @@ public:
                     if (chunk.contains("delta")) {
                         const auto& delta = chunk["delta"];
                         auto type = delta.value("type", "");
-                        if (type == "text_delta") {
-                            std::string text = delta.value("text", "");
-                            fullContent += text;
+                        if (type == "text_delta" && delta.contains("text") && delta["text"].is_string()) {
+                            const auto& text = delta["text"].get_ref<const std::string&>();
+                            if (params.accumulateStream) {
+                                fullContent += text;
+                                account.charge(text.size());
+                            }
                             callback(text);
-                        } else if (type == "input_json_delta") {
-                            currentToolArgs += delta.value("partial_json", "");
+                        } else if (type == "input_json_delta" && delta.contains("partial_json") &&
+                                   delta["partial_json"].is_string()) {
+                            const auto& partial = delta["partial_json"].get_ref<const std::string&>();
+                            currentToolArgs += partial;
+                            account.charge(partial.size());
                         }
                     }
                 } else if (event.event == "content_block_stop") {
@@ -170,11 +247,6 @@ public:
             result.content.insert(result.content.begin(), TextContent { .text = fullContent });
         }
 
-        if (!sseResponse.ok()) {
-            throw std::runtime_error("Anthropic API stream error: " +
-                std::to_string(sseResponse.statusCode) + " " + sseResponse.statusText);
-        }
-
         return result;
     }
 
@@ -183,8 +255,153 @@ public:
         co_return chat_stream(messages, params, std::move(callback));
     }
 
+    // Write the prompt cache for messages + tools ahead of a burst with one
+    // max_tokens=1 request. A system-only prefix gets an unmarked placeholder
+    // user turn, so only the system/tools breakpoints are written.
+    ChatResponse prime_cache(const std::vector<Message>& messages, const std::vector<ToolDef>& tools = {}) {
+        ChatParams params { .maxTokens = 1 };
+        if (!tools.empty()) {
+            params.tools = tools;
+        }
+        auto prefix = messages;
+        bool placeholder = std::ranges::none_of(prefix, [](const Message& m) { return m.role != Role::System; });
+        if (placeholder) {
+            prefix.push_back(Message::user("."));
+        }
+        auto payload = build_payload_(prefix, params, false);
+        if (placeholder) {
+            auto& content = payload["messages"].back()["content"];
+            if (content.is_array() && !content.empty()) {
+                content.back().erase("cache_control");
+            }
+        }
+        auto request = build_request_("/messages", payload);
+        auto response = send_(request, &payload);
+        return parse_response_(Json::parse(response.body));
+    }
+
     // NOTE: No embed() — Anthropic doesn't have an embeddings API
 
+    // FileUploadProvider: store raw bytes with the Files API (beta) so later
+    // requests can reference them by id instead of resending base64.
+    static constexpr bool referencesImageFiles = true;
+
+    FileObject upload_file(std::string_view data, std::string_view filename, std::string_view mediaType) {
+        auto boundary = multipart_boundary();
+        auto request = build_request_("/files", Json::object());
+        request.body = multipart_body(boundary, {}, "file", filename, mediaType, data);
+        request.headers["Content-Type"] = "multipart/form-data; boundary=" + boundary;
+        add_beta_(request, FILES_BETA);
+        auto response = send_(request);
+
+        auto json = Json::parse(response.body);
+        return FileObject {
+            .id = json.value("id", ""),
+            .filename = json.value("filename", std::string(filename)),
+            .mediaType = json.value("mime_type", std::string(mediaType)),
+            .bytes = json.value("size_bytes", static_cast<std::int64_t>(data.size())),
+        };
+    }
+
+    // Rate-limit headroom from the most recent response, if the upstream reported it
+    const std::optional<RateLimitStatus>& rate_limit() const { return rateLimit_; }
+
+    // Response bytes received on the wire and after decompression
+    TransferStats transfer_stats() const { return http_.stats(); }
+
+    // Request body chat() would send; for inspection, dry runs and batch entries
+    std::string payload(const std::vector<Message>& messages, const ChatParams& params) const {
+        return build_payload_(messages, params, false).dump(-1, ' ', false, Json::error_handler_t::replace);
+    }
+
+    // Parse a message received outside chat(), e.g. a batch result
+    ChatResponse parse_response(const Json& message) const { return parse_response_(message); }
+
+    // Message Batches API. `requests` is the JSON array of
+    // {"custom_id": ..., "params": ...} entries, passed as text so large
+    // batches are not rebuilt as a JSON tree.
+    BatchInfo create_batch(std::string_view requests) {
+        auto request = build_request_("/messages/batches", Json::object());
+        request.body.clear();
+        request.body.reserve(requests.size() + 16);
+        request.body += R"({"requests":)";
+        request.body += requests;
+        request.body += '}';
+        auto response = send_(request);
+        return parse_batch_(Json::parse(response.body));
+    }
+
+    // Same, with the entries read from a JSONL file (one per line) and
+    // streamed into the request body, so a 256 MB batch is never in memory
+    BatchInfo create_batch_from_file(const std::filesystem::path& entries) {
+        if (!std::filesystem::is_regular_file(entries)) {
+            throw std::runtime_error("cannot open " + entries.string());
+        }
+        auto request = build_request_("/messages/batches", Json::object());
+        request.body.clear();
+        auto response = send_(request, BodyWriter { [&](BodySink& sink) {
+            std::ifstream in(entries, std::ios::binary);
+            if (!in) throw std::runtime_error("cannot open " + entries.string());
+            sink.write(R"({"requests":[)");
+            std::string line;
+            bool first = true;
+            while (std::getline(in, line)) {
+                if (line.empty()) continue;
+                if (!first) sink.write(",");
+                sink.write(line);
+                first = false;
+            }
+            sink.write("]}");
+        } });
+        return parse_batch_(Json::parse(response.body));
+    }
+
+    BatchInfo retrieve_batch(std::string_view batchId) {
+        auto response = send_(build_get_request_(config_.baseUrl + "/messages/batches/" + std::string(batchId)));
+        return parse_batch_(Json::parse(response.body));
+    }
+
+    BatchInfo cancel_batch(std::string_view batchId) {
+        auto response = send_(build_request_("/messages/batches/" + std::string(batchId) + "/cancel", Json::object()));
+        return parse_batch_(Json::parse(response.body));
+    }
+
+    // JSONL results of an ended batch
+    std::string batch_results(const BatchInfo& batch) {
+        auto url = batch.resultsUrl.empty() ? config_.baseUrl + "/messages/batches/" + batch.id + "/results"
+                                            : batch.resultsUrl;
+        auto response = send_(build_get_request_(url));
+        return std::move(response.body);
+    }
+
+    // Like batch_results, but streamed into `path` (replaced if it exists);
+    // returns the number of bytes written. No partial file is left behind.
+    std::uint64_t download_batch_results(const BatchInfo& batch, const std::filesystem::path& path) {
+        auto url = batch.resultsUrl.empty() ? config_.baseUrl + "/messages/batches/" + batch.id + "/results"
+                                            : batch.resultsUrl;
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("cannot write " + path.string());
+        std::uint64_t written = 0;
+        try {
+            auto request = build_get_request_(url);
+            checked_([&] {
+                return http_.send_download(request, [&](std::string_view data) {
+                    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+                    written += data.size();
+                    return static_cast<bool>(out);
+                });
+            });
+            out.close();
+            if (!out) throw std::runtime_error("write to " + path.string() + " failed");
+        } catch (...) {
+            out.close();
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+            throw;
+        }
+        return written;
+    }
+
 private:
     // Serialization — extract system message and serialize remaining messages
     std::pair<std::string, Json> extract_system_and_messages_(const std::vector<Message>& messages) const {
@@ -269,7 +486,12 @@ private:
                             if constexpr (std::is_same_v<P, TextContent>) {
                                 parts.push_back(Json{{"type", "text"}, {"text", p.text}});
                             } else if constexpr (std::is_same_v<P, ImageContent>) {
-                                if (p.isUrl) {
+                                if (!p.fileId.empty()) {
+                                    parts.push_back(Json{
+                                        {"type", "image"},
+                                        {"source", Json{{"type", "file"}, {"file_id", p.fileId}}},
+                                    });
+                                } else if (p.isUrl) {
                                     parts.push_back(Json{
                                         {"type", "image"},
                                         {"source", Json{{"type", "url"}, {"url", p.data}}},
@@ -330,7 +552,6 @@ private:
             Json block;
             block["type"] = "text";
             block["text"] = systemText;
-            block["cache_control"] = Json{{"type", "ephemeral"}};
             sysBlocks.push_back(block);
             payload["system"] = sysBlocks;
         }
@@ -366,10 +587,6 @@ private:
                 } else {
                     t["input_schema"] = Json{{"type", "object"}};
                 }
-                // Add cache_control on last tool
-                if (i == params.tools->size() - 1) {
-                    t["cache_control"] = Json{{"type", "ephemeral"}};
-                }
                 tools.push_back(t);
             }
             payload["tools"] = tools;
@@ -394,6 +611,8 @@ private:
             }, *params.toolChoice);
         }
 
+        apply_cache_breakpoints_(payload, messages);
+
         // Extra JSON merge
         if (params.extraJson.has_value() && !params.extraJson->empty()) {
             auto extra = Json::parse(*params.extraJson);
@@ -403,7 +622,121 @@ private:
         return payload;
     }
 
+    // Prompt-cache breakpoints, in priority order: explicit Message::cacheControl
+    // (latest first), the strategy's primary mark, system, tools, remaining
+    // strategy marks. The API accepts at most four, and a 1h entry must not
+    // follow a shorter-lived one in prefix order (tools, system, messages).
+    void apply_cache_breakpoints_(Json& payload, const std::vector<Message>& messages) const {
+        constexpr std::ptrdiff_t TOOLS { -2 };
+        constexpr std::ptrdiff_t SYSTEM { -1 };
+        struct Breakpoint {
+            std::ptrdiff_t position;   // TOOLS, SYSTEM or index into payload["messages"]
+            CacheControl control;
+        };
+
+        const auto& policy = config_.cache;
+        bool hasSystem = payload.contains("system");
+        bool hasTools = payload.contains("tools");
+        auto& msgArray = payload["messages"];
+
+        std::vector<Breakpoint> chosen;
+        auto add = [&](std::ptrdiff_t position, CacheControl control) {
+            if (chosen.size() >= MAX_CACHE_BREAKPOINTS) return;
+            if (position == SYSTEM && !hasSystem) return;
+            if (position == TOOLS && !hasTools) return;
+            if (std::ranges::any_of(chosen, [&](const Breakpoint& b) { return b.position == position; })) return;
+            chosen.push_back(Breakpoint { .position = position, .control = std::move(control) });
+        };
+
+        // Every non-system message becomes exactly one payload message
+        std::vector<std::ptrdiff_t> positions(messages.size(), SYSTEM);
+        std::ptrdiff_t next { 0 };
+        for (std::size_t i = 0; i < messages.size(); ++i) {
+            if (messages[i].role != Role::System) positions[i] = next++;
+        }
+
+        for (std::size_t i = messages.size(); i-- > 0;) {
+            if (messages[i].cacheControl) add(positions[i], *messages[i].cacheControl);
+        }
+
+        std::vector<std::ptrdiff_t> automatic;
+        switch (policy.strategy) {
+            case CacheStrategy::RollingLastUser:
+                for (auto k = static_cast<std::ptrdiff_t>(msgArray.size()) - 1; k >= 0 && automatic.size() < 2; --k) {
+                    if (msgArray[k].value("role", "") == "user") automatic.push_back(k);
+                }
+                break;
+            case CacheStrategy::FixedAnchors:
+                for (auto index : policy.anchors) {
+                    if (index < messages.size() && messages[index].role != Role::System) {
+                        automatic.push_back(positions[index]);
+                    }
+                }
+                break;
+            case CacheStrategy::None:
+                break;
+        }
+
+        auto automaticControl = CacheControl { .ttl = policy.ttl };
+        if (!automatic.empty()) add(automatic.front(), automaticControl);
+        if (policy.system) add(SYSTEM, automaticControl);
+        if (policy.tools) add(TOOLS, automaticControl);
+        for (std::size_t i = 1; i < automatic.size(); ++i) add(automatic[i], automaticControl);
+
+        std::ranges::sort(chosen, {}, &Breakpoint::position);
+        bool shorterSeen = false;
+        for (auto& breakpoint : chosen) {
+            if (breakpoint.control.ttl != "1h") {
+                shorterSeen = true;
+            } else if (shorterSeen) {
+                breakpoint.control.ttl.clear();
+            }
+        }
+
+        for (const auto& breakpoint : chosen) {
+            Json control { {"type", breakpoint.control.type} };
+            if (!breakpoint.control.ttl.empty()) {
+                control["ttl"] = breakpoint.control.ttl;
+            }
+            if (breakpoint.position == TOOLS) {
+                payload["tools"].back()["cache_control"] = control;
+            } else if (breakpoint.position == SYSTEM) {
+                payload["system"].back()["cache_control"] = control;
+            } else {
+                // cache_control lives on the message's last content block
+                auto& message = msgArray[breakpoint.position];
+                if (message["content"].is_string()) {
+                    message["content"] = Json::array({
+                        Json{{"type", "text"}, {"text", message["content"]}},
+                    });
+                }
+                if (message["content"].is_array() && !message["content"].empty()) {
+                    message["content"].back()["cache_control"] = control;
+                }
+            }
+        }
+    }
+
     // Deserialization
+    static BatchInfo parse_batch_(const Json& json) {
+        BatchInfo info {
+            .id = json.value("id", ""),
+            .status = json.value("processing_status", ""),
+        };
+        if (json.contains("request_counts") && json["request_counts"].is_object()) {
+            const auto& counts = json["request_counts"];
+            info.processing = counts.value("processing", std::int64_t { 0 });
+            info.succeeded = counts.value("succeeded", std::int64_t { 0 });
+            info.errored = counts.value("errored", std::int64_t { 0 });
+            info.canceled = counts.value("canceled", std::int64_t { 0 });
+            info.expired = counts.value("expired", std::int64_t { 0 });
+        }
+        if (json.contains("results_url") && json["results_url"].is_string()) {
+            info.resultsUrl = json["results_url"].get<std::string>();
+        }
+        return info;
+    }
+
     ChatResponse parse_response_(const Json& json) const {
         ChatResponse result;
 
@@ -467,13 +800,95 @@ private:
     }
 
     // HTTP helpers
+    // Transport failures surface as ConnectionError, non-2xx as ApiError, so
+    // callers (and RetryProvider) can tell transient failures from bad requests.
+    // `payload` is streamed as the body when build_request_ left it out
+    tinyhttps::HttpResponse send_(const tinyhttps::HttpRequest& request, const Json* payload = nullptr) {
+        if (payload && request.body.empty()) {
+            return send_(request, BodyWriter { [payload](BodySink& sink) { write_json(sink, *payload); } });
+        }
+        return checked_([&] { return http_.send(request); });
+    }
+
+    tinyhttps::HttpResponse send_(const tinyhttps::HttpRequest& request, const BodyWriter& body) {
+        return checked_([&] { return http_.send(request, body); });
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse checked_(F&& exchange) {
+        tinyhttps::HttpResponse response;
+        try {
+            response = exchange();
+        } catch (const TimeoutError&) {
+            throw;
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw ConnectionError(std::string("Anthropic connection error: ") + e.what());
+        }
+        if (auto status = parse_rate_limit(response.headers)) {
+            rateLimit_ = status;
+        }
+        if (!response.ok()) {
+            throw make_api_error("Anthropic", response.statusCode, response.statusText,
+                                 std::move(response.body), response.headers);
+        }
+        return response;
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse send_stream_(const tinyhttps::HttpRequest& request, const Json* payload, F&& onEvent) {
+        // Exceptions thrown by the handler (i.e. the user callback) stop the
+        // stream and are rethrown as-is rather than reported as transport errors.
+        std::exception_ptr handlerError;
+        tinyhttps::HttpResponse response;
+        auto handler = [&](const tinyhttps::SseEvent& event) -> bool {
+            try {
+                return onEvent(event);
+            } catch (...) {
+                handlerError = std::current_exception();
+                return false;
+            }
+        };
+        try {
+            response = payload && request.body.empty()
+                ? http_.send_stream(request, [payload](BodySink& sink) { write_json(sink, *payload); }, handler)
+                : http_.send_stream(request, handler);
+        } catch (const TimeoutError&) {
+            throw;
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw ConnectionError(std::string("Anthropic connection error: ") + e.what());
+        }
+        if (auto status = parse_rate_limit(response.headers)) {
+            rateLimit_ = status;
+        }
+        if (handlerError) {
+            std::rethrow_exception(handlerError);
+        }
+        if (!response.ok()) {
+            throw make_api_error("Anthropic", response.statusCode, response.statusText,
+                                 std::move(response.body), response.headers);
+        }
+        return response;
+    }
+
     tinyhttps::HttpRequest build_request_(std::string_view endpoint, const Json& payload) const {
-        tinyhttps::HttpRequest req;
+        auto req = build_get_request_(config_.baseUrl + std::string(endpoint));
         req.method = tinyhttps::Method::POST;
-        req.url = config_.baseUrl + std::string(endpoint);
-        req.body = payload.dump(-1, ' ', false, Json::error_handler_t::replace);
+        if (json_size_hint(payload) < config_.streamBodyAbove) {
+            req.body = payload.dump(-1, ' ', false, Json::error_handler_t::replace);
+        }
+        req.headers.try_emplace("Content-Type", "application/json");   // unless set in customHeaders
+        return req;
+    }
 
-        req.headers["Content-Type"] = "application/json";
+    // Takes a full URL: batch results live at an absolute results_url
+    tinyhttps::HttpRequest build_get_request_(std::string url) const {
+        tinyhttps::HttpRequest req;
+        req.method = tinyhttps::Method::GET;
+        req.url = std::move(url);
         req.headers["x-api-key"] = config_.apiKey;
         req.headers["anthropic-version"] = config_.version;
 
@@ -483,6 +898,24 @@ private:
 
         return req;
     }
+
+    // anthropic-beta takes a comma-separated list; keep any the user configured
+    static void add_beta_(tinyhttps::HttpRequest& req, std::string_view feature) {
+        auto& beta = req.headers["anthropic-beta"];
+        if (beta.find(feature) != std::string::npos) return;
+        if (!beta.empty()) beta += ",";
+        beta += feature;
+    }
+
+    static bool references_files_(const std::vector<Message>& messages) {
+        return std::ranges::any_of(messages, [](const Message& message) {
+            auto* parts = std::get_if<std::vector<ContentPart>>(&message.content);
+            return parts != nullptr && std::ranges::any_of(*parts, [](const ContentPart& part) {
+                auto* image = std::get_if<ImageContent>(&part);
+                return image != nullptr && !image->fileId.empty();
+            });
+        });
+    }
 };
 
 } // namespace mcpplibs::llmapi::anthropic
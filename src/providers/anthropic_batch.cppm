@@ -0,0 +1,182 @@
+export module mcpplibs.llmapi:anthropic_batch;
+
+import :types;
+import :batch;
+import :jsonl;
+import :anthropic;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+export namespace mcpplibs::llmapi::anthropic {
+
+struct BatchPolicy {
+    std::filesystem::path directory { std::filesystem::temp_directory_path() };   // entry and result files
+    std::size_t maxRequests { 100000 };           // per batch (API limit)
+    std::uint64_t maxBytes { 256'000'000 };       // per create request (API limit: 256 MB)
+    std::chrono::milliseconds pollInterval { 5000 };
+    std::chrono::milliseconds maxPollInterval { 60000 };
+    std::chrono::milliseconds waitTimeout { std::chrono::hours { 25 } };   // wait() gives up; 0 = never
+    JsonlReadOptions read {};
+    bool keepFiles { false };                     // otherwise removed with the job
+};
+
+// One line of a batch results file
+struct BatchItemResult {
+    std::string customId;
+    std::string type;   // succeeded, errored, canceled, expired
+    std::optional<ChatResponse> response;
+    std::string error;
+
+    bool ok() const { return response.has_value(); }
+};
+
+// Offline requests through the Message Batches API (batch pricing and
+// throughput). Entries are built with the provider's own payload builder
+// and written to JSONL files on disk, split into as many batches as the
+// per-batch limits require. Results are streamed to disk and parsed in
+// parallel; custom ids map them back to the caller's requests and must be
+// unique within a job.
+class BatchJob {
+private:
+    Anthropic provider_;
+    BatchPolicy policy_;
+    std::string prefix_;   // file name prefix unique to this job
+    std::optional<JsonlWriter> writer_;
+    std::vector<std::filesystem::path> shards_;
+    BatchFiles files_;   // everything written to disk
+    std::vector<BatchInfo> batches_;
+    std::size_t size_ { 0 };
+
+public:
+    explicit BatchJob(Config config, BatchPolicy policy = {})
+        : provider_(std::move(config))
+        , policy_(std::move(policy))
+        , prefix_("llmapi-msgbatch-" + std::to_string(std::random_device {}()) + "-" +
+                  std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()))
+        , files_(policy_.keepFiles)
+    {}
+
+    BatchJob(const BatchJob&) = delete;
+    BatchJob& operator=(const BatchJob&) = delete;
+    BatchJob(BatchJob&&) = default;
+    BatchJob& operator=(BatchJob&&) = default;
+
+    void add(std::string_view customId, const std::vector<Message>& messages, const ChatParams& params = {}) {
+        if (!batches_.empty()) {
+            throw std::logic_error("BatchJob was already submitted");
+        }
+        auto body = provider_.payload(messages, params);
+        std::string entry;
+        entry.reserve(body.size() + customId.size() + 32);
+        entry += R"({"custom_id":)";
+        entry += Json(std::string(customId)).dump();
+        entry += R"(,"params":)";
+        entry += body;
+        entry += '}';
+
+        // Each entry costs its size plus a separating comma in the request body
+        bool full = writer_ && (writer_->lines() >= policy_.maxRequests ||
+                                (writer_->lines() > 0 && writer_->bytes() + entry.size() + 16 > policy_.maxBytes));
+        if (!writer_ || full) {
+            if (writer_) writer_->close();
+            auto path = policy_.directory / (prefix_ + "-entries-" + std::to_string(shards_.size()) + ".jsonl");
+            writer_.emplace(path);
+            shards_.push_back(path);
+            files_.add(path);
+        }
+        writer_->write(entry);
+        size_++;
+    }
+
+    // Create one batch per entry file
+    const std::vector<BatchInfo>& submit() {
+        if (!batches_.empty()) {
+            throw std::logic_error("BatchJob was already submitted");
+        }
+        if (writer_) {
+            writer_->close();
+        }
+        for (const auto& shard : shards_) {
+            // Streamed from disk; the entries are never held in memory
+            batches_.push_back(provider_.create_batch_from_file(shard));
+        }
+        return batches_;
+    }
+
+    // Refresh the status of every unfinished batch
+    const std::vector<BatchInfo>& poll() {
+        poll_batches(provider_, batches_);
+        return batches_;
+    }
+
+    // Poll with exponential backoff until every batch has ended; transient
+    // failures while polling are retried rather than abandoning the job.
+    // Throws TimeoutError once policy.waitTimeout has passed; the batches
+    // keep running and can be waited on again or cancelled.
+    const std::vector<BatchInfo>& wait() {
+        wait_batches(provider_, batches_, BatchWait {
+            .pollInterval = policy_.pollInterval,
+            .maxPollInterval = policy_.maxPollInterval,
+            .timeout = policy_.waitTimeout,
+            .what = "message batch wait",
+        });
+        return batches_;
+    }
+
+    // Results of ended batches. The handler runs concurrently on the parser
+    // threads, in no particular order.
+    void for_each_result(const std::function<void(BatchItemResult)>& handler) {
+        for (const auto& batch : batches_) {
+            if (!batch.done()) continue;
+            auto path = download_(batch);
+            for_each_jsonl_line(path, [&](std::string_view line) { handler(parse_line_(line)); }, policy_.read);
+        }
+    }
+
+    // All results keyed by custom id
+    std::map<std::string, BatchItemResult> results() {
+        return results_by_id<BatchItemResult>([&](const auto& handler) { for_each_result(handler); });
+    }
+
+    void cancel() { cancel_batches(provider_, batches_); }
+
+    std::size_t size() const { return size_; }
+    const std::vector<std::filesystem::path>& entry_files() const { return shards_; }
+    const std::vector<BatchInfo>& batches() const { return batches_; }
+    Anthropic& provider() { return provider_; }
+
+private:
+    std::filesystem::path download_(const BatchInfo& batch) {
+        auto path = policy_.directory / (prefix_ + "-" + batch.id + "-results.jsonl");
+        if (files_.contains(path)) {
+            return path;
+        }
+        provider_.download_batch_results(batch, path);
+        files_.add(path);
+        return path;
+    }
+
+    BatchItemResult parse_line_(std::string_view line) const {
+        auto json = Json::parse(line);
+        BatchItemResult result { .customId = json.value("custom_id", "") };
+        if (!json.contains("result") || !json["result"].is_object()) {
+            result.error = "missing result";
+            return result;
+        }
+        const auto& outcome = json["result"];
+        result.type = outcome.value("type", "");
+        if (result.type == "succeeded" && outcome.contains("message")) {
+            result.response = provider_.parse_response(outcome["message"]);
+        } else if (outcome.contains("error") && outcome["error"].is_object()) {
+            // {"type": "error", "error": {"type": ..., "message": ...}}
+            const auto& error = outcome["error"].contains("error") ? outcome["error"]["error"] : outcome["error"];
+            result.error = error.value("message", "");
+        }
+        if (!result.ok() && result.error.empty()) {
+            result.error = "request " + result.type;
+        }
+        return result;
+    }
+};
+
+} // namespace mcpplibs::llmapi::anthropic
@@ -8,6 +8,14 @@ export import :url;
 
 import :types;
 import :coro;
+import :errors;
+import :buffers;
+import :cancel;
+import :http;
+import :transport;
+import :rate_limit;
+import :files;
+import :logprobs;
 import mcpplibs.tinyhttps;
 import mcpplibs.llmapi.nlohmann.json;
 import std;
@@ -16,6 +24,22 @@ export namespace mcpplibs::llmapi::openai {
 
 using Json = nlohmann::json;
 
+// A Batch API job as reported by /batches
+struct BatchInfo {
+    std::string id;
+    std::string status;   // validating, in_progress, finalizing, completed, failed, expired, cancelling, cancelled
+    std::string inputFileId;
+    std::string outputFileId;
+    std::string errorFileId;
+    std::int64_t total { 0 };
+    std::int64_t completed { 0 };
+    std::int64_t failed { 0 };
+
+    bool done() const {
+        return status == "completed" || status == "failed" || status == "expired" || status == "cancelled";
+    }
+};
+
 struct Config {
     std::string apiKey;
     std::string baseUrl { "https://api.openai.com/v1" };
@@ -23,20 +47,45 @@ struct Config {
     std::string organization;
     std::optional<std::string> proxy;
     std::map<std::string, std::string> customHeaders;
+    // Request bodies whose strings (inline images, long documents) total at
+    // least this many bytes are streamed in chunks instead of serialized whole
+    std::size_t streamBodyAbove { 4 * 1024 * 1024 };
+    // Ask for zstd/gzip responses and decode them on the fly (not behind a proxy)
+    bool compression { true };
+    // https:// through the built-in HTTP/1.1 client instead of tinyhttps, so
+    // compression, per-phase timeouts and mid-request cancellation apply to
+    // it too (streamed bodies always take it)
+    bool nativeTls { false };
+    // Per-phase deadlines (connect, first byte, stream idle, total); an
+    // expired one raises TimeoutError
+    Timeouts timeouts {};
 };
 
 class OpenAI {
+public:
+    using ConfigType = Config;
+
 private:
     Config config_;
-    tinyhttps::HttpClient http_;
+    AnyTransport http_;
+    std::optional<RateLimitStatus> rateLimit_;
 
 public:
     explicit OpenAI(Config config)
         : config_(std::move(config))
-        , http_(tinyhttps::HttpClientConfig {
+        , http_(HttpTransport(tinyhttps::HttpClientConfig {
             .proxy = config_.proxy,
             .keepAlive = true,
-          })
+          }, config_.compression, config_.timeouts, config_.nativeTls))
+    {
+    }
+
+    // Sends every request through `transport` instead of the default
+    // HttpTransport; config.proxy, config.compression, config.nativeTls and
+    // config.timeouts are then unused
+    OpenAI(Config config, AnyTransport transport)
+        : config_(std::move(config))
+        , http_(std::move(transport))
     {
     }
 
@@ -50,14 +99,11 @@ public:
     std::string_view name() const { return "openai"; }
 
     ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        CancelScope cancelScope { params.cancel };
         auto payload = build_payload_(messages, params, false);
         auto request = build_request_("/chat/completions", payload);
-        auto response = http_.send(request);
-        if (!response.ok()) {
-            throw std::runtime_error("OpenAI API error: " +
-                std::to_string(response.statusCode) + " " + response.body);
-        }
-        return parse_response_(Json::parse(response.body));
+        auto response = send_(request, &payload);
+        return std::move(parse_body_(response.body, payload, 1).front());
     }
 
     Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
@@ -67,142 +113,179 @@ public:
     // StreamableProvider
     ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
                              std::function<void(std::string_view)> callback) {
+        CancelScope cancelScope { params.cancel };
         auto payload = build_payload_(messages, params, true);
-        auto request = build_request_("/chat/completions", payload);
+        auto responses = stream_choices_(payload, 1, params.accumulateStream, [&](std::size_t index, std::string_view delta) {
+            if (index == 0) callback(delta);
+        });
+        return std::move(responses.front());
+    }
 
-        ChatResponse result;
-        std::string fullContent;
-        std::string currentToolId;
-        std::string currentToolName;
-        std::string currentToolArgs;
-        bool inToolCall = false;
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback) {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
 
-        auto sseResponse = http_.send_stream(request, [&](const tinyhttps::SseEvent& event) -> bool {
-            if (event.data == "[DONE]") {
-                return false;
-            }
-            try {
-                auto chunk = Json::parse(event.data);
-                if (result.id.empty() && chunk.contains("id")) {
-                    result.id = chunk["id"].get<std::string>();
-                }
-                if (result.model.empty() && chunk.contains("model")) {
-                    result.model = chunk["model"].get<std::string>();
-                }
-                if (chunk.contains("choices") && !chunk["choices"].empty()) {
-                    const auto& choice = chunk["choices"][0];
-                    if (choice.contains("delta")) {
-                        const auto& delta = choice["delta"];
-                        if (delta.contains("content") && !delta["content"].is_null()) {
-                            std::string content = delta["content"].get<std::string>();
-                            fullContent += content;
-                            callback(content);
-                        }
-                        if (delta.contains("tool_calls")) {
-                            for (const auto& tc : delta["tool_calls"]) {
-                                if (tc.contains("id")) {
-                                    // New tool call starting — flush previous if any
-                                    if (inToolCall) {
-                                        result.content.push_back(ToolUseContent {
-                                            .id = currentToolId,
-                                            .name = currentToolName,
-                                            .inputJson = currentToolArgs,
-                                        });
-                                    }
-                                    currentToolId = tc["id"].get<std::string>();
-                                    currentToolName = tc.contains("function") && tc["function"].contains("name")
-                                        ? tc["function"]["name"].get<std::string>() : "";
-                                    currentToolArgs = tc.contains("function") && tc["function"].contains("arguments")
-                                        ? tc["function"]["arguments"].get<std::string>() : "";
-                                    inToolCall = true;
-                                } else {
-                                    // Continuation of existing tool call
-                                    if (tc.contains("function") && tc["function"].contains("arguments")) {
-                                        currentToolArgs += tc["function"]["arguments"].get<std::string>();
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    if (choice.contains("finish_reason") && !choice["finish_reason"].is_null()) {
-                        result.stopReason = parse_stop_reason_(choice["finish_reason"].get<std::string>());
-                    }
-                }
-                if (chunk.contains("usage") && !chunk["usage"].is_null()) {
-                    const auto& usage = chunk["usage"];
-                    result.usage.inputTokens = usage.value("prompt_tokens", 0);
-                    result.usage.outputTokens = usage.value("completion_tokens", 0);
-                    result.usage.totalTokens = result.usage.inputTokens + result.usage.outputTokens;
-                    if (usage.contains("prompt_tokens_details") && usage["prompt_tokens_details"].is_object()) {
-                        result.usage.cacheReadTokens = usage["prompt_tokens_details"].value("cached_tokens", 0);
-                    }
-                }
-            } catch (const Json::exception&) {
-                // Skip malformed chunks
-            }
-            return true;
-        });
+    // n completions from one request: the prompt is sent and prefilled once.
+    // Responses are in choice order; each carries the usage of the whole request.
+    std::vector<ChatResponse> chat_n(const std::vector<Message>& messages, const ChatParams& params, int n) {
+        check_choice_count_(n);
+        CancelScope cancelScope { params.cancel };
+        auto payload = build_payload_(messages, params, false);
+        payload["n"] = n;
+        auto request = build_request_("/chat/completions", payload);
+        auto response = send_(request, &payload);
+        return parse_body_(response.body, payload, static_cast<std::size_t>(n));
+    }
 
-        // Flush last tool call if any
-        if (inToolCall) {
-            result.content.push_back(ToolUseContent {
-                .id = currentToolId,
-                .name = currentToolName,
-                .inputJson = currentToolArgs,
-            });
-        }
+    // Streaming variant; deltas are routed to callback(choiceIndex, text)
+    std::vector<ChatResponse> chat_stream_n(const std::vector<Message>& messages, const ChatParams& params, int n,
+                                            std::function<void(std::size_t, std::string_view)> callback) {
+        check_choice_count_(n);
+        CancelScope cancelScope { params.cancel };
+        auto payload = build_payload_(messages, params, true);
+        payload["n"] = n;
+        return stream_choices_(payload, static_cast<std::size_t>(n), params.accumulateStream, callback);
+    }
 
-        // Add text content if present
-        if (!fullContent.empty()) {
-            result.content.insert(result.content.begin(), TextContent { .text = fullContent });
+    // Warm the automatic prompt cache for messages + tools ahead of a burst
+    // with one max_completion_tokens=1 request.
+    ChatResponse prime_cache(const std::vector<Message>& messages, const std::vector<ToolDef>& tools = {}) {
+        ChatParams params { .maxTokens = 1 };
+        if (!tools.empty()) {
+            params.tools = tools;
         }
-
-        if (!sseResponse.ok()) {
-            throw std::runtime_error("OpenAI API stream error: " +
-                std::to_string(sseResponse.statusCode) + " " + sseResponse.statusText);
+        auto prefix = messages;
+        if (std::ranges::none_of(prefix, [](const Message& m) { return m.role != Role::System; })) {
+            prefix.push_back(Message::user("."));
         }
+        auto payload = build_payload_(prefix, params, false);
+        auto request = build_request_("/chat/completions", payload);
+        auto response = send_(request, &payload);
+        return parse_response_(Json::parse(response.body));
+    }
 
-        return result;
+    // EmbeddableProvider
+    EmbeddingResponse embed(const std::vector<std::string>& inputs, std::string_view model) {
+        auto payload = build_embedding_payload_(inputs, model);
+        auto request = build_request_("/embeddings", payload);
+        auto response = send_(request, &payload);
+        return parse_embedding_response_(Json::parse(response.body), model);
     }
 
-    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
-                                          std::function<void(std::string_view)> callback) {
-        co_return chat_stream(messages, params, std::move(callback));
+    // Request bodies chat() and embed() would send; for inspection, dry runs and batch files
+    std::string payload(const std::vector<Message>& messages, const ChatParams& params) const {
+        return build_payload_(messages, params, false).dump(-1, ' ', false, Json::error_handler_t::replace);
     }
 
-    // EmbeddableProvider
-    EmbeddingResponse embed(const std::vector<std::string>& inputs, std::string_view model) {
-        Json payload;
-        payload["model"] = std::string(model);
-        payload["input"] = inputs;
+    std::string embedding_payload(const std::vector<std::string>& inputs, std::string_view model) const {
+        return build_embedding_payload_(inputs, model).dump(-1, ' ', false, Json::error_handler_t::replace);
+    }
 
-        auto request = build_request_("/embeddings", payload);
-        auto response = http_.send(request);
-        if (!response.ok()) {
-            throw std::runtime_error("OpenAI embeddings error: " +
-                std::to_string(response.statusCode) + " " + response.body);
-        }
+    // Parse response bodies received outside chat()/embed(), e.g. batch results
+    ChatResponse parse_response(const Json& body) const { return parse_response_(body); }
 
-        auto json = Json::parse(response.body);
-        EmbeddingResponse result;
-        result.model = json.value("model", std::string(model));
+    EmbeddingResponse parse_embedding_response(const Json& body, std::string_view model = {}) const {
+        return parse_embedding_response_(body, model);
+    }
 
-        for (const auto& item : json["data"]) {
-            std::vector<float> vec;
-            for (const auto& val : item["embedding"]) {
-                vec.push_back(val.get<float>());
-            }
-            result.embeddings.push_back(std::move(vec));
+    // Batch API: run a JSONL file of requests offline at batch pricing
+    BatchInfo create_batch(std::string_view inputFileId, std::string_view endpoint,
+                           std::string_view completionWindow = "24h") {
+        Json payload {
+            {"input_file_id", inputFileId},
+            {"endpoint", endpoint},
+            {"completion_window", completionWindow},
+        };
+        auto response = send_(build_request_("/batches", payload), &payload);
+        return parse_batch_(Json::parse(response.body));
+    }
+
+    BatchInfo retrieve_batch(std::string_view batchId) {
+        auto response = send_(build_get_request_("/batches/" + std::string(batchId)));
+        return parse_batch_(Json::parse(response.body));
+    }
+
+    BatchInfo cancel_batch(std::string_view batchId) {
+        auto response = send_(build_request_("/batches/" + std::string(batchId) + "/cancel", Json::object()));
+        return parse_batch_(Json::parse(response.body));
+    }
+
+    // Raw content of a stored file, e.g. a batch output file
+    std::string file_content(std::string_view fileId) {
+        auto response = send_(build_get_request_("/files/" + std::string(fileId) + "/content"));
+        return std::move(response.body);
+    }
+
+    // Like file_content, but streamed into `path` (replaced if it exists);
+    // returns the number of bytes written. No partial file is left behind.
+    std::uint64_t download_file(std::string_view fileId, const std::filesystem::path& path) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("cannot write " + path.string());
+        std::uint64_t written = 0;
+        try {
+            auto request = build_get_request_("/files/" + std::string(fileId) + "/content");
+            checked_([&] {
+                return http_.send_download(request, [&](std::string_view data) {
+                    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+                    written += data.size();
+                    return static_cast<bool>(out);
+                });
+            });
+            out.close();
+            if (!out) throw std::runtime_error("write to " + path.string() + " failed");
+        } catch (...) {
+            out.close();
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+            throw;
         }
+        return written;
+    }
 
-        if (json.contains("usage")) {
-            result.usage.inputTokens = json["usage"].value("prompt_tokens", 0);
-            result.usage.totalTokens = json["usage"].value("total_tokens", 0);
+    // FileUploadProvider: store raw bytes with the Files API. Chat Completions
+    // only references documents (e.g. PDFs) by id; images uploaded here are
+    // for the Responses API (openai::Responses), so they default to "vision".
+    static constexpr bool referencesImageFiles = false;
+
+    FileObject upload_file(std::string_view data, std::string_view filename, std::string_view mediaType,
+                           std::string_view purpose = {}) {
+        auto boundary = multipart_boundary();
+        if (purpose.empty()) {
+            purpose = mediaType.starts_with("image/") ? "vision" : "user_data";
         }
+        auto request = build_request_("/files", Json::object());
+        request.body = multipart_body(boundary, {{"purpose", std::string(purpose)}}, "file", filename, mediaType, data);
+        request.headers["Content-Type"] = "multipart/form-data; boundary=" + boundary;
+        auto response = send_(request);
+        return parse_file_(Json::parse(response.body), filename, mediaType, data.size());
+    }
 
-        return result;
+    // Upload a file from disk without reading it into memory, e.g. a batch
+    // input shard; the body is sent chunk-encoded
+    FileObject upload_file(const std::filesystem::path& path, std::string_view mediaType, std::string_view purpose) {
+        auto size = std::filesystem::file_size(path);   // throws if missing, before anything is sent
+        auto boundary = multipart_boundary();
+        auto filename = path.filename().string();
+        auto request = build_request_("/files", Json::object());
+        request.body.clear();
+        request.headers["Content-Type"] = "multipart/form-data; boundary=" + boundary;
+        auto head = multipart_head(boundary, {{"purpose", std::string(purpose)}}, "file", filename, mediaType);
+        auto tail = multipart_tail(boundary);
+        auto response = send_(request, BodyWriter { [&](BodySink& sink) {
+            sink.write(head);
+            write_file(sink, path);
+            sink.write(tail);
+        } });
+        return parse_file_(Json::parse(response.body), filename, mediaType, size);
     }
 
+    // Rate-limit headroom from the most recent response, if the upstream reported it
+    const std::optional<RateLimitStatus>& rate_limit() const { return rateLimit_; }
+
+    // Response bytes received on the wire and after decompression
+    TransferStats transfer_stats() const { return http_.stats(); }
+
 private:
     // Serialization
     Json serialize_messages_(const std::vector<Message>& messages) const {
@@ -230,6 +313,13 @@ private:
                         if constexpr (std::is_same_v<P, TextContent>) {
                             parts.push_back(Json{{"type", "text"}, {"text", p.text}});
                         } else if constexpr (std::is_same_v<P, ImageContent>) {
+                            // image_url is the only image part Chat Completions
+                            // takes; a file id alone cannot be sent here
+                            if (p.data.empty() && !p.fileId.empty()) {
+                                throw std::invalid_argument(
+                                    "OpenAI Chat Completions cannot reference an image by file id (" + p.fileId +
+                                    "); send it inline or use openai::Responses");
+                            }
                             Json imgUrl;
                             if (p.isUrl) {
                                 imgUrl["url"] = p.data;
@@ -318,6 +408,12 @@ private:
         if (params.maxTokens.has_value()) {
             payload["max_completion_tokens"] = *params.maxTokens;
         }
+        if (params.logprobs.has_value()) {
+            payload["logprobs"] = true;
+            if (*params.logprobs > 0) {
+                payload["top_logprobs"] = *params.logprobs;
+            }
+        }
         if (params.stop.has_value()) {
             payload["stop"] = *params.stop;
         }
@@ -394,14 +490,71 @@ private:
     }
 
     // Deserialization
+    // Logprobs, when requested, are read while parsing and never enter the DOM
+    std::vector<ChatResponse> parse_body_(const std::string& body, const Json& payload, std::size_t count) const {
+        if (!payload.value("logprobs", false)) {
+            return parse_choices_(Json::parse(body), count);
+        }
+        std::vector<Logprobs> logprobs;
+        auto results = parse_choices_(LogprobsReader { logprobs, std::max<std::size_t>(count, 1) }.parse(body), count);
+        attach_logprobs_(results, logprobs);
+        return results;
+    }
+
+    static void attach_logprobs_(std::vector<ChatResponse>& results, std::vector<Logprobs>& logprobs) {
+        for (std::size_t i = 0; i < logprobs.size() && i < results.size(); ++i) {
+            if (!logprobs[i].empty()) {
+                results[i].logprobs = std::move(logprobs[i]);
+            }
+        }
+    }
+
     ChatResponse parse_response_(const Json& json) const {
-        ChatResponse result;
+        return std::move(parse_choices_(json, 1).front());
+    }
+
+    static void check_choice_count_(int n) {
+        if (n < 1) {
+            throw std::invalid_argument("OpenAI: n must be at least 1, got " + std::to_string(n));
+        }
+    }
+
+    // Index of a choice if it is one of the `count` requested; choices with
+    // an index outside [0, count) are ignored rather than grown into
+    static std::optional<std::size_t> choice_index_(const Json& choice, std::size_t count) {
+        if (!choice.contains("index")) return 0;
+        const auto& index = choice["index"];
+        if (!index.is_number_integer() || index.get<std::int64_t>() < 0 ||
+            index.get<std::uint64_t>() >= count) {
+            return std::nullopt;
+        }
+        return index.get<std::size_t>();
+    }
+
+    // One response per choice, indexed by choice index (exactly `count`)
+    std::vector<ChatResponse> parse_choices_(const Json& json, std::size_t count) const {
+        ChatResponse shared {};
+        shared.id = json.value("id", "");
+        shared.model = json.value("model", "");
 
-        result.id = json.value("id", "");
-        result.model = json.value("model", "");
+        if (json.contains("usage")) {
+            const auto& usage = json["usage"];
+            shared.usage.inputTokens = usage.value("prompt_tokens", 0);
+            shared.usage.outputTokens = usage.value("completion_tokens", 0);
+            shared.usage.totalTokens = shared.usage.inputTokens + shared.usage.outputTokens;
+            if (usage.contains("prompt_tokens_details") && usage["prompt_tokens_details"].is_object()) {
+                shared.usage.cacheReadTokens = usage["prompt_tokens_details"].value("cached_tokens", 0);
+            }
+        }
 
-        if (json.contains("choices") && !json["choices"].empty()) {
-            const auto& choice = json["choices"][0];
+        std::vector<ChatResponse> results(std::max<std::size_t>(count, 1), shared);
+        if (!json.contains("choices")) {
+            return results;
+        }
+        for (const auto& choice : json["choices"]) {
+            auto index = choice_index_(choice, results.size());
+            if (!index) continue;
+            auto& result = results[*index];
             if (choice.contains("message")) {
                 const auto& msg = choice["message"];
                 if (msg.contains("content") && !msg["content"].is_null()) {
@@ -424,19 +577,189 @@ private:
             }
         }
 
-        if (json.contains("usage")) {
-            const auto& usage = json["usage"];
-            result.usage.inputTokens = usage.value("prompt_tokens", 0);
-            result.usage.outputTokens = usage.value("completion_tokens", 0);
-            result.usage.totalTokens = result.usage.inputTokens + result.usage.outputTokens;
-            if (usage.contains("prompt_tokens_details") && usage["prompt_tokens_details"].is_object()) {
-                result.usage.cacheReadTokens = usage["prompt_tokens_details"].value("cached_tokens", 0);
+        return results;
+    }
+
+    // Per-choice stream accumulator
+    struct StreamChoice {
+        ChatResponse result {};
+        std::string fullContent;
+        std::string currentToolId;
+        std::string currentToolName;
+        std::string currentToolArgs;
+        bool inToolCall = false;
+
+        void flush_tool_call() {
+            if (inToolCall) {
+                result.content.push_back(ToolUseContent {
+                    .id = currentToolId,
+                    .name = currentToolName,
+                    .inputJson = currentToolArgs,
+                });
+            }
+        }
+    };
+
+    template<typename Callback>
+    std::vector<ChatResponse> stream_choices_(const Json& payload, std::size_t count, bool accumulate, Callback&& callback) {
+        auto request = build_request_("/chat/completions", payload);
+        StreamMemory::Account account;
+        account.charge(ReadBufferPool::BLOCK_BYTES);
+
+        std::vector<StreamChoice> choices(std::max<std::size_t>(count, 1));
+        std::vector<Logprobs> logprobs;
+        LogprobsReader reader { logprobs, choices.size() };
+        bool wantLogprobs = payload.value("logprobs", false);
+        std::string id;
+        std::string model;
+        Usage usage;
+
+        send_stream_(request, &payload, [&](const tinyhttps::SseEvent& event) -> bool {
+            if (event.data == "[DONE]") {
+                return false;
+            }
+            try {
+                auto chunk = wantLogprobs ? reader.parse(event.data) : Json::parse(event.data);
+                if (id.empty() && chunk.contains("id")) {
+                    id = chunk["id"].get<std::string>();
+                }
+                if (model.empty() && chunk.contains("model")) {
+                    model = chunk["model"].get<std::string>();
+                }
+                if (chunk.contains("choices")) {
+                    for (const auto& choice : chunk["choices"]) {
+                        auto found = choice_index_(choice, choices.size());
+                        if (!found) continue;
+                        auto index = *found;
+                        auto& state = choices[index];
+                        if (choice.contains("delta")) {
+                            const auto& delta = choice["delta"];
+                            if (delta.contains("content") && delta["content"].is_string()) {
+                                const auto& content = delta["content"].get_ref<const std::string&>();
+                                if (accumulate) {
+                                    state.fullContent += content;
+                                    account.charge(content.size());
+                                }
+                                callback(index, std::string_view { content });
+                            }
+                            if (delta.contains("tool_calls")) {
+                                for (const auto& tc : delta["tool_calls"]) {
+                                    if (tc.contains("id")) {
+                                        // New tool call starting — flush previous if any
+                                        state.flush_tool_call();
+                                        state.currentToolId = tc["id"].get<std::string>();
+                                        state.currentToolName = tc.contains("function") && tc["function"].contains("name")
+                                            ? tc["function"]["name"].get<std::string>() : "";
+                                        state.currentToolArgs = tc.contains("function") && tc["function"].contains("arguments")
+                                            ? tc["function"]["arguments"].get<std::string>() : "";
+                                        state.inToolCall = true;
+                                        account.charge(state.currentToolArgs.size());
+                                    } else {
+                                        // Continuation of existing tool call
+                                        if (tc.contains("function") && tc["function"].contains("arguments")) {
+                                            const auto& arguments = tc["function"]["arguments"].get_ref<const std::string&>();
+                                            state.currentToolArgs += arguments;
+                                            account.charge(arguments.size());
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                        if (choice.contains("finish_reason") && !choice["finish_reason"].is_null()) {
+                            state.result.stopReason = parse_stop_reason_(choice["finish_reason"].get<std::string>());
+                        }
+                    }
+                }
+                if (chunk.contains("usage") && !chunk["usage"].is_null()) {
+                    const auto& u = chunk["usage"];
+                    usage.inputTokens = u.value("prompt_tokens", 0);
+                    usage.outputTokens = u.value("completion_tokens", 0);
+                    usage.totalTokens = usage.inputTokens + usage.outputTokens;
+                    if (u.contains("prompt_tokens_details") && u["prompt_tokens_details"].is_object()) {
+                        usage.cacheReadTokens = u["prompt_tokens_details"].value("cached_tokens", 0);
+                    }
+                }
+            } catch (const Json::exception&) {
+                // Skip malformed chunks
+            }
+            return true;
+        });
+
+        std::vector<ChatResponse> results;
+        results.reserve(choices.size());
+        for (auto& state : choices) {
+            // Flush last tool call if any
+            state.flush_tool_call();
+            // Add text content if present
+            if (!state.fullContent.empty()) {
+                state.result.content.insert(state.result.content.begin(), TextContent { .text = state.fullContent });
+            }
+            state.result.id = id;
+            state.result.model = model;
+            state.result.usage = usage;
+            results.push_back(std::move(state.result));
+        }
+        attach_logprobs_(results, logprobs);
+        return results;
+    }
+
+    Json build_embedding_payload_(const std::vector<std::string>& inputs, std::string_view model) const {
+        Json payload;
+        payload["model"] = std::string(model);
+        payload["input"] = inputs;
+        return payload;
+    }
+
+    EmbeddingResponse parse_embedding_response_(const Json& json, std::string_view model) const {
+        EmbeddingResponse result;
+        result.model = json.value("model", std::string(model));
+
+        for (const auto& item : json["data"]) {
+            std::vector<float> vec;
+            for (const auto& val : item["embedding"]) {
+                vec.push_back(val.get<float>());
             }
+            result.embeddings.push_back(std::move(vec));
+        }
+
+        if (json.contains("usage")) {
+            result.usage.inputTokens = json["usage"].value("prompt_tokens", 0);
+            result.usage.totalTokens = json["usage"].value("total_tokens", 0);
         }
 
         return result;
     }
 
+    static FileObject parse_file_(const Json& json, std::string_view filename, std::string_view mediaType,
+                                  std::uint64_t size) {
+        return FileObject {
+            .id = json.value("id", ""),
+            .filename = json.value("filename", std::string(filename)),
+            .mediaType = std::string(mediaType),
+            .bytes = json.value("bytes", static_cast<std::int64_t>(size)),
+        };
+    }
+
+    static BatchInfo parse_batch_(const Json& json) {
+        auto text = [&](const char* key) {
+            return json.contains(key) && json[key].is_string() ? json[key].get<std::string>() : std::string {};
+        };
+        BatchInfo info {
+            .id = text("id"),
+            .status = text("status"),
+            .inputFileId = text("input_file_id"),
+            .outputFileId = text("output_file_id"),
+            .errorFileId = text("error_file_id"),
+        };
+        if (json.contains("request_counts") && json["request_counts"].is_object()) {
+            const auto& counts = json["request_counts"];
+            info.total = counts.value("total", std::int64_t { 0 });
+            info.completed = counts.value("completed", std::int64_t { 0 });
+            info.failed = counts.value("failed", std::int64_t { 0 });
+        }
+        return info;
+    }
+
     static StopReason parse_stop_reason_(const std::string& reason) {
         if (reason == "stop") return StopReason::EndOfTurn;
         if (reason == "length") return StopReason::MaxTokens;
@@ -456,13 +779,94 @@ private:
     }
 
     // HTTP helpers
+    // Transport failures surface as ConnectionError, non-2xx as ApiError, so
+    // callers (and RetryProvider) can tell transient failures from bad requests.
+    // `payload` is streamed as the body when build_request_ left it out
+    tinyhttps::HttpResponse send_(const tinyhttps::HttpRequest& request, const Json* payload = nullptr) {
+        if (payload && request.body.empty()) {
+            return send_(request, BodyWriter { [payload](BodySink& sink) { write_json(sink, *payload); } });
+        }
+        return checked_([&] { return http_.send(request); });
+    }
+
+    tinyhttps::HttpResponse send_(const tinyhttps::HttpRequest& request, const BodyWriter& body) {
+        return checked_([&] { return http_.send(request, body); });
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse checked_(F&& exchange) {
+        tinyhttps::HttpResponse response;
+        try {
+            response = exchange();
+        } catch (const TimeoutError&) {
+            throw;
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw ConnectionError(std::string("OpenAI connection error: ") + e.what());
+        }
+        if (auto status = parse_rate_limit(response.headers)) {
+            rateLimit_ = status;
+        }
+        if (!response.ok()) {
+            throw make_api_error("OpenAI", response.statusCode, response.statusText,
+                                 std::move(response.body), response.headers);
+        }
+        return response;
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse send_stream_(const tinyhttps::HttpRequest& request, const Json* payload, F&& onEvent) {
+        // Exceptions thrown by the handler (i.e. the user callback) stop the
+        // stream and are rethrown as-is rather than reported as transport errors.
+        std::exception_ptr handlerError;
+        tinyhttps::HttpResponse response;
+        auto handler = [&](const tinyhttps::SseEvent& event) -> bool {
+            try {
+                return onEvent(event);
+            } catch (...) {
+                handlerError = std::current_exception();
+                return false;
+            }
+        };
+        try {
+            response = payload && request.body.empty()
+                ? http_.send_stream(request, [payload](BodySink& sink) { write_json(sink, *payload); }, handler)
+                : http_.send_stream(request, handler);
+        } catch (const TimeoutError&) {
+            throw;
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw ConnectionError(std::string("OpenAI connection error: ") + e.what());
+        }
+        if (auto status = parse_rate_limit(response.headers)) {
+            rateLimit_ = status;
+        }
+        if (handlerError) {
+            std::rethrow_exception(handlerError);
+        }
+        if (!response.ok()) {
+            throw make_api_error("OpenAI", response.statusCode, response.statusText,
+                                 std::move(response.body), response.headers);
+        }
+        return response;
+    }
+
     tinyhttps::HttpRequest build_request_(std::string_view endpoint, const Json& payload) const {
-        tinyhttps::HttpRequest req;
+        auto req = build_get_request_(endpoint);
         req.method = tinyhttps::Method::POST;
-        req.url = config_.baseUrl + std::string(endpoint);
-        req.body = payload.dump(-1, ' ', false, Json::error_handler_t::replace);
+        if (json_size_hint(payload) < config_.streamBodyAbove) {
+            req.body = payload.dump(-1, ' ', false, Json::error_handler_t::replace);
+        }
+        req.headers.try_emplace("Content-Type", "application/json");   // unless set in customHeaders
+        return req;
+    }
 
-        req.headers["Content-Type"] = "application/json";
+    tinyhttps::HttpRequest build_get_request_(std::string_view endpoint) const {
+        tinyhttps::HttpRequest req;
+        req.method = tinyhttps::Method::GET;
+        req.url = config_.baseUrl + std::string(endpoint);
         req.headers["Authorization"] = "Bearer " + config_.apiKey;
 
         if (!config_.organization.empty()) {
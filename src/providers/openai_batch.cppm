@@ -0,0 +1,208 @@
+export module mcpplibs.llmapi:openai_batch;
+
+import :types;
+import :batch;
+import :jsonl;
+import :openai;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+export namespace mcpplibs::llmapi::openai {
+
+struct BatchPolicy {
+    std::filesystem::path directory { std::filesystem::temp_directory_path() };   // input and result files
+    std::string completionWindow { "24h" };
+    std::size_t maxRequests { 50000 };                 // per batch (API limit)
+    std::uint64_t maxBytes { 200ull * 1024 * 1024 };   // per input file (API limit)
+    std::chrono::milliseconds pollInterval { 5000 };
+    std::chrono::milliseconds maxPollInterval { 60000 };
+    std::chrono::milliseconds waitTimeout { std::chrono::hours { 25 } };   // wait() gives up; 0 = never
+    JsonlReadOptions read {};
+    bool keepFiles { false };                          // otherwise removed with the job
+};
+
+// One line of a batch output or error file
+struct BatchItemResult {
+    std::string customId;
+    int statusCode { 0 };
+    std::optional<ChatResponse> response;
+    std::optional<EmbeddingResponse> embedding;
+    std::string error;
+
+    bool ok() const { return response.has_value() || embedding.has_value(); }
+};
+
+// Bulk offline requests through the Batch API (half price, separate rate
+// limits, results within the completion window). Requests are serialized
+// with the provider's own payload builder straight into JSONL files on
+// disk, split into as many batches as the per-batch limits require.
+// Results are downloaded to disk and parsed in parallel; custom ids map
+// them back to the caller's requests and must be unique within a job.
+class BatchJob {
+private:
+    OpenAI provider_;
+    BatchPolicy policy_;
+    std::string prefix_;     // file name prefix unique to this job
+    std::string endpoint_;   // one endpoint per job, as the API requires
+    std::optional<JsonlWriter> writer_;
+    std::vector<std::filesystem::path> shards_;
+    BatchFiles files_;   // everything written to disk
+    std::vector<BatchInfo> batches_;
+    std::size_t size_ { 0 };
+
+public:
+    explicit BatchJob(Config config, BatchPolicy policy = {})
+        : provider_(std::move(config))
+        , policy_(std::move(policy))
+        , prefix_("llmapi-batch-" + std::to_string(std::random_device {}()) + "-" +
+                  std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()))
+        , files_(policy_.keepFiles)
+    {}
+
+    BatchJob(const BatchJob&) = delete;
+    BatchJob& operator=(const BatchJob&) = delete;
+    BatchJob(BatchJob&&) = default;
+    BatchJob& operator=(BatchJob&&) = default;
+
+    void add(std::string_view customId, const std::vector<Message>& messages, const ChatParams& params = {}) {
+        append_(customId, "/v1/chat/completions", provider_.payload(messages, params));
+    }
+
+    void add_embedding(std::string_view customId, const std::vector<std::string>& inputs, std::string_view model) {
+        append_(customId, "/v1/embeddings", provider_.embedding_payload(inputs, model));
+    }
+
+    // Upload each input file and create one batch per file
+    const std::vector<BatchInfo>& submit() {
+        if (!batches_.empty()) {
+            throw std::logic_error("BatchJob was already submitted");
+        }
+        if (writer_) {
+            writer_->close();
+        }
+        for (const auto& shard : shards_) {
+            // Streamed from disk; the shard is never held in memory
+            auto file = provider_.upload_file(shard, "application/jsonl", "batch");
+            batches_.push_back(provider_.create_batch(file.id, endpoint_, policy_.completionWindow));
+        }
+        return batches_;
+    }
+
+    // Refresh the status of every unfinished batch
+    const std::vector<BatchInfo>& poll() {
+        poll_batches(provider_, batches_);
+        return batches_;
+    }
+
+    // Poll with exponential backoff until every batch is done; transient
+    // failures while polling are retried rather than abandoning the job.
+    // Throws TimeoutError once policy.waitTimeout has passed; the batches
+    // keep running and can be waited on again or cancelled.
+    const std::vector<BatchInfo>& wait() {
+        wait_batches(provider_, batches_, BatchWait {
+            .pollInterval = policy_.pollInterval,
+            .maxPollInterval = policy_.maxPollInterval,
+            .timeout = policy_.waitTimeout,
+            .what = "batch wait",
+        });
+        return batches_;
+    }
+
+    // Results of finished batches, successes and failures alike. The handler
+    // runs concurrently on the parser threads, in no particular order.
+    void for_each_result(const std::function<void(BatchItemResult)>& handler) {
+        for (const auto& batch : batches_) {
+            for (const auto& fileId : { batch.outputFileId, batch.errorFileId }) {
+                if (fileId.empty()) continue;
+                auto path = download_(fileId);
+                for_each_jsonl_line(path, [&](std::string_view line) { handler(parse_line_(line)); }, policy_.read);
+            }
+        }
+    }
+
+    // All results keyed by custom id
+    std::map<std::string, BatchItemResult> results() {
+        return results_by_id<BatchItemResult>([&](const auto& handler) { for_each_result(handler); });
+    }
+
+    void cancel() { cancel_batches(provider_, batches_); }
+
+    std::size_t size() const { return size_; }
+    const std::vector<std::filesystem::path>& input_files() const { return shards_; }
+    const std::vector<BatchInfo>& batches() const { return batches_; }
+    OpenAI& provider() { return provider_; }
+
+private:
+    void append_(std::string_view customId, std::string_view endpoint, const std::string& body) {
+        if (!batches_.empty()) {
+            throw std::logic_error("BatchJob was already submitted");
+        }
+        if (endpoint_.empty()) {
+            endpoint_ = endpoint;
+        } else if (endpoint_ != endpoint) {
+            throw std::logic_error("BatchJob cannot mix chat and embedding requests");
+        }
+
+        std::string line;
+        line.reserve(body.size() + customId.size() + 96);
+        line += R"({"custom_id":)";
+        line += Json(std::string(customId)).dump();
+        line += R"(,"method":"POST","url":")";
+        line += endpoint_;
+        line += R"(","body":)";
+        line += body;
+        line += '}';
+
+        bool full = writer_ && (writer_->lines() >= policy_.maxRequests ||
+                                (writer_->lines() > 0 && writer_->bytes() + line.size() + 1 > policy_.maxBytes));
+        if (!writer_ || full) {
+            if (writer_) writer_->close();
+            auto path = policy_.directory / (prefix_ + "-input-" + std::to_string(shards_.size()) + ".jsonl");
+            writer_.emplace(path);
+            shards_.push_back(path);
+            files_.add(path);
+        }
+        writer_->write(line);
+        size_++;
+    }
+
+    std::filesystem::path download_(const std::string& fileId) {
+        auto path = policy_.directory / (prefix_ + "-" + fileId + ".jsonl");
+        if (files_.contains(path)) {
+            return path;
+        }
+        provider_.download_file(fileId, path);
+        files_.add(path);
+        return path;
+    }
+
+    BatchItemResult parse_line_(std::string_view line) const {
+        auto json = Json::parse(line);
+        BatchItemResult result { .customId = json.value("custom_id", "") };
+        if (json.contains("response") && json["response"].is_object()) {
+            const auto& response = json["response"];
+            result.statusCode = response.value("status_code", 0);
+            if (response.contains("body") && response["body"].is_object()) {
+                const auto& body = response["body"];
+                if (result.statusCode >= 200 && result.statusCode < 300) {
+                    if (endpoint_ == "/v1/embeddings") {
+                        result.embedding = provider_.parse_embedding_response(body);
+                    } else {
+                        result.response = provider_.parse_response(body);
+                    }
+                } else if (body.contains("error") && body["error"].is_object()) {
+                    result.error = body["error"].value("message", "");
+                }
+            }
+        }
+        if (json.contains("error") && json["error"].is_object()) {
+            result.error = json["error"].value("message", "");
+        }
+        if (!result.ok() && result.error.empty()) {
+            result.error = "request failed with status " + std::to_string(result.statusCode);
+        }
+        return result;
+    }
+};
+
+} // namespace mcpplibs::llmapi::openai
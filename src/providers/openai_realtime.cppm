@@ -0,0 +1,439 @@
+export module mcpplibs.llmapi:openai_realtime;
+
+import :types;
+import :coro;
+import :cancel;
+import :errors;
+import :websocket;
+import :openai;
+import mcpplibs.tinyhttps;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+export namespace mcpplibs::llmapi::openai {
+
+struct RealtimeStats {
+    std::uint64_t turns { 0 };
+    std::uint64_t connects { 0 };
+    std::uint64_t continued { 0 };      // turns that only sent the new items
+    std::uint64_t itemsSent { 0 };
+    std::uint64_t bytesSent { 0 };      // event payloads, before framing
+};
+
+// OpenAI Realtime API over one long-lived WebSocket, text modality. The
+// conversation lives in the server-side session: each turn sends only the
+// items added since the last reply plus a response.create, and the reply
+// streams back as incremental events on the same socket, so a turn costs
+// no connection setup and no repeated history.
+//
+// As with Responses, the caller passes the full history. A history that
+// does not continue the last reply (or a dropped socket) opens a new
+// session and replays it. System messages become the session
+// instructions; tools and tool choice are session settings too and are
+// re-sent only when they change. Non-text content is not sent.
+//
+// Config::timeouts apply per turn: connect to the handshake, firstByte to
+// the first event after response.create, streamIdle to every later one and
+// total to the whole turn; a phase left unset falls back to the
+// WebSocketConfig limits. ChatParams::cancel is checked between events and
+// while waiting for one; a cancelled or timed-out turn closes the session.
+// Proxies are not supported, so a Config with one is rejected.
+class Realtime {
+public:
+    using ConfigType = Config;
+
+private:
+    Config config_;
+    WebSocket socket_;
+    std::size_t knownMessages_ { 0 };   // history length including the last reply
+    std::string replyText_;
+    std::string session_;               // last session.update sent on this socket
+    RealtimeStats stats_;
+    std::chrono::milliseconds readTimeout_;   // for phases without a Config timeout
+
+public:
+    explicit Realtime(Config config, WebSocketConfig websocket = {})
+        : config_(std::move(config))
+        , socket_(with_timeouts_(std::move(websocket), config_))
+        , readTimeout_(socket_.config().readTimeoutMs)
+    {
+        if (config_.proxy) {
+            throw std::invalid_argument("openai::Realtime does not support proxies");
+        }
+    }
+
+    Realtime(const Realtime&) = delete;
+    Realtime& operator=(const Realtime&) = delete;
+    Realtime(Realtime&&) = default;
+    Realtime& operator=(Realtime&&) = default;
+
+    // Provider concept
+    std::string_view name() const { return "openai-realtime"; }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        return turn_(messages, params, nullptr);
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback) {
+        return turn_(messages, params, &callback);
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback) {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    // wss:// endpoint derived from baseUrl (https -> wss, http -> ws)
+    std::string url() const {
+        auto base = config_.baseUrl;
+        if (base.starts_with("https://")) base.replace(0, 5, "wss");
+        else if (base.starts_with("http://")) base.replace(0, 4, "ws");
+        return base + "/realtime?model=" + config_.model;
+    }
+
+    // Close the session; the next turn opens a new one with the full history
+    void reset() {
+        socket_.close();
+        knownMessages_ = 0;
+        session_.clear();
+    }
+
+    bool connected() const { return socket_.is_open(); }
+    const RealtimeStats& stats() const { return stats_; }
+    const WebSocketStats& socket_stats() const { return socket_.stats(); }
+
+private:
+    // Number of leading messages the session already holds, or 0
+    std::size_t continued_prefix_(const std::vector<Message>& messages) const {
+        if (!socket_.is_open() || knownMessages_ == 0 || messages.size() <= knownMessages_) return 0;
+        const auto& reply = messages[knownMessages_ - 1];
+        if (reply.role != Role::Assistant || message_text_(reply) != replyText_) return 0;
+        return knownMessages_;
+    }
+
+    static WebSocketConfig with_timeouts_(WebSocketConfig websocket, const Config& config) {
+        if (config.timeouts.connect) {
+            websocket.connectTimeoutMs = static_cast<int>(config.timeouts.connect->count());
+        }
+        return websocket;
+    }
+
+    ChatResponse turn_(const std::vector<Message>& messages, const ChatParams& params,
+                       const std::function<void(std::string_view)>* callback) {
+        CancelScope scope { params.cancel };
+        params.cancel.check("OpenAI realtime");
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        if (config_.timeouts.total) {
+            deadline = std::chrono::steady_clock::now() + *config_.timeouts.total;
+        }
+        auto from = continued_prefix_(messages);
+        stats_.turns++;
+        if (from == 0) {
+            reset();
+            connect_();
+        } else {
+            stats_.continued++;
+        }
+
+        try {
+            auto session = build_session_(messages, params);
+            if (session != session_) {
+                send_(Json{{"type", "session.update"}, {"session", Json::parse(session)}});
+                session_ = std::move(session);
+            }
+            for (auto& item : build_items_(messages, from)) {
+                send_(Json{{"type", "conversation.item.create"}, {"item", std::move(item)}});
+                stats_.itemsSent++;
+            }
+            send_(Json{{"type", "response.create"}, {"response", build_response_(params)}});
+
+            auto response = receive_response_(callback, params.cancel, deadline);
+            knownMessages_ = messages.size() + 1;
+            replyText_ = response.text();
+            return response;
+        } catch (...) {
+            reset();   // the session may hold half a turn
+            throw;
+        }
+    }
+
+    void connect_() {
+        std::map<std::string, std::string> headers {
+            { "Authorization", "Bearer " + config_.apiKey },
+            { "OpenAI-Beta", "realtime=v1" },
+        };
+        if (!config_.organization.empty()) {
+            headers["OpenAI-Organization"] = config_.organization;
+        }
+        for (const auto& [key, value] : config_.customHeaders) {
+            headers[key] = value;
+        }
+        tinyhttps::HttpResponse response;
+        try {
+            response = socket_.connect(url(), headers);
+        } catch (const ConnectionError&) {
+            throw;   // TimeoutError
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw ConnectionError(std::string("OpenAI realtime connection error: ") + e.what());
+        }
+        if (!socket_.is_open()) {
+            throw make_api_error("OpenAI", response.statusCode, response.statusText,
+                                 std::move(response.body), response.headers);
+        }
+        stats_.connects++;
+    }
+
+    // Socket failures surface as ConnectionError, like HTTP transport failures
+    void send_(const Json& event) {
+        auto text = event.dump(-1, ' ', false, Json::error_handler_t::replace);
+        stats_.bytesSent += text.size();
+        try {
+            socket_.send_text(text);
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::runtime_error& e) {
+            throw ConnectionError(std::string("OpenAI realtime connection error: ") + e.what());
+        }
+    }
+
+    // Waits for the next event within the phase's limit, or within what is
+    // left of the turn's total budget when that is shorter
+    std::string receive_(TimeoutPhase phase, std::optional<std::chrono::steady_clock::time_point> deadline) {
+        auto limit = (phase == TimeoutPhase::FirstByte ? config_.timeouts.firstByte : config_.timeouts.streamIdle)
+                         .value_or(readTimeout_);
+        if (deadline) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                *deadline - std::chrono::steady_clock::now());
+            if (left <= limit) {
+                phase = TimeoutPhase::Total;
+                limit = std::max(left, std::chrono::milliseconds { 0 });
+            }
+        }
+        std::optional<std::string> message;
+        try {
+            message = socket_.receive(limit, phase);
+        } catch (const TimeoutError& e) {
+            if (e.phase == TimeoutPhase::Total) {
+                throw TimeoutError(TimeoutPhase::Total, *config_.timeouts.total, "OpenAI realtime");
+            }
+            throw;
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::runtime_error& e) {
+            throw ConnectionError(std::string("OpenAI realtime connection error: ") + e.what());
+        }
+        if (!message) {
+            throw ConnectionError("OpenAI realtime connection error: session closed by server");
+        }
+        return std::move(*message);
+    }
+
+    ChatResponse receive_response_(const std::function<void(std::string_view)>* callback, const Cancellation& cancel,
+                                   std::optional<std::chrono::steady_clock::time_point> deadline) {
+        auto phase = TimeoutPhase::FirstByte;
+        for (;;) {
+            // Frames already buffered do not reach the socket's own check
+            cancel.check("OpenAI realtime");
+            Json event;
+            try {
+                event = Json::parse(receive_(phase, deadline));
+            } catch (const Json::exception&) {
+                continue;   // Skip malformed events
+            }
+            phase = TimeoutPhase::StreamIdle;
+            auto type = event.value("type", "");
+            if (type == "response.text.delta" || type == "response.output_text.delta") {
+                if (callback) {
+                    (*callback)(event.value("delta", ""));
+                }
+            } else if (type == "response.done" && event.contains("response")) {
+                return parse_response_(event["response"]);
+            } else if (type == "error") {
+                throw make_api_error("OpenAI", 400, "realtime error",
+                                     Json{{"error", event.value("error", Json::object())}}.dump(), {});
+            }
+        }
+    }
+
+    static std::string message_text_(const Message& message) {
+        if (auto* text = std::get_if<std::string>(&message.content)) {
+            return *text;
+        }
+        std::string result;
+        for (const auto& part : std::get<std::vector<ContentPart>>(message.content)) {
+            if (auto* t = std::get_if<TextContent>(&part)) {
+                result += t->text;
+            }
+        }
+        return result;
+    }
+
+    // Serialization
+    static std::vector<Json> build_items_(const std::vector<Message>& messages, std::size_t from) {
+        std::vector<Json> items;
+        for (std::size_t i = from; i < messages.size(); ++i) {
+            const auto& msg = messages[i];
+            if (msg.role == Role::System) continue;
+            bool assistant = msg.role == Role::Assistant;
+            auto textItem = [&](std::string text) {
+                return Json{
+                    {"type", "message"},
+                    {"role", assistant ? "assistant" : "user"},
+                    {"content", Json::array({Json{{"type", assistant ? "text" : "input_text"}, {"text", std::move(text)}}})},
+                };
+            };
+
+            if (auto* text = std::get_if<std::string>(&msg.content)) {
+                items.push_back(textItem(*text));
+                continue;
+            }
+            std::string text;
+            for (const auto& part : std::get<std::vector<ContentPart>>(msg.content)) {
+                if (auto* t = std::get_if<TextContent>(&part)) {
+                    text += t->text;
+                } else if (auto* tu = std::get_if<ToolUseContent>(&part)) {
+                    items.push_back(Json{
+                        {"type", "function_call"},
+                        {"call_id", tu->id},
+                        {"name", tu->name},
+                        {"arguments", tu->inputJson},
+                    });
+                } else if (auto* tr = std::get_if<ToolResultContent>(&part)) {
+                    items.push_back(Json{
+                        {"type", "function_call_output"},
+                        {"call_id", tr->toolUseId},
+                        {"output", tr->content},
+                    });
+                }
+            }
+            if (!text.empty()) {
+                items.push_back(textItem(std::move(text)));
+            }
+        }
+        return items;
+    }
+
+    // Session settings as compact JSON text, compared to skip redundant updates
+    std::string build_session_(const std::vector<Message>& messages, const ChatParams& params) const {
+        Json session{{"modalities", Json::array({"text"})}};
+
+        std::string instructions;
+        for (const auto& msg : messages) {
+            if (msg.role != Role::System) continue;
+            if (!instructions.empty()) instructions += "\n\n";
+            instructions += message_text_(msg);
+        }
+        if (!instructions.empty()) {
+            session["instructions"] = instructions;
+        }
+
+        if (params.tools.has_value() && !params.tools->empty()) {
+            Json tools = Json::array();
+            for (const auto& tool : *params.tools) {
+                Json t{{"type", "function"}, {"name", tool.name}, {"description", tool.description}};
+                if (!tool.inputSchema.empty()) {
+                    t["parameters"] = Json::parse(tool.inputSchema);
+                }
+                tools.push_back(t);
+            }
+            session["tools"] = tools;
+        }
+
+        if (params.toolChoice.has_value()) {
+            std::visit([&](const auto& tc) {
+                using T = std::decay_t<decltype(tc)>;
+                if constexpr (std::is_same_v<T, ToolChoice>) {
+                    switch (tc) {
+                        case ToolChoice::Auto: session["tool_choice"] = "auto"; break;
+                        case ToolChoice::None: session["tool_choice"] = "none"; break;
+                        case ToolChoice::Required: session["tool_choice"] = "required"; break;
+                    }
+                } else if constexpr (std::is_same_v<T, ToolChoiceForced>) {
+                    session["tool_choice"] = Json{{"type", "function"}, {"name", tc.name}};
+                }
+            }, *params.toolChoice);
+        }
+
+        return session.dump();
+    }
+
+    static Json build_response_(const ChatParams& params) {
+        Json response{{"modalities", Json::array({"text"})}};
+        if (params.temperature.has_value()) {
+            response["temperature"] = *params.temperature;
+        }
+        if (params.maxTokens.has_value()) {
+            response["max_response_output_tokens"] = *params.maxTokens;
+        }
+        if (params.extraJson.has_value() && !params.extraJson->empty()) {
+            response.merge_patch(Json::parse(*params.extraJson));
+        }
+        return response;
+    }
+
+    // Deserialization
+    static ChatResponse parse_response_(const Json& json) {
+        auto status = json.value("status", "");
+        const auto& details = json.contains("status_details") && json["status_details"].is_object()
+            ? json["status_details"] : Json::object();
+        if (status == "failed") {
+            auto error = details.contains("error") && details["error"].is_object() ? details["error"] : details;
+            throw make_api_error("OpenAI", 500, "response failed", Json{{"error", error}}.dump(), {});
+        }
+
+        ChatResponse result;
+        result.id = json.value("id", "");
+        result.stopReason = StopReason::EndOfTurn;
+
+        bool toolUse = false;
+        if (json.contains("output") && json["output"].is_array()) {
+            for (const auto& item : json["output"]) {
+                auto type = item.value("type", "");
+                if (type == "message" && item.contains("content")) {
+                    for (const auto& part : item["content"]) {
+                        auto partType = part.value("type", "");
+                        if (partType == "text" || partType == "output_text") {
+                            result.content.push_back(TextContent { .text = part.value("text", "") });
+                        }
+                    }
+                } else if (type == "function_call") {
+                    result.content.push_back(ToolUseContent {
+                        .id = item.value("call_id", ""),
+                        .name = item.value("name", ""),
+                        .inputJson = item.value("arguments", ""),
+                    });
+                    toolUse = true;
+                }
+            }
+        }
+
+        if (status == "incomplete") {
+            auto reason = details.value("reason", "");
+            if (reason == "max_output_tokens") result.stopReason = StopReason::MaxTokens;
+            if (reason == "content_filter") result.stopReason = StopReason::ContentFilter;
+        } else if (toolUse) {
+            result.stopReason = StopReason::ToolUse;
+        }
+
+        if (json.contains("usage") && json["usage"].is_object()) {
+            const auto& usage = json["usage"];
+            result.usage.inputTokens = usage.value("input_tokens", 0);
+            result.usage.outputTokens = usage.value("output_tokens", 0);
+            result.usage.totalTokens = result.usage.inputTokens + result.usage.outputTokens;
+            if (usage.contains("input_token_details") && usage["input_token_details"].is_object()) {
+                result.usage.cacheReadTokens = usage["input_token_details"].value("cached_tokens", 0);
+            }
+        }
+        return result;
+    }
+};
+
+} // namespace mcpplibs::llmapi::openai
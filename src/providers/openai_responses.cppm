@@ -0,0 +1,526 @@
+module;
+
+#include <cassert>
+
+export module mcpplibs.llmapi:openai_responses;
+
+import :types;
+import :coro;
+import :errors;
+import :cancel;
+import :http;
+import :transport;
+import :rate_limit;
+import :files;
+import :openai;
+import mcpplibs.tinyhttps;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+export namespace mcpplibs::llmapi::openai {
+
+struct ResponsesStats {
+    std::uint64_t requests { 0 };
+    std::uint64_t chained { 0 };        // sent as a delta on previous_response_id
+    std::uint64_t resent { 0 };         // chain expired upstream; full history sent again
+    std::uint64_t itemsSent { 0 };
+    std::uint64_t bytesSent { 0 };
+};
+
+// OpenAI Responses API (/responses) with server-side conversation state.
+// After the first turn each request carries previous_response_id and only
+// the messages added since the last reply, so request size and
+// serialization cost grow with the delta rather than the history. The
+// caller still passes (and may persist) the full history: a request whose
+// history does not continue the chain, or whose stored response expired
+// upstream, is sent in full and starts a new chain.
+//
+// The history before the last reply is assumed unchanged; call reset()
+// after editing earlier messages. System messages are sent as
+// `instructions` on every request, since they are not carried over.
+class Responses {
+public:
+    using ConfigType = Config;
+
+private:
+    struct Chain {
+        std::string responseId;
+        std::size_t knownMessages { 0 };   // history length including the reply
+        std::string replyText;
+    };
+
+    Config config_;
+    AnyTransport http_;
+    std::optional<RateLimitStatus> rateLimit_;
+    std::optional<Chain> chain_;
+    ResponsesStats stats_;
+
+public:
+    explicit Responses(Config config)
+        : config_(std::move(config))
+        , http_(HttpTransport(tinyhttps::HttpClientConfig {
+            .proxy = config_.proxy,
+            .keepAlive = true,
+          }, config_.compression, config_.timeouts, config_.nativeTls))
+    {
+    }
+
+    // Sends every request through `transport` instead of the default
+    // HttpTransport; config.proxy, config.compression, config.nativeTls and
+    // config.timeouts are then unused
+    Responses(Config config, AnyTransport transport)
+        : config_(std::move(config))
+        , http_(std::move(transport))
+    {
+    }
+
+    // Non-copyable (HttpClient owns TLS connections)
+    Responses(const Responses&) = delete;
+    Responses& operator=(const Responses&) = delete;
+    Responses(Responses&&) = default;
+    Responses& operator=(Responses&&) = default;
+
+    // Provider concept
+    std::string_view name() const { return "openai-responses"; }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        CancelScope cancelScope { params.cancel };
+        return send_chained_(messages, params, [&](const Json& payload) {
+            auto request = build_request_("/responses", payload);
+            auto response = send_(request);
+            return parse_response_(Json::parse(response.body));
+        }, false);
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback) {
+        CancelScope cancelScope { params.cancel };
+        return send_chained_(messages, params, [&](const Json& payload) {
+            auto request = build_request_("/responses", payload);
+
+            ChatResponse result;
+            std::string fullContent;
+            bool completed = false;
+
+            send_stream_(request, [&](const tinyhttps::SseEvent& event) -> bool {
+                if (event.data == "[DONE]") {
+                    return false;
+                }
+                Json chunk;
+                try {
+                    chunk = Json::parse(event.data);
+                } catch (const Json::exception&) {
+                    return true;   // Skip malformed chunks
+                }
+                auto type = chunk.value("type", "");
+                if (type == "response.output_text.delta") {
+                    auto delta = chunk.value("delta", "");
+                    fullContent += delta;
+                    callback(delta);
+                } else if (type == "response.created" && chunk.contains("response")) {
+                    result.id = chunk["response"].value("id", "");
+                    result.model = chunk["response"].value("model", "");
+                } else if ((type == "response.completed" || type == "response.incomplete") &&
+                           chunk.contains("response")) {
+                    result = parse_response_(chunk["response"]);
+                    completed = true;
+                    return false;
+                } else if (type == "response.failed" || type == "error") {
+                    const auto& source = type == "error" ? chunk : chunk["response"];
+                    auto error = source.contains("error") && source["error"].is_object() ? source["error"] : chunk;
+                    throw make_api_error("OpenAI", 500, "response failed",
+                                         Json{{"error", error}}.dump(), {});
+                }
+                return true;
+            });
+
+            if (!completed && !fullContent.empty()) {
+                result.content.push_back(TextContent { .text = fullContent });
+                result.stopReason = StopReason::EndOfTurn;
+            }
+            return result;
+        }, true);
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback) {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    // Id of the response the next request would continue from
+    std::optional<std::string> response_id() const {
+        if (!chain_) return std::nullopt;
+        return chain_->responseId;
+    }
+
+    // Forget the server-side chain; the next request sends the full history
+    void reset() { chain_.reset(); }
+
+    const ResponsesStats& stats() const { return stats_; }
+
+    // Response bytes received on the wire and after decompression
+    TransferStats transfer_stats() const { return http_.stats(); }
+
+    // Rate-limit headroom from the most recent response, if the upstream reported it
+    const std::optional<RateLimitStatus>& rate_limit() const { return rateLimit_; }
+
+    // FileUploadProvider: input_image parts take the id of an image stored
+    // with purpose "vision", so AttachmentProvider can send it by reference
+    static constexpr bool referencesImageFiles = true;
+
+    FileObject upload_file(std::string_view data, std::string_view filename, std::string_view mediaType) {
+        auto boundary = multipart_boundary();
+        auto purpose = mediaType.starts_with("image/") ? "vision" : "user_data";
+        auto request = base_request_("/files");
+        request.body = multipart_body(boundary, {{"purpose", purpose}}, "file", filename, mediaType, data);
+        request.headers["Content-Type"] = "multipart/form-data; boundary=" + boundary;
+        auto response = send_(request);
+
+        auto json = Json::parse(response.body);
+        return FileObject {
+            .id = json.value("id", ""),
+            .filename = json.value("filename", std::string(filename)),
+            .mediaType = std::string(mediaType),
+            .bytes = json.value("bytes", static_cast<std::int64_t>(data.size())),
+        };
+    }
+
+private:
+    // Number of leading messages the server already holds, or 0
+    std::size_t continued_prefix_(const std::vector<Message>& messages) const {
+        if (!chain_ || messages.size() <= chain_->knownMessages) return 0;
+        const auto& reply = messages[chain_->knownMessages - 1];
+        if (reply.role != Role::Assistant || message_text_(reply) != chain_->replyText) return 0;
+        return chain_->knownMessages;
+    }
+
+    template<typename Send>
+    ChatResponse send_chained_(const std::vector<Message>& messages, const ChatParams& params,
+                               Send&& send, bool stream) {
+        auto from = continued_prefix_(messages);
+        std::optional<ChatResponse> response;
+        if (from > 0) {
+            auto payload = build_payload_(messages, from, params, stream);
+            payload["previous_response_id"] = chain_->responseId;
+            try {
+                response = send(payload);
+                stats_.chained++;
+            } catch (const ApiError& e) {
+                // Stored responses expire; anything else is the caller's problem
+                if (e.type != "previous_response_not_found") throw;
+                chain_.reset();
+                stats_.resent++;
+            }
+        }
+        if (!response) {
+            response = send(build_payload_(messages, 0, params, stream));
+        }
+
+        chain_ = Chain {
+            .responseId = response->id,
+            .knownMessages = messages.size() + 1,
+            .replyText = response->text(),
+        };
+        if (response->id.empty()) {
+            chain_.reset();
+        }
+        return std::move(*response);
+    }
+
+    static std::string message_text_(const Message& message) {
+        if (auto* text = std::get_if<std::string>(&message.content)) {
+            return *text;
+        }
+        std::string result;
+        for (const auto& part : std::get<std::vector<ContentPart>>(message.content)) {
+            if (auto* t = std::get_if<TextContent>(&part)) {
+                result += t->text;
+            }
+        }
+        return result;
+    }
+
+    // Serialization
+    static Json serialize_part_(const ContentPart& part, Role role) {
+        Json item;
+        std::visit([&](const auto& p) {
+            using P = std::decay_t<decltype(p)>;
+            if constexpr (std::is_same_v<P, TextContent>) {
+                item = Json{{"type", role == Role::Assistant ? "output_text" : "input_text"}, {"text", p.text}};
+            } else if constexpr (std::is_same_v<P, ImageContent>) {
+                item = Json{{"type", "input_image"}};
+                if (!p.fileId.empty()) {
+                    item["file_id"] = p.fileId;
+                } else if (p.isUrl) {
+                    item["image_url"] = p.data;
+                } else {
+                    item["image_url"] = "data:" + p.mediaType + ";base64," + p.data;
+                }
+            }
+        }, part);
+        return item;
+    }
+
+    // Input items for messages[from..]; tool calls and results are items of their own
+    static void serialize_items_(const std::vector<Message>& messages, std::size_t from, Json& input) {
+        for (std::size_t i = from; i < messages.size(); ++i) {
+            const auto& msg = messages[i];
+            if (msg.role == Role::System) continue;
+
+            if (auto* text = std::get_if<std::string>(&msg.content)) {
+                input.push_back(Json{{"role", msg.role == Role::Assistant ? "assistant" : "user"}, {"content", *text}});
+                continue;
+            }
+
+            Json content = Json::array();
+            for (const auto& part : std::get<std::vector<ContentPart>>(msg.content)) {
+                if (auto* tu = std::get_if<ToolUseContent>(&part)) {
+                    input.push_back(Json{
+                        {"type", "function_call"},
+                        {"call_id", tu->id},
+                        {"name", tu->name},
+                        {"arguments", tu->inputJson},
+                    });
+                } else if (auto* tr = std::get_if<ToolResultContent>(&part)) {
+                    input.push_back(Json{
+                        {"type", "function_call_output"},
+                        {"call_id", tr->toolUseId},
+                        {"output", tr->content},
+                    });
+                } else {
+                    content.push_back(serialize_part_(part, msg.role));
+                }
+            }
+            if (!content.empty()) {
+                input.push_back(Json{{"role", msg.role == Role::Assistant ? "assistant" : "user"}, {"content", content}});
+            }
+        }
+    }
+
+    Json build_payload_(const std::vector<Message>& messages, std::size_t from, const ChatParams& params,
+                        bool stream) {
+        Json payload;
+        payload["model"] = config_.model;
+
+        std::string instructions;
+        for (const auto& msg : messages) {
+            if (msg.role != Role::System) continue;
+            if (!instructions.empty()) instructions += "\n\n";
+            instructions += message_text_(msg);
+        }
+        if (!instructions.empty()) {
+            payload["instructions"] = instructions;
+        }
+
+        Json input = Json::array();
+        serialize_items_(messages, from, input);
+        stats_.itemsSent += input.size();
+        payload["input"] = std::move(input);
+
+        if (stream) {
+            payload["stream"] = true;
+        }
+        if (params.temperature.has_value()) {
+            payload["temperature"] = *params.temperature;
+        }
+        if (params.topP.has_value()) {
+            payload["top_p"] = *params.topP;
+        }
+        if (params.maxTokens.has_value()) {
+            payload["max_output_tokens"] = *params.maxTokens;
+        }
+
+        // Tools are not carried over by previous_response_id
+        if (params.tools.has_value() && !params.tools->empty()) {
+            Json tools = Json::array();
+            for (const auto& tool : *params.tools) {
+                Json t{{"type", "function"}, {"name", tool.name}, {"description", tool.description}};
+                if (!tool.inputSchema.empty()) {
+                    t["parameters"] = Json::parse(tool.inputSchema);
+                }
+                tools.push_back(t);
+            }
+            payload["tools"] = tools;
+        }
+
+        if (params.toolChoice.has_value()) {
+            std::visit([&](const auto& tc) {
+                using T = std::decay_t<decltype(tc)>;
+                if constexpr (std::is_same_v<T, ToolChoice>) {
+                    switch (tc) {
+                        case ToolChoice::Auto: payload["tool_choice"] = "auto"; break;
+                        case ToolChoice::None: payload["tool_choice"] = "none"; break;
+                        case ToolChoice::Required: payload["tool_choice"] = "required"; break;
+                    }
+                } else if constexpr (std::is_same_v<T, ToolChoiceForced>) {
+                    payload["tool_choice"] = Json{{"type", "function"}, {"name", tc.name}};
+                }
+            }, *params.toolChoice);
+        }
+
+        if (params.responseFormat.has_value()) {
+            const auto& rf = *params.responseFormat;
+            switch (rf.type) {
+                case ResponseFormatType::Text:
+                    payload["text"] = Json{{"format", Json{{"type", "text"}}}};
+                    break;
+                case ResponseFormatType::JsonObject:
+                    payload["text"] = Json{{"format", Json{{"type", "json_object"}}}};
+                    break;
+                case ResponseFormatType::JsonSchema: {
+                    Json format{{"type", "json_schema"}, {"name", rf.schemaName}};
+                    if (!rf.schema.empty()) {
+                        format["schema"] = Json::parse(rf.schema);
+                    }
+                    payload["text"] = Json{{"format", format}};
+                    break;
+                }
+            }
+        }
+
+        if (params.extraJson.has_value() && !params.extraJson->empty()) {
+            payload.merge_patch(Json::parse(*params.extraJson));
+        }
+
+        return payload;
+    }
+
+    // Deserialization
+    static ChatResponse parse_response_(const Json& json) {
+        ChatResponse result;
+        result.id = json.value("id", "");
+        result.model = json.value("model", "");
+        result.stopReason = StopReason::EndOfTurn;
+
+        bool toolUse = false;
+        if (json.contains("output") && json["output"].is_array()) {
+            for (const auto& item : json["output"]) {
+                auto type = item.value("type", "");
+                if (type == "message" && item.contains("content")) {
+                    for (const auto& part : item["content"]) {
+                        if (part.value("type", "") == "output_text") {
+                            result.content.push_back(TextContent { .text = part.value("text", "") });
+                        }
+                    }
+                } else if (type == "function_call") {
+                    result.content.push_back(ToolUseContent {
+                        .id = item.value("call_id", ""),
+                        .name = item.value("name", ""),
+                        .inputJson = item.value("arguments", ""),
+                    });
+                    toolUse = true;
+                }
+            }
+        }
+
+        if (json.value("status", "") == "incomplete" && json.contains("incomplete_details") &&
+            json["incomplete_details"].is_object()) {
+            auto reason = json["incomplete_details"].value("reason", "");
+            if (reason == "max_output_tokens") result.stopReason = StopReason::MaxTokens;
+            if (reason == "content_filter") result.stopReason = StopReason::ContentFilter;
+        } else if (toolUse) {
+            result.stopReason = StopReason::ToolUse;
+        }
+
+        if (json.contains("usage") && json["usage"].is_object()) {
+            const auto& usage = json["usage"];
+            result.usage.inputTokens = usage.value("input_tokens", 0);
+            result.usage.outputTokens = usage.value("output_tokens", 0);
+            result.usage.totalTokens = result.usage.inputTokens + result.usage.outputTokens;
+            if (usage.contains("input_tokens_details") && usage["input_tokens_details"].is_object()) {
+                result.usage.cacheReadTokens = usage["input_tokens_details"].value("cached_tokens", 0);
+            }
+        }
+
+        return result;
+    }
+
+    // HTTP helpers (same error mapping as OpenAI)
+    tinyhttps::HttpResponse send_(const tinyhttps::HttpRequest& request) {
+        tinyhttps::HttpResponse response;
+        try {
+            response = http_.send(request);
+        } catch (const TimeoutError&) {
+            throw;
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw ConnectionError(std::string("OpenAI connection error: ") + e.what());
+        }
+        if (auto status = parse_rate_limit(response.headers)) {
+            rateLimit_ = status;
+        }
+        if (!response.ok()) {
+            throw make_api_error("OpenAI", response.statusCode, response.statusText,
+                                 std::move(response.body), response.headers);
+        }
+        return response;
+    }
+
+    template<typename F>
+    tinyhttps::HttpResponse send_stream_(const tinyhttps::HttpRequest& request, F&& onEvent) {
+        std::exception_ptr handlerError;
+        tinyhttps::HttpResponse response;
+        try {
+            response = http_.send_stream(request, [&](const tinyhttps::SseEvent& event) -> bool {
+                try {
+                    return onEvent(event);
+                } catch (...) {
+                    handlerError = std::current_exception();
+                    return false;
+                }
+            });
+        } catch (const TimeoutError&) {
+            throw;
+        } catch (const CancelledError&) {
+            throw;
+        } catch (const std::exception& e) {
+            throw ConnectionError(std::string("OpenAI connection error: ") + e.what());
+        }
+        if (auto status = parse_rate_limit(response.headers)) {
+            rateLimit_ = status;
+        }
+        if (handlerError) {
+            std::rethrow_exception(handlerError);
+        }
+        if (!response.ok()) {
+            throw make_api_error("OpenAI", response.statusCode, response.statusText,
+                                 std::move(response.body), response.headers);
+        }
+        return response;
+    }
+
+    tinyhttps::HttpRequest build_request_(std::string_view endpoint, const Json& payload) {
+        auto req = base_request_(endpoint);
+        req.body = payload.dump(-1, ' ', false, Json::error_handler_t::replace);
+        req.headers["Content-Type"] = "application/json";
+        stats_.requests++;
+        stats_.bytesSent += req.body.size();
+        return req;
+    }
+
+    // POST with auth and custom headers, not counted in stats()
+    tinyhttps::HttpRequest base_request_(std::string_view endpoint) const {
+        tinyhttps::HttpRequest req;
+        req.method = tinyhttps::Method::POST;
+        req.url = config_.baseUrl + std::string(endpoint);
+        req.headers["Authorization"] = "Bearer " + config_.apiKey;
+
+        if (!config_.organization.empty()) {
+            req.headers["OpenAI-Organization"] = config_.organization;
+        }
+
+        for (const auto& [key, value] : config_.customHeaders) {
+            req.headers[key] = value;
+        }
+
+        return req;
+    }
+};
+
+} // namespace mcpplibs::llmapi::openai
@@ -32,4 +32,10 @@ concept EmbeddableProvider = Provider<P> && requires(P p,
     { p.embed(inputs, model) } -> std::same_as<EmbeddingResponse>;
 };
 
+template<typename P>
+concept CachePrimableProvider = Provider<P> && requires(P p,
+    const std::vector<Message>& messages, const std::vector<ToolDef>& tools) {
+    { p.prime_cache(messages, tools) } -> std::same_as<ChatResponse>;
+};
+
 } // namespace mcpplibs::llmapi
@@ -0,0 +1,59 @@
+export module mcpplibs.llmapi:rate_limit;
+
+import :errors;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+// Rate-limit headroom reported by the upstream on its last response
+// (x-ratelimit-* for OpenAI, anthropic-ratelimit-* for Anthropic).
+struct RateLimitStatus {
+    std::optional<std::int64_t> limitRequests;
+    std::optional<std::int64_t> remainingRequests;
+    std::optional<std::int64_t> limitTokens;
+    std::optional<std::int64_t> remainingTokens;
+    std::chrono::steady_clock::time_point observedAt;
+
+    // Smallest remaining/limit ratio in [0, 1]; nullopt if nothing was reported
+    std::optional<double> headroom() const {
+        std::optional<double> result;
+        auto ratio = [&](const std::optional<std::int64_t>& remaining, const std::optional<std::int64_t>& limit) {
+            if (!remaining || !limit || *limit <= 0) return;
+            auto value = std::clamp(static_cast<double>(*remaining) / static_cast<double>(*limit), 0.0, 1.0);
+            result = result ? std::min(*result, value) : value;
+        };
+        ratio(remainingRequests, limitRequests);
+        ratio(remainingTokens, limitTokens);
+        return result;
+    }
+};
+
+} // namespace mcpplibs::llmapi
+
+namespace mcpplibs::llmapi {
+
+inline std::optional<RateLimitStatus> parse_rate_limit(const Headers& headers) {
+    auto number = [&](std::string_view openaiName, std::string_view anthropicName) -> std::optional<std::int64_t> {
+        auto header = find_header(headers, openaiName);
+        if (!header) header = find_header(headers, anthropicName);
+        if (!header) return std::nullopt;
+        std::int64_t value { 0 };
+        auto [ptr, ec] = std::from_chars(header->data(), header->data() + header->size(), value);
+        if (ec != std::errc{}) return std::nullopt;
+        return value;
+    };
+
+    RateLimitStatus status {
+        .limitRequests = number("x-ratelimit-limit-requests", "anthropic-ratelimit-requests-limit"),
+        .remainingRequests = number("x-ratelimit-remaining-requests", "anthropic-ratelimit-requests-remaining"),
+        .limitTokens = number("x-ratelimit-limit-tokens", "anthropic-ratelimit-tokens-limit"),
+        .remainingTokens = number("x-ratelimit-remaining-tokens", "anthropic-ratelimit-tokens-remaining"),
+        .observedAt = std::chrono::steady_clock::now(),
+    };
+    if (!status.limitRequests && !status.remainingRequests && !status.limitTokens && !status.remainingTokens) {
+        return std::nullopt;
+    }
+    return status;
+}
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,233 @@
+export module mcpplibs.llmapi:retry;
+
+import :types;
+import :coro;
+import :provider;
+import :errors;
+import :cancel;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+struct RetryPolicy {
+    int maxAttempts { 4 };                                   // including the first attempt
+    std::chrono::milliseconds initialBackoff { 500 };
+    std::chrono::milliseconds maxBackoff { 30000 };
+    double multiplier { 2.0 };
+    std::chrono::milliseconds totalDeadline { 120000 };      // 0 = no deadline
+    bool honorRetryAfter { true };
+    // Retry budget: every request earns `budgetRatio` retry tokens, every retry
+    // spends one. Caps retry traffic at ~ratio of normal traffic during outages.
+    double budgetRatio { 0.2 };
+    double budgetMax { 10.0 };
+};
+
+// Failure classification
+struct FailureInfo {
+    bool retryable { false };
+    std::optional<std::chrono::milliseconds> retryAfter;
+};
+
+inline FailureInfo classify_failure(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const ApiError& e) {
+        return FailureInfo { .retryable = e.retryable(), .retryAfter = e.retryAfter };
+    } catch (const ConnectionError&) {
+        return FailureInfo { .retryable = true };
+    } catch (...) {
+        return FailureInfo {};
+    }
+}
+
+// Exponential backoff with full jitter: delay ~ U(0, min(max, initial * mult^n)).
+// Safe to share between threads: the jitter source is per thread.
+class Backoff {
+private:
+    RetryPolicy policy_;
+
+public:
+    explicit Backoff(RetryPolicy policy)
+        : policy_(std::move(policy))
+    {}
+
+    // retry: 0 for the first retry
+    std::chrono::milliseconds delay(int retry) const {
+        static thread_local std::mt19937_64 rng { std::random_device{}() };
+        double ceiling = static_cast<double>(policy_.initialBackoff.count()) *
+                         std::pow(policy_.multiplier, retry);
+        ceiling = std::min(ceiling, static_cast<double>(policy_.maxBackoff.count()));
+        std::uniform_real_distribution<double> jitter { 0.0, std::max(ceiling, 1.0) };
+        return std::chrono::milliseconds { static_cast<std::int64_t>(jitter(rng)) };
+    }
+};
+
+// Token bucket shared by all requests going through one RetryProvider
+class RetryBudget {
+private:
+    mutable std::mutex mutex_;
+    double tokens_;
+    double ratio_;
+    double max_;
+
+public:
+    RetryBudget(double ratio, double max) : tokens_(max), ratio_(ratio), max_(max) {}
+
+    void on_request() {
+        std::lock_guard lock { mutex_ };
+        tokens_ = std::min(max_, tokens_ + ratio_);
+    }
+
+    bool try_spend() {
+        std::lock_guard lock { mutex_ };
+        if (tokens_ < 1.0) return false;
+        tokens_ -= 1.0;
+        return true;
+    }
+
+    double tokens() const {
+        std::lock_guard lock { mutex_ };
+        return tokens_;
+    }
+};
+
+struct RetryStats {
+    std::uint64_t requests { 0 };
+    std::uint64_t retries { 0 };
+    std::uint64_t budgetExhausted { 0 };
+};
+
+} // namespace mcpplibs::llmapi
+
+namespace mcpplibs::llmapi {
+
+// Live counters behind RetryStats, updated by concurrent calls
+struct RetryCounters {
+    std::atomic<std::uint64_t> requests { 0 };
+    std::atomic<std::uint64_t> retries { 0 };
+    std::atomic<std::uint64_t> budgetExhausted { 0 };
+};
+
+} // namespace mcpplibs::llmapi
+
+export namespace mcpplibs::llmapi {
+
+// Wraps any Provider and retries transient failures (429, 5xx, 529, connection
+// errors) with jittered backoff, honoring Retry-After and a total deadline.
+// Streams are only retried while nothing has been delivered to the callback.
+template<Provider P>
+class RetryProvider {
+private:
+    P provider_;
+    RetryPolicy policy_;
+    Backoff backoff_;
+    std::unique_ptr<RetryBudget> budget_;
+    std::unique_ptr<RetryCounters> counters_;
+
+public:
+    explicit RetryProvider(P provider, RetryPolicy policy = {})
+        : provider_(std::move(provider))
+        , policy_(policy)
+        , backoff_(policy)
+        , budget_(std::make_unique<RetryBudget>(policy.budgetRatio, policy.budgetMax))
+        , counters_(std::make_unique<RetryCounters>())
+    {}
+
+    // Provider concept
+    std::string_view name() const { return provider_.name(); }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        CancelScope cancelScope { params.cancel };
+        return run_([&] { return provider_.chat(messages, params); }, [] { return true; });
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        CancelScope cancelScope { params.cancel };
+        bool delivered = false;
+        std::function<void(std::string_view)> tracked = [&](std::string_view chunk) {
+            delivered = true;
+            callback(chunk);
+        };
+        return run_([&] { return provider_.chat_stream(messages, params, tracked); },
+                    [&] { return !delivered; });
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    // EmbeddableProvider
+    EmbeddingResponse embed(const std::vector<std::string>& inputs, std::string_view model)
+        requires EmbeddableProvider<P>
+    {
+        return run_([&] { return provider_.embed(inputs, model); }, [] { return true; });
+    }
+
+    const RetryPolicy& policy() const { return policy_; }
+    RetryStats stats() const {
+        return RetryStats {
+            .requests = counters_->requests.load(),
+            .retries = counters_->retries.load(),
+            .budgetExhausted = counters_->budgetExhausted.load(),
+        };
+    }
+    const P& provider() const { return provider_; }
+    P& provider() { return provider_; }
+
+private:
+    template<typename Fn, typename CanRetry>
+    auto run_(Fn&& attempt, CanRetry&& canRetry) -> decltype(attempt()) {
+        using Clock = std::chrono::steady_clock;
+        auto start = Clock::now();
+        counters_->requests++;
+        budget_->on_request();
+
+        for (int attemptNo = 1; ; ++attemptNo) {
+            try {
+                return attempt();
+            } catch (...) {
+                auto error = std::current_exception();
+                auto failure = classify_failure(error);
+                if (!failure.retryable || attemptNo >= policy_.maxAttempts || !canRetry()) {
+                    throw;
+                }
+
+                auto wait = backoff_.delay(attemptNo - 1);
+                if (policy_.honorRetryAfter && failure.retryAfter) {
+                    wait = std::max(wait, *failure.retryAfter);
+                }
+                if (policy_.totalDeadline.count() > 0) {
+                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+                    if (elapsed + wait >= policy_.totalDeadline) {
+                        throw;
+                    }
+                }
+                // No retry that would outlive the caller's deadline
+                const auto& cancel = current_cancellation();
+                if (cancel.deadline && wait >= cancel.remaining()) {
+                    throw;
+                }
+                if (!budget_->try_spend()) {
+                    counters_->budgetExhausted++;
+                    throw;
+                }
+
+                counters_->retries++;
+                if (!cancel.sleep_for(wait)) cancel.check(provider_.name());
+            }
+        }
+    }
+};
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,252 @@
+export module mcpplibs.llmapi:routing;
+
+import :types;
+import :coro;
+import :provider;
+import :retry;
+import :metrics;
+import :affinity;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+struct RoutingPolicy {
+    std::chrono::milliseconds decay { 10000 };            // EWMA time constant
+    std::chrono::milliseconds initialLatency { 500 };     // prior for endpoints without samples
+    std::chrono::milliseconds failurePenalty { 10000 };   // latency sample recorded on transient failures
+    AffinityPolicy affinity {};                           // sticky routing by prompt prefix
+};
+
+struct EndpointStats {
+    std::string name;
+    double latencyMs { 0 };      // EWMA of chat() / full stream latency
+    double ttftMs { 0 };         // EWMA of time to first streamed chunk
+    int inFlight { 0 };
+    std::uint64_t requests { 0 };
+    std::uint64_t failures { 0 };
+    CacheStats cache;
+};
+
+// Latency-aware router over equivalent endpoints (e.g. the same model behind
+// URL::OpenAI, URL::OpenRouter and a self-hosted gateway). Each call picks two
+// endpoints at random and sends to the cheaper one (power of two choices),
+// where cost = peak EWMA latency (TTFT for streams) * (in-flight + 1).
+//
+// Thread-safe: concurrent callers may share one router. Each endpoint's
+// provider is used by one caller at a time; queued callers count as in-flight.
+// Failures are not retried here; wrap in RetryProvider to re-route retries.
+//
+// With policy.affinity enabled, requests sharing a prompt prefix go to the
+// same endpoint (rendezvous hashing on prefix_fingerprint) so its prompt
+// cache stays warm, unless that endpoint's cost exceeds maxCostRatio x the
+// cheapest; then the next endpoint in rendezvous order is used.
+template<Provider P>
+class RoutingProvider {
+private:
+    struct Endpoint {
+        P provider;
+        std::string label;
+        std::uint64_t seed;
+        std::mutex callMutex;
+        Ewma latency;
+        Ewma ttft;
+        EndpointStats stats;
+
+        Endpoint(P p, std::string name, std::chrono::milliseconds decay)
+            : provider(std::move(p)), label(std::move(name)), seed(affinity_seed(label))
+            , latency(decay, true), ttft(decay, true) {}
+    };
+
+    struct State {
+        RoutingPolicy policy;
+        std::mutex mutex;   // guards EWMAs, stats and rng
+        std::mt19937_64 rng { std::random_device{}() };
+        std::vector<std::unique_ptr<Endpoint>> endpoints;
+    };
+
+    std::unique_ptr<State> state_;
+
+public:
+    explicit RoutingProvider(RoutingPolicy policy = {})
+        : state_(std::make_unique<State>())
+    {
+        state_->policy = policy;
+    }
+
+    template<std::same_as<P>... Ps>
+    explicit RoutingProvider(P first, Ps... rest)
+        : RoutingProvider(RoutingPolicy {}, std::move(first), std::move(rest)...) {}
+
+    template<std::same_as<P>... Ps>
+    RoutingProvider(RoutingPolicy policy, P first, Ps... rest)
+        : RoutingProvider(policy)
+    {
+        add(std::move(first));
+        (add(std::move(rest)), ...);
+    }
+
+    RoutingProvider& add(P provider, std::string label = {}) {
+        std::lock_guard lock { state_->mutex };
+        if (label.empty()) {
+            label = std::string(provider.name()) + "#" + std::to_string(state_->endpoints.size());
+        }
+        state_->endpoints.push_back(
+            std::make_unique<Endpoint>(std::move(provider), std::move(label), state_->policy.decay));
+        return *this;
+    }
+
+    // Provider concept
+    std::string_view name() const { return "router"; }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        return run_(false, fingerprint_(messages, params),
+                    [&](P& provider, auto&&) { return provider.chat(messages, params); });
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+
+    // StreamableProvider
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams& params,
+                             std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        return run_(true, fingerprint_(messages, params), [&](P& provider, auto&& onFirstChunk) {
+            bool first = true;
+            return provider.chat_stream(messages, params, [&](std::string_view chunk) {
+                if (first) {
+                    first = false;
+                    onFirstChunk();
+                }
+                callback(chunk);
+            });
+        });
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& messages, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback)
+        requires StreamableProvider<P>
+    {
+        co_return chat_stream(messages, params, std::move(callback));
+    }
+
+    std::size_t size() const {
+        std::lock_guard lock { state_->mutex };
+        return state_->endpoints.size();
+    }
+
+    std::vector<EndpointStats> endpoints() const {
+        std::lock_guard lock { state_->mutex };
+        std::vector<EndpointStats> result;
+        for (const auto& endpoint : state_->endpoints) {
+            auto stats = endpoint->stats;
+            stats.name = endpoint->label;
+            stats.latencyMs = endpoint->latency.value_or(0.0);
+            stats.ttftMs = endpoint->ttft.value_or(0.0);
+            result.push_back(std::move(stats));
+        }
+        return result;
+    }
+
+private:
+    double cost_(const Endpoint& endpoint, bool stream) const {
+        auto prior = static_cast<double>(state_->policy.initialLatency.count());
+        auto base = stream && endpoint.ttft.has_value() ? endpoint.ttft.value_or(prior)
+                                                         : endpoint.latency.value_or(prior);
+        return base * static_cast<double>(endpoint.stats.inFlight + 1);
+    }
+
+    std::optional<std::uint64_t> fingerprint_(const std::vector<Message>& messages, const ChatParams& params) const {
+        const auto& affinity = state_->policy.affinity;
+        if (!affinity.enabled) return std::nullopt;
+        return prefix_fingerprint(messages, params, affinity.prefixMessages);
+    }
+
+    // Caller holds state_->mutex
+    Endpoint& pick_(bool stream, std::optional<std::uint64_t> fingerprint) {
+        auto& endpoints = state_->endpoints;
+        if (endpoints.empty()) {
+            throw std::logic_error("RoutingProvider has no endpoints");
+        }
+        if (endpoints.size() == 1) return *endpoints[0];
+
+        if (fingerprint) {
+            // Saturation is judged against measured endpoints only; the prior
+            // of an unmeasured endpoint says nothing about its load.
+            std::vector<std::uint64_t> seeds;
+            auto cheapest = std::numeric_limits<double>::max();
+            for (const auto& endpoint : endpoints) {
+                seeds.push_back(endpoint->seed);
+                if (endpoint->latency.has_value()) {
+                    cheapest = std::min(cheapest, cost_(*endpoint, stream));
+                }
+            }
+            auto limit = std::max(cheapest, 1.0) * state_->policy.affinity.maxCostRatio;
+            for (auto index : rendezvous_order(*fingerprint, seeds, {})) {
+                const auto& endpoint = *endpoints[index];
+                if (!endpoint.latency.has_value() || cost_(endpoint, stream) <= limit) {
+                    return *endpoints[index];
+                }
+            }
+        }
+
+        std::uniform_int_distribution<std::size_t> dist { 0, endpoints.size() - 1 };
+        auto a = dist(state_->rng);
+        auto b = dist(state_->rng);
+        while (b == a) b = dist(state_->rng);
+        return cost_(*endpoints[a], stream) <= cost_(*endpoints[b], stream) ? *endpoints[a] : *endpoints[b];
+    }
+
+    template<typename Fn>
+    ChatResponse run_(bool stream, std::optional<std::uint64_t> fingerprint, Fn&& attempt) {
+        Endpoint* endpoint = nullptr;
+        {
+            std::lock_guard lock { state_->mutex };
+            endpoint = &pick_(stream, fingerprint);
+            endpoint->stats.inFlight++;
+            endpoint->stats.requests++;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto elapsedMs = [&] {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        auto onFirstChunk = [&] {
+            auto ttft = elapsedMs();
+            std::lock_guard lock { state_->mutex };
+            endpoint->ttft.record(ttft);
+        };
+
+        try {
+            std::unique_lock call { endpoint->callMutex };
+            start = std::chrono::steady_clock::now();   // queueing is reflected by inFlight, not latency
+            auto response = attempt(endpoint->provider, onFirstChunk);
+            call.unlock();
+
+            auto latency = elapsedMs();
+            std::lock_guard lock { state_->mutex };
+            endpoint->latency.record(latency);
+            endpoint->stats.inFlight--;
+            endpoint->stats.cache.record(response.usage);
+            return response;
+        } catch (...) {
+            bool transient = classify_failure(std::current_exception()).retryable;
+            std::lock_guard lock { state_->mutex };
+            if (transient) {
+                endpoint->latency.record(static_cast<double>(state_->policy.failurePenalty.count()));
+                endpoint->stats.failures++;
+            }
+            endpoint->stats.inFlight--;
+            throw;
+        }
+    }
+};
+
+template<Provider P, typename... Ps>
+RoutingProvider(P, Ps...) -> RoutingProvider<P>;
+
+template<Provider P, typename... Ps>
+RoutingProvider(RoutingPolicy, P, Ps...) -> RoutingProvider<P>;
+
+} // namespace mcpplibs::llmapi
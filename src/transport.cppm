@@ -0,0 +1,122 @@
+export module mcpplibs.llmapi:transport;
+
+import :http;
+import mcpplibs.tinyhttps;
+import std;
+
+export namespace mcpplibs::llmapi {
+
+using SseCallback = std::function<bool(const tinyhttps::SseEvent&)>;
+using BodyCallback = std::function<bool(std::string_view)>;
+
+// What a provider needs from its HTTP layer. send_stream hands each SSE
+// event of a 2xx response to the callback until it returns false; error
+// responses come back with their body. The BodyWriter overloads stream the
+// request body instead of reading request.body.
+template<typename T>
+concept Transport = requires(T t, const tinyhttps::HttpRequest& request, const BodyWriter& body, SseCallback callback) {
+    { t.send(request) } -> std::same_as<tinyhttps::HttpResponse>;
+    { t.send(request, body) } -> std::same_as<tinyhttps::HttpResponse>;
+    { t.send_stream(request, callback) } -> std::same_as<tinyhttps::HttpResponse>;
+    { t.send_stream(request, body, callback) } -> std::same_as<tinyhttps::HttpResponse>;
+};
+
+// Type-erased transport, so providers can run over HttpTransport (the
+// default), a pooled or HTTP/2 backend, a recorder, or an in-memory fake
+// for zero-network benchmarks, without being templates themselves.
+class AnyTransport {
+private:
+    struct Concept {
+        virtual ~Concept() = default;
+        virtual tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request) = 0;
+        virtual tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request, const BodyWriter& body) = 0;
+        virtual tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, SseCallback callback) = 0;
+        virtual tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, const BodyWriter& body,
+                                                    SseCallback callback) = 0;
+        virtual tinyhttps::HttpResponse send_download(const tinyhttps::HttpRequest& request, BodyCallback onBody) = 0;
+        virtual TransferStats stats() const = 0;
+    };
+
+    template<Transport T>
+    struct Model final : Concept {
+        T transport;
+
+        explicit Model(T t) : transport(std::move(t)) {}
+
+        tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request) override {
+            return transport.send(request);
+        }
+
+        tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request, const BodyWriter& body) override {
+            return transport.send(request, body);
+        }
+
+        tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, SseCallback callback) override {
+            return transport.send_stream(request, std::move(callback));
+        }
+
+        tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, const BodyWriter& body,
+                                            SseCallback callback) override {
+            return transport.send_stream(request, body, std::move(callback));
+        }
+
+        tinyhttps::HttpResponse send_download(const tinyhttps::HttpRequest& request, BodyCallback onBody) override {
+            if constexpr (requires { transport.send_download(request, onBody); }) {
+                return transport.send_download(request, std::move(onBody));
+            } else {
+                auto response = transport.send(request);
+                if (response.ok()) {
+                    onBody(std::string_view(response.body));
+                    response.body.clear();
+                }
+                return response;
+            }
+        }
+
+        TransferStats stats() const override {
+            if constexpr (requires { { transport.stats() } -> std::convertible_to<TransferStats>; }) {
+                return transport.stats();
+            } else {
+                return {};
+            }
+        }
+    };
+
+    std::unique_ptr<Concept> impl_;
+
+public:
+    template<Transport T>
+        requires (!std::same_as<std::remove_cvref_t<T>, AnyTransport>)
+    AnyTransport(T transport)
+        : impl_(std::make_unique<Model<T>>(std::move(transport))) {}
+
+    AnyTransport(AnyTransport&&) noexcept = default;
+    AnyTransport& operator=(AnyTransport&&) noexcept = default;
+
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request) {
+        return impl_->send(request);
+    }
+
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request, const BodyWriter& body) {
+        return impl_->send(request, body);
+    }
+
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, SseCallback callback) {
+        return impl_->send_stream(request, std::move(callback));
+    }
+
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, const BodyWriter& body, SseCallback callback) {
+        return impl_->send_stream(request, body, std::move(callback));
+    }
+
+    // Large response bodies (file downloads) without holding them in memory.
+    // Transports without a send_download hand over the whole body at once.
+    tinyhttps::HttpResponse send_download(const tinyhttps::HttpRequest& request, BodyCallback onBody) {
+        return impl_->send_download(request, std::move(onBody));
+    }
+
+    // Zero for transports that do not count bytes
+    TransferStats stats() const { return impl_->stats(); }
+};
+
+} // namespace mcpplibs::llmapi
@@ -1,5 +1,6 @@
 export module mcpplibs.llmapi:types;
 
+import :cancel;
 import std;
 import mcpplibs.llmapi.nlohmann.json;
 
@@ -17,6 +18,7 @@ export struct ImageContent {
     std::string data;       // base64 or URL
     std::string mediaType;  // "image/png", "image/jpeg"
     bool isUrl{false};
+    std::string fileId;     // Files API id; when set, sent by reference instead of data
 };
 
 export struct AudioContent {
@@ -42,6 +44,7 @@ export using Content = std::variant<std::string, std::vector<ContentPart>>;
 
 export struct CacheControl {
     std::string type {"ephemeral"};
+    std::string ttl;  // "5m" or "1h"; empty = provider default
 };
 
 // Message
@@ -106,6 +109,14 @@ export struct ChatParams {
     std::optional<ToolChoicePolicy> toolChoice;
     std::optional<ResponseFormat> responseFormat;
     std::optional<std::string> extraJson;
+    std::optional<int> logprobs;   // token logprobs with this many top alternatives (0-20)
+    // false: chat_stream keeps no copy of the streamed text, the callback is
+    // its only consumer and the returned response carries no text (tool
+    // calls, usage and stop reason are still filled in). Not sent upstream.
+    bool accumulateStream { true };
+    // Stop token and deadline for this call; the call then throws
+    // CancelledError. Not sent upstream.
+    Cancellation cancel;
 };
 
 // Stop reason
@@ -120,6 +131,58 @@ export struct Usage {
     int cacheReadTokens{0};
 };
 
+// Token log probabilities, struct-of-arrays: token texts share one string
+// pool and are addressed by offset, so a long response costs a few flat
+// arrays rather than a string (and a JSON node) per token.
+export struct Logprobs {
+    std::string pool;
+    std::vector<std::uint32_t> offsets;   // token i is pool.substr(offsets[i], lengths[i])
+    std::vector<std::uint32_t> lengths;
+    std::vector<float> values;
+    // Top alternatives, flattened: those of token i are [topBegin[i], topBegin[i + 1])
+    std::vector<std::uint32_t> topBegin { 0 };
+    std::vector<std::uint32_t> topOffsets;
+    std::vector<std::uint32_t> topLengths;
+    std::vector<float> topValues;
+
+    std::size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+
+    std::string_view token(std::size_t i) const { return std::string_view { pool }.substr(offsets[i], lengths[i]); }
+    float logprob(std::size_t i) const { return values[i]; }
+
+    std::size_t alternatives(std::size_t i) const { return topBegin[i + 1] - topBegin[i]; }
+    std::string_view alternative(std::size_t i, std::size_t k) const {
+        auto j = topBegin[i] + k;
+        return std::string_view { pool }.substr(topOffsets[j], topLengths[j]);
+    }
+    float alternative_logprob(std::size_t i, std::size_t k) const { return topValues[topBegin[i] + k]; }
+
+    // Log probability of the whole sequence
+    double sum() const {
+        double total { 0 };
+        for (auto value : values) total += value;
+        return total;
+    }
+
+    void add_token(std::string_view text, float logprob) {
+        offsets.push_back(static_cast<std::uint32_t>(pool.size()));
+        lengths.push_back(static_cast<std::uint32_t>(text.size()));
+        pool += text;
+        values.push_back(logprob);
+        topBegin.push_back(topBegin.back());
+    }
+
+    // Alternative for the most recently added token
+    void add_alternative(std::string_view text, float logprob) {
+        topOffsets.push_back(static_cast<std::uint32_t>(pool.size()));
+        topLengths.push_back(static_cast<std::uint32_t>(text.size()));
+        pool += text;
+        topValues.push_back(logprob);
+        topBegin.back()++;
+    }
+};
+
 // Chat response
 export struct ChatResponse {
     std::string id;
@@ -127,6 +190,7 @@ export struct ChatResponse {
     std::vector<ContentPart> content;
     StopReason stopReason;
     Usage usage;
+    std::optional<Logprobs> logprobs;   // when requested via ChatParams::logprobs
 
     std::string text() const {
         std::string result;
@@ -201,7 +265,11 @@ inline Json contentPartToJson(const ContentPart& part) {
         if constexpr (std::is_same_v<T, TextContent>) {
             return Json{{"type", "text"}, {"text", p.text}};
         } else if constexpr (std::is_same_v<T, ImageContent>) {
-            return Json{{"type", "image"}, {"data", p.data}, {"mediaType", p.mediaType}, {"isUrl", p.isUrl}};
+            Json j{{"type", "image"}, {"data", p.data}, {"mediaType", p.mediaType}, {"isUrl", p.isUrl}};
+            if (!p.fileId.empty()) {
+                j["fileId"] = p.fileId;
+            }
+            return j;
         } else if constexpr (std::is_same_v<T, AudioContent>) {
             return Json{{"type", "audio"}, {"data", p.data}, {"format", p.format}};
         } else if constexpr (std::is_same_v<T, ToolUseContent>) {
@@ -221,6 +289,7 @@ inline ContentPart contentPartFromJson(const Json& j) {
             .data = j.at("data").get<std::string>(),
             .mediaType = j.at("mediaType").get<std::string>(),
             .isUrl = j.value("isUrl", false),
+            .fileId = j.value("fileId", ""),
         };
     } else if (type == "audio") {
         return AudioContent{
@@ -260,6 +329,9 @@ inline Json messageToJson(const Message& msg) {
     }, msg.content);
     if (msg.cacheControl) {
         j["cache_control"] = Json{{"type", msg.cacheControl->type}};
+        if (!msg.cacheControl->ttl.empty()) {
+            j["cache_control"]["ttl"] = msg.cacheControl->ttl;
+        }
     }
     return j;
 }
@@ -278,7 +350,10 @@ inline Message messageFromJson(const Json& j) {
         msg.content = std::move(parts);
     }
     if (j.contains("cache_control") && j["cache_control"].is_object()) {
-        msg.cacheControl = CacheControl{.type = j["cache_control"].value("type", "ephemeral")};
+        msg.cacheControl = CacheControl{
+            .type = j["cache_control"].value("type", "ephemeral"),
+            .ttl = j["cache_control"].value("ttl", ""),
+        };
     }
     return msg;
 }
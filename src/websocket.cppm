@@ -0,0 +1,442 @@
+export module mcpplibs.llmapi:websocket;
+
+import :cancel;
+import :errors;
+import mcpplibs.tinyhttps;
+import std;
+
+namespace mcpplibs::llmapi {
+
+inline constexpr std::string_view WEBSOCKET_GUID { "258EAFA5-E914-47DA-95CA-C5AB0DC85B11" };
+
+// SHA-1, only for the Sec-WebSocket-Accept handshake check
+std::array<std::uint8_t, 20> sha1(std::string_view input) {
+    std::uint32_t h[5] { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::string data(input);
+    auto bits = static_cast<std::uint64_t>(input.size()) * 8;
+    data += static_cast<char>(0x80);
+    while (data.size() % 64 != 56) data += '\0';
+    for (int i = 7; i >= 0; --i) data += static_cast<char>((bits >> (i * 8)) & 0xFF);
+
+    for (std::size_t block = 0; block < data.size(); block += 64) {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[block + i * 4])) << 24 |
+                   static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[block + i * 4 + 1])) << 16 |
+                   static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[block + i * 4 + 2])) << 8 |
+                   static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[block + i * 4 + 3]));
+        }
+        for (int i = 16; i < 80; ++i) w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        auto [a, b, c, d, e] = h;
+        for (int i = 0; i < 80; ++i) {
+            std::uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            auto t = std::rotl(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = std::rotl(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    std::array<std::uint8_t, 20> digest;
+    for (int i = 0; i < 20; ++i) digest[i] = static_cast<std::uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+    return digest;
+}
+
+std::string base64_encode(std::span<const std::uint8_t> bytes) {
+    static constexpr std::string_view alphabet {
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" };
+    std::string out;
+    out.reserve((bytes.size() + 2) / 3 * 4);
+    for (std::size_t i = 0; i < bytes.size(); i += 3) {
+        std::uint32_t n = static_cast<std::uint32_t>(bytes[i]) << 16;
+        if (i + 1 < bytes.size()) n |= static_cast<std::uint32_t>(bytes[i + 1]) << 8;
+        if (i + 2 < bytes.size()) n |= bytes[i + 2];
+        out += alphabet[(n >> 18) & 63];
+        out += alphabet[(n >> 12) & 63];
+        out += i + 1 < bytes.size() ? alphabet[(n >> 6) & 63] : '=';
+        out += i + 2 < bytes.size() ? alphabet[n & 63] : '=';
+    }
+    return out;
+}
+
+std::string websocket_accept(std::string_view key) {
+    auto digest = sha1(std::string(key) + std::string(WEBSOCKET_GUID));
+    return base64_encode(digest);
+}
+
+} // namespace mcpplibs::llmapi
+
+export namespace mcpplibs::llmapi {
+
+struct WebSocketConfig {
+    int connectTimeoutMs { 10000 };
+    int readTimeoutMs { 60000 };
+    bool verifySsl { true };
+    std::size_t maxMessageBytes { 16 * 1024 * 1024 };
+};
+
+struct WebSocketStats {
+    std::uint64_t messagesSent { 0 };
+    std::uint64_t messagesReceived { 0 };
+    std::uint64_t bytesSent { 0 };       // on the wire, frame headers included
+    std::uint64_t bytesReceived { 0 };
+};
+
+// Minimal RFC 6455 client over tinyhttps sockets (ws:// and wss://), for
+// long-lived sessions that exchange many small text messages. Pings are
+// answered while receiving; fragmented messages are reassembled. Reads wait
+// in slices while a Cancellation is current (see CancelScope), and a
+// cancelled read drops the connection. Not thread-safe.
+class WebSocket {
+private:
+    enum Opcode : std::uint8_t { Continuation = 0x0, Text = 0x1, Binary = 0x2, Close = 0x8, Ping = 0x9, Pong = 0xA };
+
+    WebSocketConfig config_;
+    std::variant<std::monostate, tinyhttps::Socket, tinyhttps::TlsSocket> socket_;
+    std::string buffer_;   // received but not yet parsed
+    bool open_ { false };
+    std::chrono::milliseconds readTimeout_ { 0 };   // per read, for the current receive
+    TimeoutPhase readPhase_ { TimeoutPhase::FirstByte };
+    WebSocketStats stats_;
+
+public:
+    explicit WebSocket(WebSocketConfig config = {}) : config_(std::move(config)) {}
+
+    ~WebSocket() {
+        try {
+            close();
+        } catch (...) {}
+    }
+
+    WebSocket(const WebSocket&) = delete;
+    WebSocket& operator=(const WebSocket&) = delete;
+    WebSocket(WebSocket&&) = default;
+    WebSocket& operator=(WebSocket&&) = default;
+
+    // Opens the connection and performs the upgrade handshake. A server
+    // that refuses the upgrade gets its response (with body) returned and
+    // the socket stays closed; transport failures throw.
+    tinyhttps::HttpResponse connect(std::string_view url, const std::map<std::string, std::string>& headers = {}) {
+        close();
+        bool tls = url.starts_with("wss://");
+        if (!tls && !url.starts_with("ws://")) {
+            throw std::invalid_argument("not a ws:// or wss:// URL: " + std::string(url));
+        }
+        auto rest = url.substr(tls ? 6 : 5);
+        auto slash = rest.find_first_of("/?");
+        auto authority = rest.substr(0, slash);
+        std::string target = slash == std::string_view::npos ? "/" : std::string(rest.substr(slash));
+        if (target.starts_with('?')) target.insert(0, "/");
+        std::string host(authority);
+        int port = tls ? 443 : 80;
+        if (auto colon = authority.rfind(':'); colon != std::string_view::npos) {
+            host = authority.substr(0, colon);
+            port = std::stoi(std::string(authority.substr(colon + 1)));
+        }
+
+        current_cancellation().check(std::string(authority));
+        auto start = std::chrono::steady_clock::now();
+        bool connected = false;
+        if (tls) {
+            connected = socket_.emplace<tinyhttps::TlsSocket>().connect(host, port, config_.connectTimeoutMs, config_.verifySsl);
+        } else {
+            connected = socket_.emplace<tinyhttps::Socket>().connect(host, port, config_.connectTimeoutMs);
+        }
+        if (!connected) {
+            socket_.emplace<std::monostate>();
+            std::chrono::milliseconds limit { config_.connectTimeoutMs };
+            if (std::chrono::steady_clock::now() - start >= limit) {
+                throw TimeoutError(TimeoutPhase::Connect, limit, std::string(authority));
+            }
+            throw std::runtime_error("websocket connect to " + std::string(authority) + " failed");
+        }
+
+        std::array<std::uint8_t, 16> nonce;
+        std::random_device random;
+        for (auto& byte : nonce) byte = static_cast<std::uint8_t>(random());
+        auto key = base64_encode(nonce);
+
+        std::string request = "GET " + target + " HTTP/1.1\r\nHost: " + std::string(authority) +
+                              "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " + key +
+                              "\r\nSec-WebSocket-Version: 13\r\n";
+        for (const auto& [name, value] : headers) {
+            request += name + ": " + value + "\r\n";
+        }
+        request += "\r\n";
+        write_(request);
+
+        readTimeout_ = std::chrono::milliseconds { config_.readTimeoutMs };
+        readPhase_ = TimeoutPhase::FirstByte;
+        auto response = read_handshake_();
+        if (response.statusCode != 101) {
+            socket_.emplace<std::monostate>();
+            buffer_.clear();
+            return response;
+        }
+        auto accept = find_header(response.headers, "Sec-WebSocket-Accept");
+        if (!accept || *accept != websocket_accept(key)) {
+            socket_.emplace<std::monostate>();
+            throw std::runtime_error("websocket handshake failed: bad Sec-WebSocket-Accept");
+        }
+        open_ = true;
+        return response;
+    }
+
+    void send_text(std::string_view text) {
+        if (!open_) {
+            throw std::logic_error("WebSocket is not open");
+        }
+        send_frame_(Text, text);
+        stats_.messagesSent++;
+    }
+
+    // Next text (or binary) message. Returns nullopt once the peer has
+    // closed the connection. Throws TimeoutError tagged with `phase` when a
+    // read waits longer than `timeout` (readTimeoutMs by default).
+    std::optional<std::string> receive() {
+        return receive(std::chrono::milliseconds { config_.readTimeoutMs }, TimeoutPhase::StreamIdle);
+    }
+
+    std::optional<std::string> receive(std::chrono::milliseconds timeout, TimeoutPhase phase) {
+        readTimeout_ = timeout;
+        readPhase_ = phase;
+        std::string message;
+        bool fragmented = false;
+        while (open_) {
+            auto [fin, opcode, payload] = read_frame_();
+            switch (opcode) {
+                case Ping:
+                    send_frame_(Pong, payload);
+                    continue;
+                case Pong:
+                    continue;
+                case Close:
+                    if (open_) {
+                        send_frame_(Close, std::string_view(payload).substr(0, std::min<std::size_t>(payload.size(), 2)));
+                    }
+                    shutdown_();
+                    return std::nullopt;
+                case Continuation:
+                    if (!fragmented) throw std::runtime_error("websocket protocol error: unexpected continuation");
+                    break;
+                default:
+                    if (fragmented) throw std::runtime_error("websocket protocol error: interleaved message");
+                    break;
+            }
+            message += payload;
+            if (message.size() > config_.maxMessageBytes) {
+                shutdown_();
+                throw std::runtime_error("websocket message exceeds " + std::to_string(config_.maxMessageBytes) + " bytes");
+            }
+            if (fin) {
+                stats_.messagesReceived++;
+                return message;
+            }
+            fragmented = true;
+        }
+        return std::nullopt;
+    }
+
+    void close(std::uint16_t code = 1000) {
+        if (open_) {
+            std::string reason { static_cast<char>(code >> 8), static_cast<char>(code & 0xFF) };
+            try {
+                send_frame_(Close, reason);
+            } catch (...) {}
+        }
+        shutdown_();
+    }
+
+    bool is_open() const { return open_; }
+    const WebSocketStats& stats() const { return stats_; }
+    const WebSocketConfig& config() const { return config_; }
+
+private:
+    void shutdown_() {
+        open_ = false;
+        socket_.emplace<std::monostate>();
+        buffer_.clear();
+    }
+
+    void write_(std::string_view data) {
+        while (!data.empty()) {
+            int n = std::visit([&](auto& socket) -> int {
+                if constexpr (std::is_same_v<std::decay_t<decltype(socket)>, std::monostate>) {
+                    return -1;
+                } else {
+                    return socket.write(data.data(), static_cast<int>(std::min<std::size_t>(data.size(), 1 << 30)));
+                }
+            }, socket_);
+            if (n <= 0) {
+                shutdown_();
+                throw std::runtime_error("websocket write failed");
+            }
+            stats_.bytesSent += static_cast<std::uint64_t>(n);
+            data.remove_prefix(static_cast<std::size_t>(n));
+        }
+    }
+
+    // Waits up to readTimeout_ for the socket; a cancellable call waits in
+    // slices of CANCEL_POLL, since a stop request cannot interrupt a blocked
+    // wait on a tinyhttps socket
+    void await_readable_() {
+        const auto& cancel = current_cancellation();
+        auto until = std::chrono::steady_clock::now() + readTimeout_;
+        for (;;) {
+            if (cancel.active() && (cancel.stop_requested() || cancel.expired())) {
+                shutdown_();
+                cancel.check("websocket");
+            }
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(until - std::chrono::steady_clock::now());
+            if (left.count() <= 0) {
+                shutdown_();
+                throw TimeoutError(readPhase_, readTimeout_, "websocket");
+            }
+            if (cancel.active()) {
+                left = std::min({ left, CANCEL_POLL, std::max(cancel.remaining(), std::chrono::milliseconds { 1 }) });
+            }
+            auto waitMs = static_cast<int>(std::min<std::int64_t>(left.count(), std::numeric_limits<int>::max()));
+            bool ready = std::visit([&](auto& socket) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(socket)>, std::monostate>) {
+                    return true;   // the read reports the closed connection
+                } else {
+                    return socket.wait_readable(waitMs);
+                }
+            }, socket_);
+            if (ready) return;
+        }
+    }
+
+    void fill_() {
+        await_readable_();
+        char chunk[16384];
+        int n = std::visit([&](auto& socket) -> int {
+            if constexpr (std::is_same_v<std::decay_t<decltype(socket)>, std::monostate>) {
+                return -1;
+            } else {
+                return socket.read(chunk, static_cast<int>(sizeof(chunk)));
+            }
+        }, socket_);
+        if (n <= 0) {
+            shutdown_();
+            throw std::runtime_error("websocket connection closed");
+        }
+        stats_.bytesReceived += static_cast<std::uint64_t>(n);
+        buffer_.append(chunk, static_cast<std::size_t>(n));
+    }
+
+    tinyhttps::HttpResponse read_handshake_() {
+        std::size_t end;
+        while ((end = buffer_.find("\r\n\r\n")) == std::string::npos) fill_();
+        tinyhttps::HttpResponse response;
+        std::string_view head { buffer_.data(), end };
+        auto lineEnd = head.find("\r\n");
+        auto statusLine = head.substr(0, lineEnd);
+        auto sp1 = statusLine.find(' ');
+        if (!statusLine.starts_with("HTTP/") || sp1 == std::string_view::npos) {
+            throw std::runtime_error("websocket handshake failed: malformed status line");
+        }
+        auto sp2 = statusLine.find(' ', sp1 + 1);
+        response.statusCode = std::stoi(std::string(statusLine.substr(sp1 + 1, 3)));
+        response.statusText = sp2 == std::string_view::npos ? std::string {} : std::string(statusLine.substr(sp2 + 1));
+        auto pos = lineEnd == std::string_view::npos ? head.size() : lineEnd + 2;
+        while (pos < head.size()) {
+            auto next = head.find("\r\n", pos);
+            if (next == std::string_view::npos) next = head.size();
+            auto line = head.substr(pos, next - pos);
+            if (auto colon = line.find(':'); colon != std::string_view::npos) {
+                auto value = line.substr(colon + 1);
+                while (value.starts_with(' ')) value.remove_prefix(1);
+                response.headers[std::string(line.substr(0, colon))] = std::string(value);
+            }
+            pos = next + 2;
+        }
+        buffer_.erase(0, end + 4);
+
+        // A refused upgrade carries an ordinary body (the API error)
+        if (response.statusCode != 101) {
+            if (auto length = find_header(response.headers, "Content-Length")) {
+                auto size = static_cast<std::size_t>(std::stoull(*length));
+                try {
+                    while (buffer_.size() < size) fill_();
+                } catch (const std::runtime_error&) {}
+                response.body = buffer_.substr(0, size);
+            }
+        }
+        return response;
+    }
+
+    // Client frames are always masked (RFC 6455 5.3) with a fresh,
+    // unpredictable key per frame
+    void send_frame_(Opcode opcode, std::string_view payload) {
+        std::string frame;
+        frame.reserve(payload.size() + 14);
+        frame += static_cast<char>(0x80 | opcode);
+        if (payload.size() < 126) {
+            frame += static_cast<char>(0x80 | payload.size());
+        } else if (payload.size() <= 0xFFFF) {
+            frame += static_cast<char>(0x80 | 126);
+            frame += static_cast<char>(payload.size() >> 8);
+            frame += static_cast<char>(payload.size() & 0xFF);
+        } else {
+            frame += static_cast<char>(0x80 | 127);
+            for (int i = 7; i >= 0; --i) {
+                frame += static_cast<char>((static_cast<std::uint64_t>(payload.size()) >> (i * 8)) & 0xFF);
+            }
+        }
+        std::array<char, 4> mask;
+        auto key = std::random_device {}();
+        for (std::size_t i = 0; i < mask.size(); ++i) mask[i] = static_cast<char>(key >> (i * 8));
+        frame.append(mask.data(), mask.size());
+        auto start = frame.size();
+        frame.append(payload);
+        for (std::size_t i = 0; i < payload.size(); ++i) {
+            frame[start + i] ^= mask[i % 4];
+        }
+        write_(frame);
+    }
+
+    struct Frame {
+        bool fin;
+        std::uint8_t opcode;
+        std::string payload;
+    };
+
+    Frame read_frame_() {
+        while (buffer_.size() < 2) fill_();
+        auto b0 = static_cast<std::uint8_t>(buffer_[0]);
+        auto b1 = static_cast<std::uint8_t>(buffer_[1]);
+        bool masked = b1 & 0x80;
+        std::uint64_t length = b1 & 0x7F;
+        std::size_t headerSize = 2;
+        if (length == 126) headerSize += 2;
+        if (length == 127) headerSize += 8;
+        if (masked) headerSize += 4;
+        while (buffer_.size() < headerSize) fill_();
+        if (length >= 126) {
+            auto bytes = length == 126 ? 2 : 8;
+            length = 0;
+            for (int i = 0; i < bytes; ++i) {
+                length = length << 8 | static_cast<std::uint8_t>(buffer_[2 + i]);
+            }
+        }
+        if (length > config_.maxMessageBytes) {
+            shutdown_();
+            throw std::runtime_error("websocket frame exceeds " + std::to_string(config_.maxMessageBytes) + " bytes");
+        }
+        while (buffer_.size() < headerSize + length) fill_();
+        Frame frame { .fin = (b0 & 0x80) != 0, .opcode = static_cast<std::uint8_t>(b0 & 0x0F),
+                      .payload = buffer_.substr(headerSize, static_cast<std::size_t>(length)) };
+        if (masked) {
+            for (std::size_t i = 0; i < frame.payload.size(); ++i) {
+                frame.payload[i] ^= buffer_[headerSize - 4 + i % 4];
+            }
+        }
+        buffer_.erase(0, headerSize + static_cast<std::size_t>(length));
+        return frame;
+    }
+};
+
+} // namespace mcpplibs::llmapi
@@ -0,0 +1,290 @@
+#pragma once
+
+// Local stand-in for provider HTTP APIs: a blocking HTTP/1.1 server on
+// 127.0.0.1 with an ephemeral port (or a Unix domain socket), serving one
+// connection at a time.
+// Include before any `import` so the platform socket headers come first.
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mock {
+
+#if defined(_WIN32)
+using socket_t = SOCKET;
+inline constexpr socket_t INVALID = INVALID_SOCKET;
+inline void close_socket(socket_t s) { closesocket(s); }
+#else
+using socket_t = int;
+inline constexpr socket_t INVALID = -1;
+inline void close_socket(socket_t s) { ::close(s); }
+#endif
+
+struct Request {
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> headers;   // lower-case names
+    std::string body;
+    int bodyChunks { 0 };   // chunks of a Transfer-Encoding: chunked body
+
+    std::string header(const std::string& name) const {
+        auto it = headers.find(name);
+        return it == headers.end() ? std::string {} : it->second;
+    }
+};
+
+struct Response {
+    int status { 200 };
+    std::map<std::string, std::string> headers { { "Content-Type", "application/json" } };
+    std::string body;
+    std::vector<std::string> chunks;   // non-empty: sent with chunked encoding, one write each
+    int chunkDelayMs { 0 };            // pause before every chunk after the first
+    bool dropAfter { false };          // close after answering, though keep-alive was announced
+};
+
+class Server {
+public:
+    using Handler = std::function<Response(const Request&)>;
+
+    explicit Server(Handler handler) : handler_(std::move(handler)) {
+#if defined(_WIN32)
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+        listener_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        int yes = 1;
+        ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (::bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listener_, 16) != 0) {
+            std::abort();
+        }
+        socklen_t len = sizeof(addr);
+        ::getsockname(listener_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { serve_(); });
+    }
+
+#if !defined(_WIN32)
+    // Listens on a Unix domain socket at `socketPath` instead of TCP
+    Server(Handler handler, std::string socketPath)
+        : handler_(std::move(handler)), socketPath_(std::move(socketPath)) {
+        ::unlink(socketPath_.c_str());
+        listener_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+        std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socketPath_.c_str());
+        if (::bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listener_, 16) != 0) {
+            std::abort();
+        }
+        thread_ = std::thread([this] { serve_(); });
+    }
+#endif
+
+    ~Server() {
+        stop_ = true;
+        thread_.join();
+        close_socket(listener_);
+#if defined(_WIN32)
+        WSACleanup();
+#else
+        if (!socketPath_.empty()) ::unlink(socketPath_.c_str());
+#endif
+    }
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    int port() const { return port_; }
+    std::string url(const std::string& path = "") const {
+        if (!socketPath_.empty()) return "unix://" + socketPath_ + path;
+        return "http://127.0.0.1:" + std::to_string(port_) + path;
+    }
+
+    // Connections accepted so far
+    int connections() const { return connections_; }
+
+    std::vector<Request> requests() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_;
+    }
+
+private:
+    Handler handler_;
+    socket_t listener_ { INVALID };
+    int port_ { 0 };
+    std::string socketPath_;
+    std::atomic<int> connections_ { 0 };
+    std::atomic<bool> stop_ { false };
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::vector<Request> requests_;
+
+    bool readable_(socket_t s, int timeoutMs) const {
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(s, &set);
+        timeval tv { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+        return ::select(static_cast<int>(s + 1), &set, nullptr, nullptr, &tv) > 0;
+    }
+
+    void serve_() {
+        while (!stop_) {
+            if (!readable_(listener_, 20)) continue;
+            socket_t client = ::accept(listener_, nullptr, nullptr);
+            if (client == INVALID) continue;
+            connections_++;
+            handle_(client);
+            close_socket(client);
+        }
+    }
+
+    void send_all_(socket_t s, const std::string& data) const {
+#if defined(MSG_NOSIGNAL)
+        constexpr int flags = MSG_NOSIGNAL;   // a client that gave up must not SIGPIPE the test
+#else
+        constexpr int flags = 0;
+#endif
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            auto n = ::send(s, data.data() + sent, static_cast<int>(data.size() - sent), flags);
+            if (n <= 0) return;
+            sent += static_cast<std::size_t>(n);
+        }
+    }
+
+    // Serves requests on one connection until the client closes it
+    void handle_(socket_t client) {
+        std::string buffer;
+        char tmp[16384];
+        while (!stop_) {
+            auto headerEnd = buffer.find("\r\n\r\n");
+            while (headerEnd == std::string::npos) {
+                if (stop_ || !readable_(client, 20)) {
+                    if (stop_) return;
+                    continue;
+                }
+                auto n = ::recv(client, tmp, sizeof(tmp), 0);
+                if (n <= 0) return;
+                buffer.append(tmp, static_cast<std::size_t>(n));
+                headerEnd = buffer.find("\r\n\r\n");
+            }
+
+            Request request;
+            auto head = buffer.substr(0, headerEnd);
+            buffer.erase(0, headerEnd + 4);
+            auto lineEnd = head.find("\r\n");
+            auto requestLine = head.substr(0, lineEnd);
+            auto sp1 = requestLine.find(' ');
+            auto sp2 = requestLine.find(' ', sp1 + 1);
+            request.method = requestLine.substr(0, sp1);
+            request.path = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+            std::size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+            while (pos < head.size()) {
+                auto end = head.find("\r\n", pos);
+                if (end == std::string::npos) end = head.size();
+                auto line = head.substr(pos, end - pos);
+                auto colon = line.find(':');
+                if (colon != std::string::npos) {
+                    auto name = line.substr(0, colon);
+                    std::transform(name.begin(), name.end(), name.begin(),
+                                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                    auto value = line.substr(colon + 1);
+                    value.erase(0, value.find_first_not_of(' '));
+                    request.headers[name] = value;
+                }
+                pos = end + 2;
+            }
+
+            auto need = [&](std::size_t size) {
+                while (buffer.size() < size) {
+                    if (!readable_(client, 1000)) return false;
+                    auto n = ::recv(client, tmp, sizeof(tmp), 0);
+                    if (n <= 0) return false;
+                    buffer.append(tmp, static_cast<std::size_t>(n));
+                }
+                return true;
+            };
+            if (request.header("transfer-encoding") == "chunked") {
+                for (;;) {
+                    std::size_t lineEnd;
+                    while ((lineEnd = buffer.find("\r\n")) == std::string::npos) {
+                        if (!need(buffer.size() + 1)) return;
+                    }
+                    auto size = static_cast<std::size_t>(std::strtoull(buffer.c_str(), nullptr, 16));
+                    if (!need(lineEnd + 2 + size + 2)) return;
+                    request.body += buffer.substr(lineEnd + 2, size);
+                    buffer.erase(0, lineEnd + 2 + size + 2);
+                    if (size == 0) break;
+                    request.bodyChunks++;
+                }
+            } else {
+                auto length = static_cast<std::size_t>(std::atoll(request.header("content-length").c_str()));
+                if (!need(length)) return;
+                request.body = buffer.substr(0, length);
+                buffer.erase(0, length);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                requests_.push_back(request);
+            }
+            auto response = handler_(request);
+            bool close = request.header("connection") == "close";
+
+            std::string out = "HTTP/1.1 " + std::to_string(response.status) + " " +
+                              (response.status < 400 ? "OK" : "Error") + "\r\n";
+            for (const auto& [name, value] : response.headers) {
+                out += name + ": " + value + "\r\n";
+            }
+            out += close ? "Connection: close\r\n" : "Connection: keep-alive\r\n";
+            if (response.chunks.empty()) {
+                out += "Content-Length: " + std::to_string(response.body.size()) + "\r\n\r\n" + response.body;
+                send_all_(client, out);
+            } else {
+                out += "Transfer-Encoding: chunked\r\n\r\n";
+                send_all_(client, out);
+                for (std::size_t i = 0; i < response.chunks.size(); ++i) {
+                    const auto& chunk = response.chunks[i];
+                    if (i > 0 && response.chunkDelayMs > 0) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(response.chunkDelayMs));
+                    }
+                    char size[32];
+                    std::snprintf(size, sizeof(size), "%zx\r\n", chunk.size());
+                    send_all_(client, size + chunk + "\r\n");
+                }
+                send_all_(client, "0\r\n\r\n");
+            }
+            if (close || response.dropAfter) return;
+        }
+    }
+};
+
+} // namespace mock
@@ -0,0 +1,296 @@
+#pragma once
+
+// Local stand-in for WebSocket APIs: accepts one connection at a time on
+// 127.0.0.1, performs the upgrade and hands the connection to a session
+// function that scripts the server side. Include before any `import`.
+
+#include "mock_server.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace mock {
+
+namespace detail {
+
+inline std::string sha1_base64(const std::string& input) {
+    auto rotl = [](std::uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    std::uint32_t h[5] { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::string data = input;
+    std::uint64_t bits = static_cast<std::uint64_t>(input.size()) * 8;
+    data += static_cast<char>(0x80);
+    while (data.size() % 64 != 56) data += '\0';
+    for (int i = 7; i >= 0; --i) data += static_cast<char>((bits >> (i * 8)) & 0xFF);
+    for (std::size_t block = 0; block < data.size(); block += 64) {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = 0;
+            for (int j = 0; j < 4; ++j) w[i] = w[i] << 8 | static_cast<unsigned char>(data[block + i * 4 + j]);
+        }
+        for (int i = 16; i < 80; ++i) w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            std::uint32_t f = i < 20 ? (b & c) | (~b & d) : i < 40 ? b ^ c ^ d : i < 60 ? (b & c) | (b & d) | (c & d) : b ^ c ^ d;
+            std::uint32_t k = i < 20 ? 0x5A827999 : i < 40 ? 0x6ED9EBA1 : i < 60 ? 0x8F1BBCDC : 0xCA62C1D6;
+            std::uint32_t t = rotl(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rotl(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    unsigned char digest[20];
+    for (int i = 0; i < 20; ++i) digest[i] = static_cast<unsigned char>(h[i / 4] >> (24 - (i % 4) * 8));
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (int i = 0; i < 20; i += 3) {
+        std::uint32_t n = digest[i] << 16 | (i + 1 < 20 ? digest[i + 1] << 8 : 0) | (i + 2 < 20 ? digest[i + 2] : 0);
+        out += alphabet[(n >> 18) & 63];
+        out += alphabet[(n >> 12) & 63];
+        out += i + 1 < 20 ? alphabet[(n >> 6) & 63] : '=';
+        out += i + 2 < 20 ? alphabet[n & 63] : '=';
+    }
+    return out;
+}
+
+} // namespace detail
+
+// Server side of one upgraded connection
+class WebSocket {
+public:
+    Request request;   // the upgrade request
+    int pongs { 0 };
+
+    WebSocket(socket_t socket, std::string buffered, const std::atomic<bool>& stop)
+        : socket_(socket), buffer_(std::move(buffered)), stop_(stop) {}
+
+    // Next text message; nullopt once the client closed (or the server stops)
+    std::optional<std::string> receive() {
+        std::string message;
+        for (;;) {
+            if (!need_(2)) return std::nullopt;
+            auto b0 = static_cast<unsigned char>(buffer_[0]);
+            auto b1 = static_cast<unsigned char>(buffer_[1]);
+            std::uint64_t length = b1 & 0x7F;
+            std::size_t header = 2 + (length == 126 ? 2 : length == 127 ? 8 : 0) + ((b1 & 0x80) ? 4 : 0);
+            if (!need_(header)) return std::nullopt;
+            if (length >= 126) {
+                int bytes = length == 126 ? 2 : 8;
+                length = 0;
+                for (int i = 0; i < bytes; ++i) length = length << 8 | static_cast<unsigned char>(buffer_[2 + i]);
+            }
+            if (!need_(header + length)) return std::nullopt;
+            std::string payload = buffer_.substr(header, static_cast<std::size_t>(length));
+            if (b1 & 0x80) {
+                for (std::size_t i = 0; i < payload.size(); ++i) payload[i] ^= buffer_[header - 4 + i % 4];
+            } else {
+                unmasked = true;
+            }
+            buffer_.erase(0, header + static_cast<std::size_t>(length));
+            int opcode = b0 & 0x0F;
+            if (opcode == 0xA) { pongs++; continue; }
+            if (opcode == 0x8) { frame_(0x8, payload.substr(0, 2)); return std::nullopt; }
+            message += payload;
+            if (b0 & 0x80) return message;
+        }
+    }
+
+    void send(const std::string& text) { frame_(0x1, text); }
+
+    // One message split across `pieces` frames
+    void send_fragmented(const std::string& text, std::size_t pieces) {
+        std::size_t step = (text.size() + pieces - 1) / pieces;
+        for (std::size_t i = 0; i < text.size(); i += step) {
+            bool first = i == 0;
+            bool last = i + step >= text.size();
+            frame_(first ? 0x1 : 0x0, text.substr(i, step), last);
+        }
+    }
+
+    void ping(const std::string& payload) { frame_(0x9, payload); }
+
+    bool unmasked { false };   // a client frame arrived without a mask
+
+private:
+    socket_t socket_;
+    std::string buffer_;
+    const std::atomic<bool>& stop_;
+
+    bool need_(std::size_t size) {
+        char tmp[16384];
+        while (buffer_.size() < size) {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(socket_, &set);
+            timeval tv { 0, 20000 };
+            if (::select(static_cast<int>(socket_ + 1), &set, nullptr, nullptr, &tv) <= 0) {
+                if (stop_) return false;
+                continue;
+            }
+            auto n = ::recv(socket_, tmp, sizeof(tmp), 0);
+            if (n <= 0) return false;
+            buffer_.append(tmp, static_cast<std::size_t>(n));
+        }
+        return true;
+    }
+
+    void frame_(int opcode, const std::string& payload, bool fin = true) {
+        std::string out;
+        out += static_cast<char>((fin ? 0x80 : 0) | opcode);
+        if (payload.size() < 126) {
+            out += static_cast<char>(payload.size());
+        } else if (payload.size() <= 0xFFFF) {
+            out += static_cast<char>(126);
+            out += static_cast<char>(payload.size() >> 8);
+            out += static_cast<char>(payload.size() & 0xFF);
+        } else {
+            out += static_cast<char>(127);
+            for (int i = 7; i >= 0; --i) out += static_cast<char>((static_cast<std::uint64_t>(payload.size()) >> (i * 8)) & 0xFF);
+        }
+        out += payload;
+        std::size_t sent = 0;
+        while (sent < out.size()) {
+            auto n = ::send(socket_, out.data() + sent, static_cast<int>(out.size() - sent), 0);
+            if (n <= 0) return;
+            sent += static_cast<std::size_t>(n);
+        }
+    }
+};
+
+class WebSocketServer {
+public:
+    using Session = std::function<void(WebSocket&)>;
+
+    // Set to answer upgrade requests with this response instead of 101
+    std::optional<Response> refuse;
+
+    explicit WebSocketServer(Session session) : session_(std::move(session)) {
+#if defined(_WIN32)
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+        listener_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        int yes = 1;
+        ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (::bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listener_, 16) != 0) {
+            std::abort();
+        }
+        socklen_t len = sizeof(addr);
+        ::getsockname(listener_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { serve_(); });
+    }
+
+    ~WebSocketServer() {
+        stop_ = true;
+        thread_.join();
+        close_socket(listener_);
+#if defined(_WIN32)
+        WSACleanup();
+#endif
+    }
+
+    WebSocketServer(const WebSocketServer&) = delete;
+    WebSocketServer& operator=(const WebSocketServer&) = delete;
+
+    std::string url(const std::string& path = "") const {
+        return "ws://127.0.0.1:" + std::to_string(port_) + path;
+    }
+    std::string http_url(const std::string& path = "") const {
+        return "http://127.0.0.1:" + std::to_string(port_) + path;
+    }
+
+    // Upgrade requests accepted so far
+    int connections() const { return connections_; }
+
+private:
+    Session session_;
+    socket_t listener_ { INVALID };
+    int port_ { 0 };
+    std::atomic<int> connections_ { 0 };
+    std::atomic<bool> stop_ { false };
+    std::thread thread_;
+
+    void serve_() {
+        while (!stop_) {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(listener_, &set);
+            timeval tv { 0, 20000 };
+            if (::select(static_cast<int>(listener_ + 1), &set, nullptr, nullptr, &tv) <= 0) continue;
+            socket_t client = ::accept(listener_, nullptr, nullptr);
+            if (client == INVALID) continue;
+            handle_(client);
+            close_socket(client);
+        }
+    }
+
+    static void send_all_(socket_t s, const std::string& data) {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            auto n = ::send(s, data.data() + sent, static_cast<int>(data.size() - sent), 0);
+            if (n <= 0) return;
+            sent += static_cast<std::size_t>(n);
+        }
+    }
+
+    void handle_(socket_t client) {
+        std::string buffer;
+        char tmp[4096];
+        while (buffer.find("\r\n\r\n") == std::string::npos) {
+            auto n = ::recv(client, tmp, sizeof(tmp), 0);
+            if (n <= 0) return;
+            buffer.append(tmp, static_cast<std::size_t>(n));
+        }
+        auto end = buffer.find("\r\n\r\n");
+        auto head = buffer.substr(0, end);
+        buffer.erase(0, end + 4);
+
+        Request request;
+        auto lineEnd = head.find("\r\n");
+        auto requestLine = head.substr(0, lineEnd);
+        auto sp1 = requestLine.find(' ');
+        auto sp2 = requestLine.find(' ', sp1 + 1);
+        request.method = requestLine.substr(0, sp1);
+        request.path = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+        std::size_t pos = lineEnd + 2;
+        while (pos < head.size()) {
+            auto next = head.find("\r\n", pos);
+            if (next == std::string::npos) next = head.size();
+            auto line = head.substr(pos, next - pos);
+            auto colon = line.find(':');
+            if (colon != std::string::npos) {
+                auto name = line.substr(0, colon);
+                std::transform(name.begin(), name.end(), name.begin(),
+                               [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                auto value = line.substr(colon + 1);
+                value.erase(0, value.find_first_not_of(' '));
+                request.headers[name] = value;
+            }
+            pos = next + 2;
+        }
+
+        if (refuse) {
+            std::string out = "HTTP/1.1 " + std::to_string(refuse->status) + " Refused\r\n";
+            for (const auto& [name, value] : refuse->headers) out += name + ": " + value + "\r\n";
+            out += "Content-Length: " + std::to_string(refuse->body.size()) + "\r\nConnection: close\r\n\r\n";
+            send_all_(client, out + refuse->body);
+            return;
+        }
+
+        connections_++;
+        send_all_(client, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: " +
+                          detail::sha1_base64(request.header("sec-websocket-key") + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11") +
+                          "\r\n\r\n");
+        WebSocket socket(client, std::move(buffer), stop_);
+        socket.request = std::move(request);
+        session_(socket);
+    }
+};
+
+} // namespace mock
@@ -0,0 +1,158 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+// Reports a cache hit when the same conversation prefix was seen before by
+// the same backend, like a real per-backend prompt cache.
+struct CachingBackend {
+    struct Config {
+        std::string apiKey;
+    };
+    using ConfigType = Config;
+
+    std::string label;
+    std::set<std::string> cached;
+
+    explicit CachingBackend(std::string name) : label(std::move(name)) {}
+    explicit CachingBackend(Config config) : label(std::move(config.apiKey)) {}
+
+    std::string_view name() const { return "backend"; }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams&) {
+        auto prefix = std::get<std::string>(messages.front().content);
+        bool hit = cached.contains(prefix);
+        cached.insert(prefix);
+        return ChatResponse {
+            .content = { TextContent { label } },
+            .stopReason = StopReason::EndOfTurn,
+            .usage = Usage {
+                .inputTokens = hit ? 10 : 1000,
+                .outputTokens = 5,
+                .totalTokens = hit ? 15 : 1005,
+                .cacheCreationTokens = hit ? 0 : 990,
+                .cacheReadTokens = hit ? 990 : 0,
+            },
+        };
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& msgs, const ChatParams& p) {
+        co_return chat(msgs, p);
+    }
+};
+
+std::vector<Message> conversation(std::string_view system, int turns) {
+    std::vector<Message> messages { Message::system(system), Message::user("first question") };
+    for (int i = 0; i < turns; ++i) {
+        messages.push_back(Message::assistant("answer " + std::to_string(i)));
+        messages.push_back(Message::user("follow-up " + std::to_string(i)));
+    }
+    return messages;
+}
+
+int main() {
+    // Test 1: fingerprint covers system + tools + early messages only
+    {
+        ChatParams params {};
+        auto a = prefix_fingerprint(conversation("You are A", 0), params);
+        auto a2 = prefix_fingerprint(conversation("You are A", 5), params);
+        auto b = prefix_fingerprint(conversation("You are B", 0), params);
+        assert(a == a2);
+        assert(a != b);
+
+        ChatParams withTools { .tools = std::vector<ToolDef> { { .name = "search", .inputSchema = "{}" } } };
+        assert(prefix_fingerprint(conversation("You are A", 0), withTools) != a);
+
+        std::vector<Message> other { Message::system("You are A"), Message::user("different question") };
+        assert(prefix_fingerprint(other, params) != a);
+        assert(prefix_fingerprint(other, params, 0) == prefix_fingerprint(conversation("You are A", 0), params, 0));
+    }
+    println("Test 1: prefix fingerprint - PASSED");
+
+    // Test 2: router sticks each conversation to one endpoint
+    {
+        auto policy = RoutingPolicy { .affinity = AffinityPolicy { .enabled = true } };
+        RoutingProvider<CachingBackend> router(policy);
+        for (auto name : { "east", "west", "central" }) {
+            router.add(CachingBackend { std::string(name) }, name);
+        }
+
+        std::set<std::string> targets;
+        for (int conv = 0; conv < 12; ++conv) {
+            std::set<std::string> used;
+            auto system = "system prompt " + std::to_string(conv);
+            for (int turn = 0; turn < 5; ++turn) {
+                used.insert(router.chat(conversation(system, turn), ChatParams {}).text());
+            }
+            assert(used.size() == 1);
+            targets.insert(*used.begin());
+        }
+        assert(targets.size() > 1);   // different prefixes still spread out
+
+        std::uint64_t hits { 0 };
+        std::uint64_t requests { 0 };
+        for (const auto& endpoint : router.endpoints()) {
+            hits += endpoint.cache.cacheHits;
+            requests += endpoint.cache.requests;
+            assert(endpoint.cache.cacheReadTokens == endpoint.cache.cacheHits * 990);
+        }
+        assert(requests == 60);
+        assert(hits == 48);   // every turn after the first reads the cache
+    }
+    println("Test 2: sticky routing - PASSED");
+
+    // Test 3: multi-key provider sticks to one key until it runs out of headroom
+    {
+        auto policy = MultiKeyPolicy { .affinity = AffinityPolicy { .enabled = true, .minHeadroom = 0.5 } };
+        MultiKeyProvider<CachingBackend> provider(
+            CachingBackend::Config {},
+            { ApiKey { .key = "key-1", .requestsPerMinute = 8 }, ApiKey { .key = "key-2", .requestsPerMinute = 8 },
+              ApiKey { .key = "key-3", .requestsPerMinute = 8 } },
+            policy);
+
+        std::set<std::string> used;
+        for (int turn = 0; turn < 4; ++turn) {
+            used.insert(provider.chat(conversation("shared prefix", turn), ChatParams {}).text());
+        }
+        assert(used.size() == 1);
+
+        // Headroom drops below 0.5 after four requests: traffic moves on
+        for (int turn = 4; turn < 8; ++turn) {
+            used.insert(provider.chat(conversation("shared prefix", turn), ChatParams {}).text());
+        }
+        assert(used.size() > 1);
+
+        auto keys = provider.keys();
+        std::uint64_t hits { 0 };
+        for (const auto& key : keys) hits += key.cache.cacheHits;
+        assert(hits >= 3);
+        assert(std::ranges::any_of(keys, [](const KeyStatus& k) { return k.cache.hit_rate() >= 0.75; }));
+    }
+    println("Test 3: sticky keys with saturation fallback - PASSED");
+
+    // Test 4: placement depends only on prefix and endpoint labels, so separate
+    // router instances (e.g. in different processes) agree
+    {
+        auto policy = RoutingPolicy { .affinity = AffinityPolicy { .enabled = true } };
+        auto build = [&] {
+            RoutingProvider<CachingBackend> router(policy);
+            for (auto name : { "east", "west", "central" }) {
+                router.add(CachingBackend { std::string(name) }, name);
+            }
+            return router;
+        };
+        auto first = build();
+        auto second = build();
+        for (int conv = 0; conv < 6; ++conv) {
+            auto messages = conversation("prompt " + std::to_string(conv), 0);
+            assert(first.chat(messages, ChatParams {}).text() == second.chat(messages, ChatParams {}).text());
+        }
+    }
+    println("Test 4: placement stable across instances - PASSED");
+
+    println("test_affinity: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,202 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+// Stand-in for /messages/batches: a batch ends on its second poll and
+// answers every request by echoing the last user message.
+struct BatchApi {
+    std::mutex mutex;
+    std::string base;   // server URL, for results_url
+    std::map<std::string, std::pair<Json, int>> batches;   // id -> requests, polls
+    std::vector<std::size_t> sizes;
+    std::vector<int> createChunks;   // per create request; 0 = sent with Content-Length
+    int endAfter { 2 };              // polls until a batch ends
+
+    static std::string results(const Json& requests) {
+        std::string out;
+        for (const auto& entry : requests) {
+            std::string id = entry["custom_id"];
+            Json result;
+            if (id.ends_with("-fail")) {
+                result = Json{
+                    {"type", "errored"},
+                    {"error", Json{{"type", "error"}, {"error", Json{{"type", "invalid_request_error"}, {"message", "bad " + id}}}}},
+                };
+            } else if (id.ends_with("-expire")) {
+                result = Json{{"type", "expired"}};
+            } else {
+                std::string text = entry["params"]["messages"].back()["content"][0]["text"];
+                result = Json{
+                    {"type", "succeeded"},
+                    {"message", Json{
+                        {"id", "msg_" + id},
+                        {"type", "message"},
+                        {"role", "assistant"},
+                        {"model", entry["params"]["model"]},
+                        {"content", Json::array({Json{{"type", "text"}, {"text", "echo " + text}}})},
+                        {"stop_reason", "end_turn"},
+                        {"usage", Json{{"input_tokens", 7}, {"output_tokens", 2}}},
+                    }},
+                };
+            }
+            out += Json{{"custom_id", id}, {"result", result}}.dump() + "\n";
+        }
+        return out;
+    }
+
+    mock::Response handle(const mock::Request& request) {
+        std::lock_guard lock { mutex };
+        if (request.method == "POST" && request.path == "/v1/messages/batches") {
+            auto body = Json::parse(request.body);
+            auto id = "msgbatch_" + std::to_string(batches.size());
+            sizes.push_back(body["requests"].size());
+            createChunks.push_back(request.bodyChunks);
+            batches[id] = { body["requests"], 0 };
+            return mock::Response { .body = Json{{"id", id}, {"processing_status", "in_progress"}}.dump() };
+        }
+        if (request.method == "GET" && request.path.ends_with("/results")) {
+            auto id = request.path.substr(21, request.path.size() - 21 - 8);
+            // Served in pieces, so results are written as they arrive
+            auto text = results(batches[id].first);
+            mock::Response response;
+            for (std::size_t pos = 0; pos < text.size(); pos += 4096) {
+                response.chunks.push_back(text.substr(pos, 4096));
+            }
+            return response;
+        }
+        if (request.method == "GET" && request.path.starts_with("/v1/messages/batches/")) {
+            auto id = request.path.substr(21);
+            auto& [requests, polls] = batches[id];
+            if (++polls < endAfter) {
+                return mock::Response { .body = Json{{"id", id}, {"processing_status", "in_progress"}}.dump() };
+            }
+            return mock::Response { .body = Json{
+                {"id", id},
+                {"processing_status", "ended"},
+                {"request_counts", Json{{"processing", 0}, {"succeeded", requests.size()}, {"errored", 0}}},
+                {"results_url", base + "/v1/messages/batches/" + id + "/results"},
+            }.dump() };
+        }
+        if (request.method == "POST" && request.path.ends_with("/cancel")) {
+            auto id = request.path.substr(21, request.path.size() - 21 - 7);
+            return mock::Response { .body = Json{{"id", id}, {"processing_status", "canceling"}}.dump() };
+        }
+        return mock::Response { .status = 404, .body = "{}" };
+    }
+};
+
+anthropic::BatchPolicy fast_policy() {
+    return anthropic::BatchPolicy {
+        .pollInterval = std::chrono::milliseconds(1),
+        .maxPollInterval = std::chrono::milliseconds(5),
+        .read = JsonlReadOptions { .threads = 4, .chunkBytes = 4096 },
+    };
+}
+
+int main() {
+    // Test 1: entries are split by count and size, results map back by id
+    {
+        BatchApi api;
+        mock::Server server([&](const mock::Request& r) { return api.handle(r); });
+        api.base = server.url();
+        auto policy = fast_policy();
+        policy.maxRequests = 400;
+        policy.maxBytes = 100'000;
+
+        anthropic::BatchJob job({ .apiKey = "sk-ant", .baseUrl = server.url("/v1"), .model = "claude" }, policy);
+        for (int i = 0; i < 1000; ++i) {
+            auto id = "eval-" + std::to_string(i) + (i % 250 == 3 ? "-fail" : i == 999 ? "-expire" : "");
+            job.add(id, { Message::system("grade it"), Message::user("answer " + std::to_string(i)) },
+                    ChatParams { .maxTokens = 32 });
+        }
+        assert(job.size() == 1000);
+        auto shards = job.entry_files().size();
+        assert(shards >= 3);
+
+        auto submitted = job.submit();
+        assert(submitted.size() == shards);
+        std::size_t total { 0 };
+        for (auto size : api.sizes) {
+            assert(size <= 400);
+            total += size;
+        }
+        assert(total == 1000);
+        // Entry files are streamed from disk, not buffered into one body
+        assert(std::ranges::all_of(api.createChunks, [](int chunks) { return chunks > 0; }));
+
+        auto ended = job.wait();
+        assert(std::ranges::all_of(ended, &anthropic::BatchInfo::done));
+        assert(!ended[0].resultsUrl.empty());
+
+        auto results = job.results();
+        assert(results.size() == 1000);
+        assert(results["eval-10"].ok());
+        assert(results["eval-10"].type == "succeeded");
+        assert(results["eval-10"].response->text() == "echo answer 10");
+        assert(results["eval-10"].response->usage.inputTokens == 7);
+        assert(!results["eval-253-fail"].ok());
+        assert(results["eval-253-fail"].error == "bad eval-253-fail");
+        assert(results["eval-999-expire"].type == "expired");
+        assert(!results["eval-999-expire"].ok());
+    }
+    println("Test 1: message batches - PASSED");
+
+    // Test 2: entries carry the same params chat() would send
+    {
+        BatchApi api;
+        mock::Server server([&](const mock::Request& r) { return api.handle(r); });
+        api.base = server.url();
+        anthropic::Config config { .apiKey = "sk-ant", .baseUrl = server.url("/v1"), .model = "claude" };
+        anthropic::BatchJob job(config, fast_policy());
+        std::vector<Message> messages { Message::system("sys"), Message::user("hi") };
+        ChatParams params { .temperature = 0.5 };
+        job.add("one", messages, params);
+        job.submit();
+
+        auto entry = api.batches["msgbatch_0"].first[0];
+        assert(entry["custom_id"] == "one");
+        assert(entry["params"] == Json::parse(anthropic::Anthropic(config).payload(messages, params)));
+        assert(!entry["params"].contains("stream"));
+
+        job.cancel();
+        assert(job.batches()[0].status == "canceling");
+    }
+    println("Test 2: entry payloads and cancel - PASSED");
+
+    // Test 3: wait() gives up at waitTimeout; the job can still be cancelled
+    {
+        BatchApi api;
+        api.endAfter = 1'000'000;
+        mock::Server server([&](const mock::Request& r) { return api.handle(r); });
+        api.base = server.url();
+        auto policy = fast_policy();
+        policy.waitTimeout = std::chrono::milliseconds(100);
+        anthropic::BatchJob job({ .apiKey = "sk-ant", .baseUrl = server.url("/v1"), .model = "claude" }, policy);
+        job.add("slow", { Message::user("hi") });
+        job.submit();
+
+        bool timedOut = false;
+        try {
+            job.wait();
+        } catch (const TimeoutError& e) {
+            timedOut = e.phase == TimeoutPhase::Total;
+        }
+        assert(timedOut);
+        assert(!job.batches()[0].done());
+        assert(api.batches["msgbatch_0"].second >= 2);   // kept polling until the deadline
+        job.cancel();
+        assert(job.batches()[0].status == "canceling");
+    }
+    println("Test 3: wait timeout - PASSED");
+
+    println("test_anthropic_batch: ALL PASSED");
+    return 0;
+}
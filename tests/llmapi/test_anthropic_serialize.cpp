@@ -1,10 +1,40 @@
 import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
 import std;
 
 #include <cassert>
 #include "../test_print.hpp"
 
 using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+// Payload locations that carry cache_control, e.g. "tools", "system", "messages[3]"
+static std::vector<std::string> breakpoints(const Json& payload) {
+    std::vector<std::string> result;
+    if (payload.contains("tools") && payload["tools"].back().contains("cache_control")) {
+        result.push_back("tools");
+    }
+    if (payload.contains("system") && payload["system"].back().contains("cache_control")) {
+        result.push_back("system");
+    }
+    for (std::size_t i = 0; i < payload["messages"].size(); ++i) {
+        const auto& content = payload["messages"][i]["content"];
+        if (content.is_array() && !content.empty() && content.back().contains("cache_control")) {
+            result.push_back("messages[" + std::to_string(i) + "]");
+        }
+    }
+    return result;
+}
+
+static std::vector<Message> long_conversation() {
+    std::vector<Message> messages { Message::system("You are terse.") };
+    for (int i = 0; i < 4; ++i) {
+        messages.push_back(Message::user("question " + std::to_string(i)));
+        messages.push_back(Message::assistant("answer " + std::to_string(i)));
+    }
+    messages.push_back(Message::user("last question"));
+    return messages;
+}
 
 int main() {
     anthropic::Anthropic provider(anthropic::Config {
@@ -27,6 +57,81 @@ int main() {
     });
     assert(client.provider().name() == "anthropic");
 
+    // Test 4: rolling breakpoints on the last two user turns plus system and tools
+    ChatParams withTools {
+        .tools = std::vector<ToolDef> {
+            { .name = "a", .inputSchema = R"({"type":"object"})" },
+            { .name = "b", .inputSchema = R"({"type":"object"})" },
+        },
+    };
+    {
+        auto payload = Json::parse(provider.payload(long_conversation(), withTools));
+        auto marks = breakpoints(payload);
+        assert((marks == std::vector<std::string> { "tools", "system", "messages[6]", "messages[8]" }));
+        assert(!payload["tools"][0].contains("cache_control"));
+        assert(payload["messages"][8]["content"][0]["text"] == "last question");
+        assert(!payload["messages"][8]["content"][0]["cache_control"].contains("ttl"));
+    }
+
+    // Test 5: explicit Message::cacheControl wins and the total stays at four
+    {
+        auto messages = long_conversation();
+        messages[1].cacheControl = CacheControl {};
+        messages[3].cacheControl = CacheControl {};
+        auto payload = Json::parse(provider.payload(messages, withTools));
+        auto marks = breakpoints(payload);
+        assert(marks.size() == anthropic::Anthropic::MAX_CACHE_BREAKPOINTS);
+        assert((marks == std::vector<std::string> { "system", "messages[0]", "messages[2]", "messages[8]" }));
+    }
+
+    // Test 6: fixed anchors, TTL, no system/tools marks
+    {
+        anthropic::Anthropic anchored(anthropic::Config {
+            .apiKey = "test-key",
+            .model = "claude-sonnet-4-20250514",
+            .cache = anthropic::CachePolicy {
+                .strategy = anthropic::CacheStrategy::FixedAnchors,
+                .ttl = "1h",
+                .anchors = { 2, 0, 99 },
+                .system = false,
+                .tools = false,
+            },
+        });
+        auto payload = Json::parse(anchored.payload(long_conversation(), withTools));
+        assert((breakpoints(payload) == std::vector<std::string> { "messages[1]" }));
+        assert(payload["messages"][1]["content"][0]["cache_control"]["ttl"] == "1h");
+    }
+
+    // Test 7: a 1h entry may not follow a shorter-lived one
+    {
+        anthropic::Anthropic hourly(anthropic::Config {
+            .apiKey = "test-key",
+            .model = "claude-sonnet-4-20250514",
+            .cache = anthropic::CachePolicy { .ttl = "1h" },
+        });
+        auto messages = long_conversation();
+        messages[0].cacheControl = CacheControl { .ttl = "5m" };
+        auto payload = Json::parse(hourly.payload(messages, ChatParams {}));
+        assert(payload["system"][0]["cache_control"]["ttl"] == "5m");
+        assert(!payload["messages"][8]["content"][0]["cache_control"].contains("ttl"));
+    }
+
+    // Test 8: strategy None keeps only explicit marks
+    {
+        anthropic::Anthropic manual(anthropic::Config {
+            .apiKey = "test-key",
+            .model = "claude-sonnet-4-20250514",
+            .cache = anthropic::CachePolicy {
+                .strategy = anthropic::CacheStrategy::None, .system = false, .tools = false,
+            },
+        });
+        auto messages = long_conversation();
+        assert(breakpoints(Json::parse(manual.payload(messages, withTools))).empty());
+        messages[5].cacheControl = CacheControl {};
+        assert((breakpoints(Json::parse(manual.payload(messages, withTools))) ==
+                std::vector<std::string> { "messages[4]" }));
+    }
+
     println("test_anthropic_serialize: ALL PASSED");
     return 0;
 }
@@ -0,0 +1,268 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+// Stand-in for /files and /batches: a batch completes on its second poll
+// and answers every chat request by echoing the last user message.
+struct BatchApi {
+    std::mutex mutex;
+    std::map<std::string, std::string> files;
+    std::map<std::string, std::pair<std::string, int>> batches;   // id -> input file, polls
+    std::vector<std::string> purposes;
+    std::vector<int> uploadChunks;   // per upload; 0 = sent with Content-Length
+    int failPolls { 0 };   // answer this many polls with 503 first
+
+    static std::string file_part(const std::string& body) {
+        auto start = body.find("\r\n\r\n", body.find("filename=")) + 4;
+        return body.substr(start, body.rfind("\r\n--") - start);
+    }
+
+    static std::string outputs(const std::string& input, bool errors) {
+        std::string out;
+        std::istringstream lines(input);
+        std::string line;
+        while (std::getline(lines, line)) {
+            auto request = Json::parse(line);
+            std::string id = request["custom_id"];
+            bool fail = id.ends_with("-fail");
+            if (fail != errors) continue;
+            Json body;
+            if (fail) {
+                body = Json{{"error", Json{{"message", "bad request " + id}, {"type", "invalid_request_error"}}}};
+            } else if (request["url"] == "/v1/embeddings") {
+                body = Json{
+                    {"model", request["body"]["model"]},
+                    {"data", Json::array({Json{{"embedding", Json::array({0.5, 0.25})}}})},
+                    {"usage", Json{{"prompt_tokens", 3}, {"total_tokens", 3}}},
+                };
+            } else {
+                std::string text = request["body"]["messages"].back()["content"];
+                body = Json{
+                    {"id", "chatcmpl-" + id},
+                    {"model", request["body"]["model"]},
+                    {"choices", Json::array({Json{
+                        {"index", 0},
+                        {"message", Json{{"role", "assistant"}, {"content", "echo " + text}}},
+                        {"finish_reason", "stop"},
+                    }})},
+                    {"usage", Json{{"prompt_tokens", 5}, {"completion_tokens", 2}}},
+                };
+            }
+            out += Json{
+                {"id", "batch_req_" + id},
+                {"custom_id", id},
+                {"response", Json{{"status_code", fail ? 400 : 200}, {"body", body}}},
+                {"error", nullptr},
+            }.dump() + "\n";
+        }
+        return out;
+    }
+
+    mock::Response handle(const mock::Request& request) {
+        std::lock_guard lock { mutex };
+        if (request.method == "POST" && request.path == "/v1/files") {
+            auto id = "file-" + std::to_string(files.size());
+            files[id] = file_part(request.body);
+            auto purpose = request.body.find("name=\"purpose\"\r\n\r\nbatch") != std::string::npos ? "batch" : "?";
+            purposes.push_back(purpose);
+            uploadChunks.push_back(request.bodyChunks);
+            return mock::Response { .body = Json{{"id", id}, {"bytes", files[id].size()}}.dump() };
+        }
+        if (request.method == "POST" && request.path == "/v1/batches") {
+            auto body = Json::parse(request.body);
+            auto id = "batch_" + std::to_string(batches.size());
+            batches[id] = { body["input_file_id"], 0 };
+            return mock::Response { .body = Json{{"id", id}, {"status", "validating"}}.dump() };
+        }
+        if (request.method == "GET" && request.path.starts_with("/v1/batches/")) {
+            if (failPolls > 0) {
+                failPolls--;
+                return mock::Response { .status = 503, .body = R"({"error":{"message":"busy","type":"server_error"}})" };
+            }
+            auto id = request.path.substr(12);
+            auto& [input, polls] = batches[id];
+            if (++polls < 2) {
+                return mock::Response { .body = Json{{"id", id}, {"status", "in_progress"}}.dump() };
+            }
+            auto output = "file-out-" + id;
+            auto error = "file-err-" + id;
+            files[output] = outputs(files[input], false);
+            files[error] = outputs(files[input], true);
+            return mock::Response { .body = Json{
+                {"id", id},
+                {"status", "completed"},
+                {"input_file_id", input},
+                {"output_file_id", output},
+                {"error_file_id", error},
+                {"request_counts", Json{{"total", 1}, {"completed", 1}, {"failed", 0}}},
+            }.dump() };
+        }
+        if (request.method == "GET" && request.path.starts_with("/v1/files/")) {
+            // Served in pieces, so downloads are written as they arrive
+            auto id = request.path.substr(10, request.path.size() - 10 - 8);   // strip "/content"
+            mock::Response response { .headers = { { "Content-Type", "application/jsonl" } } };
+            for (std::size_t pos = 0; pos < files[id].size(); pos += 4096) {
+                response.chunks.push_back(files[id].substr(pos, 4096));
+            }
+            if (response.chunks.empty()) response.body = files[id];
+            return response;
+        }
+        return mock::Response { .status = 404, .body = "{}" };
+    }
+};
+
+openai::Config config(const mock::Server& server) {
+    return openai::Config { .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4o-mini" };
+}
+
+openai::BatchPolicy fast_policy() {
+    return openai::BatchPolicy {
+        .pollInterval = std::chrono::milliseconds(1),
+        .maxPollInterval = std::chrono::milliseconds(5),
+        .read = JsonlReadOptions { .threads = 4, .chunkBytes = 4096 },
+    };
+}
+
+int main() {
+    // Test 1: parallel JSONL reading sees every line exactly once
+    {
+        auto path = std::filesystem::temp_directory_path() / "llmapi_test_jsonl.jsonl";
+        std::uint64_t expected { 0 };
+        {
+            JsonlWriter writer(path);
+            for (int i = 0; i < 5000; ++i) {
+                writer.write(Json{{"n", i}, {"pad", std::string(static_cast<std::size_t>(i % 300), 'x')}}.dump());
+                expected += static_cast<std::uint64_t>(i);
+            }
+            assert(writer.lines() == 5000);
+        }
+        for (std::size_t chunk : { std::size_t { 64 }, std::size_t { 1 << 20 } }) {
+            std::atomic<std::uint64_t> sum { 0 };
+            std::atomic<int> lines { 0 };
+            for_each_jsonl_line(path, [&](std::string_view line) {
+                sum += Json::parse(line)["n"].get<std::uint64_t>();
+                lines++;
+            }, JsonlReadOptions { .threads = 4, .chunkBytes = chunk });
+            assert(lines == 5000);
+            assert(sum == expected);
+        }
+
+        bool thrown = false;
+        try {
+            for_each_jsonl_line(path, [](std::string_view line) {
+                if (line.find("\"n\":4000") != std::string_view::npos) throw std::runtime_error("stop");
+            }, JsonlReadOptions { .threads = 2, .chunkBytes = 256 });
+        } catch (const std::runtime_error& e) {
+            thrown = std::string_view(e.what()) == "stop";
+        }
+        assert(thrown);
+        std::filesystem::remove(path);
+    }
+    println("Test 1: parallel JSONL reader - PASSED");
+
+    // Test 2: chat requests are split into batches and mapped back by id
+    {
+        BatchApi api;
+        mock::Server server([&](const mock::Request& r) { return api.handle(r); });
+        auto policy = fast_policy();
+        policy.maxRequests = 300;
+        std::vector<std::filesystem::path> inputs;
+        {
+            openai::BatchJob job(config(server), policy);
+            for (int i = 0; i < 1000; ++i) {
+                auto id = "req-" + std::to_string(i) + (i % 100 == 7 ? "-fail" : "");
+                job.add(id, { Message::system("be brief"), Message::user("question " + std::to_string(i)) },
+                        ChatParams { .maxTokens = 16 });
+            }
+            assert(job.size() == 1000);
+            assert(job.input_files().size() == 4);
+            inputs = job.input_files();
+
+            std::ifstream first(inputs[0]);
+            std::string line;
+            std::getline(first, line);
+            auto request = Json::parse(line);
+            assert(request["custom_id"] == "req-0");
+            assert(request["method"] == "POST");
+            assert(request["url"] == "/v1/chat/completions");
+            assert(request["body"]["max_completion_tokens"] == 16);
+            assert(request["body"]["messages"].size() == 2);
+
+            auto submitted = job.submit();
+            assert(submitted.size() == 4);
+            assert(api.purposes == std::vector<std::string>(4, "batch"));
+            // Shards are streamed from disk, not buffered into one body
+            assert(std::ranges::all_of(api.uploadChunks, [](int chunks) { return chunks > 0; }));
+            auto done = job.wait();
+            assert(std::ranges::all_of(done, [](const auto& b) { return b.status == "completed"; }));
+
+            auto results = job.results();
+            assert(results.size() == 1000);
+            assert(results["req-42"].ok());
+            assert(results["req-42"].statusCode == 200);
+            assert(results["req-42"].response->text() == "echo question 42");
+            assert(results["req-42"].response->usage.inputTokens == 5);
+            assert(!results["req-107-fail"].ok());
+            assert(results["req-107-fail"].statusCode == 400);
+            assert(results["req-107-fail"].error == "bad request req-107-fail");
+            assert(std::filesystem::exists(inputs[0]));
+        }
+        // Files are removed with the job
+        for (const auto& path : inputs) {
+            assert(!std::filesystem::exists(path));
+        }
+    }
+    println("Test 2: chat batch - PASSED");
+
+    // Test 3: embedding batches; endpoints cannot be mixed
+    {
+        BatchApi api;
+        mock::Server server([&](const mock::Request& r) { return api.handle(r); });
+        openai::BatchJob job(config(server), fast_policy());
+        job.add_embedding("doc-1", { "hello" }, "text-embedding-3-small");
+        job.add_embedding("doc-2", { "world" }, "text-embedding-3-small");
+        bool threw = false;
+        try {
+            job.add("chat-1", { Message::user("hi") });
+        } catch (const std::logic_error&) {
+            threw = true;
+        }
+        assert(threw);
+
+        job.submit();
+        job.wait();
+        std::atomic<int> count { 0 };
+        job.for_each_result([&](openai::BatchItemResult result) {
+            assert(result.ok());
+            assert(result.embedding->embeddings[0] == (std::vector<float> { 0.5f, 0.25f }));
+            count++;
+        });
+        assert(count == 2);
+    }
+    println("Test 3: embedding batch - PASSED");
+
+    // Test 4: transient polling failures do not abandon the job
+    {
+        BatchApi api;
+        api.failPolls = 3;
+        mock::Server server([&](const mock::Request& r) { return api.handle(r); });
+        openai::BatchJob job(config(server), fast_policy());
+        job.add("only", { Message::user("hi") });
+        job.submit();
+        auto done = job.wait();
+        assert(done.size() == 1 && done[0].done());
+        assert(job.results().at("only").response->text() == "echo hi");
+    }
+    println("Test 4: polling retries - PASSED");
+
+    println("test_batch: ALL PASSED");
+    return 0;
+}
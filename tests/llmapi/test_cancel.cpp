@@ -0,0 +1,177 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using namespace std::chrono_literals;
+
+const std::string CHAT_BODY = R"({"id":"c1","model":"gpt-4o","choices":[{"index":0,"message":{"role":"assistant","content":"done"},"finish_reason":"stop"}],"usage":{"prompt_tokens":1,"completion_tokens":1}})";
+
+std::string delta(const std::string& text) {
+    return R"(data: {"choices":[{"index":0,"delta":{"content":")" + text + "\"}}]}\n\n";
+}
+
+// How long the slow server takes to answer. Timing bounds below are half of
+// it: loose enough for a loaded CI runner, tight enough to tell an
+// interrupted call from one that waited for the server.
+constexpr auto SLOW = 2000ms;
+
+mock::Response slow_chat(const mock::Request&) {
+    std::this_thread::sleep_for(SLOW);
+    return mock::Response { .body = CHAT_BODY };
+}
+
+std::chrono::steady_clock::duration since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::steady_clock::now() - start;
+}
+
+template<typename F>
+std::optional<CancelledError> cancelled_by(F&& call) {
+    try {
+        call();
+    } catch (const CancelledError& e) {
+        return e;
+    }
+    return std::nullopt;
+}
+
+int main() {
+    // Test 1: the context itself
+    {
+        std::stop_source stop;
+        auto cancel = Cancellation::after(50ms, stop.get_token());
+        assert(cancel.active());
+        assert(!cancel.expired());
+        assert(cancel.remaining() <= 50ms);
+        assert(!Cancellation {}.active());
+
+        std::jthread stopper([&] { std::this_thread::sleep_for(20ms); stop.request_stop(); });
+        auto start = std::chrono::steady_clock::now();
+        assert(!Cancellation { stop.get_token() }.sleep_for(5s));
+        assert(std::chrono::steady_clock::now() - start < 1s);
+
+        auto error = cancelled_by([] { Cancellation::after(0ms).check("here"); });
+        assert(error && error->deadlineExceeded);
+        assert(!classify_failure(std::make_exception_ptr(*error)).retryable);
+    }
+    println("Test 1: cancellation context - PASSED");
+
+    // Test 2: a stop request ends a stream mid-way and drops the connection
+    {
+        mock::Server server([](const mock::Request&) {
+            std::vector<std::string> chunks;
+            for (int i = 0; i < 20; ++i) chunks.push_back(delta("x"));
+            chunks.push_back("data: [DONE]\n\n");
+            return mock::Response {
+                .headers = { { "Content-Type", "text/event-stream" } },
+                .chunks = chunks,
+                .chunkDelayMs = static_cast<int>(SLOW.count() / 20),
+            };
+        });
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+        std::stop_source stop;
+        int received = 0;
+        auto start = std::chrono::steady_clock::now();
+        auto error = cancelled_by([&] {
+            provider.chat_stream({ Message::user("hi") }, { .cancel = { stop.get_token() } }, [&](std::string_view) {
+                if (++received == 2) stop.request_stop();
+            });
+        });
+        // No chunk reaches the callback after the stop, and the call does not
+        // wait for the rest of the stream
+        assert(error && !error->deadlineExceeded);
+        assert(received == 2);
+        assert(since(start) < SLOW / 2);
+    }
+    println("Test 2: stop mid-stream - PASSED");
+
+    // Test 3: a stop request from another thread interrupts the wait for the first byte
+    {
+        mock::Server server(slow_chat);
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+        std::stop_source stop;
+        std::atomic<bool> requested { false };
+        std::jthread stopper([&] {
+            std::this_thread::sleep_for(100ms);
+            requested = true;
+            stop.request_stop();
+        });
+        auto start = std::chrono::steady_clock::now();
+        auto error = cancelled_by([&] { provider.chat({ Message::user("hi") }, { .cancel = { stop.get_token() } }); });
+        assert(requested);
+        assert(error && !error->deadlineExceeded);
+        assert(since(start) < SLOW / 2);
+    }
+    println("Test 3: stop while waiting - PASSED");
+
+    // Test 4: deadlines are not retried, a cancelled call sends nothing, and a
+    // transport timeout stays a TimeoutError
+    {
+        mock::Server server(slow_chat);
+        RetryProvider provider(openai::OpenAI({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" }),
+                               RetryPolicy { .initialBackoff = 1ms });
+        auto start = std::chrono::steady_clock::now();
+        auto error = cancelled_by([&] {
+            provider.chat({ Message::user("hi") }, { .cancel = Cancellation::after(150ms) });
+        });
+        assert(error && error->deadlineExceeded);
+        assert(since(start) >= 150ms && since(start) < SLOW / 2);
+        assert(provider.stats().retries == 0);
+        assert(server.requests().size() == 1);
+
+        mock::Server idle(slow_chat);
+        RetryProvider unsent(openai::OpenAI({ .apiKey = "k", .baseUrl = idle.url("/v1"), .model = "gpt-4o" }),
+                             RetryPolicy { .initialBackoff = 1ms });
+        std::stop_source stop;
+        stop.request_stop();
+        error = cancelled_by([&] { unsent.chat({ Message::user("hi") }, { .cancel = { stop.get_token() } }); });
+        assert(error && !error->deadlineExceeded);
+        assert(idle.requests().empty());
+
+        mock::Server stuck(slow_chat);
+        openai::OpenAI timed({ .apiKey = "k", .baseUrl = stuck.url("/v1"), .model = "gpt-4o",
+                               .timeouts = { .firstByte = 100ms } });
+        bool timedOut = false;
+        try {
+            timed.chat({ Message::user("hi") }, { .cancel = Cancellation::after(SLOW * 10) });
+        } catch (const TimeoutError& e) {
+            timedOut = e.phase == TimeoutPhase::FirstByte;
+        }
+        assert(timedOut);
+    }
+    println("Test 4: deadline - PASSED");
+
+    // Test 5: when_any cancels the slower task through the shared token
+    {
+        mock::Server fast([](const mock::Request&) { return mock::Response { .body = CHAT_BODY }; });
+        mock::Server slow(slow_chat);
+        openai::OpenAI a({ .apiKey = "k", .baseUrl = slow.url("/v1"), .model = "gpt-4o" });
+        openai::OpenAI b({ .apiKey = "k", .baseUrl = fast.url("/v1"), .model = "gpt-4o" });
+        ThreadPool pool(2);
+        std::stop_source stop;
+
+        auto ask = [&](openai::OpenAI& provider) -> Task<ChatResponse> {
+            co_await schedule_on(pool);
+            std::vector<Message> messages { Message::user("hi") };
+            ChatParams params { .cancel = { stop.get_token() } };
+            co_return co_await provider.chat_async(messages, params);
+        };
+        std::vector<Task<ChatResponse>> tasks;
+        tasks.push_back(ask(a));
+        tasks.push_back(ask(b));
+        auto start = std::chrono::steady_clock::now();
+        auto winner = sync_wait(when_any(std::move(tasks), stop));
+        assert(winner.index == 1);
+        assert(winner.value.text() == "done");
+        assert(stop.stop_requested());
+        assert(since(start) < SLOW / 2);   // the loser's wait was interrupted, not sat out
+    }
+    println("Test 5: when_any cancels the loser - PASSED");
+
+    println("test_cancel: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+std::string sse(const Json& chunk) {
+    return "data: " + chunk.dump() + "\n\n";
+}
+
+Json delta(int index, const std::string& text) {
+    return Json{
+        {"id", "chatcmpl-n"},
+        {"model", "gpt-4o"},
+        {"choices", Json::array({Json{{"index", index}, {"delta", Json{{"content", text}}}}})},
+    };
+}
+
+mock::Response handler(const mock::Request& request) {
+    auto body = Json::parse(request.body);
+    int n = body.value("n", 1);
+    if (body.value("stream", false)) {
+        // Choices interleave; choice 1 ends in a tool call
+        std::vector<std::string> chunks {
+            sse(delta(0, "Hel")),
+            sse(delta(2, "Bon")),
+            sse(delta(0, "lo")),
+            sse(Json{{"choices", Json::array({Json{{"index", 1}, {"delta", Json{{"tool_calls", Json::array({Json{
+                {"index", 0}, {"id", "call_1"}, {"function", Json{{"name", "lookup"}, {"arguments", "{\"q\":"}}},
+            }})}}}}})}}),
+            sse(Json{{"choices", Json::array({Json{{"index", 1}, {"delta", Json{{"tool_calls", Json::array({Json{
+                {"index", 0}, {"function", Json{{"arguments", "1}"}}},
+            }})}}}}})}}),
+            sse(delta(2, "jour")),
+            sse(Json{{"choices", Json::array({
+                Json{{"index", 0}, {"delta", Json::object()}, {"finish_reason", "stop"}},
+                Json{{"index", 1}, {"delta", Json::object()}, {"finish_reason", "tool_calls"}},
+                Json{{"index", 2}, {"delta", Json::object()}, {"finish_reason", "length"}},
+            })}}),
+            sse(Json{{"choices", Json::array()}, {"usage", Json{{"prompt_tokens", 50}, {"completion_tokens", 9}}}}),
+            "data: [DONE]\n\n",
+        };
+        return mock::Response { .headers = { { "Content-Type", "text/event-stream" } }, .chunks = chunks };
+    }
+    Json choices = Json::array();
+    for (int i = n - 1; i >= 0; --i) {   // out of order on purpose
+        choices.push_back(Json{
+            {"index", i},
+            {"message", Json{{"role", "assistant"}, {"content", "candidate " + std::to_string(i)}}},
+            {"finish_reason", "stop"},
+        });
+    }
+    return mock::Response { .body = Json{
+        {"id", "chatcmpl-n"},
+        {"model", "gpt-4o"},
+        {"choices", choices},
+        {"usage", Json{{"prompt_tokens", 50}, {"completion_tokens", 3 * n}}},
+    }.dump() };
+}
+
+int main() {
+    mock::Server server(handler);
+    openai::OpenAI provider({ .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+    std::vector<Message> messages { Message::user("Say hello") };
+
+    // Test 1: n completions from one request, in choice order
+    {
+        auto responses = provider.chat_n(messages, ChatParams { .temperature = 1.0 }, 4);
+        assert(responses.size() == 4);
+        for (std::size_t i = 0; i < responses.size(); ++i) {
+            assert(responses[i].text() == "candidate " + std::to_string(i));
+            assert(responses[i].stopReason == StopReason::EndOfTurn);
+            assert(responses[i].usage.inputTokens == 50);
+            assert(responses[i].id == "chatcmpl-n");
+        }
+        auto requests = server.requests();
+        assert(requests.size() == 1);
+        assert(Json::parse(requests[0].body)["n"] == 4);
+    }
+    println("Test 1: chat_n - PASSED");
+
+    // Test 2: streamed choices are demultiplexed by index
+    {
+        std::map<std::size_t, std::string> streamed;
+        auto responses = provider.chat_stream_n(messages, {}, 3, [&](std::size_t index, std::string_view text) {
+            streamed[index] += text;
+        });
+        assert(responses.size() == 3);
+        assert(streamed[0] == "Hello" && streamed[2] == "Bonjour");
+        assert(!streamed.contains(1));
+        assert(responses[0].text() == "Hello");
+        assert(responses[0].stopReason == StopReason::EndOfTurn);
+        assert(responses[1].stopReason == StopReason::ToolUse);
+        assert(responses[1].tool_calls().size() == 1);
+        assert(responses[1].tool_calls()[0].arguments == "{\"q\":1}");
+        assert(responses[2].text() == "Bonjour");
+        assert(responses[2].stopReason == StopReason::MaxTokens);
+        assert(responses[2].usage.outputTokens == 9);
+        assert(Json::parse(server.requests().back().body)["n"] == 3);
+    }
+    println("Test 2: chat_stream_n - PASSED");
+
+    // Test 3: single-choice paths are unchanged
+    {
+        auto response = provider.chat(messages, {});
+        assert(response.text() == "candidate 0");
+        assert(!Json::parse(server.requests().back().body).contains("n"));
+        std::string streamed;
+        auto streamedResponse = provider.chat_stream(messages, {}, [&](std::string_view t) { streamed += t; });
+        assert(streamed == "Hello");   // only choice 0 is forwarded
+        assert(streamedResponse.text() == "Hello");
+    }
+    println("Test 3: single choice - PASSED");
+
+    // Test 4: choice indices outside [0, n) are ignored; n must be positive
+    {
+        mock::Server rogue([](const mock::Request& request) {
+            auto choice = [](std::int64_t index, const std::string& text) {
+                return Json{{"index", index}, {"message", Json{{"role", "assistant"}, {"content", text}}}};
+            };
+            if (Json::parse(request.body).value("stream", false)) {
+                std::vector<std::string> chunks {
+                    sse(delta(-1, "negative")),
+                    sse(delta(0, "zero")),
+                    sse(Json{{"choices", Json::array({Json{{"index", 1ll << 40}, {"delta", Json{{"content", "huge"}}}}})}}),
+                    sse(delta(1, "one")),
+                    "data: [DONE]\n\n",
+                };
+                return mock::Response { .headers = { { "Content-Type", "text/event-stream" } }, .chunks = chunks };
+            }
+            return mock::Response { .body = Json{{"choices", Json::array({
+                choice(-1, "negative"), choice(1ll << 40, "huge"), choice(2, "extra"),
+                choice(1, "one"), choice(0, "zero"),
+            })}}.dump() };
+        });
+        openai::OpenAI bounded({ .apiKey = "sk-test", .baseUrl = rogue.url("/v1"), .model = "gpt-4o" });
+
+        auto responses = bounded.chat_n(messages, {}, 2);
+        assert(responses.size() == 2);
+        assert(responses[0].text() == "zero" && responses[1].text() == "one");
+
+        std::vector<std::size_t> seen;
+        auto streamed = bounded.chat_stream_n(messages, {}, 2, [&](std::size_t index, std::string_view) {
+            seen.push_back(index);
+        });
+        assert(streamed.size() == 2);
+        assert((seen == std::vector<std::size_t> { 0, 1 }));
+        assert(streamed[0].text() == "zero" && streamed[1].text() == "one");
+
+        auto before = rogue.requests().size();
+        for (int n : { 0, -3 }) {
+            bool rejected = false;
+            try {
+                bounded.chat_n(messages, {}, n);
+            } catch (const std::invalid_argument&) {
+                rejected = true;
+            }
+            assert(rejected);
+            rejected = false;
+            try {
+                bounded.chat_stream_n(messages, {}, n, [](std::size_t, std::string_view) {});
+            } catch (const std::invalid_argument&) {
+                rejected = true;
+            }
+            assert(rejected);
+        }
+        assert(rogue.requests().size() == before);   // nothing was sent
+    }
+    println("Test 4: choice index bounds - PASSED");
+
+    println("test_choices: ALL PASSED");
+    return 0;
+}
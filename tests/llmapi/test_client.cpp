@@ -43,6 +43,9 @@ struct FullMockProvider {
             auto len = std::min(std::size_t{5}, text.size() - i);
             callback(std::string_view(text).substr(i, len));
         }
+        if (!params.accumulateStream) {
+            resp.content.clear();
+        }
         return resp;
     }
 
@@ -102,7 +105,23 @@ int main() {
     assert(client2.conversation().size() == 2);
     std::filesystem::remove("/tmp/test_client_conv.json");
 
-    // Test 8: isolated clients can be used concurrently without sharing conversation state
+    // Test 8: streams that are not accumulated leave no empty assistant turn
+    client.clear();
+    std::string relayed;
+    auto relay = client.chat_stream("relay", ChatParams { .accumulateStream = false },
+                                    [&relayed](std::string_view chunk) { relayed += chunk; });
+    assert(relayed == "reply to: relay");
+    assert(relay.text().empty());
+    assert(client.conversation().size() == 1);
+    assert(client.conversation().messages.back().role == Role::User);
+    client.chat_stream_async("relay again", ChatParams { .accumulateStream = false },
+                             [](std::string_view) {}).get();
+    assert(client.conversation().size() == 2);
+    assert(client.conversation().messages.back().role == Role::User);
+    client.add_message(Message::assistant(relayed));
+    assert(client.conversation().size() == 3);
+
+    // Test 9: isolated clients can be used concurrently without sharing conversation state
     auto futureA = std::async(std::launch::async, [] {
         auto isolatedClient = Client(FullMockProvider{
             .prefix = "openai-like: ",
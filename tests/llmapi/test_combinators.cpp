@@ -0,0 +1,181 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using namespace std::chrono_literals;
+
+Task<int> number(int n) {
+    co_return n;
+}
+
+Task<std::string> text(std::string s) {
+    co_return s;
+}
+
+Task<void> nothing() {
+    co_return;
+}
+
+Task<int> sleepy(ThreadPool& pool, int n, std::chrono::milliseconds delay) {
+    co_await schedule_on(pool);
+    std::this_thread::sleep_for(delay);
+    co_return n;
+}
+
+Task<int> failing(ThreadPool& pool, std::string message) {
+    co_await schedule_on(pool);
+    throw std::runtime_error(message);
+    co_return 0;
+}
+
+// Polls its token like a provider waiting on a socket
+Task<int> until_stopped(ThreadPool& pool, std::stop_token stop, std::atomic<bool>& sawStop) {
+    co_await schedule_on(pool);
+    auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (!stop.stop_requested() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(5ms);
+    }
+    sawStop = stop.stop_requested();
+    throw std::runtime_error("stopped");
+    co_return 0;
+}
+
+// A blocking provider, the way the built-in ones implement chat_async
+struct SlowProvider {
+    std::atomic<int> active { 0 };
+    std::atomic<int> peak { 0 };
+
+    std::string_view name() const { return "slow"; }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams&) {
+        auto now = ++active;
+        for (auto seen = peak.load(); now > seen && !peak.compare_exchange_weak(seen, now);) {}
+        std::this_thread::sleep_for(50ms);
+        --active;
+        return ChatResponse {
+            .content = { TextContent { "re: " + std::get<std::string>(messages.back().content) } },
+            .stopReason = StopReason::EndOfTurn,
+        };
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& messages, const ChatParams& params) {
+        co_return chat(messages, params);
+    }
+};
+
+static_assert(Provider<SlowProvider>);
+
+int main() {
+    // Test 1: tuple form, void results become monostate
+    {
+        auto [n, s, v] = when_all(number(1), text("two"), nothing()).get();
+        assert(n == 1);
+        assert(s == "two");
+        static_assert(std::is_same_v<decltype(v), std::monostate>);
+    }
+    println("Test 1: when_all tuple - PASSED");
+
+    // Test 2: range form runs concurrently on the pool and keeps order
+    {
+        ThreadPool pool(4);
+        std::vector<Task<int>> tasks;
+        for (int i = 0; i < 4; ++i) tasks.push_back(sleepy(pool, i, 100ms));
+        auto start = std::chrono::steady_clock::now();
+        auto results = sync_wait(when_all(std::move(tasks)));
+        assert(std::chrono::steady_clock::now() - start < 300ms);
+        assert((results == std::vector<int> { 0, 1, 2, 3 }));
+    }
+    println("Test 2: when_all range - PASSED");
+
+    // Test 3: a failure surfaces after every task finished
+    {
+        ThreadPool pool(2);
+        std::vector<Task<int>> tasks;
+        tasks.push_back(sleepy(pool, 0, 50ms));
+        tasks.push_back(failing(pool, "first"));
+        tasks.push_back(failing(pool, "second"));
+        try {
+            sync_wait(when_all(std::move(tasks)));
+            assert(false);
+        } catch (const std::runtime_error& e) {
+            assert(std::string(e.what()) == "first");
+        }
+    }
+    println("Test 3: when_all failure - PASSED");
+
+    // Test 4: when_any takes the first success and stops the losers
+    {
+        ThreadPool pool(3);
+        std::stop_source stop;
+        std::atomic<bool> sawStop { false };
+        std::vector<Task<int>> tasks;
+        tasks.push_back(until_stopped(pool, stop.get_token(), sawStop));
+        tasks.push_back(failing(pool, "fast failure"));
+        tasks.push_back(sleepy(pool, 42, 50ms));
+        auto start = std::chrono::steady_clock::now();
+        auto winner = sync_wait(when_any(std::move(tasks), stop));
+        assert(winner.index == 2);
+        assert(winner.value == 42);
+        assert(sawStop);
+        assert(std::chrono::steady_clock::now() - start < 1s);
+
+        std::vector<Task<int>> doomed;
+        doomed.push_back(failing(pool, "a"));
+        doomed.push_back(failing(pool, "b"));
+        try {
+            sync_wait(when_any(std::move(doomed)));
+            assert(false);
+        } catch (const std::runtime_error& e) {
+            assert(std::string(e.what()) == "a");
+        }
+    }
+    println("Test 4: when_any - PASSED");
+
+    // Test 5: bounded fan-out over Task<ChatResponse>
+    {
+        ThreadPool pool(4);
+        SlowProvider provider;
+        std::vector<std::string> prompts;
+        for (int i = 0; i < 12; ++i) prompts.push_back("prompt " + std::to_string(i));
+        std::mutex mutex;
+        std::vector<std::string> replies;
+
+        auto start = std::chrono::steady_clock::now();
+        sync_wait(for_each_async(pool, prompts, 3, [&](const std::string& prompt) -> Task<void> {
+            std::vector<Message> messages { Message::user(prompt) };
+            auto response = co_await provider.chat_async(messages, {});
+            std::lock_guard lock { mutex };
+            replies.push_back(response.text());
+        }));
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        assert(replies.size() == 12);
+        assert(provider.peak == 3);
+        assert(elapsed >= 200ms && elapsed < 550ms);   // 12 calls of 50ms, 3 at a time
+        std::ranges::sort(replies);
+        assert(replies.front() == "re: prompt 0");
+    }
+    println("Test 5: for_each_async - PASSED");
+
+    // Test 6: fan-out stops taking items after a failure
+    {
+        ThreadPool pool(2);
+        std::atomic<int> calls { 0 };
+        try {
+            sync_wait(for_each_async(pool, std::vector<int>(100, 0), 2, [&](int) -> Task<void> {
+                if (++calls == 3) throw std::runtime_error("bad item");
+                co_return;
+            }));
+            assert(false);
+        } catch (const std::runtime_error& e) {
+            assert(std::string(e.what()) == "bad item");
+        }
+        assert(calls < 100);
+    }
+    println("Test 6: for_each_async failure - PASSED");
+
+    println("test_combinators: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "mock_server.hpp"
+
+#include <zlib.h>
+#include <zstd.h>
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+// Compresses `pieces` into one gzip or zstd stream, flushed after every
+// piece the way a server flushes after every SSE event. Returns the output
+// of each flush.
+std::vector<std::string> compress(ContentEncoding encoding, const std::vector<std::string>& pieces) {
+    std::vector<std::string> out;
+    if (encoding == ContentEncoding::Gzip) {
+        z_stream z {};
+        deflateInit2(&z, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        for (std::size_t i = 0; i < pieces.size(); ++i) {
+            std::string buffer(deflateBound(&z, pieces[i].size()) + 64, '\0');
+            z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pieces[i].data()));
+            z.avail_in = static_cast<uInt>(pieces[i].size());
+            z.next_out = reinterpret_cast<Bytef*>(buffer.data());
+            z.avail_out = static_cast<uInt>(buffer.size());
+            deflate(&z, i + 1 == pieces.size() ? Z_FINISH : Z_SYNC_FLUSH);
+            buffer.resize(buffer.size() - z.avail_out);
+            out.push_back(std::move(buffer));
+        }
+        deflateEnd(&z);
+    } else {
+        auto* cctx = ZSTD_createCCtx();
+        for (std::size_t i = 0; i < pieces.size(); ++i) {
+            std::string buffer(ZSTD_compressBound(pieces[i].size()) + 64, '\0');
+            ZSTD_inBuffer input { pieces[i].data(), pieces[i].size(), 0 };
+            ZSTD_outBuffer output { buffer.data(), buffer.size(), 0 };
+            ZSTD_compressStream2(cctx, &output, &input, i + 1 == pieces.size() ? ZSTD_e_end : ZSTD_e_flush);
+            buffer.resize(output.pos);
+            out.push_back(std::move(buffer));
+        }
+        ZSTD_freeCCtx(cctx);
+    }
+    return out;
+}
+
+std::string compress(ContentEncoding encoding, const std::string& text) {
+    return compress(encoding, std::vector<std::string> { text }).front();
+}
+
+std::string decode(ContentEncoding encoding, std::string_view data, std::size_t step, bool* finished = nullptr) {
+    Decompressor decoder(encoding);
+    std::string out;
+    for (std::size_t pos = 0; pos < data.size(); pos += step) {
+        decoder.feed(data.substr(pos, step), [&](std::string_view piece) {
+            assert(piece.size() <= Decompressor::OUTPUT_BYTES);
+            out.append(piece);
+            return true;
+        });
+    }
+    if (finished) *finished = decoder.finished();
+    return out;
+}
+
+// Float-heavy JSON, the case compression helps most
+std::string embedding_body() {
+    Json embedding = Json::array();
+    for (int i = 0; i < 3072; ++i) embedding.push_back(std::sin(i) * 0.0123456789);
+    return Json {
+        {"object", "list"},
+        {"model", "text-embedding-3-large"},
+        {"data", Json::array({Json{{"object", "embedding"}, {"index", 0}, {"embedding", embedding}}})},
+        {"usage", Json{{"prompt_tokens", 2}, {"total_tokens", 2}}},
+    }.dump();
+}
+
+std::string chat_body(const std::string& text) {
+    return Json {
+        {"id", "c1"},
+        {"model", "gpt-4o"},
+        {"choices", Json::array({Json{
+            {"index", 0},
+            {"message", Json{{"role", "assistant"}, {"content", text}}},
+            {"finish_reason", "stop"},
+        }})},
+        {"usage", Json{{"prompt_tokens", 3}, {"completion_tokens", 100}}},
+    }.dump();
+}
+
+int main() {
+    std::string longText;
+    while (longText.size() < 200 * 1024) longText += "the quick brown fox jumps over the lazy dog. ";
+
+    // Test 1: streaming decoders, any input split
+    {
+        assert(parse_content_encoding("gzip") == ContentEncoding::Gzip);
+        assert(parse_content_encoding(" ZSTD ") == ContentEncoding::Zstd);
+        assert(parse_content_encoding("identity") == ContentEncoding::Identity);
+        assert(!parse_content_encoding("br").has_value());
+
+        for (auto encoding : { ContentEncoding::Gzip, ContentEncoding::Zstd }) {
+            auto packed = compress(encoding, longText);
+            assert(packed.size() < longText.size() / 10);
+            for (std::size_t step : { std::size_t { 1 }, std::size_t { 1000 }, packed.size() }) {
+                bool finished = false;
+                assert(decode(encoding, packed, step, &finished) == longText);
+                assert(finished);
+            }
+            // Two members/frames back to back
+            assert(decode(encoding, packed + compress(encoding, "tail"), 512) == longText + "tail");
+
+            bool finished = true;
+            decode(encoding, std::string_view(packed).substr(0, packed.size() / 2), 4096, &finished);
+            assert(!finished);
+
+            bool threw = false;
+            try {
+                decode(encoding, "definitely not compressed", 64);
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            assert(threw);
+        }
+    }
+    println("Test 1: decompressor - PASSED");
+
+    // Test 2: compressed JSON responses are decoded before parsing
+    {
+        auto embeddings = embedding_body();
+        auto completion = chat_body(longText);
+        mock::Server server([&](const mock::Request& request) {
+            auto encoding = request.path == "/v1/embeddings" ? ContentEncoding::Zstd : ContentEncoding::Gzip;
+            auto body = request.path == "/v1/embeddings" ? embeddings : completion;
+            return mock::Response {
+                .headers = {
+                    { "Content-Type", "application/json" },
+                    { "Content-Encoding", encoding == ContentEncoding::Zstd ? "zstd" : "gzip" },
+                },
+                .body = compress(encoding, body),
+            };
+        });
+        {
+            openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+            auto response = provider.chat({ Message::user("hi") }, {});
+            assert(response.text() == longText);
+            auto embedded = provider.embed({ "hi" }, "text-embedding-3-large");
+            assert(embedded.embeddings.size() == 1);
+            assert(embedded.embeddings[0].size() == 3072);
+
+            auto stats = provider.transfer_stats();
+            assert(stats.responses == 2);
+            assert(stats.compressed == 2);
+            assert(stats.bodyBytes == completion.size() + embeddings.size());
+            assert(stats.wireBytes < stats.bodyBytes / 2);
+        }
+        for (const auto& request : server.requests()) {
+            assert(request.header("accept-encoding") == "zstd, gzip, deflate");
+        }
+    }
+    println("Test 2: compressed responses - PASSED");
+
+    // Test 3: compressed SSE streams deliver each event as it is flushed
+    for (auto encoding : { ContentEncoding::Gzip, ContentEncoding::Zstd }) {
+        std::vector<std::string> events;
+        for (auto word : { "com", "press", "ed" }) {
+            events.push_back("data: " + Json{{"choices", Json::array({Json{{"index", 0}, {"delta", Json{{"content", word}}}}})}}.dump() + "\n\n");
+        }
+        events.push_back("data: [DONE]\n\n");
+        auto chunks = compress(encoding, events);
+        mock::Server server([&](const mock::Request&) {
+            return mock::Response {
+                .headers = {
+                    { "Content-Type", "text/event-stream" },
+                    { "Content-Encoding", encoding == ContentEncoding::Zstd ? "zstd" : "gzip" },
+                },
+                .chunks = chunks,
+            };
+        });
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+        std::vector<std::string> deltas;
+        auto response = provider.chat_stream({ Message::user("hi") }, {},
+                                             [&](std::string_view delta) { deltas.emplace_back(delta); });
+        assert((deltas == std::vector<std::string> { "com", "press", "ed" }));
+        assert(response.text() == "compressed");
+        assert(provider.transfer_stats().compressed == 1);
+    }
+    println("Test 3: compressed streams - PASSED");
+
+    // Test 4: compression can be turned off
+    {
+        mock::Server server([&](const mock::Request&) { return mock::Response { .body = chat_body("plain") }; });
+        {
+            openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o",
+                                      .compression = false });
+            assert(provider.chat({ Message::user("hi") }, {}).text() == "plain");
+            assert(provider.transfer_stats().responses == 0);
+        }
+        assert(server.requests().back().header("accept-encoding").empty());
+    }
+    println("Test 4: compression off - PASSED");
+
+    println("test_compression: ALL PASSED");
+    return 0;
+}
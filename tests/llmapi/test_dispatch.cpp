@@ -0,0 +1,193 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+// Shared upstream cache: a prefix becomes readable once the request that
+// writes it has finished prefill (i.e. starts streaming).
+struct Upstream {
+    std::mutex mutex;
+    std::set<std::string> cached;
+    std::atomic<int> misses { 0 };
+    std::atomic<int> hits { 0 };
+    std::atomic<int> primes { 0 };
+    std::atomic<int> inFlight { 0 };
+    std::atomic<int> maxInFlight { 0 };
+};
+
+struct CachedBackend {
+    std::shared_ptr<Upstream> upstream;
+
+    std::string_view name() const { return "cached"; }
+
+    static std::string system_of(const std::vector<Message>& messages) {
+        for (const auto& m : messages) {
+            if (m.role == Role::System) return std::get<std::string>(m.content);
+        }
+        return {};
+    }
+
+    // Prefill, then publish the prefix; returns whether it was a hit
+    bool prefill(const std::vector<Message>& messages) {
+        auto prefix = system_of(messages);
+        bool hit = false;
+        {
+            std::lock_guard lock { upstream->mutex };
+            hit = upstream->cached.contains(prefix);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(hit ? 2 : 30));
+        {
+            std::lock_guard lock { upstream->mutex };
+            upstream->cached.insert(prefix);
+        }
+        (hit ? upstream->hits : upstream->misses)++;
+        return hit;
+    }
+
+    ChatResponse respond(bool hit) {
+        return ChatResponse {
+            .content = { TextContent { "ok" } },
+            .stopReason = StopReason::EndOfTurn,
+            .usage = Usage { .inputTokens = hit ? 10 : 5000, .cacheReadTokens = hit ? 4990 : 0 },
+        };
+    }
+
+    ChatResponse chat(const std::vector<Message>& messages, const ChatParams& params) {
+        return chat_stream(messages, params, [](std::string_view) {});
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& msgs, const ChatParams& p) {
+        co_return chat(msgs, p);
+    }
+
+    ChatResponse chat_stream(const std::vector<Message>& messages, const ChatParams&,
+                             std::function<void(std::string_view)> callback) {
+        auto now = ++upstream->inFlight;
+        auto seen = upstream->maxInFlight.load();
+        while (now > seen && !upstream->maxInFlight.compare_exchange_weak(seen, now)) {}
+        bool hit = prefill(messages);
+        callback("o");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));   // decode
+        callback("k");
+        upstream->inFlight--;
+        return respond(hit);
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& msgs, const ChatParams& p,
+                                          std::function<void(std::string_view)> cb) {
+        co_return chat_stream(msgs, p, std::move(cb));
+    }
+
+    ChatResponse prime_cache(const std::vector<Message>& messages, const std::vector<ToolDef>&) {
+        upstream->primes++;
+        return respond(prefill(messages));
+    }
+};
+
+static_assert(CachePrimableProvider<CachedBackend>);
+static_assert(CachePrimableProvider<anthropic::Anthropic>);
+static_assert(CachePrimableProvider<openai::OpenAI>);
+
+std::vector<BatchRequest> make_batch(const std::string& system, int count) {
+    std::vector<BatchRequest> batch;
+    for (int i = 0; i < count; ++i) {
+        batch.push_back(BatchRequest {
+            .messages = { Message::system(system), Message::user("item " + std::to_string(i)) },
+        });
+    }
+    return batch;
+}
+
+int main() {
+    auto longPrompt = std::string(5000, 'x');
+
+    // Test 1: without grouping every concurrent request misses
+    {
+        auto upstream = std::make_shared<Upstream>();
+        BurstDispatcher<CachedBackend> dispatcher(
+            [&] { return CachedBackend { upstream }; },
+            DispatchPolicy { .concurrency = 8, .minPrefixChars = 1'000'000 });
+        auto results = dispatcher.run(make_batch(longPrompt, 16));
+        assert(results.size() == 16);
+        assert(std::ranges::all_of(results, &BatchResult::ok));
+        assert(upstream->misses > 1);
+        assert(dispatcher.stats().groups == 0);
+    }
+    println("Test 1: baseline thundering herd - PASSED");
+
+    // Test 2: first request primes, the rest wait until it streams
+    {
+        auto upstream = std::make_shared<Upstream>();
+        BurstDispatcher<CachedBackend> dispatcher(
+            [&] { return CachedBackend { upstream }; }, DispatchPolicy { .concurrency = 8 });
+        auto results = dispatcher.run(make_batch(longPrompt, 16));
+        assert(std::ranges::all_of(results, &BatchResult::ok));
+        assert(upstream->misses == 1);
+        assert(upstream->hits == 15);
+        assert(upstream->maxInFlight > 1);   // held requests still run concurrently afterwards
+        assert(dispatcher.stats().groups == 1);
+        assert(dispatcher.stats().held == 15);
+        assert(results[3].response->usage.cacheReadTokens == 4990);
+    }
+    println("Test 2: first-request priming - PASSED");
+
+    // Test 3: explicit priming request; unrelated requests are not held
+    {
+        auto upstream = std::make_shared<Upstream>();
+        BurstDispatcher<CachedBackend> dispatcher(
+            [&] { return CachedBackend { upstream }; },
+            DispatchPolicy { .concurrency = 4, .prime = PrimeMode::PrimingRequest });
+        auto batch = make_batch(longPrompt, 8);
+        batch.push_back(BatchRequest { .messages = { Message::system("short"), Message::user("solo") } });
+        auto results = dispatcher.run(batch);
+        assert(std::ranges::all_of(results, &BatchResult::ok));
+        assert(upstream->primes == 1);
+        assert(upstream->hits == 8);
+        assert(upstream->misses == 2);   // the priming request and the unrelated one
+        assert(dispatcher.stats().primingRequests == 1);
+        assert(dispatcher.stats().held == 8);
+    }
+    println("Test 3: priming request - PASSED");
+
+    // Test 4: two prefixes form two groups
+    {
+        auto upstream = std::make_shared<Upstream>();
+        BurstDispatcher<CachedBackend> dispatcher(
+            [&] { return CachedBackend { upstream }; }, DispatchPolicy { .concurrency = 6 });
+        auto batch = make_batch(longPrompt, 6);
+        auto other = make_batch(std::string(5000, 'y'), 6);
+        batch.insert(batch.end(), other.begin(), other.end());
+        dispatcher.run(batch);
+        assert(upstream->misses == 2);
+        assert(dispatcher.stats().groups == 2);
+    }
+    println("Test 4: multiple groups - PASSED");
+
+    // Test 5: failures are reported per request
+    {
+        struct Failing {
+            std::string_view name() const { return "failing"; }
+            ChatResponse chat(const std::vector<Message>&, const ChatParams&) {
+                throw ApiError(400, "invalid_request_error", "{}", "bad request");
+            }
+            Task<ChatResponse> chat_async(const std::vector<Message>& m, const ChatParams& p) { co_return chat(m, p); }
+        };
+        BurstDispatcher<Failing> dispatcher([] { return Failing {}; });
+        auto results = dispatcher.run(make_batch(longPrompt, 3));
+        for (const auto& result : results) {
+            assert(!result.ok() && result.error);
+            try {
+                std::rethrow_exception(result.error);
+            } catch (const ApiError& e) {
+                assert(e.statusCode == 400);
+            }
+        }
+    }
+    println("Test 5: per-request errors - PASSED");
+
+    println("test_dispatch: ALL PASSED");
+    return 0;
+}
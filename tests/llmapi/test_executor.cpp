@@ -0,0 +1,115 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+Task<int> one() {
+    co_return 1;
+}
+
+// Each level awaits the next and is resumed by symmetric transfer. GCC
+// emits that as a tail call only when optimizing and the project builds
+// without mode rules, so depths stay small enough to pass nested at -O0
+// on a 1 MiB stack.
+Task<long> depth(int n) {
+    if (n == 0) co_return 0;
+    co_return 1 + co_await depth(n - 1);
+}
+
+Task<long> sum_sequential(int n) {
+    long total = 0;
+    for (int i = 0; i < n; ++i) total += co_await one();
+    co_return total;
+}
+
+Task<std::thread::id> hop(ThreadPool& pool) {
+    co_await schedule_on(pool);
+    co_return std::this_thread::get_id();
+}
+
+Task<int> hop_then_throw(ThreadPool& pool) {
+    co_await schedule_on(pool);
+    throw std::runtime_error("on a worker");
+    co_return 0;
+}
+
+// Suspends on the pool, finishes there and resumes the awaiter there too
+Task<std::pair<std::thread::id, std::thread::id>> awaited_across_threads(ThreadPool& pool) {
+    auto worker = co_await hop(pool);
+    co_return std::pair { worker, std::this_thread::get_id() };
+}
+
+Task<void> count_on(ThreadPool& pool, std::atomic<int>& counter, std::mutex& mutex,
+                    std::set<std::thread::id>& threads) {
+    co_await schedule_on(pool);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    {
+        std::lock_guard lock { mutex };
+        threads.insert(std::this_thread::get_id());
+    }
+    counter++;
+}
+
+int main() {
+    // Test 1: co_await chains resume each awaiter with its result
+    {
+        assert(depth(1000).get() == 1000);
+        assert(sum_sequential(1000).get() == 1000);
+    }
+    println("Test 1: awaited chains - PASSED");
+
+    // Test 2: sync_wait blocks on a task that finishes on another thread
+    {
+        ThreadPool pool(2);
+        assert(pool.size() == 2);
+        auto worker = sync_wait(hop(pool));
+        assert(worker != std::this_thread::get_id());
+
+        auto [inner, outer] = awaited_across_threads(pool).get();
+        assert(inner == outer);
+        assert(inner != std::this_thread::get_id());
+
+        try {
+            sync_wait(hop_then_throw(pool));
+            assert(false);
+        } catch (const std::runtime_error& e) {
+            assert(std::string(e.what()) == "on a worker");
+        }
+    }
+    println("Test 2: sync_wait across threads - PASSED");
+
+    // Test 3: work spreads over the pool's threads
+    {
+        ThreadPool pool(4);
+        std::atomic<int> counter { 0 };
+        std::mutex mutex;
+        std::set<std::thread::id> threads;
+        std::vector<Task<void>> tasks;
+        std::vector<std::jthread> waiters;
+        for (int i = 0; i < 8; ++i) tasks.push_back(count_on(pool, counter, mutex, threads));
+        for (auto& task : tasks) waiters.emplace_back([&task] { task.get(); });
+        waiters.clear();
+        assert(counter == 8);
+        assert(threads.size() > 1);
+    }
+    println("Test 3: thread pool - PASSED");
+
+    // Test 4: the inline executor keeps everything on the caller
+    {
+        InlineExecutor inline_;
+        auto here = [&]() -> Task<std::thread::id> {
+            co_await schedule_on(inline_);
+            co_return std::this_thread::get_id();
+        };
+        assert(here().get() == std::this_thread::get_id());
+        static_assert(Executor<InlineExecutor>);
+        static_assert(Executor<ThreadPool>);
+    }
+    println("Test 4: inline executor - PASSED");
+
+    println("test_executor: ALL PASSED");
+    return 0;
+}
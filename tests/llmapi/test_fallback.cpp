@@ -0,0 +1,149 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+// Behaviour is controlled through a shared handle so tests can flip it after
+// the provider has been moved into the chain.
+struct Control {
+    int status { 0 };          // 0 = healthy, otherwise throw ApiError(status)
+    int delayMs { 0 };
+    int calls { 0 };
+};
+
+struct ScriptedProvider {
+    std::string label;
+    std::shared_ptr<Control> control { std::make_shared<Control>() };
+
+    std::string_view name() const { return label; }
+
+    ChatResponse chat(const std::vector<Message>&, const ChatParams&) {
+        control->calls++;
+        if (control->delayMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(control->delayMs));
+        }
+        if (control->status != 0) {
+            throw ApiError(control->status, "api_error", "{}", label + " failed");
+        }
+        return ChatResponse {
+            .content = { TextContent { label } },
+            .stopReason = StopReason::EndOfTurn,
+        };
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& msgs, const ChatParams& p) {
+        co_return chat(msgs, p);
+    }
+};
+
+static_assert(Provider<AnyProvider>);
+static_assert(StreamableProvider<AnyProvider>);
+static_assert(StreamableProvider<FallbackProvider>);
+
+int main() {
+    auto policy = CircuitBreakerPolicy {
+        .window = 10,
+        .minRequests = 3,
+        .failureRateThreshold = 0.5,
+        .slowCallThreshold = std::chrono::milliseconds { 40 },
+        .slowCallRateThreshold = 0.6,
+        .openDuration = std::chrono::milliseconds { 100 },
+    };
+
+    auto primary = ScriptedProvider { .label = "anthropic" };
+    auto secondary = ScriptedProvider { .label = "openai" };
+    auto primaryControl = primary.control;
+    auto secondaryControl = secondary.control;
+    FallbackProvider chain(policy, std::move(primary), std::move(secondary));
+    assert(chain.size() == 2);
+
+    // Test 1: healthy primary serves the request
+    assert(chain.chat({}, {}).text() == "anthropic");
+
+    // Test 2: transient failure falls over to the next member
+    primaryControl->status = 529;
+    assert(chain.chat({}, {}).text() == "openai");
+
+    // Test 3: after enough failures the primary's circuit opens and it is skipped
+    chain.chat({}, {});
+    chain.chat({}, {});
+    assert(chain.members()[0].state == CircuitState::Open);
+    auto callsWhenOpen = primaryControl->calls;
+    assert(chain.chat({}, {}).text() == "openai");
+    assert(primaryControl->calls == callsWhenOpen);
+    assert(chain.members()[0].skipped >= 1);
+
+    // Test 4: half-open probe closes the circuit once the primary recovers
+    primaryControl->status = 0;
+    std::this_thread::sleep_for(std::chrono::milliseconds { 120 });
+    assert(chain.members()[0].state == CircuitState::HalfOpen);
+    assert(chain.chat({}, {}).text() == "anthropic");
+    assert(chain.members()[0].state == CircuitState::Closed);
+
+    // Test 5: non-transient errors do not fail over
+    primaryControl->status = 400;
+    try {
+        chain.chat({}, {});
+        assert(false);
+    } catch (const ApiError& e) {
+        assert(e.statusCode == 400);
+    }
+    assert(chain.members()[0].state == CircuitState::Closed);
+    primaryControl->status = 0;
+
+    // Test 6: every circuit open -> CircuitOpenError without any upstream call
+    primaryControl->status = 503;
+    secondaryControl->status = 503;
+    for (int i = 0; i < 10; ++i) {
+        try { chain.chat({}, {}); } catch (const ApiError&) {} catch (const CircuitOpenError&) {}
+    }
+    auto totalCalls = primaryControl->calls + secondaryControl->calls;
+    try {
+        chain.chat({}, {});
+        assert(false);
+    } catch (const CircuitOpenError&) {}
+    assert(primaryControl->calls + secondaryControl->calls == totalCalls);
+
+    // Test 7: slow calls trip the breaker as well
+    auto slow = ScriptedProvider { .label = "slow" };
+    slow.control->delayMs = 50;
+    auto slowControl = slow.control;
+    FallbackProvider latencyChain(policy, std::move(slow), ScriptedProvider { .label = "fast" });
+    for (int i = 0; i < 3; ++i) latencyChain.chat({}, {});
+    assert(latencyChain.members()[0].state == CircuitState::Open);
+    assert(latencyChain.chat({}, {}).text() == "fast");
+
+    // Test 8: a rejected request is no verdict: a half-open circuit stays
+    // half-open and its probe is free for the next call
+    auto flaky = ScriptedProvider { .label = "flaky" };
+    auto flakyControl = flaky.control;
+    FallbackProvider probing(policy, std::move(flaky), ScriptedProvider { .label = "backup" });
+    flakyControl->status = 503;
+    for (int i = 0; i < 3; ++i) probing.chat({}, {});
+    assert(probing.members()[0].state == CircuitState::Open);
+    std::this_thread::sleep_for(std::chrono::milliseconds { 120 });
+    flakyControl->status = 400;
+    try { probing.chat({}, {}); assert(false); } catch (const ApiError&) {}
+    assert(probing.members()[0].state == CircuitState::HalfOpen);
+    flakyControl->status = 0;
+    assert(probing.chat({}, {}).text() == "flaky");
+    assert(probing.members()[0].state == CircuitState::Closed);
+    assert(probing.members()[0].requests == 5);
+    assert(probing.members()[0].failures == 3);
+
+    // Test 9: non-streamable members still stream through AnyProvider
+    FallbackProvider streaming(ScriptedProvider { .label = "whole" });
+    std::string streamed;
+    streaming.chat_stream({}, {}, [&](std::string_view chunk) { streamed += chunk; });
+    assert(streamed == "whole");
+
+    // Test 10: usable from Client
+    auto client = Client(FallbackProvider(ScriptedProvider { .label = "client" }));
+    assert(client.chat("hi").text() == "client");
+
+    println("test_fallback: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,260 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+static_assert(FileUploadProvider<openai::OpenAI>);
+static_assert(FileUploadProvider<anthropic::Anthropic>);
+static_assert(ImageFileProvider<openai::Responses>);
+static_assert(ImageFileProvider<anthropic::Anthropic>);
+static_assert(!ImageFileProvider<openai::OpenAI>);   // Chat Completions keeps images inline
+
+// A 20000-byte "image": base64 of bytes 0..255 repeated
+std::string sample_bytes() {
+    std::string bytes;
+    for (int i = 0; i < 20000; ++i) bytes.push_back(static_cast<char>(i % 256));
+    return bytes;
+}
+
+std::string base64(std::string_view bytes) {
+    constexpr std::string_view ALPHABET { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" };
+    std::string out;
+    std::size_t i = 0;
+    for (; i + 2 < bytes.size(); i += 3) {
+        auto n = (static_cast<unsigned char>(bytes[i]) << 16) | (static_cast<unsigned char>(bytes[i + 1]) << 8) |
+                 static_cast<unsigned char>(bytes[i + 2]);
+        out += ALPHABET[(n >> 18) & 63];
+        out += ALPHABET[(n >> 12) & 63];
+        out += ALPHABET[(n >> 6) & 63];
+        out += ALPHABET[n & 63];
+    }
+    if (i + 1 == bytes.size()) {
+        auto n = static_cast<unsigned char>(bytes[i]) << 16;
+        out += ALPHABET[(n >> 18) & 63];
+        out += ALPHABET[(n >> 12) & 63];
+        out += "==";
+    } else if (i + 2 == bytes.size()) {
+        auto n = (static_cast<unsigned char>(bytes[i]) << 16) | (static_cast<unsigned char>(bytes[i + 1]) << 8);
+        out += ALPHABET[(n >> 18) & 63];
+        out += ALPHABET[(n >> 12) & 63];
+        out += ALPHABET[(n >> 6) & 63];
+        out += '=';
+    }
+    return out;
+}
+
+Message screenshot_turn(const std::string& data, const std::string& text) {
+    return Message {
+        .role = Role::User,
+        .content = std::vector<ContentPart> {
+            ImageContent { .data = data, .mediaType = "image/png" },
+            TextContent { text },
+        },
+    };
+}
+
+mock::Response openai_handler(const mock::Request& request) {
+    if (request.path == "/v1/files") {
+        return mock::Response { .body = R"({"id":"file-abc","object":"file","bytes":20000,"filename":"image.png","purpose":"vision"})" };
+    }
+    if (request.path == "/v1/responses") {
+        return mock::Response { .body = R"({"id":"resp_1","object":"response","model":"gpt-4o","status":"completed","output":[{"type":"message","role":"assistant","content":[{"type":"output_text","text":"ok"}]}],"usage":{"input_tokens":10,"output_tokens":1}})" };
+    }
+    return mock::Response { .body = R"({"id":"c1","model":"gpt-4o","choices":[{"index":0,"message":{"role":"assistant","content":"ok"},"finish_reason":"stop"}],"usage":{"prompt_tokens":10,"completion_tokens":1,"total_tokens":11}})" };
+}
+
+mock::Response anthropic_handler(const mock::Request& request) {
+    if (request.path == "/v1/files") {
+        return mock::Response { .body = R"({"id":"file_011","type":"file","filename":"image.png","mime_type":"image/png","size_bytes":20000})" };
+    }
+    return mock::Response { .body = R"({"id":"msg_1","type":"message","role":"assistant","model":"claude","content":[{"type":"text","text":"ok"}],"stop_reason":"end_turn","usage":{"input_tokens":10,"output_tokens":1}})" };
+}
+
+int main() {
+    auto bytes = sample_bytes();
+    auto encoded = base64(bytes);
+
+    // Test 1: OpenAI upload is multipart with the decoded bytes
+    {
+        mock::Server server(openai_handler);
+        openai::OpenAI provider({ .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+        auto file = provider.upload_file(bytes, "image.png", "image/png");
+        assert(file.id == "file-abc");
+        assert(file.bytes == 20000);
+
+        auto requests = server.requests();
+        assert(requests.size() == 1);
+        assert(requests[0].method == "POST");
+        assert(requests[0].header("content-type").starts_with("multipart/form-data; boundary="));
+        assert(requests[0].header("authorization") == "Bearer sk-test");
+        const auto& body = requests[0].body;
+        assert(body.find("name=\"purpose\"\r\n\r\nvision") != std::string::npos);
+        assert(body.find("name=\"file\"; filename=\"image.png\"") != std::string::npos);
+        assert(body.find(bytes) != std::string::npos);
+    }
+    println("Test 1: openai multipart upload - PASSED");
+
+    // Test 2: the same image in every turn is uploaded once and sent to the
+    // Responses API as an input_image by id
+    {
+        mock::Server server(openai_handler);
+        AttachmentProvider provider(
+            openai::Responses({ .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4o" }));
+
+        std::vector<Message> history { screenshot_turn(encoded, "what is this?") };
+        provider.chat(history, {});
+        history.push_back(Message::assistant("ok"));
+        history.push_back(screenshot_turn(encoded, "and now?"));
+        provider.provider().reset();   // send the whole history again
+        provider.chat(history, {});
+
+        assert(provider.uploads() == 1);
+        assert(provider.cached() == 1);
+
+        auto requests = server.requests();
+        assert(requests.size() == 3);
+        assert(requests[0].path == "/v1/files");
+        assert(requests[0].body.find("name=\"purpose\"\r\n\r\nvision") != std::string::npos);
+        for (std::size_t i = 1; i < requests.size(); ++i) {
+            assert(requests[i].path == "/v1/responses");
+            assert(requests[i].body.find(R"({"file_id":"file-abc","type":"input_image"})") != std::string::npos);
+            assert(requests[i].body.find(encoded.substr(0, 64)) == std::string::npos);
+        }
+        // The caller's history is untouched
+        assert(std::get<ImageContent>(std::get<std::vector<ContentPart>>(history[0].content)[0]).data == encoded);
+    }
+    println("Test 2: upload once, reference after - PASSED");
+
+    // Test 3: Anthropic references files in image sources with the beta header
+    {
+        mock::Server server(anthropic_handler);
+        AttachmentProvider provider(anthropic::Anthropic({
+            .apiKey = "sk-ant",
+            .baseUrl = server.url("/v1"),
+            .model = "claude",
+            .customHeaders = { { "anthropic-beta", "prompt-caching-2024-07-31" } },
+        }));
+
+        std::vector<Message> history { screenshot_turn(encoded, "describe") };
+        assert(provider.attach(history) == 1);
+        auto& image = std::get<ImageContent>(std::get<std::vector<ContentPart>>(history[0].content)[0]);
+        assert(image.fileId == "file_011");
+        assert(image.data.empty());
+        provider.chat(history, {});
+
+        auto requests = server.requests();
+        assert(requests.size() == 2);
+        assert(requests[0].path == "/v1/files");
+        assert(requests[0].header("anthropic-beta").find("files-api-2025-04-14") != std::string::npos);
+        assert(requests[0].body.find(bytes) != std::string::npos);
+        assert(requests[1].path == "/v1/messages");
+        assert(requests[1].header("anthropic-beta") == "prompt-caching-2024-07-31,files-api-2025-04-14");
+        assert(requests[1].body.find("\"source\":{\"file_id\":\"file_011\",\"type\":\"file\"}") != std::string::npos);
+    }
+    println("Test 3: anthropic file source - PASSED");
+
+    // Test 4: small, URL and already-uploaded images are left alone
+    {
+        mock::Server server(openai_handler);
+        AttachmentProvider provider(
+            openai::Responses({ .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4o" }));
+        std::vector<Message> history {
+            screenshot_turn(base64("tiny"), "small"),
+            Message {
+                .role = Role::User,
+                .content = std::vector<ContentPart> {
+                    ImageContent { .data = "https://example.com/a.png", .isUrl = true },
+                    ImageContent { .mediaType = "image/png", .fileId = "file-old" },
+                },
+            },
+        };
+        assert(provider.attach(history) == 0);
+        provider.chat(history, {});
+        assert(provider.uploads() == 0);
+        assert(server.requests().size() == 1);
+    }
+    println("Test 4: small images stay inline - PASSED");
+
+    // Test 5: Chat Completions sends images inline even when they carry a
+    // file id, and rejects an image that is only a file id
+    {
+        mock::Server server(openai_handler);
+        openai::OpenAI provider({ .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+        auto turn = screenshot_turn(base64("tiny"), "look");
+        std::get<ImageContent>(std::get<std::vector<ContentPart>>(turn.content)[0]).fileId = "file-abc";
+        provider.chat({ turn }, {});
+        auto requests = server.requests();
+        assert(requests.size() == 1);
+        auto expected = R"({"image_url":{"url":"data:image/png;base64,)" + base64("tiny") + R"("},"type":"image_url"})";
+        assert(requests[0].body.find(expected) != std::string::npos);
+        assert(requests[0].body.find("file-abc") == std::string::npos);
+
+        std::vector<Message> byId {
+            Message {
+                .role = Role::User,
+                .content = std::vector<ContentPart> { ImageContent { .mediaType = "image/png", .fileId = "file-abc" } },
+            },
+        };
+        try {
+            provider.chat(byId, {});
+            assert(false);
+        } catch (const std::invalid_argument&) {}
+        assert(server.requests().size() == 1);
+    }
+    println("Test 5: chat completions keeps images inline - PASSED");
+
+    // Test 6: fileId survives conversation persistence
+    {
+        Conversation conversation;
+        Message message = screenshot_turn("", "saved");
+        std::get<ImageContent>(std::get<std::vector<ContentPart>>(message.content)[0]).fileId = "file-abc";
+        conversation.push(message);
+        auto path = std::filesystem::temp_directory_path() / "llmapi_test_files.json";
+        conversation.save(path.string());
+        auto loaded = Conversation::load(path.string());
+        std::filesystem::remove(path);
+        auto& parts = std::get<std::vector<ContentPart>>(loaded.messages[0].content);
+        assert(std::get<ImageContent>(parts[0]).fileId == "file-abc");
+    }
+    println("Test 6: persistence - PASSED");
+
+    // Test 7: the id cache is bounded and can be cleared; forgotten images
+    // are uploaded again
+    {
+        mock::Server server(openai_handler);
+        AttachmentProvider provider(
+            openai::Responses({ .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4o" }),
+            AttachmentPolicy { .maxCached = 1 });
+        auto other = base64(std::string(20000, 'x'));
+        ImageContent first { .data = encoded, .mediaType = "image/png" };
+        ImageContent second { .data = other, .mediaType = "image/png" };
+        ImageContent relabeled { .data = encoded, .mediaType = "image/jpeg" };
+
+        provider.upload(first);
+        provider.upload(first);
+        assert(provider.uploads() == 1);
+        provider.upload(second);
+        assert(provider.uploads() == 2 && provider.cached() == 1);
+        provider.upload(first);   // evicted by second
+        assert(provider.uploads() == 3);
+        provider.upload(relabeled);   // same bytes, different media type
+        assert(provider.uploads() == 4);
+
+        provider.clear();
+        assert(provider.cached() == 0);
+        provider.upload(relabeled);
+        assert(provider.uploads() == 5);
+        auto uploads = server.requests();
+        assert(uploads.back().body.find("filename=\"image-") != std::string::npos);
+        assert(uploads.back().body.find(".jpeg\"") != std::string::npos);
+    }
+    println("Test 7: bounded id cache - PASSED");
+
+    println("test_files: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,216 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+struct DelayProvider {
+    std::string label;
+    int delayMs { 0 };
+    bool fail { false };
+    bool cancellable { false };   // wait on ChatParams::cancel instead of sleeping through it
+    std::shared_ptr<std::atomic<int>> calls { std::make_shared<std::atomic<int>>(0) };
+    std::shared_ptr<std::atomic<int>> cancelled { std::make_shared<std::atomic<int>>(0) };
+    std::shared_ptr<std::atomic<int>> active { std::make_shared<std::atomic<int>>(0) };
+    std::shared_ptr<std::atomic<bool>> overlapped { std::make_shared<std::atomic<bool>>(false) };
+
+    std::string_view name() const { return "delay"; }
+
+    ChatResponse chat(const std::vector<Message>&, const ChatParams& params) {
+        (*calls)++;
+        if ((*active)++ > 0) *overlapped = true;
+        bool slept = true;
+        if (cancellable) {
+            slept = params.cancel.sleep_for(std::chrono::milliseconds(delayMs));
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        }
+        (*active)--;
+        if (!slept) {
+            (*cancelled)++;
+            params.cancel.check(label);
+        }
+        if (fail) throw ConnectionError(label + " down");
+        return ChatResponse {
+            .content = { TextContent { label } },
+            .stopReason = StopReason::EndOfTurn,
+        };
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& msgs, const ChatParams& p) {
+        co_return chat(msgs, p);
+    }
+
+    ChatResponse chat_stream(const std::vector<Message>& msgs, const ChatParams& params,
+                             std::function<void(std::string_view)> callback) {
+        auto resp = chat(msgs, params);   // delay acts as time-to-first-token
+        for (int i = 0; i < 3; ++i) {
+            callback(label);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return resp;
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& msgs, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback) {
+        co_return chat_stream(msgs, params, std::move(callback));
+    }
+};
+
+static_assert(StreamableProvider<HedgedProvider<DelayProvider>>);
+
+static HedgePolicy test_policy() {
+    return HedgePolicy {
+        .minSamples = 1000,   // stay on fallbackDelay
+        .fallbackDelay = std::chrono::milliseconds { 30 },
+        .minDelay = std::chrono::milliseconds { 1 },
+        .budgetRatio = 0.0,
+        .budgetBurst = 2.0,
+    };
+}
+
+int main() {
+    using Clock = std::chrono::steady_clock;
+    auto messages = std::vector<Message> { Message::user("hi") };
+
+    // Test 1: fast primary is never hedged
+    {
+        HedgedProvider hedged(DelayProvider { .label = "a" }, DelayProvider { .label = "b" }, test_policy());
+        auto resp = hedged.chat(messages, {});
+        assert(resp.text() == "a");
+        assert(hedged.stats().hedges == 0);
+    }
+
+    // Test 2: slow primary is hedged and the duplicate wins
+    {
+        HedgedProvider hedged(DelayProvider { .label = "slow", .delayMs = 400 },
+                              DelayProvider { .label = "fast", .delayMs = 5 }, test_policy());
+        auto start = Clock::now();
+        auto resp = hedged.chat(messages, {});
+        assert(resp.text() == "fast");
+        assert(Clock::now() - start < std::chrono::milliseconds { 300 });
+        assert(hedged.stats().hedges == 1);
+        assert(hedged.stats().hedgeWins == 1);
+        assert(hedged.latency().count() >= 1);
+    }
+
+    // Test 3: TTFT hedging for streams; only the winner reaches the callback
+    {
+        HedgedProvider hedged(DelayProvider { .label = "slow", .delayMs = 400 },
+                              DelayProvider { .label = "fast", .delayMs = 5 }, test_policy());
+        std::string streamed;
+        auto start = Clock::now();
+        auto resp = hedged.chat_stream(messages, {}, [&](std::string_view chunk) { streamed += chunk; });
+        assert(Clock::now() - start < std::chrono::milliseconds { 300 });
+        assert(streamed == "fastfastfast");
+        assert(resp.text() == "fast");
+        assert(hedged.ttft().count() >= 1);
+    }
+
+    // Test 4: the budget caps extra load
+    {
+        auto policy = test_policy();
+        policy.budgetBurst = 1.0;
+        HedgedProvider hedged(DelayProvider { .label = "slow", .delayMs = 80 },
+                              DelayProvider { .label = "slow2", .delayMs = 80 }, policy);
+        hedged.chat(messages, {});
+        hedged.chat(messages, {});
+        hedged.chat(messages, {});
+        assert(hedged.stats().hedges == 1);
+        assert(hedged.stats().requests == 3);
+    }
+
+    // Test 5: a failing primary is reported when no hedge was sent
+    {
+        HedgedProvider hedged(DelayProvider { .label = "a", .fail = true },
+                              DelayProvider { .label = "b" }, test_policy());
+        try {
+            hedged.chat(messages, {});
+            assert(false);
+        } catch (const ConnectionError& e) {
+            assert(std::string(e.what()) == "a down");
+        }
+        assert(hedged.stats().hedges == 0);
+    }
+
+    // Test 6: a loser winding down does not hold up the next call, and
+    // concurrent callers never share a replica
+    {
+        HedgedProvider hedged(DelayProvider { .label = "slow", .delayMs = 400 },
+                              DelayProvider { .label = "fast", .delayMs = 5 }, test_policy());
+        assert(hedged.chat(messages, {}).text() == "fast");
+        auto start = Clock::now();
+        assert(hedged.chat(messages, {}).text() == "fast");   // slow replica is still busy
+        assert(Clock::now() - start < std::chrono::milliseconds { 300 });
+
+        DelayProvider a { .label = "a", .delayMs = 20 };
+        DelayProvider b { .label = "b", .delayMs = 20 };
+        auto aOverlapped = a.overlapped;
+        auto bOverlapped = b.overlapped;
+        HedgedProvider shared(std::move(a), std::move(b), test_policy());
+        std::vector<std::jthread> callers;
+        for (int t = 0; t < 4; ++t) {
+            callers.emplace_back([&] {
+                for (int i = 0; i < 5; ++i) shared.chat(messages, {});
+            });
+        }
+        callers.clear();
+        assert(!*aOverlapped && !*bOverlapped);
+        assert(shared.stats().requests == 20);
+    }
+
+    // Test 7: losers, caller stops and deadlines reach the replicas through
+    // ChatParams::cancel. Replicas would otherwise sleep for 5 s, and leaving
+    // each scope waits for them.
+    {
+        DelayProvider slow { .label = "slow", .delayMs = 5000, .cancellable = true };
+        auto slowCancelled = slow.cancelled;
+        {
+            HedgedProvider hedged(std::move(slow), DelayProvider { .label = "fast", .delayMs = 5 }, test_policy());
+            assert(hedged.chat(messages, {}).text() == "fast");
+        }
+        assert(*slowCancelled == 1);
+
+        DelayProvider a { .label = "a", .delayMs = 5000, .cancellable = true };
+        DelayProvider b { .label = "b", .delayMs = 5000, .cancellable = true };
+        auto calls = std::array { a.calls, b.calls };
+        auto cancelled = std::array { a.cancelled, b.cancelled };
+        {
+            HedgedProvider hedged(std::move(a), std::move(b), test_policy());
+            std::stop_source stop;
+            std::jthread stopper([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds { 100 });
+                stop.request_stop();
+            });
+            try {
+                hedged.chat_stream(messages, { .cancel = { stop.get_token() } }, [](std::string_view) {});
+                assert(false);
+            } catch (const CancelledError& e) {
+                assert(!e.deadlineExceeded);
+            }
+
+            try {
+                hedged.chat(messages, { .cancel = Cancellation::after(std::chrono::milliseconds { 100 }) });
+                assert(false);
+            } catch (const CancelledError& e) {
+                assert(e.deadlineExceeded);
+            }
+        }
+        assert(*calls[0] + *calls[1] >= 2);
+        assert(*cancelled[0] == *calls[0] && *cancelled[1] == *calls[1]);
+    }
+
+    // Test 8: histogram percentiles
+    LatencyHistogram histogram;
+    for (int i = 1; i <= 100; ++i) histogram.record(std::chrono::milliseconds { i });
+    auto p50 = histogram.percentile(0.5).value();
+    auto p99 = histogram.percentile(0.99).value();
+    assert(p50 >= std::chrono::milliseconds { 40 } && p50 <= std::chrono::milliseconds { 65 });
+    assert(p99 >= std::chrono::milliseconds { 99 } && p99 <= std::chrono::milliseconds { 130 });
+    assert(!histogram.percentile(0.5, 1000).has_value());
+
+    println("test_hedging: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.tinyhttps;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+namespace tinyhttps = mcpplibs::tinyhttps;
+
+mock::Response handler(const mock::Request&) {
+    return mock::Response { .body = R"({"id":"c1","model":"gpt-4o","choices":[{"index":0,"message":{"role":"assistant","content":"pooled"},"finish_reason":"stop"}],"usage":{"prompt_tokens":3,"completion_tokens":1}})" };
+}
+
+int main() {
+    tinyhttps::HttpClientConfig proxied { .proxy = "http://proxy.internal:3128", .keepAlive = true };
+    tinyhttps::HttpClientConfig direct { .keepAlive = true };
+
+    // Test 1: clients are reused per (proxy, origin)
+    {
+        HttpClientPool pool;
+        tinyhttps::HttpClient* first;
+        {
+            auto lease = pool.acquire(proxied, "https://api.openai.com/v1/chat/completions");
+            first = &lease.client();
+        }
+        {
+            auto lease = pool.acquire(proxied, "https://api.openai.com/v1/embeddings");
+            assert(&lease.client() == first);
+            // Held: a concurrent request needs a client of its own
+            auto other = pool.acquire(proxied, "https://api.openai.com/v1/models");
+            assert(&other.client() != first);
+        }
+        {
+            auto a = pool.acquire(direct, "https://api.openai.com/v1/models");
+            auto b = pool.acquire(proxied, "https://api.anthropic.com/v1/messages");
+            assert(&a.client() != first && &b.client() != first);
+        }
+        auto stats = pool.stats();
+        assert(stats.created == 4);
+        assert(stats.reused == 1);
+        assert(stats.idle == 4);
+    }
+    println("Test 1: reuse per key - PASSED");
+
+    // Test 2: failed, idle-expired and surplus clients are not reused
+    {
+        HttpClientPool pool({ .maxIdlePerKey = 2 });
+        {
+            auto lease = pool.acquire(proxied, "https://api.openai.com/v1");
+            lease.discard();
+        }
+        assert(pool.stats().discarded == 1);
+        assert(pool.stats().idle == 0);
+
+        {
+            auto a = pool.acquire(proxied, "https://api.openai.com/v1");
+            auto b = pool.acquire(proxied, "https://api.openai.com/v1");
+            auto c = pool.acquire(proxied, "https://api.openai.com/v1");
+        }
+        assert(pool.stats().idle == 2);
+
+        pool.set_options({ .idleTimeout = std::chrono::milliseconds { 0 } });
+        { auto lease = pool.acquire(proxied, "https://api.openai.com/v1"); }
+        auto stats = pool.stats();
+        assert(stats.expired == 2);
+        assert(stats.created == 5);
+
+        pool.prune();
+        assert(pool.stats().idle == 0);
+        assert(pool.stats().expired == 3);
+
+        pool.set_options({});
+        { auto lease = pool.acquire(direct, "https://api.openai.com/v1"); }
+        pool.clear();
+        assert(pool.stats().idle == 0);
+    }
+    println("Test 2: idle and age limits - PASSED");
+
+    // Test 3: provider instances share pooled connections
+    {
+        mock::Server server(handler);
+        auto before = HttpClientPool::shared().stats();
+        for (int i = 0; i < 3; ++i) {
+            // compression = false keeps this origin on tinyhttps, like a proxied one
+            openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o",
+                                      .compression = false });
+            assert(provider.chat({ Message::user("hi") }, {}).text() == "pooled");
+        }
+        auto after = HttpClientPool::shared().stats();
+        assert(after.created == before.created + 1);
+        assert(after.reused == before.reused + 2);
+        assert(server.requests().size() == 3);
+        HttpClientPool::shared().clear();
+    }
+    println("Test 3: shared across providers - PASSED");
+
+    println("test_http_pool: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+Json entry(const std::string& token, double logprob, std::vector<std::pair<std::string, double>> top) {
+    Json alternatives = Json::array();
+    for (const auto& [t, lp] : top) {
+        alternatives.push_back(Json{{"token", t}, {"logprob", lp}, {"bytes", Json::array({1, 2})}});
+    }
+    return Json{{"token", token}, {"logprob", logprob}, {"bytes", Json::array({104, 105})}, {"top_logprobs", alternatives}};
+}
+
+mock::Response handler(const mock::Request& request) {
+    auto body = Json::parse(request.body);
+    if (body.value("stream", false)) {
+        auto chunk = [](const Json& choice) {
+            return "data: " + Json{{"id", "c"}, {"model", "gpt-4o"}, {"choices", Json::array({choice})}}.dump() + "\n\n";
+        };
+        return mock::Response {
+            .headers = { { "Content-Type", "text/event-stream" } },
+            .chunks = {
+                chunk(Json{{"index", 0}, {"delta", Json{{"content", "Yes"}}},
+                           {"logprobs", Json{{"content", Json::array({entry("Yes", -0.01, {{"Yes", -0.01}, {"No", -4.6}})})}}}}),
+                chunk(Json{{"index", 0}, {"delta", Json{{"content", "."}}},
+                           {"logprobs", Json{{"content", Json::array({entry(".", -0.5, {{".", -0.5}, {"!", -1.0}})})}}}}),
+                chunk(Json{{"index", 0}, {"delta", Json::object()}, {"logprobs", nullptr}, {"finish_reason", "stop"}}),
+                "data: [DONE]\n\n",
+            },
+        };
+    }
+    Json choices = Json::array();
+    choices.push_back(Json{
+        {"index", 0},
+        {"message", Json{{"role", "assistant"}, {"content", "Hi there"}}},
+        {"logprobs", Json{{"content", Json::array({
+            entry("Hi", -0.25, {{"Hi", -0.25}, {"Hello", -1.5}}),
+            entry(" there", -0.75, {{" there", -0.75}, {"!", -2.0}}),
+        })}, {"refusal", nullptr}}},
+        {"finish_reason", "stop"},
+    });
+    choices.push_back(Json{
+        {"index", 1},
+        {"message", Json{{"role", "assistant"}, {"content", "Hey"}}},
+        {"logprobs", Json{{"content", Json::array({entry("Hey", -1.25, {})})}}},
+        {"finish_reason", "stop"},
+    });
+    return mock::Response { .body = Json{
+        {"id", "c"},
+        {"model", "gpt-4o"},
+        {"choices", choices},
+        {"usage", Json{{"prompt_tokens", 4}, {"completion_tokens", 3}}},
+    }.dump() };
+}
+
+int main() {
+    // Test 1: struct-of-arrays layout
+    {
+        Logprobs lp;
+        lp.add_token("a", -0.5f);
+        lp.add_alternative("a", -0.5f);
+        lp.add_alternative("b", -1.0f);
+        lp.add_token("c", -0.25f);
+        assert(lp.size() == 2);
+        assert(lp.token(0) == "a" && lp.token(1) == "c");
+        assert(lp.alternatives(0) == 2 && lp.alternatives(1) == 0);
+        assert(lp.alternative(0, 1) == "b");
+        assert(lp.alternative_logprob(0, 1) == -1.0f);
+        assert(lp.sum() == -0.75);
+        assert(lp.pool == "aabc");
+    }
+    println("Test 1: Logprobs layout - PASSED");
+
+    mock::Server server(handler);
+    openai::OpenAI provider({ .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+    std::vector<Message> messages { Message::user("greet") };
+
+    // Test 2: non-streaming, per choice
+    {
+        auto responses = provider.chat_n(messages, ChatParams { .logprobs = 2 }, 2);
+        auto request = Json::parse(server.requests().back().body);
+        assert(request["logprobs"] == true);
+        assert(request["top_logprobs"] == 2);
+
+        assert(responses[0].text() == "Hi there");
+        const auto& lp = *responses[0].logprobs;
+        assert(lp.size() == 2);
+        assert(lp.token(0) == "Hi" && lp.token(1) == " there");
+        assert(lp.logprob(1) == -0.75f);
+        assert(lp.alternatives(0) == 2);
+        assert(lp.alternative(0, 1) == "Hello");
+        assert(lp.alternative_logprob(1, 1) == -2.0f);
+
+        assert(responses[1].logprobs->size() == 1);
+        assert(responses[1].logprobs->token(0) == "Hey");
+        assert(responses[1].logprobs->alternatives(0) == 0);
+        assert(responses[1].usage.outputTokens == 3);
+    }
+    println("Test 2: non-streaming logprobs - PASSED");
+
+    // Test 3: streaming chunks accumulate into one Logprobs
+    {
+        std::string streamed;
+        auto response = provider.chat_stream(messages, ChatParams { .logprobs = 0 },
+                                             [&](std::string_view t) { streamed += t; });
+        auto request = Json::parse(server.requests().back().body);
+        assert(request["logprobs"] == true);
+        assert(!request.contains("top_logprobs"));
+        assert(streamed == "Yes.");
+        assert(response.stopReason == StopReason::EndOfTurn);
+        const auto& lp = *response.logprobs;
+        assert(lp.size() == 2);
+        assert(lp.token(0) == "Yes" && lp.token(1) == ".");
+        assert(lp.alternative(0, 1) == "No");
+        assert(std::abs(lp.sum() - (-0.51)) < 1e-6);
+    }
+    println("Test 3: streaming logprobs - PASSED");
+
+    // Test 4: not requested, not parsed
+    {
+        auto response = provider.chat(messages, {});
+        assert(!Json::parse(server.requests().back().body).contains("logprobs"));
+        assert(!response.logprobs);
+        assert(response.text() == "Hi there");
+    }
+    println("Test 4: logprobs off - PASSED");
+
+    println("test_logprobs: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,162 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+struct FakeConfig {
+    std::string apiKey;
+    std::string organization;
+    std::string model;
+};
+
+// Per-key behaviour shared by every provider built from the same registry
+struct Registry {
+    std::map<std::string, int> calls;
+    std::map<std::string, std::string> organizations;
+    std::set<std::string> throttled;   // keys answering 429
+    std::map<std::string, RateLimitStatus> remote;
+};
+
+inline std::shared_ptr<Registry> registry = std::make_shared<Registry>();
+
+struct FakeProvider {
+    using ConfigType = FakeConfig;
+
+    FakeConfig config;
+    std::optional<RateLimitStatus> status;
+
+    explicit FakeProvider(FakeConfig c) : config(std::move(c)) {
+        registry->organizations[config.apiKey] = config.organization;
+    }
+
+    std::string_view name() const { return "fake"; }
+
+    ChatResponse chat(const std::vector<Message>&, const ChatParams&) {
+        registry->calls[config.apiKey]++;
+        if (registry->throttled.contains(config.apiKey)) {
+            throw ApiError(429, "rate_limit_error", "{}", "slow down", std::chrono::milliseconds { 80 });
+        }
+        if (auto it = registry->remote.find(config.apiKey); it != registry->remote.end()) {
+            status = it->second;
+            status->observedAt = std::chrono::steady_clock::now();
+        }
+        return ChatResponse {
+            .content = { TextContent { config.apiKey } },
+            .stopReason = StopReason::EndOfTurn,
+            .usage = Usage { .inputTokens = 60, .outputTokens = 40, .totalTokens = 100 },
+        };
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& msgs, const ChatParams& p) {
+        co_return chat(msgs, p);
+    }
+
+    const std::optional<RateLimitStatus>& rate_limit() const { return status; }
+};
+
+static_assert(Provider<MultiKeyProvider<FakeProvider>>);
+static_assert(Provider<MultiKeyProvider<openai::OpenAI>>);
+static_assert(StreamableProvider<MultiKeyProvider<openai::OpenAI>>);
+static_assert(EmbeddableProvider<MultiKeyProvider<openai::OpenAI>>);
+static_assert(StreamableProvider<MultiKeyProvider<anthropic::Anthropic>>);
+
+int main() {
+    std::vector<Message> messages { Message::user("hi") };
+    auto reset = [] { registry = std::make_shared<Registry>(); };
+
+    // Test 1: config per key, organization override
+    {
+        MultiKeyProvider<FakeProvider> provider(
+            FakeConfig { .organization = "org-base", .model = "m" },
+            { ApiKey { .key = "key-a1" }, ApiKey { .key = "key-b2", .organization = "org-b" } });
+        assert(provider.size() == 2);
+        assert(registry->organizations["key-a1"] == "org-base");
+        assert(registry->organizations["key-b2"] == "org-b");
+        auto keys = provider.keys();
+        assert(keys[0].name == "...y-a1");
+        assert(keys[0].headroom == 1.0 && !keys[0].quarantined);
+    }
+    println("Test 1: per-key providers - PASSED");
+
+    // Test 2: weights spread traffic
+    reset();
+    {
+        MultiKeyProvider<FakeProvider> provider(
+            FakeConfig {},
+            { ApiKey { .key = "heavy", .weight = 3.0 }, ApiKey { .key = "light", .weight = 1.0 } });
+        for (int i = 0; i < 200; ++i) provider.chat(messages, ChatParams {});
+        assert(registry->calls["heavy"] > registry->calls["light"]);
+        assert(registry->calls["light"] > 10);
+    }
+    println("Test 2: weighted spread - PASSED");
+
+    // Test 3: local per-minute limits cap a key; exhausted set throws 429
+    reset();
+    {
+        MultiKeyProvider<FakeProvider> provider(
+            FakeConfig {},
+            { ApiKey { .key = "rpm3", .requestsPerMinute = 3 }, ApiKey { .key = "tpm5", .tokensPerMinute = 500 } });
+        for (int i = 0; i < 8; ++i) provider.chat(messages, ChatParams {});
+        assert(registry->calls["rpm3"] == 3);
+        assert(registry->calls["tpm5"] == 5);
+        try {
+            provider.chat(messages, ChatParams {});
+            assert(false);
+        } catch (const ApiError& e) {
+            assert(e.statusCode == 429);
+            assert(e.retryable());
+            assert(e.retryAfter.has_value());
+        }
+        assert(provider.keys()[1].tokensInWindow == 500);
+    }
+    println("Test 3: local limits - PASSED");
+
+    // Test 4: throttled key is quarantined and the request moves on
+    reset();
+    {
+        registry->throttled.insert("bad");
+        MultiKeyProvider<FakeProvider> provider(FakeConfig {}, { ApiKey { .key = "bad" }, ApiKey { .key = "good" } });
+        for (int i = 0; i < 20; ++i) {
+            auto response = provider.chat(messages, ChatParams {});
+            assert(response.text() == "good");
+        }
+        assert(registry->calls["bad"] == 1);
+        auto keys = provider.keys();
+        assert(keys[0].quarantined && keys[0].throttled == 1);
+
+        // Quarantine expires after Retry-After
+        registry->throttled.clear();
+        std::this_thread::sleep_for(std::chrono::milliseconds { 100 });
+        assert(!provider.keys()[0].quarantined);
+        for (int i = 0; i < 40; ++i) provider.chat(messages, ChatParams {});
+        assert(registry->calls["bad"] > 1);
+    }
+    println("Test 4: quarantine on 429 - PASSED");
+
+    // Test 5: remote rate-limit headers reduce headroom
+    reset();
+    {
+        registry->remote["drained"] = RateLimitStatus { .limitRequests = 100, .remainingRequests = 0 };
+        MultiKeyProvider<FakeProvider> provider(FakeConfig {}, { ApiKey { .key = "drained" }, ApiKey { .key = "fresh" } });
+        for (int i = 0; i < 30; ++i) provider.chat(messages, ChatParams {});
+        assert(registry->calls["drained"] <= 2);
+        assert(provider.keys()[0].headroom == 0.0);
+    }
+    println("Test 5: remote headroom - PASSED");
+
+    // Test 6: headroom of a reported status
+    {
+        RateLimitStatus status { .limitRequests = 100, .remainingRequests = 50,
+                                 .limitTokens = 1000, .remainingTokens = 100 };
+        assert(status.headroom().has_value());
+        assert(*status.headroom() == 0.1);
+        assert(!RateLimitStatus {}.headroom().has_value());
+    }
+    println("Test 6: RateLimitStatus - PASSED");
+
+    println("test_multi_key: ALL PASSED");
+    return 0;
+}
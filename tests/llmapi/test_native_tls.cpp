@@ -0,0 +1,136 @@
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import mcpplibs.tinyhttps;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+// Round trips over real TLS (httpbin.org, like tinyhttps' test_tls). Short
+// idle timeouts turn a read that waits on an already-decrypted record into
+// a TimeoutError instead of a slow pass.
+tinyhttps::HttpRequest request(tinyhttps::Method method, std::string url) {
+    tinyhttps::HttpRequest req;
+    req.method = method;
+    req.url = std::move(url);
+    return req;
+}
+
+tinyhttps::HttpRequest get(std::string url) {
+    return request(tinyhttps::Method::GET, std::move(url));
+}
+
+int main() {
+    tinyhttps::Socket::platform_init();
+    Timeouts timeouts {
+        .connect = std::chrono::seconds(10),
+        .firstByte = std::chrono::seconds(20),
+        .streamIdle = std::chrono::seconds(5),
+    };
+
+    // Test 1: https stays on tinyhttps unless nativeTls is set
+    {
+        HttpTransport transport(tinyhttps::HttpClientConfig { .keepAlive = true }, true, timeouts);
+        auto response = transport.send(get("https://httpbin.org/get"));
+        assert(response.ok());
+        assert(transport.stats().responses == 0);
+    }
+    println("Test 1: tinyhttps by default - PASSED");
+
+    HttpTransport transport(tinyhttps::HttpClientConfig { .keepAlive = true }, true, timeouts, true);
+
+    // Test 2: compressed response decoded over TLS
+    {
+        auto response = transport.send(get("https://httpbin.org/gzip"));
+        assert(response.ok());
+        assert(Json::parse(response.body)["gzipped"] == true);
+        assert(transport.stats().compressed == 1);
+    }
+    println("Test 2: gzip over TLS - PASSED");
+
+    // Test 3: bodies spanning many TLS records, sized and chunked, on the
+    // kept-alive connection
+    {
+        auto sized = transport.send(get("https://httpbin.org/bytes/100000"));
+        assert(sized.ok());
+        assert(sized.body.size() == 100000);
+
+        std::uint64_t received = 0;
+        int pieces = 0;
+        auto chunked = transport.send_download(get("https://httpbin.org/stream-bytes/100000?chunk_size=7000"),
+                                               [&](std::string_view data) {
+            received += data.size();
+            pieces++;
+            return true;
+        });
+        assert(chunked.ok());
+        assert(received == 100000);
+        assert(pieces > 1);
+    }
+    println("Test 3: multi-record bodies - PASSED");
+
+    // Test 4: chunk-encoded upload over TLS
+    {
+        auto post = request(tinyhttps::Method::POST, "https://httpbin.org/post");
+        post.headers["Content-Type"] = "text/plain";
+        auto response = transport.send(post, [](BodySink& sink) {
+            for (int i = 0; i < 50; ++i) sink.write(std::string(4000, static_cast<char>('a' + i % 26)));
+        });
+        assert(response.ok());
+        auto echoed = Json::parse(response.body)["data"].get<std::string>();
+        assert(echoed.size() == 200000);
+        assert(echoed.starts_with("aaaa") && echoed.ends_with(std::string(4000, 'x')));
+    }
+    println("Test 4: streamed upload - PASSED");
+
+    // Test 5: the default https path still reports a timed-out read by phase
+    {
+        HttpTransport fallback(tinyhttps::HttpClientConfig { .keepAlive = true }, true, Timeouts {
+            .connect = std::chrono::seconds(10),
+            .firstByte = std::chrono::seconds(2),
+        });
+        std::optional<TimeoutPhase> phase;
+        try {
+            fallback.send(get("https://httpbin.org/delay/5"));
+        } catch (const TimeoutError& e) {
+            phase = e.phase;
+        }
+        assert(phase == TimeoutPhase::FirstByte);
+    }
+    println("Test 5: timeouts on tinyhttps - PASSED");
+
+    // Test 6: cancellation on the default https path is seen before the
+    // request and once the uninterruptible call returns
+    {
+        HttpTransport fallback(tinyhttps::HttpClientConfig { .keepAlive = true }, true, timeouts);
+        std::stop_source stop;
+        stop.request_stop();
+        Cancellation stopped { .token = stop.get_token() };
+        bool cancelled = false;
+        try {
+            CancelScope scope { stopped };
+            fallback.send(get("https://httpbin.org/delay/5"));
+        } catch (const CancelledError& e) {
+            cancelled = !e.deadlineExceeded;
+        }
+        assert(cancelled);
+
+        auto deadline = Cancellation::after(std::chrono::seconds(1));
+        bool expired = false;
+        try {
+            CancelScope scope { deadline };
+            fallback.send(get("https://httpbin.org/delay/2"));
+        } catch (const CancelledError& e) {
+            expired = e.deadlineExceeded;
+        }
+        assert(expired);
+    }
+    println("Test 6: cancellation on tinyhttps - PASSED");
+
+    tinyhttps::Socket::platform_cleanup();
+    println("test_native_tls: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,310 @@
+#include "mock_websocket.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+// Scripted realtime session: echoes the last user message, streamed as
+// deltas, answers "tool" with a function call and never answers "hang".
+struct Upstream {
+    std::mutex mutex;
+    std::vector<Json> events;
+    std::vector<mock::Request> upgrades;
+    int pongs { 0 };
+    bool unmasked { false };
+    std::atomic<int> ended { 0 };
+
+    // Sessions end on the server thread once the client's close arrives
+    void wait_ended(int count) {
+        while (ended < count) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<Json> of_type(const std::string& type) {
+        std::lock_guard lock { mutex };
+        std::vector<Json> out;
+        for (const auto& e : events) {
+            if (e["type"] == type) out.push_back(e);
+        }
+        return out;
+    }
+
+    void session(mock::WebSocket& ws) {
+        {
+            std::lock_guard lock { mutex };
+            upgrades.push_back(ws.request);
+        }
+        ws.send(Json{{"type", "session.created"}, {"session", Json{{"id", "sess_1"}}}}.dump());
+        std::string lastUser;
+        int responses = 0;
+        while (auto message = ws.receive()) {
+            auto event = Json::parse(*message);
+            {
+                std::lock_guard lock { mutex };
+                events.push_back(event);
+            }
+            auto type = event.value("type", "");
+            if (type == "conversation.item.create" && event["item"].value("role", "") == "user") {
+                lastUser = event["item"]["content"][0]["text"];
+                if (lastUser == "bad") {
+                    ws.send(Json{{"type", "error"}, {"error", Json{
+                        {"type", "invalid_request_error"}, {"code", "bad_item"}, {"message", "rejected"}}}}.dump());
+                }
+            } else if (type == "response.create") {
+                if (lastUser == "hang") continue;
+                auto id = "resp_" + std::to_string(++responses);
+                Json output;
+                if (lastUser == "tool") {
+                    output = Json::array({Json{{"type", "function_call"}, {"call_id", "call_1"},
+                                               {"name", "lookup"}, {"arguments", "{\"q\":1}"}}});
+                } else {
+                    auto reply = "echo " + lastUser;
+                    ws.ping("keepalive");
+                    ws.send(Json{{"type", "response.created"}, {"response", Json{{"id", id}}}}.dump());
+                    ws.send(Json{{"type", "response.text.delta"}, {"delta", reply.substr(0, 5)}}.dump());
+                    ws.send_fragmented(Json{{"type", "response.text.delta"}, {"delta", reply.substr(5)}}.dump(), 3);
+                    output = Json::array({Json{{"type", "message"}, {"role", "assistant"},
+                                               {"content", Json::array({Json{{"type", "text"}, {"text", reply}}})}}});
+                }
+                ws.send(Json{{"type", "response.done"}, {"response", Json{
+                    {"id", id},
+                    {"status", "completed"},
+                    {"output", output},
+                    {"usage", Json{{"input_tokens", 10}, {"output_tokens", 2},
+                                   {"input_token_details", Json{{"cached_tokens", 8}}}}},
+                }}}.dump());
+            }
+        }
+        std::lock_guard lock { mutex };
+        pongs += ws.pongs;
+        unmasked = unmasked || ws.unmasked;
+        ended++;
+    }
+};
+
+openai::Config config(const mock::WebSocketServer& server) {
+    return openai::Config { .apiKey = "sk-test", .baseUrl = server.http_url("/v1"), .model = "gpt-realtime" };
+}
+
+int main() {
+    static_assert(StreamableProvider<openai::Realtime>);
+
+    // Test 1: first turn opens the session and sends everything
+    {
+        Upstream upstream;
+        mock::WebSocketServer server([&](mock::WebSocket& ws) { upstream.session(ws); });
+        openai::Realtime provider(config(server));
+        assert(provider.url() == server.url("/v1/realtime?model=gpt-realtime"));
+
+        auto response = provider.chat({ Message::system("be brief"), Message::user("one") }, {});
+        assert(response.text() == "echo one");
+        assert(response.id == "resp_1");
+        assert(response.stopReason == StopReason::EndOfTurn);
+        assert(response.usage.inputTokens == 10 && response.usage.cacheReadTokens == 8);
+        assert(provider.connected());
+
+        provider.reset();
+        assert(!provider.connected());
+        upstream.wait_ended(1);
+        assert(upstream.upgrades.size() == 1);
+        assert(upstream.upgrades[0].path == "/v1/realtime?model=gpt-realtime");
+        assert(upstream.upgrades[0].header("authorization") == "Bearer sk-test");
+        assert(upstream.upgrades[0].header("openai-beta") == "realtime=v1");
+        auto sessions = upstream.of_type("session.update");
+        assert(sessions.size() == 1);
+        assert(sessions[0]["session"]["instructions"] == "be brief");
+        assert(upstream.of_type("conversation.item.create").size() == 1);
+        assert(upstream.of_type("response.create").size() == 1);
+        assert(upstream.pongs == 1);
+        assert(!upstream.unmasked);
+    }
+    println("Test 1: first turn - PASSED");
+
+    // Test 2: later turns send only the new items over the same socket
+    {
+        Upstream upstream;
+        mock::WebSocketServer server([&](mock::WebSocket& ws) { upstream.session(ws); });
+        auto client = Client(openai::Realtime(config(server)));
+        client.system("be brief");
+        client.chat("one");
+        std::string streamed;
+        auto response = client.chat_stream("two", [&](std::string_view chunk) { streamed += chunk; });
+        assert(streamed == "echo two");
+        assert(response.text() == "echo two");
+        client.chat("three");
+
+        assert(server.connections() == 1);
+        assert(upstream.of_type("session.update").size() == 1);
+        auto items = upstream.of_type("conversation.item.create");
+        assert(items.size() == 3);
+        assert(items[2]["item"]["content"][0]["text"] == "three");
+        assert(client.provider().stats().turns == 3);
+        assert(client.provider().stats().continued == 2);
+        assert(client.provider().stats().connects == 1);
+    }
+    println("Test 2: incremental turns - PASSED");
+
+    // Test 3: a diverged history starts a new session and replays it
+    {
+        Upstream upstream;
+        mock::WebSocketServer server([&](mock::WebSocket& ws) { upstream.session(ws); });
+        openai::Realtime provider(config(server));
+        std::vector<Message> history { Message::user("one") };
+        auto reply = provider.chat(history, {});
+        history.push_back(Message::assistant("edited " + reply.text()));
+        history.push_back(Message::user("two"));
+        assert(provider.chat(history, {}).text() == "echo two");
+        provider.reset();
+
+        assert(server.connections() == 2);
+        auto items = upstream.of_type("conversation.item.create");
+        assert(items.size() == 4);
+        assert(items[2]["item"]["role"] == "assistant");
+        assert(items[2]["item"]["content"][0]["type"] == "text");
+        assert(items[2]["item"]["content"][0]["text"] == "edited echo one");
+    }
+    println("Test 3: diverged history - PASSED");
+
+    // Test 4: tool calls and results
+    {
+        Upstream upstream;
+        mock::WebSocketServer server([&](mock::WebSocket& ws) { upstream.session(ws); });
+        auto client = Client(openai::Realtime(config(server)));
+        auto response = client.chat("tool", ChatParams {
+            .tools = std::vector<ToolDef> { { .name = "lookup", .description = "find", .inputSchema = R"({"type":"object"})" } },
+        });
+        assert(response.stopReason == StopReason::ToolUse);
+        assert(response.tool_calls().size() == 1);
+        assert(response.tool_calls()[0].name == "lookup");
+
+        client.add_message(Message {
+            .role = Role::Tool,
+            .content = std::vector<ContentPart> { ToolResultContent { .toolUseId = "call_1", .content = "42" } },
+        });
+        client.chat("and?");
+        auto items = upstream.of_type("conversation.item.create");
+        assert(items.size() == 3);
+        assert(items[1]["item"]["type"] == "function_call_output");
+        assert(items[1]["item"]["output"] == "42");
+        // Tools were dropped on the second turn, so the session was updated
+        auto sessions = upstream.of_type("session.update");
+        assert(sessions.size() == 2);
+        assert(sessions[0]["session"]["tools"][0]["name"] == "lookup");
+        assert(!sessions[1]["session"].contains("tools"));
+        assert(server.connections() == 1);
+    }
+    println("Test 4: tool calls - PASSED");
+
+    // Test 5: error events and refused upgrades
+    {
+        Upstream upstream;
+        mock::WebSocketServer server([&](mock::WebSocket& ws) { upstream.session(ws); });
+        openai::Realtime provider(config(server));
+        bool threw = false;
+        try {
+            provider.chat({ Message::user("bad") }, {});
+        } catch (const ApiError& e) {
+            threw = e.type == "bad_item";
+        }
+        assert(threw);
+        assert(!provider.connected());
+        assert(provider.chat({ Message::user("ok") }, {}).text() == "echo ok");
+
+        mock::WebSocketServer refusing([&](mock::WebSocket&) {});
+        refusing.refuse = mock::Response {
+            .status = 401,
+            .body = R"({"error":{"type":"invalid_request_error","code":"invalid_api_key","message":"bad key"}})",
+        };
+        openai::Realtime unauthorized(config(refusing));
+        threw = false;
+        try {
+            unauthorized.chat({ Message::user("hi") }, {});
+        } catch (const ApiError& e) {
+            threw = e.statusCode == 401 && e.type == "invalid_api_key";
+        }
+        assert(threw);
+    }
+    println("Test 5: errors - PASSED");
+
+    // Test 6: RFC 6455 handshake vector (section 1.3), and response options
+    {
+        assert(mock::detail::sha1_base64("dGhlIHNhbXBsZSBub25jZQ==258EAFA5-E914-47DA-95CA-C5AB0DC85B11") ==
+               "s3pPLMBiTxaQ9kYGJRwhPxoo+2Y=");
+
+        Upstream upstream;
+        mock::WebSocketServer server([&](mock::WebSocket& ws) { upstream.session(ws); });
+        openai::Realtime provider(config(server));
+        provider.chat({ Message::user("one") }, ChatParams { .maxTokens = 64 });
+        provider.reset();
+        upstream.wait_ended(1);
+        auto creates = upstream.of_type("response.create");
+        assert(creates.size() == 1);
+        assert(creates[0]["response"]["max_response_output_tokens"] == 64);
+        assert(!creates[0]["response"].contains("max_output_tokens"));
+    }
+    println("Test 6: handshake vector and response options - PASSED");
+
+    // Test 7: cancellation, per-phase timeouts and proxies
+    {
+        Upstream upstream;
+        mock::WebSocketServer server([&](mock::WebSocket& ws) { upstream.session(ws); });
+        openai::Realtime provider(config(server));
+        std::stop_source stop;
+        std::jthread stopper([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            stop.request_stop();
+        });
+        auto start = std::chrono::steady_clock::now();
+        bool cancelled = false;
+        try {
+            provider.chat({ Message::user("hang") }, ChatParams { .cancel = { .token = stop.get_token() } });
+        } catch (const CancelledError& e) {
+            cancelled = !e.deadlineExceeded;
+        }
+        assert(cancelled);
+        assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+        assert(!provider.connected());
+        upstream.wait_ended(1);
+
+        auto timed = config(server);
+        timed.timeouts.firstByte = std::chrono::milliseconds(100);
+        openai::Realtime impatient(timed);
+        std::optional<TimeoutPhase> phase;
+        try {
+            impatient.chat({ Message::user("hang") }, {});
+        } catch (const TimeoutError& e) {
+            phase = e.phase;
+        }
+        assert(phase == TimeoutPhase::FirstByte);
+        assert(!impatient.connected());
+
+        timed.timeouts.total = std::chrono::milliseconds(50);
+        openai::Realtime bounded(timed);
+        phase.reset();
+        try {
+            bounded.chat({ Message::user("hang") }, {});
+        } catch (const TimeoutError& e) {
+            phase = e.phase;
+        }
+        assert(phase == TimeoutPhase::Total);
+
+        auto proxied = config(server);
+        proxied.proxy = "http://127.0.0.1:3128";
+        bool rejected = false;
+        try {
+            openai::Realtime unsupported(proxied);
+        } catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+    println("Test 7: cancellation, timeouts and proxies - PASSED");
+
+    println("test_realtime: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+static_assert(StreamableProvider<openai::Responses>);
+
+// Stand-in /responses endpoint that remembers stored responses
+struct Upstream {
+    std::mutex mutex;
+    int next { 0 };
+    std::set<std::string> stored;
+    bool expireAll { false };
+
+    mock::Response handle(const mock::Request& request) {
+        auto body = Json::parse(request.body);
+        std::lock_guard lock { mutex };
+        if (expireAll) {
+            stored.clear();
+            expireAll = false;
+        }
+        if (body.contains("previous_response_id") && !stored.contains(body["previous_response_id"])) {
+            return mock::Response {
+                .status = 400,
+                .body = R"({"error":{"type":"invalid_request_error","code":"previous_response_not_found","message":"Previous response not found."}})",
+            };
+        }
+        auto id = "resp_" + std::to_string(++next);
+        stored.insert(id);
+        Json response {
+            {"id", id},
+            {"object", "response"},
+            {"model", "gpt-4.1"},
+            {"status", "completed"},
+            {"output", Json::array({Json{
+                {"type", "message"},
+                {"role", "assistant"},
+                {"content", Json::array({Json{{"type", "output_text"}, {"text", "reply " + std::to_string(next)}}})},
+            }})},
+            {"usage", Json{{"input_tokens", 100}, {"output_tokens", 5}, {"input_tokens_details", Json{{"cached_tokens", 80}}}}},
+        };
+        if (body.value("stream", false)) {
+            return mock::Response {
+                .headers = { { "Content-Type", "text/event-stream" } },
+                .chunks = {
+                    "event: response.created\ndata: " +
+                        Json{{"type", "response.created"}, {"response", Json{{"id", id}}}}.dump() + "\n\n",
+                    "event: response.output_text.delta\ndata: " +
+                        Json{{"type", "response.output_text.delta"}, {"delta", "reply "}}.dump() + "\n\n",
+                    "event: response.output_text.delta\ndata: " +
+                        Json{{"type", "response.output_text.delta"}, {"delta", std::to_string(next)}}.dump() + "\n\n",
+                    "event: response.completed\ndata: " +
+                        Json{{"type", "response.completed"}, {"response", response}}.dump() + "\n\n",
+                },
+            };
+        }
+        return mock::Response { .body = response.dump() };
+    }
+};
+
+openai::Config config(const mock::Server& server) {
+    return openai::Config { .apiKey = "sk-test", .baseUrl = server.url("/v1"), .model = "gpt-4.1" };
+}
+
+int main() {
+    // Test 1: the first turn is sent in full, later turns as deltas
+    {
+        Upstream upstream;
+        mock::Server server([&](const mock::Request& r) { return upstream.handle(r); });
+        auto client = Client(openai::Responses(config(server)));
+        client.system("You are terse.");
+
+        auto first = client.chat("hello");
+        assert(first.text() == "reply 1");
+        assert(first.usage.cacheReadTokens == 80);
+        auto second = client.chat("again");
+        assert(second.text() == "reply 2");
+        assert(client.conversation().size() == 5);
+
+        auto requests = server.requests();
+        assert(requests.size() == 2);
+        auto body0 = Json::parse(requests[0].body);
+        assert(requests[0].path == "/v1/responses");
+        assert(body0["instructions"] == "You are terse.");
+        assert(!body0.contains("previous_response_id"));
+        assert(body0["input"].size() == 1);
+
+        auto body1 = Json::parse(requests[1].body);
+        assert(body1["previous_response_id"] == "resp_1");
+        assert(body1["instructions"] == "You are terse.");
+        assert(body1["input"].size() == 1);
+        assert(body1["input"][0]["content"] == "again");
+        assert(client.provider().response_id() == "resp_2");
+    }
+    println("Test 1: delta turns - PASSED");
+
+    // Test 2: request size stays flat as the history grows
+    {
+        Upstream upstream;
+        mock::Server server([&](const mock::Request& r) { return upstream.handle(r); });
+        auto client = Client(openai::Responses(config(server)));
+        for (int i = 0; i < 20; ++i) {
+            client.chat("turn " + std::to_string(i) + " " + std::string(500, 'x'));
+        }
+        auto requests = server.requests();
+        assert(requests.back().body.size() < requests.front().body.size() + 64);
+        const auto& stats = client.provider().stats();
+        assert(stats.requests == 20);
+        assert(stats.chained == 19);
+        assert(stats.itemsSent == 20);
+    }
+    println("Test 2: O(delta) request size - PASSED");
+
+    // Test 3: an expired chain falls back to the full history
+    {
+        Upstream upstream;
+        mock::Server server([&](const mock::Request& r) { return upstream.handle(r); });
+        auto client = Client(openai::Responses(config(server)));
+        client.chat("one");
+        client.chat("two");
+        upstream.expireAll = true;
+        auto third = client.chat("three");
+        assert(third.text() == "reply 3");
+
+        auto requests = server.requests();
+        assert(requests.size() == 4);
+        assert(Json::parse(requests[2].body)["previous_response_id"] == "resp_2");
+        auto resent = Json::parse(requests[3].body);
+        assert(!resent.contains("previous_response_id"));
+        assert(resent["input"].size() == 5);
+        assert(client.provider().stats().resent == 1);
+    }
+    println("Test 3: expired chain fallback - PASSED");
+
+    // Test 4: a history that does not continue the chain is sent in full
+    {
+        Upstream upstream;
+        mock::Server server([&](const mock::Request& r) { return upstream.handle(r); });
+        openai::Responses provider(config(server));
+        std::vector<Message> history { Message::user("a") };
+        provider.chat(history, {});
+        history.push_back(Message::assistant("edited reply"));
+        history.push_back(Message::user("b"));
+        provider.chat(history, {});
+        auto body = Json::parse(server.requests()[1].body);
+        assert(!body.contains("previous_response_id"));
+        assert(body["input"].size() == 3);
+
+        provider.reset();
+        assert(!provider.response_id());
+    }
+    println("Test 4: diverged history - PASSED");
+
+    // Test 5: streaming continues the same chain; tool results become items
+    {
+        Upstream upstream;
+        mock::Server server([&](const mock::Request& r) { return upstream.handle(r); });
+        auto client = Client(openai::Responses(config(server)));
+        std::string streamed;
+        auto response = client.chat_stream("hi", [&](std::string_view chunk) { streamed += chunk; });
+        assert(streamed == "reply 1");
+        assert(response.text() == "reply 1");
+        assert(response.id == "resp_1");
+
+        client.add_message(Message {
+            .role = Role::Tool,
+            .content = std::vector<ContentPart> { ToolResultContent { .toolUseId = "call_1", .content = "42" } },
+        });
+        client.chat("and?");
+        auto body = Json::parse(server.requests()[1].body);
+        assert(body["previous_response_id"] == "resp_1");
+        assert(body["input"].size() == 2);
+        assert(body["input"][0]["type"] == "function_call_output");
+        assert(body["input"][0]["call_id"] == "call_1");
+    }
+    println("Test 5: streaming and tool outputs - PASSED");
+
+    println("test_responses: ALL PASSED");
+    return 0;
+}
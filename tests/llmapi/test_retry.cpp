@@ -0,0 +1,219 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+// Fails the first `failures` calls with the configured error, then succeeds.
+struct FlakyProvider {
+    int failures { 0 };
+    std::function<void()> fail;
+    int calls { 0 };
+    int streamChunksBeforeFailure { 0 };
+
+    std::string_view name() const { return "flaky"; }
+
+    ChatResponse chat(const std::vector<Message>&, const ChatParams&) {
+        if (calls++ < failures) fail();
+        return ChatResponse {
+            .content = { TextContent { "ok" } },
+            .stopReason = StopReason::EndOfTurn,
+        };
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& msgs, const ChatParams& p) {
+        co_return chat(msgs, p);
+    }
+
+    ChatResponse chat_stream(const std::vector<Message>& msgs, const ChatParams& params,
+                             std::function<void(std::string_view)> callback) {
+        if (calls < failures) {
+            for (int i = 0; i < streamChunksBeforeFailure; ++i) callback("x");
+        }
+        auto resp = chat(msgs, params);
+        callback(resp.text());
+        return resp;
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& msgs, const ChatParams& params,
+                                          std::function<void(std::string_view)> callback) {
+        co_return chat_stream(msgs, params, std::move(callback));
+    }
+};
+
+// Fails every other call; safe to call from several threads
+struct AlternatingProvider {
+    std::shared_ptr<std::atomic<int>> calls { std::make_shared<std::atomic<int>>(0) };
+
+    std::string_view name() const { return "alternating"; }
+
+    ChatResponse chat(const std::vector<Message>&, const ChatParams&) {
+        if ((*calls)++ % 2 == 0) throw ApiError(503, "api_error", "{}", "unavailable");
+        return ChatResponse {
+            .content = { TextContent { "ok" } },
+            .stopReason = StopReason::EndOfTurn,
+        };
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& msgs, const ChatParams& p) {
+        co_return chat(msgs, p);
+    }
+};
+
+static_assert(Provider<RetryProvider<FlakyProvider>>);
+static_assert(StreamableProvider<RetryProvider<FlakyProvider>>);
+
+static RetryPolicy fast_policy() {
+    return RetryPolicy {
+        .maxAttempts = 4,
+        .initialBackoff = std::chrono::milliseconds { 1 },
+        .maxBackoff = std::chrono::milliseconds { 5 },
+        .totalDeadline = std::chrono::milliseconds { 2000 },
+    };
+}
+
+int main() {
+    // Test 1: 429 and 529 are retried until success
+    RetryProvider rateLimited(FlakyProvider {
+        .failures = 2,
+        .fail = [] { throw ApiError(429, "rate_limit_error", "{}", "rate limited"); },
+    }, fast_policy());
+    assert(rateLimited.chat({}, {}).text() == "ok");
+    assert(rateLimited.provider().calls == 3);
+    assert(rateLimited.stats().retries == 2);
+
+    RetryProvider overloaded(FlakyProvider {
+        .failures = 1,
+        .fail = [] { throw ApiError(529, "overloaded_error", "{}", "overloaded"); },
+    }, fast_policy());
+    assert(overloaded.chat({}, {}).text() == "ok");
+
+    // Test 2: connection errors are retried
+    RetryProvider reset(FlakyProvider {
+        .failures = 1,
+        .fail = [] { throw ConnectionError("connection reset"); },
+    }, fast_policy());
+    assert(reset.chat({}, {}).text() == "ok");
+
+    // Test 3: 400 and insufficient_quota are not retried
+    RetryProvider badRequest(FlakyProvider {
+        .failures = 1,
+        .fail = [] { throw ApiError(400, "invalid_request_error", "{}", "bad request"); },
+    }, fast_policy());
+    try {
+        badRequest.chat({}, {});
+        assert(false);
+    } catch (const ApiError& e) {
+        assert(e.statusCode == 400);
+    }
+    assert(badRequest.provider().calls == 1);
+
+    RetryProvider quota(FlakyProvider {
+        .failures = 1,
+        .fail = [] { throw ApiError(429, "insufficient_quota", "{}", "quota"); },
+    }, fast_policy());
+    try {
+        quota.chat({}, {});
+        assert(false);
+    } catch (const ApiError&) {}
+    assert(quota.provider().calls == 1);
+
+    // Test 4: gives up after maxAttempts
+    RetryProvider alwaysFailing(FlakyProvider {
+        .failures = 100,
+        .fail = [] { throw ApiError(503, "api_error", "{}", "unavailable"); },
+    }, fast_policy());
+    try {
+        alwaysFailing.chat({}, {});
+        assert(false);
+    } catch (const ApiError& e) {
+        assert(e.statusCode == 503);
+    }
+    assert(alwaysFailing.provider().calls == 4);
+
+    // Test 5: Retry-After is honored
+    RetryProvider retryAfter(FlakyProvider {
+        .failures = 1,
+        .fail = [] {
+            throw ApiError(429, "rate_limit_error", "{}", "slow down", std::chrono::milliseconds { 50 });
+        },
+    }, fast_policy());
+    auto start = std::chrono::steady_clock::now();
+    retryAfter.chat({}, {});
+    assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds { 50 });
+
+    // Test 6: Retry-After beyond the total deadline fails fast
+    auto shortDeadline = fast_policy();
+    shortDeadline.totalDeadline = std::chrono::milliseconds { 100 };
+    RetryProvider tooLong(FlakyProvider {
+        .failures = 1,
+        .fail = [] {
+            throw ApiError(429, "rate_limit_error", "{}", "slow down", std::chrono::milliseconds { 5000 });
+        },
+    }, shortDeadline);
+    start = std::chrono::steady_clock::now();
+    try {
+        tooLong.chat({}, {});
+        assert(false);
+    } catch (const ApiError&) {}
+    assert(std::chrono::steady_clock::now() - start < std::chrono::milliseconds { 1000 });
+
+    // Test 7: streams retry before the first byte only
+    RetryProvider streamBeforeFirstByte(FlakyProvider {
+        .failures = 1,
+        .fail = [] { throw ConnectionError("reset"); },
+    }, fast_policy());
+    std::string streamed;
+    streamBeforeFirstByte.chat_stream({}, {}, [&](std::string_view chunk) { streamed += chunk; });
+    assert(streamed == "ok");
+
+    RetryProvider streamAfterFirstByte(FlakyProvider {
+        .failures = 1,
+        .fail = [] { throw ConnectionError("reset"); },
+        .streamChunksBeforeFailure = 1,
+    }, fast_policy());
+    try {
+        streamAfterFirstByte.chat_stream({}, {}, [](std::string_view) {});
+        assert(false);
+    } catch (const ConnectionError&) {}
+    assert(streamAfterFirstByte.provider().calls == 1);
+
+    // Test 8: retry budget caps retries across requests
+    auto budgeted = fast_policy();
+    budgeted.budgetMax = 1.0;
+    budgeted.budgetRatio = 0.0;
+    RetryProvider limited(FlakyProvider {
+        .failures = 100,
+        .fail = [] { throw ApiError(500, "api_error", "{}", "boom"); },
+    }, budgeted);
+    try { limited.chat({}, {}); } catch (const ApiError&) {}
+    assert(limited.provider().calls == 2);
+    assert(limited.stats().budgetExhausted == 1);
+
+    // Test 9: classification helper
+    assert(classify_failure(std::make_exception_ptr(ApiError(502, "", "", "bad gateway"))).retryable);
+    assert(!classify_failure(std::make_exception_ptr(std::runtime_error("other"))).retryable);
+
+    // Test 10: concurrent callers share the backoff and the stats
+    {
+        auto shared = fast_policy();
+        shared.budgetMax = 1000.0;
+        shared.maxAttempts = 100;
+        RetryProvider concurrent(AlternatingProvider {}, shared);
+        std::vector<std::jthread> callers;
+        for (int t = 0; t < 8; ++t) {
+            callers.emplace_back([&] {
+                for (int i = 0; i < 25; ++i) assert(concurrent.chat({}, {}).text() == "ok");
+            });
+        }
+        callers.clear();
+        auto stats = concurrent.stats();
+        assert(stats.requests == 200);
+        assert(stats.retries == static_cast<std::uint64_t>(concurrent.provider().calls->load()) - 200);
+    }
+
+    println("test_retry: ALL PASSED");
+    return 0;
+}
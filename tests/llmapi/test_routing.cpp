@@ -0,0 +1,175 @@
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+struct Control {
+    std::atomic<int> delayMs { 0 };
+    std::atomic<int> ttftMs { 0 };
+    std::atomic<int> status { 0 };   // 0 = healthy, otherwise throw ApiError(status)
+    std::atomic<int> calls { 0 };
+};
+
+struct Endpoint {
+    std::string label;
+    std::shared_ptr<Control> control { std::make_shared<Control>() };
+
+    std::string_view name() const { return label; }
+
+    ChatResponse chat(const std::vector<Message>&, const ChatParams&) {
+        control->calls++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(control->delayMs.load()));
+        if (control->status != 0) {
+            throw ApiError(control->status, "api_error", "{}", label + " failed");
+        }
+        return ChatResponse {
+            .content = { TextContent { label } },
+            .stopReason = StopReason::EndOfTurn,
+        };
+    }
+
+    Task<ChatResponse> chat_async(const std::vector<Message>& msgs, const ChatParams& p) {
+        co_return chat(msgs, p);
+    }
+
+    ChatResponse chat_stream(const std::vector<Message>&, const ChatParams&,
+                             std::function<void(std::string_view)> callback) {
+        control->calls++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(control->ttftMs.load()));
+        callback(label);
+        std::this_thread::sleep_for(std::chrono::milliseconds(control->delayMs.load()));
+        return ChatResponse {
+            .content = { TextContent { label } },
+            .stopReason = StopReason::EndOfTurn,
+        };
+    }
+
+    Task<ChatResponse> chat_stream_async(const std::vector<Message>& msgs, const ChatParams& p,
+                                          std::function<void(std::string_view)> cb) {
+        co_return chat_stream(msgs, p, std::move(cb));
+    }
+};
+
+static_assert(Provider<RoutingProvider<Endpoint>>);
+static_assert(StreamableProvider<RoutingProvider<Endpoint>>);
+
+int main() {
+    std::vector<Message> messages { Message::user("hi") };
+    auto policy = RoutingPolicy {
+        .decay = std::chrono::milliseconds { 200 },
+        .initialLatency = std::chrono::milliseconds { 1 },
+        .failurePenalty = std::chrono::milliseconds { 500 },
+    };
+
+    auto fast = Endpoint { .label = "fast" };
+    auto medium = Endpoint { .label = "medium" };
+    auto slow = Endpoint { .label = "slow" };
+    auto fastControl = fast.control;
+    auto mediumControl = medium.control;
+    auto slowControl = slow.control;
+    fastControl->delayMs = 1;
+    mediumControl->delayMs = 8;
+    slowControl->delayMs = 30;
+
+    RoutingProvider router(policy, std::move(fast), std::move(medium), std::move(slow));
+
+    // Test 1: endpoints and labels
+    assert(router.size() == 3);
+    assert(router.name() == "router");
+    assert(router.endpoints()[0].name == "fast#0");
+    println("Test 1: endpoints - PASSED");
+
+    // Test 2: traffic converges on the fastest endpoint
+    for (int i = 0; i < 60; ++i) {
+        router.chat(messages, ChatParams {});
+    }
+    assert(fastControl->calls > mediumControl->calls);
+    assert(mediumControl->calls >= slowControl->calls);
+    assert(slowControl->calls < 10);
+    auto stats = router.endpoints();
+    assert(stats[0].latencyMs < stats[2].latencyMs);
+    assert(stats[0].inFlight == 0 && stats[2].inFlight == 0);
+    println("Test 2: fastest endpoint preferred - PASSED");
+
+    // Test 3: traffic shifts when the fast endpoint degrades
+    fastControl->delayMs = 60;
+    slowControl->delayMs = 1;
+    slowControl->calls = 0;
+    for (int i = 0; i < 60; ++i) {
+        router.chat(messages, ChatParams {});
+    }
+    assert(slowControl->calls > 20);
+    println("Test 3: traffic shifts to new fastest - PASSED");
+
+    // Test 4: transient failures are penalized and rethrown
+    slowControl->status = 503;
+    bool threw = false;
+    for (int i = 0; i < 20 && !threw; ++i) {
+        try {
+            router.chat(messages, ChatParams {});
+        } catch (const ApiError& e) {
+            assert(e.statusCode == 503);
+            threw = true;
+        }
+    }
+    assert(threw);
+    stats = router.endpoints();
+    assert(stats[2].failures >= 1);
+    assert(stats[2].latencyMs > stats[1].latencyMs);
+    slowControl->status = 0;
+    println("Test 4: failure penalty - PASSED");
+
+    // Test 5: streams route on TTFT and record it
+    {
+        auto a = Endpoint { .label = "a" };
+        auto b = Endpoint { .label = "b" };
+        a.control->ttftMs = 1;
+        a.control->delayMs = 20;
+        b.control->ttftMs = 15;
+        b.control->delayMs = 0;
+        RoutingProvider streams(policy, std::move(a), std::move(b));
+        int chunks { 0 };
+        for (int i = 0; i < 20; ++i) {
+            streams.chat_stream(messages, ChatParams {}, [&](std::string_view) { chunks++; });
+        }
+        assert(chunks == 20);
+        auto s = streams.endpoints();
+        assert(s[0].requests > s[1].requests);
+        assert(s[0].ttftMs > 0 && s[0].ttftMs < s[1].ttftMs);
+    }
+    println("Test 5: streaming routes on TTFT - PASSED");
+
+    // Test 6: concurrent callers spread over endpoints by in-flight count
+    {
+        auto a = Endpoint { .label = "a" };
+        auto b = Endpoint { .label = "b" };
+        a.control->delayMs = 10;
+        b.control->delayMs = 10;
+        auto aControl = a.control;
+        auto bControl = b.control;
+        RoutingProvider shared(policy, std::move(a), std::move(b));
+        {
+            std::vector<std::jthread> threads;
+            for (int t = 0; t < 4; ++t) {
+                threads.emplace_back([&] {
+                    for (int i = 0; i < 10; ++i) shared.chat(messages, ChatParams {});
+                });
+            }
+        }
+        assert(aControl->calls + bControl->calls == 40);
+        assert(aControl->calls >= 8 && bControl->calls >= 8);
+        for (const auto& s : shared.endpoints()) assert(s.inFlight == 0);
+    }
+    println("Test 6: concurrent load balancing - PASSED");
+
+    // Test 7: async
+    auto task = router.chat_async(messages, ChatParams {});
+    assert(!task.get().text().empty());
+    println("Test 7: async - PASSED");
+
+    println("test_routing: ALL PASSED");
+    return 0;
+}
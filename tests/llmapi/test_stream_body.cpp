@@ -0,0 +1,189 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import mcpplibs.tinyhttps;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+
+// What the provider would have sent in one piece
+std::string dumped(const Json& value) {
+    return value.dump(-1, ' ', false, Json::error_handler_t::replace);
+}
+
+std::string written(const Json& value, std::size_t limit, int* drains = nullptr) {
+    std::string out;
+    BodySink sink { limit, [&](std::string_view chunk) {
+        assert(chunk.size() <= limit);
+        out.append(chunk);
+        if (drains) ++*drains;
+    } };
+    write_json(sink, value);
+    sink.flush();
+    assert(sink.bytes() == out.size());
+    return out;
+}
+
+Message screenshot_turn(const std::string& data) {
+    return Message {
+        .role = Role::User,
+        .content = std::vector<ContentPart> {
+            ImageContent { .data = data, .mediaType = "image/png" },
+            TextContent { "what is on screen?" },
+        },
+    };
+}
+
+mock::Response openai_handler(const mock::Request& request) {
+    if (Json::parse(request.body).value("stream", false)) {
+        return mock::Response {
+            .headers = { { "Content-Type", "text/event-stream" } },
+            .chunks = {
+                R"(data: {"choices":[{"index":0,"delta":{"content":"a terminal"},"finish_reason":"stop"}]})" "\n\n",
+                "data: [DONE]\n\n",
+            },
+        };
+    }
+    return mock::Response { .body = R"({"id":"c1","model":"gpt-4o","choices":[{"index":0,"message":{"role":"assistant","content":"a terminal"},"finish_reason":"stop"}],"usage":{"prompt_tokens":10,"completion_tokens":2}})" };
+}
+
+mock::Response anthropic_handler(const mock::Request&) {
+    return mock::Response { .body = R"({"id":"msg_1","type":"message","role":"assistant","model":"claude","content":[{"type":"text","text":"a terminal"}],"stop_reason":"end_turn","usage":{"input_tokens":10,"output_tokens":2}})" };
+}
+
+int main() {
+    // ~5 MiB of base64-looking data: above the default streamBodyAbove
+    std::string image;
+    image.reserve(5 * 1024 * 1024);
+    while (image.size() < 5 * 1024 * 1024) image += "iVBORw0KGgoAAAANSUhEUgAAA+/=";
+
+    // Test 1: write_json matches dump() byte for byte, in bounded chunks
+    {
+        std::string text;
+        while (text.size() < 300 * 1024) text += "line \"quoted\"\n\ttab \xC3\xA9t\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 \\ \x01";
+        Json value {
+            {"model", "m"},
+            {"messages", Json::array({
+                Json{{"role", "user"}, {"content", text}},
+                Json{{"role", "user"}, {"content", Json::array({1, 2.5, true, nullptr, "x"})}},
+            })},
+            {"empty", Json::object()},
+            {"none", Json::array()},
+        };
+        int drains = 0;
+        assert(written(value, 4096, &drains) == dumped(value));
+        assert(drains > 64);
+        assert(written(value, 1) == dumped(value));
+        assert(written(Json("short"), 64) == "\"short\"");
+        assert(json_size_hint(value) >= text.size());
+        assert(json_size_hint(Json::object()) == 0);
+    }
+    println("Test 1: write_json - PASSED");
+
+    // Test 2: a large chat body goes out chunked and arrives intact
+    {
+        mock::Server server(openai_handler);
+        auto messages = std::vector<Message> { screenshot_turn(image) };
+        std::string expected;
+        {
+            openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+            expected = provider.payload(messages, {});
+            auto response = provider.chat(messages, {});
+            assert(response.text() == "a terminal");
+        }
+        auto request = server.requests().back();
+        assert(request.header("transfer-encoding") == "chunked");
+        assert(request.header("content-length").empty());
+        assert(request.bodyChunks >= 5 * 1024 / 64);
+        assert(request.body == expected);
+    }
+    println("Test 2: chunked chat body - PASSED");
+
+    // Test 3: small bodies keep Content-Length; the threshold is configurable
+    {
+        mock::Server server(openai_handler);
+        {
+            openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+            provider.chat({ Message::user("hi") }, {});
+        }
+        {
+            openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o",
+                                      .streamBodyAbove = 0 });
+            provider.chat({ Message::user("hi") }, {});
+        }
+        auto requests = server.requests();
+        assert(requests.size() == 2);
+        assert(requests[0].header("transfer-encoding").empty());
+        assert(requests[0].header("content-length") == std::to_string(requests[0].body.size()));
+        assert(requests[1].header("transfer-encoding") == "chunked");
+        assert(requests[1].body == requests[0].body);
+    }
+    println("Test 3: threshold - PASSED");
+
+    // Test 4: streamed responses to streamed requests
+    {
+        mock::Server server(openai_handler);
+        std::string received;
+        {
+            openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+            auto response = provider.chat_stream({ screenshot_turn(image) }, {},
+                                                 [&](std::string_view delta) { received += delta; });
+            assert(response.text() == "a terminal");
+        }
+        assert(received == "a terminal");
+        auto request = server.requests().back();
+        assert(request.header("transfer-encoding") == "chunked");
+        assert(Json::parse(request.body)["stream"] == true);
+    }
+    println("Test 4: streaming chat - PASSED");
+
+    // Test 5: Anthropic, over a kept-alive connection
+    {
+        mock::Server server(anthropic_handler);
+        auto messages = std::vector<Message> { screenshot_turn(image) };
+        std::string expected;
+        {
+            anthropic::Anthropic provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "claude" });
+            expected = provider.payload(messages, {});
+            auto before = server.connections();
+            assert(provider.chat(messages, {}).text() == "a terminal");
+            assert(provider.chat(messages, {}).text() == "a terminal");
+            assert(server.connections() == before + 1);
+        }
+        auto requests = server.requests();
+        assert(requests.size() == 2);
+        for (const auto& request : requests) {
+            assert(request.header("transfer-encoding") == "chunked");
+            assert(request.body == expected);
+        }
+    }
+    println("Test 5: anthropic - PASSED");
+
+    // Test 6: an idle connection the server dropped is noticed before the
+    // request is sent, so the body is written once, on a new connection
+    {
+        mock::Server dropping([](const mock::Request&) { return mock::Response { .body = "{}", .dropAfter = true }; });
+        Http1Client client(dropping.url(), tinyhttps::HttpClientConfig { .keepAlive = true });
+        tinyhttps::HttpRequest request { .method = tinyhttps::Method::POST, .url = dropping.url("/v1/upload") };
+        int writes = 0;
+        BodyWriter body = [&](BodySink& sink) {
+            writes++;
+            sink.write("payload");
+        };
+        assert(client.send(request, body).ok());
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));   // let the close arrive
+        writes = 0;
+        assert(client.send(request, body).ok());
+        assert(writes == 1);
+        assert(dropping.connections() == 2);
+    }
+    println("Test 6: dropped idle connection - PASSED");
+
+    println("test_stream_body: ALL PASSED");
+    return 0;
+}
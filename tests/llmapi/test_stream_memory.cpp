@@ -0,0 +1,146 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+
+std::string long_text() {
+    std::string text;
+    while (text.size() < 64 * 1024) text += "streamed text that nobody keeps. ";
+    return text;
+}
+
+mock::Response openai_handler(const mock::Request&) {
+    std::vector<std::string> chunks;
+    auto text = long_text();
+    for (std::size_t pos = 0; pos < text.size(); pos += 1024) {
+        chunks.push_back(R"(data: {"choices":[{"index":0,"delta":{"content":")" + text.substr(pos, 1024) + "\"}}]}\n\n");
+    }
+    chunks.push_back(R"(data: {"choices":[{"index":0,"delta":{},"finish_reason":"stop"}],"usage":{"prompt_tokens":4,"completion_tokens":900}})" "\n\n");
+    chunks.push_back("data: [DONE]\n\n");
+    return mock::Response { .headers = { { "Content-Type", "text/event-stream" } }, .chunks = chunks };
+}
+
+mock::Response anthropic_handler(const mock::Request&) {
+    return mock::Response {
+        .headers = { { "Content-Type", "text/event-stream" } },
+        .chunks = {
+            "event: message_start\ndata: {\"type\":\"message_start\",\"message\":{\"id\":\"msg_1\",\"model\":\"claude\",\"usage\":{\"input_tokens\":5}}}\n\n",
+            "event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":{\"type\":\"text_delta\",\"text\":\"calling \"}}\n\n",
+            "event: content_block_start\ndata: {\"type\":\"content_block_start\",\"index\":1,\"content_block\":{\"type\":\"tool_use\",\"id\":\"tu_1\",\"name\":\"lookup\"}}\n\n",
+            "event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":1,\"delta\":{\"type\":\"input_json_delta\",\"partial_json\":\"{\\\"q\\\":\"}}\n\n",
+            "event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":1,\"delta\":{\"type\":\"input_json_delta\",\"partial_json\":\"\\\"x\\\"}\"}}\n\n",
+            "event: message_delta\ndata: {\"type\":\"message_delta\",\"delta\":{\"stop_reason\":\"tool_use\"},\"usage\":{\"output_tokens\":7}}\n\n",
+            "event: message_stop\ndata: {\"type\":\"message_stop\"}\n\n",
+        },
+    };
+}
+
+int main() {
+    // Test 1: receive buffers are recycled; oversized ones are not pooled
+    {
+        ReadBufferPool pool(2);
+        auto a = pool.acquire();
+        assert(a.capacity() >= ReadBufferPool::BLOCK_BYTES);
+        a = "leftover";
+        pool.release(std::move(a));
+        auto b = pool.acquire();
+        assert(b.empty());
+        assert(pool.stats().reused == 1);
+
+        auto big = pool.acquire();
+        big.resize(4 * ReadBufferPool::BLOCK_BYTES);
+        pool.release(std::move(big));
+        pool.release(std::move(b));
+        auto stats = pool.stats();
+        assert(stats.allocated == 2);
+        assert(stats.dropped == 1);
+        assert(stats.leased == 0);
+        assert(stats.pooled == 1);
+    }
+    println("Test 1: read buffer pool - PASSED");
+
+    // Test 2: per-stream accounting
+    {
+        StreamMemory memory;
+        {
+            StreamMemory::Account first(memory);
+            StreamMemory::Account second(memory);
+            first.charge(100);
+            second.charge(30);
+            first.charge(50);
+            auto stats = memory.stats();
+            assert(stats.activeStreams == 2);
+            assert(stats.liveBytes == 180);
+            assert(stats.peakStreamBytes == 150);
+        }
+        auto stats = memory.stats();
+        assert(stats.activeStreams == 0);
+        assert(stats.liveBytes == 0);
+        assert(stats.peakStreamBytes == 150);
+        assert(stats.streams == 2);
+    }
+    println("Test 2: stream accounting - PASSED");
+
+    // Test 3: without accumulation the callback is the only consumer
+    {
+        mock::Server server(openai_handler);
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+        auto before = StreamMemory::shared().stats();
+
+        std::size_t received = 0;
+        auto response = provider.chat_stream({ Message::user("hi") }, { .accumulateStream = false },
+                                             [&](std::string_view delta) { received += delta.size(); });
+        assert(received == long_text().size());
+        assert(response.text().empty());
+        assert(response.usage.outputTokens == 900);
+        assert(response.stopReason == StopReason::EndOfTurn);
+        auto lean = StreamMemory::shared().stats();
+        assert(lean.streams == before.streams + 1);
+        assert(lean.activeStreams == 0);
+        assert(lean.peakStreamBytes < long_text().size());
+
+        auto full = provider.chat_stream({ Message::user("hi") }, {}, [](std::string_view) {});
+        assert(full.text() == long_text());
+        assert(StreamMemory::shared().stats().peakStreamBytes >= long_text().size());
+    }
+    println("Test 3: openai no-accumulation mode - PASSED");
+
+    // Test 4: tool calls survive no-accumulation mode
+    {
+        mock::Server server(anthropic_handler);
+        anthropic::Anthropic provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "claude" });
+        std::string streamed;
+        auto response = provider.chat_stream({ Message::user("hi") }, { .accumulateStream = false },
+                                             [&](std::string_view delta) { streamed += delta; });
+        assert(streamed == "calling ");
+        assert(response.text().empty());
+        auto calls = response.tool_calls();
+        assert(calls.size() == 1);
+        assert(calls[0].arguments == R"({"q":"x"})");
+        assert(response.usage.outputTokens == 7);
+    }
+    println("Test 4: anthropic no-accumulation mode - PASSED");
+
+    // Test 5: idle connections give their receive buffer back
+    {
+        mock::Server server(openai_handler);
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" });
+        auto before = ReadBufferPool::shared().stats();
+        for (int i = 0; i < 5; ++i) {
+            provider.chat_stream({ Message::user("hi") }, { .accumulateStream = false }, [](std::string_view) {});
+        }
+        auto after = ReadBufferPool::shared().stats();
+        assert(after.leased == 0);
+        assert(after.allocated <= before.allocated + 1);
+        assert(after.reused >= before.reused + 4);
+    }
+    println("Test 5: buffer reuse across requests - PASSED");
+
+    println("test_stream_memory: ALL PASSED");
+    return 0;
+}
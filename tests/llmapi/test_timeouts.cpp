@@ -0,0 +1,128 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using namespace std::chrono_literals;
+
+const std::string CHAT_BODY = R"({"id":"c1","model":"gpt-4o","choices":[{"index":0,"message":{"role":"assistant","content":"late"},"finish_reason":"stop"}],"usage":{"prompt_tokens":1,"completion_tokens":1}})";
+
+std::string delta(const std::string& text) {
+    return R"(data: {"choices":[{"index":0,"delta":{"content":")" + text + "\"}}]}\n\n";
+}
+
+template<typename F>
+std::optional<TimeoutError> timeout_of(F&& call) {
+    try {
+        call();
+    } catch (const TimeoutError& e) {
+        return e;
+    }
+    return std::nullopt;
+}
+
+int main() {
+    // Test 1: no response within the first-byte budget
+    {
+        mock::Server server([](const mock::Request&) {
+            std::this_thread::sleep_for(400ms);
+            return mock::Response { .body = CHAT_BODY };
+        });
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o",
+                                  .timeouts = { .firstByte = 100ms } });
+        auto start = std::chrono::steady_clock::now();
+        auto error = timeout_of([&] { provider.chat({ Message::user("hi") }, {}); });
+        assert(error && error->phase == TimeoutPhase::FirstByte);
+        assert(error->limit == 100ms);
+        assert(std::chrono::steady_clock::now() - start < 350ms);
+        assert(classify_failure(std::make_exception_ptr(*error)).retryable);
+    }
+    println("Test 1: first byte - PASSED");
+
+    // Test 2: a stream that stops sending
+    {
+        mock::Server server([](const mock::Request&) {
+            return mock::Response {
+                .headers = { { "Content-Type", "text/event-stream" } },
+                .chunks = { delta("partial"), delta("never"), "data: [DONE]\n\n" },
+                .chunkDelayMs = 400,
+            };
+        });
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o",
+                                  .timeouts = { .streamIdle = 100ms } });
+        std::string received;
+        auto error = timeout_of([&] {
+            provider.chat_stream({ Message::user("hi") }, {}, [&](std::string_view d) { received += d; });
+        });
+        assert(error && error->phase == TimeoutPhase::StreamIdle);
+        assert(received == "partial");
+    }
+    println("Test 2: stream idle - PASSED");
+
+    // Test 3: Anthropic pings keep a slow stream alive
+    {
+        mock::Server server([](const mock::Request&) {
+            std::vector<std::string> chunks {
+                "event: message_start\ndata: {\"type\":\"message_start\",\"message\":{\"id\":\"msg_1\",\"model\":\"claude\",\"usage\":{\"input_tokens\":1}}}\n\n",
+            };
+            for (int i = 0; i < 6; ++i) chunks.push_back("event: ping\ndata: {\"type\":\"ping\"}\n\n");
+            chunks.push_back("event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":{\"type\":\"text_delta\",\"text\":\"thought hard\"}}\n\n");
+            chunks.push_back("event: message_stop\ndata: {\"type\":\"message_stop\"}\n\n");
+            return mock::Response {
+                .headers = { { "Content-Type", "text/event-stream" } },
+                .chunks = chunks,
+                .chunkDelayMs = 60,
+            };
+        });
+        anthropic::Anthropic provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "claude",
+                                        .timeouts = { .streamIdle = 250ms } });
+        auto response = provider.chat_stream({ Message::user("hi") }, {}, [](std::string_view) {});
+        assert(response.text() == "thought hard");
+    }
+    println("Test 3: pings count as liveness - PASSED");
+
+    // Test 4: total deadline over a stream that never stalls
+    {
+        mock::Server server([](const mock::Request&) {
+            std::vector<std::string> chunks;
+            for (int i = 0; i < 40; ++i) chunks.push_back(delta("x"));
+            chunks.push_back("data: [DONE]\n\n");
+            return mock::Response {
+                .headers = { { "Content-Type", "text/event-stream" } },
+                .chunks = chunks,
+                .chunkDelayMs = 30,
+            };
+        });
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o",
+                                  .timeouts = { .streamIdle = 200ms, .total = 300ms } });
+        std::size_t received = 0;
+        auto error = timeout_of([&] {
+            provider.chat_stream({ Message::user("hi") }, {}, [&](std::string_view) { ++received; });
+        });
+        assert(error && error->phase == TimeoutPhase::Total);
+        assert(received > 0 && received < 40);
+    }
+    println("Test 4: total - PASSED");
+
+    // Test 5: the provider recovers on the next request
+    {
+        std::atomic<int> calls { 0 };
+        mock::Server server([&](const mock::Request&) {
+            if (calls++ == 0) std::this_thread::sleep_for(300ms);
+            return mock::Response { .body = CHAT_BODY };
+        });
+        openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o",
+                                  .timeouts = { .firstByte = 100ms } });
+        assert(timeout_of([&] { provider.chat({ Message::user("hi") }, {}); }).has_value());
+        std::this_thread::sleep_for(300ms);   // the stalled exchange drains server-side
+        assert(provider.chat({ Message::user("hi") }, {}).text() == "late");
+    }
+    println("Test 5: recovery - PASSED");
+
+    println("test_timeouts: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import mcpplibs.tinyhttps;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+namespace tinyhttps = mcpplibs::tinyhttps;
+
+// Answers from memory and remembers what it was asked: no sockets at all
+struct FakeTransport {
+    struct Sent {
+        std::string url;
+        std::string body;
+        bool streamedBody { false };
+    };
+
+    std::shared_ptr<std::vector<Sent>> sent { std::make_shared<std::vector<Sent>>() };
+    std::string reply;
+    std::string events;   // SSE stream for send_stream
+
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request) {
+        sent->push_back({ request.url, request.body });
+        return ok_(reply);
+    }
+
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& request, const BodyWriter& body) {
+        sent->push_back({ request.url, collect_(body), true });
+        return ok_(reply);
+    }
+
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, SseCallback callback) {
+        sent->push_back({ request.url, request.body });
+        return stream_(std::move(callback));
+    }
+
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& request, const BodyWriter& body,
+                                        SseCallback callback) {
+        sent->push_back({ request.url, collect_(body), true });
+        return stream_(std::move(callback));
+    }
+
+private:
+    static tinyhttps::HttpResponse ok_(std::string body) {
+        tinyhttps::HttpResponse response;
+        response.statusCode = 200;
+        response.body = std::move(body);
+        return response;
+    }
+
+    static std::string collect_(const BodyWriter& body) {
+        std::string out;
+        BodySink sink { 1024, [&](std::string_view chunk) { out.append(chunk); } };
+        body(sink);
+        sink.flush();
+        return out;
+    }
+
+    tinyhttps::HttpResponse stream_(SseCallback callback) {
+        tinyhttps::SseParser parser;
+        for (const auto& event : parser.feed(events)) {
+            if (!callback(event)) break;
+        }
+        return ok_("");
+    }
+};
+
+static_assert(Transport<FakeTransport>);
+static_assert(Transport<HttpTransport>);
+
+// Wraps another transport and counts requests
+template<Transport T>
+struct CountingTransport {
+    T inner;
+    std::shared_ptr<int> count { std::make_shared<int>(0) };
+
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& r) { ++*count; return inner.send(r); }
+    tinyhttps::HttpResponse send(const tinyhttps::HttpRequest& r, const BodyWriter& b) { ++*count; return inner.send(r, b); }
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& r, SseCallback c) {
+        ++*count;
+        return inner.send_stream(r, std::move(c));
+    }
+    tinyhttps::HttpResponse send_stream(const tinyhttps::HttpRequest& r, const BodyWriter& b, SseCallback c) {
+        ++*count;
+        return inner.send_stream(r, b, std::move(c));
+    }
+    TransferStats stats() const { return inner.stats(); }
+};
+
+int main() {
+    // Test 1: OpenAI over an in-memory transport
+    {
+        FakeTransport fake;
+        fake.reply = R"({"id":"c1","model":"gpt-4o","choices":[{"index":0,"message":{"role":"assistant","content":"from memory"},"finish_reason":"stop"}],"usage":{"prompt_tokens":3,"completion_tokens":2}})";
+        fake.events =
+            "data: {\"choices\":[{\"index\":0,\"delta\":{\"content\":\"str\"}}]}\n\n"
+            "data: {\"choices\":[{\"index\":0,\"delta\":{\"content\":\"eamed\"},\"finish_reason\":\"stop\"}]}\n\n"
+            "data: [DONE]\n\n";
+        auto sent = fake.sent;
+        openai::OpenAI provider({ .apiKey = "k", .model = "gpt-4o" }, fake);
+
+        auto response = provider.chat({ Message::user("hi") }, {});
+        assert(response.text() == "from memory");
+        assert(response.usage.outputTokens == 2);
+
+        std::string streamed;
+        auto streamedResponse = provider.chat_stream({ Message::user("hi") }, {},
+                                                     [&](std::string_view delta) { streamed += delta; });
+        assert(streamed == "streamed");
+        assert(streamedResponse.text() == "streamed");
+
+        assert(sent->size() == 2);
+        assert((*sent)[0].url == "https://api.openai.com/v1/chat/completions");
+        assert(Json::parse((*sent)[0].body)["model"] == "gpt-4o");
+        assert(Json::parse((*sent)[1].body)["stream"] == true);
+        assert(provider.transfer_stats().responses == 0);
+    }
+    println("Test 1: openai over a fake transport - PASSED");
+
+    // Test 2: large bodies reach a custom transport as a BodyWriter
+    {
+        FakeTransport fake;
+        fake.reply = R"({"id":"msg_1","type":"message","role":"assistant","model":"claude","content":[{"type":"text","text":"ok"}],"stop_reason":"end_turn","usage":{"input_tokens":1,"output_tokens":1}})";
+        auto sent = fake.sent;
+        anthropic::Anthropic provider({ .apiKey = "k", .model = "claude", .streamBodyAbove = 16 }, fake);
+        std::vector<Message> messages { Message::user("a message longer than sixteen bytes") };
+        assert(provider.chat(messages, {}).text() == "ok");
+        assert(sent->back().streamedBody);
+        assert(sent->back().body == provider.payload(messages, {}));
+    }
+    println("Test 2: streamed body through a custom transport - PASSED");
+
+    // Test 3: async chat and downloads through a transport without either
+    {
+        FakeTransport fake;
+        fake.reply = R"({"id":"c1","model":"gpt-4o","choices":[{"index":0,"message":{"role":"assistant","content":"pong"},"finish_reason":"stop"}],"usage":{"prompt_tokens":1,"completion_tokens":1}})";
+        auto sent = fake.sent;
+        openai::OpenAI provider({ .apiKey = "k", .model = "gpt-4o" }, fake);
+        auto response = provider.chat_async({ Message::user("ping") }, {}).get();
+        assert(response.text() == "pong");
+        assert(sent->size() == 1);
+
+        AnyTransport transport(FakeTransport { .reply = "file body" });
+        tinyhttps::HttpRequest request;
+        request.url = "memory://file";
+        std::string downloaded;
+        int pieces = 0;
+        auto head = transport.send_download(request, [&](std::string_view data) {
+            downloaded += data;
+            pieces++;
+            return true;
+        });
+        assert(head.ok());
+        assert(head.body.empty());
+        assert(downloaded == "file body" && pieces == 1);
+    }
+    println("Test 3: async - PASSED");
+
+    // Test 4: wrapping the default transport
+    {
+        mock::Server server([](const mock::Request&) {
+            return mock::Response { .body = R"({"id":"c1","model":"gpt-4o","choices":[{"index":0,"message":{"role":"assistant","content":"wrapped"},"finish_reason":"stop"}],"usage":{"prompt_tokens":1,"completion_tokens":1}})" };
+        });
+        CountingTransport<HttpTransport> counting { HttpTransport(tinyhttps::HttpClientConfig { .keepAlive = true }) };
+        auto count = counting.count;
+        {
+            openai::OpenAI provider({ .apiKey = "k", .baseUrl = server.url("/v1"), .model = "gpt-4o" },
+                                    std::move(counting));
+            assert(provider.chat({ Message::user("hi") }, {}).text() == "wrapped");
+            assert(provider.transfer_stats().responses == 1);
+        }
+        assert(*count == 1);
+        assert(server.requests().size() == 1);
+    }
+    println("Test 4: wrapped default transport - PASSED");
+
+    println("test_transport: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "mock_server.hpp"
+
+import mcpplibs.llmapi;
+import mcpplibs.llmapi.nlohmann.json;
+import mcpplibs.tinyhttps;
+import std;
+
+#include <cassert>
+#include "../test_print.hpp"
+
+using namespace mcpplibs::llmapi;
+using Json = nlohmann::json;
+namespace tinyhttps = mcpplibs::tinyhttps;
+
+mock::Response handler(const mock::Request& request) {
+    if (request.path == "/v1/broken") {
+        return mock::Response { .status = 500, .body = R"({"error":{"type":"server_error","message":"boom"}})" };
+    }
+    auto body = Json::parse(request.body);
+    if (body.value("stream", false)) {
+        return mock::Response {
+            .headers = { { "Content-Type", "text/event-stream" } },
+            .chunks = {
+                R"(data: {"choices":[{"index":0,"delta":{"content":"lo"}}]})" "\n\n",
+                R"(data: {"choices":[{"index":0,"delta":{"content":"cal"},"finish_reason":"stop"}]})" "\n\n",
+                "data: [DONE]\n\n",
+            },
+        };
+    }
+    return mock::Response { .body = Json{
+        {"id", "chatcmpl-local"},
+        {"model", "llama"},
+        {"choices", Json::array({Json{
+            {"index", 0},
+            {"message", Json{{"role", "assistant"}, {"content", "local"}}},
+            {"finish_reason", "stop"},
+        }})},
+        {"usage", Json{{"prompt_tokens", 3}, {"completion_tokens", 1}}},
+    }.dump() };
+}
+
+int main() {
+    // Socket inside a nested directory, reached through unix:///.../llama.sock/v1
+    auto dir = std::filesystem::temp_directory_path() / ("llmapi-unix-" + std::to_string(std::random_device {}()));
+    std::filesystem::create_directories(dir / "run");
+    auto socketPath = (dir / "run" / "llama.sock").string();
+
+    {
+        mock::Server server(handler, socketPath);
+        assert(server.url("/v1") == "unix://" + socketPath + "/v1");
+
+        // The server takes one connection at a time: the provider's kept-alive
+        // connection has to be closed before another client can get in.
+        {
+            openai::OpenAI provider({ .apiKey = "local", .baseUrl = server.url("/v1"), .model = "llama" });
+            std::vector<Message> messages { Message::user("hi") };
+
+            // Test 1: plain request over AF_UNIX
+            {
+                auto response = provider.chat(messages, {});
+                assert(response.text() == "local");
+                assert(response.usage.inputTokens == 3);
+                auto request = server.requests().back();
+                assert(request.method == "POST");
+                assert(request.path == "/v1/chat/completions");
+                assert(request.header("host") == "localhost");
+                assert(request.header("authorization") == "Bearer local");
+                assert(Json::parse(request.body)["model"] == "llama");
+            }
+            println("Test 1: chat over unix socket - PASSED");
+
+            // Test 2: chunked SSE stream
+            {
+                std::string streamed;
+                auto response = provider.chat_stream(messages, {}, [&](std::string_view t) { streamed += t; });
+                assert(streamed == "local");
+                assert(response.text() == "local");
+            }
+            println("Test 2: streaming over unix socket - PASSED");
+
+            // Test 3: the connection is kept alive across requests (a stream
+            // that stops at [DONE] gives up its connection)
+            {
+                auto before = server.connections();
+                for (int i = 0; i < 5; ++i) {
+                    provider.chat(messages, {});
+                }
+                assert(server.connections() == before + 1);
+                assert(server.requests().size() == 7);
+            }
+            println("Test 3: keep-alive - PASSED");
+        }
+
+        // Test 4: error responses carry their body, streamed or not
+        {
+            Http1Client client(server.url());
+            auto response = client.send(tinyhttps::HttpRequest {
+                .method = tinyhttps::Method::POST, .url = server.url("/v1/broken"), .body = "{}" });
+            assert(response.statusCode == 500);
+            assert(response.body.find("boom") != std::string::npos);
+
+            int events = 0;
+            auto streamed = client.send_stream(
+                tinyhttps::HttpRequest { .method = tinyhttps::Method::POST, .url = server.url("/v1/broken"), .body = "{}" },
+                [&](const tinyhttps::SseEvent&) { return ++events > 0; });
+            assert(streamed.statusCode == 500);
+            assert(events == 0);
+            assert(streamed.body.find("boom") != std::string::npos);
+            assert(client.connected());
+        }
+        println("Test 4: error bodies - PASSED");
+    }
+
+    // Test 5: a missing socket is a connection error
+    {
+        openai::OpenAI provider({ .apiKey = "local", .baseUrl = "unix://" + socketPath + "/v1", .model = "llama" });
+        bool threw = false;
+        try {
+            provider.chat({ Message::user("hi") }, {});
+        } catch (const ConnectionError& e) {
+            threw = std::string(e.what()).find("llama.sock") != std::string::npos;
+        }
+        assert(threw);
+    }
+    println("Test 5: missing socket - PASSED");
+
+    std::filesystem::remove_all(dir);
+    println("test_unix_socket: ALL PASSED");
+    return 0;
+}
@@ -81,3 +81,181 @@ target("test_llmapi_integration")
     set_policy("build.c++.modules", true)
     add_files("test_llmapi_integration.cpp")
     add_deps("llmapi")
+
+target("test_retry")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_retry.cpp")
+    add_deps("llmapi")
+
+target("test_hedging")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_hedging.cpp")
+    add_deps("llmapi")
+
+target("test_fallback")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_fallback.cpp")
+    add_deps("llmapi")
+
+target("test_routing")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_routing.cpp")
+    add_deps("llmapi")
+
+target("test_multi_key")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_multi_key.cpp")
+    add_deps("llmapi")
+
+target("test_affinity")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_affinity.cpp")
+    add_deps("llmapi")
+
+target("test_dispatch")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_dispatch.cpp")
+    add_deps("llmapi")
+
+target("test_files")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_files.cpp")
+    add_deps("llmapi")
+
+target("test_responses")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_responses.cpp")
+    add_deps("llmapi")
+
+target("test_batch")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_batch.cpp")
+    add_deps("llmapi")
+
+target("test_anthropic_batch")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_anthropic_batch.cpp")
+    add_deps("llmapi")
+
+target("test_choices")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_choices.cpp")
+    add_deps("llmapi")
+
+target("test_logprobs")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_logprobs.cpp")
+    add_deps("llmapi")
+
+-- unix:// sockets: the mock server has no AF_UNIX support on Windows
+if not is_plat("windows") then
+    target("test_unix_socket")
+        set_kind("binary")
+        set_languages("c++23")
+        set_policy("build.c++.modules", true)
+        add_files("test_unix_socket.cpp")
+        add_deps("llmapi")
+end
+
+target("test_realtime")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_realtime.cpp")
+    add_deps("llmapi")
+
+target("test_stream_body")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_stream_body.cpp")
+    add_deps("llmapi")
+
+target("test_compression")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_compression.cpp")
+    add_deps("llmapi")
+
+target("test_native_tls")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_native_tls.cpp")
+    add_deps("llmapi")
+
+target("test_http_pool")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_http_pool.cpp")
+    add_deps("llmapi")
+
+target("test_transport")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_transport.cpp")
+    add_deps("llmapi")
+
+target("test_stream_memory")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_stream_memory.cpp")
+    add_deps("llmapi")
+
+target("test_timeouts")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_timeouts.cpp")
+    add_deps("llmapi")
+
+target("test_executor")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_executor.cpp")
+    add_deps("llmapi")
+
+target("test_combinators")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_combinators.cpp")
+    add_deps("llmapi")
+
+target("test_cancel")
+    set_kind("binary")
+    set_languages("c++23")
+    set_policy("build.c++.modules", true)
+    add_files("test_cancel.cpp")
+    add_deps("llmapi")